@@ -99,6 +99,10 @@
 #include "trackdrummapupdater.h"
 #include "songpos_toolbar.h"
 #include "sig_tempo_toolbar.h"
+#include "pluginpool.h"
+#include "recwriter.h"
+#include "clipcache.h"
+#include "decoderpool.h"
 
 namespace MusECore {
 extern void exitJackAudio();
@@ -723,8 +727,16 @@ MusE::MusE() : QMainWindow()
       actJackCpuLoad->setWhatsThis(tr("CPU load reported by JACK audio server"));
       QLabel *lbCpuLoad = new QLabel(tr("Not connected to JACK"));
       lbCpuLoad->setObjectName("JackCpuLoadToolbarLabel");
+      connect(MusEGlobal::song, SIGNAL(cpuLoadTextChanged(const QString&)), lbCpuLoad, SLOT(setText(const QString&)));
       actJackCpuLoad->setDefaultWidget(lbCpuLoad);
       jackCpuToolbar->addAction(actJackCpuLoad);
+      QWidgetAction *actRecBuffer = new QWidgetAction(this);
+      actRecBuffer->setWhatsThis(tr("Fill of the record buffers while recording, and audio lost to overruns"));
+      QLabel *lbRecBuffer = new QLabel();
+      lbRecBuffer->setObjectName("RecordBufferToolbarLabel");
+      connect(MusEGlobal::song, SIGNAL(recordBufferTextChanged(const QString&)), lbRecBuffer, SLOT(setText(const QString&)));
+      actRecBuffer->setDefaultWidget(lbRecBuffer);
+      jackCpuToolbar->addAction(actRecBuffer);
 
       requiredToolbars.push_back(tools);
       optionalToolbars.push_back(songpos_tb);
@@ -1581,6 +1593,16 @@ void MusE::closeEvent(QCloseEvent* event)
       delete MusEGlobal::audio;
       delete MusEGlobal::midiSeq;
       delete MusEGlobal::song;
+      delete MusEGlobal::pluginPool;
+      MusEGlobal::pluginPool = 0;
+      delete MusEGlobal::waveTiles;
+      MusEGlobal::waveTiles = 0;
+      delete MusEGlobal::recordWriter;
+      MusEGlobal::recordWriter = 0;
+      delete MusEGlobal::clipCache;
+      MusEGlobal::clipCache = 0;
+      delete MusEGlobal::decoderPool;
+      MusEGlobal::decoderPool = 0;
       
       if(MusEGlobal::debugMsg)
         printf("MusE: Deleting icons\n");
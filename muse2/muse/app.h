@@ -213,7 +213,6 @@ class MusE : public QMainWindow
       
       bool readMidi(FILE*);
       void read(MusECore::Xml& xml, bool doReadMidiPorts, bool isTemplate);
-      void processTrack(MusECore::MidiTrack* track);
 
       void write(MusECore::Xml& xml, bool writeTopwins) const;
       // If clear_all is false, it will not touch things like midi ports.
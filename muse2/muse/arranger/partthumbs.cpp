@@ -0,0 +1,564 @@
+//=========================================================
+//  MusE
+//  Linux Music Editor
+//
+//  partthumbs.cpp
+//
+//  This program is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU General Public License
+//  as published by the Free Software Foundation; version 2 of
+//  the License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+//
+//=========================================================
+
+#include <stdio.h>
+#include <math.h>
+#include <algorithm>
+#include <vector>
+
+#include <QMutexLocker>
+#include <QPainter>
+#include <QRect>
+#include <QRunnable>
+
+#include "partthumbs.h"
+#include "part.h"
+#include "track.h"
+#include "event.h"
+#include "midictrl.h"
+#include "gconfig.h"
+#include "globals.h"
+
+namespace MusEGui {
+
+// Memory kept for thumbnail images. When exceeded, the least
+//  recently used ones are dropped down to three quarters, but
+//  not those on screen.
+static const size_t maxThumbBytes = 64 * 1024 * 1024;
+
+//---------------------------------------------------------
+//   PartThumbStyle
+//    pt may be 0 for the events being recorded.
+//---------------------------------------------------------
+
+PartThumbStyle::PartThumbStyle(const MusECore::MidiTrack* mt, const MusECore::MidiPart* pt)
+{
+  showType  = MusEGlobal::config.canvasShowPartType;
+  showEvent = MusEGlobal::config.canvasShowPartEvent;
+  isDrum    = mt->type() == MusECore::Track::DRUM || mt->type() == MusECore::Track::NEW_DRUM;
+  height    = mt->height();
+  if(pt)
+  {
+    int part_r, part_g, part_b, brightness;
+    MusEGlobal::config.partColors[pt->colorIndex()].getRgb(&part_r, &part_g, &part_b);
+    brightness =  part_r*29 + part_g*59 + part_b*12;
+    if (brightness >= 12000 && !pt->selected()) {
+      eventColor = MusEGlobal::config.partMidiDarkEventColor.rgba();
+      colorBrightness = 54; // 96;    // too bright: use dark color
+    }
+    else {
+      eventColor = MusEGlobal::config.partMidiLightEventColor.rgba();
+      colorBrightness = 200; //160;   // too dark: use lighter color
+    }
+  }
+  else {
+    eventColor = QColor(80,80,80).rgba();
+    colorBrightness = 80;
+  }
+}
+
+bool PartThumbStyle::operator==(const PartThumbStyle& s) const
+{
+  return showType == s.showType && showEvent == s.showEvent && eventColor == s.eventColor
+     && colorBrightness == s.colorBrightness && isDrum == s.isDrum && height == s.height;
+}
+
+//---------------------------------------------------------
+//   partThumbEvents
+//    Copy of the event list, all of it since y-stretching
+//    looks at every note.
+//---------------------------------------------------------
+
+PartThumbEvents partThumbEvents(const MusECore::EventList& events)
+{
+  PartThumbEvents v;
+  v.reserve(events.size());
+  for (MusECore::ciEvent i = events.begin(); i != events.end(); ++i)
+  {
+    PartThumbEvent e;
+    e.tick = i->first;
+    e.len  = i->second.lenTick();
+    e.type = i->second.type();
+    e.a    = i->second.dataA();
+    e.b    = i->second.dataB();
+    v.append(e);
+  }
+  return v;
+}
+
+//---------------------------------------------------------
+//   partThumbEvents
+//    Copy of the events that can show in [from, to). With
+//    notes drawn as lines, that includes the notes from
+//    before which reach into it.
+//---------------------------------------------------------
+
+PartThumbEvents partThumbEvents(const MusECore::EventList& events, int from, int to,
+   const PartThumbStyle& s)
+{
+  PartThumbEvents v;
+  const bool lines = !(s.showType & 2);
+  MusECore::ciEvent ito = events.lower_bound(to);
+  for (MusECore::ciEvent i = lines ? events.begin() : events.lower_bound(from); i != ito; ++i)
+  {
+    if (i->first < from &&
+       (i->second.type() != MusECore::Note || int(i->first + i->second.lenTick()) < from))
+      continue;
+    PartThumbEvent e;
+    e.tick = i->first;
+    e.len  = i->second.lenTick();
+    e.type = i->second.type();
+    e.a    = i->second.dataA();
+    e.b    = i->second.dataB();
+    v.append(e);
+  }
+  return v;
+}
+
+//---------------------------------------------------------
+//   PartThumbPitches
+//---------------------------------------------------------
+
+PartThumbPitches::PartThumbPitches()
+{
+  for (int i = 0; i < 128; ++i)
+    used[i] = false;
+}
+
+PartThumbPitches partThumbPitches(const MusECore::EventList& events)
+{
+  PartThumbPitches pitches;
+  for (MusECore::ciEvent i = events.begin(); i != events.end(); ++i)
+    if (i->second.type() == MusECore::Note)
+      pitches.used[i->second.pitch() & 0x7f] = true;
+  return pitches;
+}
+
+PartThumbPitches partThumbPitches(const PartThumbEvents& events)
+{
+  PartThumbPitches pitches;
+  const PartThumbEvent* end = events.constData() + events.size();
+  for (const PartThumbEvent* i = events.constData(); i != end; ++i)
+    if (i->type == MusECore::Note)
+      pitches.used[i->a & 0x7f] = true;
+  return pitches;
+}
+
+//---------------------------------------------------------
+//   drawPartEvents
+//    Draws the events in [from, to) the way the arranger
+//    shows them, in ticks horizontally and pixels vertically.
+//    r is the part, pTick its position. Notes going on past
+//    to are cut at clipTick. pitches are those of the whole
+//    part, events may be part of it.
+//---------------------------------------------------------
+
+void drawPartEvents(QPainter& p, const PartThumbEvents& events, const PartThumbPitches& pitches,
+   const PartThumbStyle& s, const QRect& r, int pTick, int from, int to, int clipTick)
+{
+  const int y0 = r.y();
+  const PartThumbEvent* begin = events.constData();
+  const PartThumbEvent* end   = begin + events.size();
+  const PartThumbEvent* ifrom = begin;
+  while(ifrom != end && ifrom->tick < from)
+    ++ifrom;
+  const PartThumbEvent* ito = ifrom;
+  while(ito != end && ito->tick < to)
+    ++ito;
+
+  if (s.showType & 2) {      // show events
+            p.setPen(QColor::fromRgba(s.eventColor));
+            for (const PartThumbEvent* i = ifrom; i != ito; ++i) {
+                  int type = i->type;
+                  int a = i->a | 0xff;
+                  if (
+                    ((s.showEvent & 1) && (type == MusECore::Note))
+                    || ((s.showEvent & (2 | 4)) == (2 | 4) &&
+                         type == MusECore::Controller && a == MusECore::CTRL_POLYAFTER)
+                    || ((s.showEvent & 4) && (type == MusECore::Controller) &&
+                        (a != MusECore::CTRL_POLYAFTER  || (s.showEvent & 2)) &&
+                        (a != MusECore::CTRL_AFTERTOUCH || (s.showEvent & 16)))
+                    || ((s.showEvent & (16 | 4)) == (16 | 4) &&
+                        type == MusECore::Controller && a == MusECore::CTRL_AFTERTOUCH)
+                    || ((s.showEvent & 64) && (type == MusECore::Sysex || type == MusECore::Meta))
+                    ) {
+                        int t = i->tick + pTick;
+                        if(t >= r.left() && t <= r.right())
+                          p.drawLine(t, y0+2, t, y0+s.height-4);
+                        }
+                  }
+            return;
+      }
+
+  // show Cakewalk Style
+  using std::map;
+  using std::pair;
+
+  const int th = int(s.height * 0.75); // only draw on three quarters
+  const int hoffset = (s.height - th ) / 2; // offset from bottom
+
+  // draw controllers ------------------------------------------
+  p.setPen(QColor(192,192,s.colorBrightness/2));
+  for (const PartThumbEvent* i = begin; i != ito; ++i) { // PITCH BEND
+        if (i->type == MusECore::Controller && i->a == MusECore::CTRL_PITCH) {
+              int t = i->tick + pTick;
+              p.drawLine(t, hoffset + y0 + th/2, t, hoffset + y0 - i->b*th/8192/2 + th/2);
+              }
+        }
+
+  p.setPen(QColor(192,s.colorBrightness/2,s.colorBrightness/2));
+  for (const PartThumbEvent* i = begin; i != ito; ++i) { // PAN
+        if (i->type == MusECore::Controller && i->a == 10) {
+              int t = i->tick + pTick;
+              p.drawLine(t, hoffset + y0 + th - i->b*th/127, t, hoffset + y0 + th);
+              }
+        }
+
+  p.setPen(QColor(s.colorBrightness/2,192,s.colorBrightness/2));
+  for (const PartThumbEvent* i = begin; i != ito; ++i) { // VOLUME
+        if (i->type == MusECore::Controller && i->a == 7) {
+              int t = i->tick + pTick;
+              p.drawLine(t, hoffset + y0 + th - i->b*th/127, t, hoffset + y0 + th);
+              }
+        }
+
+  p.setPen(QColor(0,0,255));
+  for (const PartThumbEvent* i = begin; i != ito; ++i) { // PROGRAM CHANGE
+        if (i->type == MusECore::Controller && i->a == MusECore::CTRL_PROGRAM) {
+              int t = i->tick + pTick;
+              p.drawLine(t, hoffset + y0, t, hoffset + y0 + th);
+              }
+        }
+
+  // draw notes ------------------------------------------------
+
+  int lowest_pitch=127;
+  int highest_pitch=0;
+  map<int,int> y_mapper;
+
+  if (s.showType & 4) //y-stretch?
+  {
+    for (int pitch = 0; pitch < 128; ++pitch)
+    {
+      if (pitches.used[pitch])
+      {
+        if (!s.isDrum)
+        {
+          if (pitch > highest_pitch) highest_pitch=pitch;
+          if (pitch < lowest_pitch) lowest_pitch=pitch;
+        }
+        else
+        {
+          y_mapper.insert(pair<int,int>(pitch, 0));
+        }
+      }
+    }
+
+    if (s.isDrum)
+    {
+      int cnt=0;
+      for (map<int,int>::iterator it=y_mapper.begin(); it!=y_mapper.end(); it++)
+      {
+        it->second=cnt;
+        cnt++;
+      }
+      lowest_pitch=0;
+      highest_pitch=cnt-1;
+    }
+
+    if (lowest_pitch==highest_pitch)
+    {
+      lowest_pitch--;
+      highest_pitch++;
+    }
+
+    if (MusEGlobal::heavyDebugMsg)
+    {
+        if (!s.isDrum)
+            printf("DEBUG: arranger: cakewalk enabled, y-stretching from %i to %i.\n",lowest_pitch, highest_pitch);
+        else
+        {
+            printf("DEBUG: arranger: cakewalk enabled, y-stretching drums: ");;
+            for (map<int,int>::iterator it=y_mapper.begin(); it!=y_mapper.end(); it++)
+                printf("%i ", it->first);
+            printf("\n");
+        }
+    }
+  }
+  else
+  {
+    lowest_pitch=0;
+    highest_pitch=127;
+
+    if (s.isDrum)
+      for (int cnt=0;cnt<127;cnt++)
+        y_mapper[cnt]=cnt;
+
+    if (MusEGlobal::heavyDebugMsg) printf("DEBUG: arranger: cakewalk enabled, y-stretch disabled\n");
+  }
+
+  p.setPen(QColor::fromRgba(s.eventColor));
+  for (const PartThumbEvent* i = begin; i != ito; ++i) {
+        int t  = i->tick + pTick;
+        int te = t + i->len;
+
+        if (te < (from + pTick))
+              continue;
+
+        if (te >= (to + pTick))
+              te = clipTick;
+
+        if (i->type == MusECore::Note) {
+              int pitch = i->a;
+              int y;
+              if (!s.isDrum)
+                y = hoffset + y0 + th - (pitch-lowest_pitch)*th/(highest_pitch-lowest_pitch);
+              else
+                y = hoffset + y0 + y_mapper[pitch]*th/(highest_pitch-lowest_pitch);
+
+              p.drawLine(t, y, te, y);
+        }
+  }
+}
+
+//---------------------------------------------------------
+//   PartThumbJob
+//    Draws a whole part into an image from the copy of its
+//    events.
+//---------------------------------------------------------
+
+class PartThumbJob : public QRunnable {
+      PartThumbCache* _cache;
+      const MusECore::MidiPart* _part;
+      int _sn;
+      PartThumbCache::Params _params;
+      PartThumbEvents _events;
+
+   public:
+      PartThumbJob(PartThumbCache* cache, const MusECore::MidiPart* part, int sn,
+         const PartThumbCache::Params& params, const PartThumbEvents& events)
+         : _cache(cache), _part(part), _sn(sn), _params(params), _events(events) {}
+      virtual void run();
+      };
+
+void PartThumbJob::run()
+{
+  // Zooming asks for a new size on every step, skip the ones
+  //  that have been overtaken before they got started.
+  if(!_cache->wanted(_part, _sn, _params))
+    return;
+
+  QImage img(_params.width, _params.style.height, QImage::Format_ARGB32_Premultiplied);
+  img.fill(0);
+  {
+    QPainter p(&img);
+    const double tpp = double(_params.len) / _params.width;   // ticks per pixel
+    p.scale(1.0 / tpp, 1.0);
+    drawPartEvents(p, _events, partThumbPitches(_events), _params.style,
+       QRect(0, 0, _params.len, _params.style.height), 0, 0, _params.len,
+       lrint(double(_params.width - 1) * tpp));
+  }
+  _cache->store(_part, _sn, _params, img);
+}
+
+//---------------------------------------------------------
+//   PartThumbCache
+//---------------------------------------------------------
+
+PartThumbCache::PartThumbCache()
+   : QObject(0)
+{
+  _useCounter = 0;
+  _paintGen = 0;
+  _bytes = 0;
+}
+
+PartThumbCache::~PartThumbCache()
+{
+  _threads.clear();
+  _threads.waitForDone();
+}
+
+//---------------------------------------------------------
+//   thumbnail
+//    Sets image to the picture of the part and returns
+//    true if there is one. exact is false if it was made
+//    for another zoom, height or state of the events, it
+//    then needs to be stretched to the part and a new one
+//    is on its way, thumbReady() is emitted when it is done.
+//    Gui thread only.
+//---------------------------------------------------------
+
+bool PartThumbCache::thumbnail(const MusECore::MidiPart* part, int width, const PartThumbStyle& style,
+   QImage* image, bool* exact)
+{
+  const Params want(part->eventsRevision(), part->lenTick(), width, style);
+
+  QMutexLocker locker(&_lock);
+  std::map<const MusECore::MidiPart*, Entry>::iterator i = _parts.find(part);
+  if(i == _parts.end())
+    i = _parts.insert(std::make_pair(part, Entry(want))).first;
+  Entry& e = i->second;
+  if(e.sn != part->sn())
+  {
+    // New, or a new part where a deleted one was.
+    if(e.hasImage)
+      _bytes -= e.image.bytesPerLine() * e.image.height();
+    e = Entry(want);
+    e.sn = part->sn();
+    e.revision = want.revision;
+    e.events = partThumbEvents(part->events());
+  }
+  else if(e.revision != want.revision)
+  {
+    e.revision = want.revision;
+    e.events = partThumbEvents(part->events());
+  }
+  e.lastUse = ++_useCounter;
+  e.paintUse = _paintGen;
+
+  if(e.hasImage && e.imageParams == want)
+  {
+    *image = e.image;
+    *exact = true;
+    return true;
+  }
+  if(!e.scheduled || !(e.wanted == want))
+  {
+    e.wanted = want;
+    e.scheduled = true;
+    _threads.start(new PartThumbJob(this, part, e.sn, want, e.events));
+  }
+  if(!e.hasImage)
+    return false;
+  *image = e.image;
+  *exact = false;
+  return true;
+}
+
+//---------------------------------------------------------
+//   pitches
+//    Of the whole part, for drawing a part of it directly.
+//    Kept per events revision. Gui thread only.
+//---------------------------------------------------------
+
+const PartThumbPitches& PartThumbCache::pitches(const MusECore::MidiPart* part)
+{
+  PitchEntry& e = _pitches[part];
+  if(e.sn != part->sn() || e.revision != part->eventsRevision())
+  {
+    e.sn = part->sn();
+    e.revision = part->eventsRevision();
+    e.pitches = partThumbPitches(part->events());
+  }
+  return e.pitches;
+}
+
+//---------------------------------------------------------
+//   beginPaint
+//    The parts asked for from now on are on screen.
+//---------------------------------------------------------
+
+void PartThumbCache::beginPaint()
+{
+  QMutexLocker locker(&_lock);
+  ++_paintGen;
+}
+
+//---------------------------------------------------------
+//   wanted
+//    Whether a job's result would still be used.
+//    Called from the worker threads.
+//---------------------------------------------------------
+
+bool PartThumbCache::wanted(const MusECore::MidiPart* part, int sn, const Params& params)
+{
+  QMutexLocker locker(&_lock);
+  std::map<const MusECore::MidiPart*, Entry>::const_iterator i = _parts.find(part);
+  return i != _parts.end() && i->second.sn == sn && i->second.wanted == params;
+}
+
+//---------------------------------------------------------
+//   store
+//    Called from the worker threads.
+//---------------------------------------------------------
+
+void PartThumbCache::store(const MusECore::MidiPart* part, int sn, const Params& params, const QImage& image)
+{
+  {
+    QMutexLocker locker(&_lock);
+    // Dropped, or something newer asked for in the meantime?
+    std::map<const MusECore::MidiPart*, Entry>::iterator i = _parts.find(part);
+    if(i == _parts.end() || i->second.sn != sn || !(i->second.wanted == params))
+      return;
+    Entry& e = i->second;
+    if(e.hasImage)
+      _bytes -= e.image.bytesPerLine() * e.image.height();
+    e.image       = image;
+    e.imageParams = params;
+    e.hasImage    = true;
+    e.scheduled   = false;
+    _bytes += image.bytesPerLine() * image.height();
+    if(_bytes > maxThumbBytes)
+      evict();
+  }
+  emit thumbReady();
+}
+
+//---------------------------------------------------------
+//   evict
+//    Must be called with _lock held. Entries are only
+//    dropped as a whole, so a deleted part's entry goes
+//    away with its image. Those of the last paint stay,
+//    even above the cap: dropping them would only have
+//    them drawn again, dropping others in turn.
+//---------------------------------------------------------
+
+void PartThumbCache::evict()
+{
+  typedef std::map<const MusECore::MidiPart*, Entry> EntryMap;
+  std::vector<std::pair<unsigned, const MusECore::MidiPart*> > used;
+  for(EntryMap::const_iterator i = _parts.begin(); i != _parts.end(); ++i)
+    if(i->second.hasImage && i->second.paintUse != _paintGen)
+      used.push_back(std::make_pair(i->second.lastUse, i->first));
+  std::sort(used.begin(), used.end());
+  for(size_t n = 0; n < used.size() && _bytes > maxThumbBytes / 4 * 3; ++n)
+  {
+    EntryMap::iterator i = _parts.find(used[n].second);
+    _bytes -= i->second.image.bytesPerLine() * i->second.image.height();
+    _parts.erase(i);
+  }
+}
+
+//---------------------------------------------------------
+//   clear
+//---------------------------------------------------------
+
+void PartThumbCache::clear()
+{
+  QMutexLocker locker(&_lock);
+  _parts.clear();
+  _pitches.clear();
+  _bytes = 0;
+}
+
+} // namespace MusEGui
@@ -0,0 +1,178 @@
+//=========================================================
+//  MusE
+//  Linux Music Editor
+//
+//  partthumbs.h
+//
+//  This program is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU General Public License
+//  as published by the Free Software Foundation; version 2 of
+//  the License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+//
+//=========================================================
+
+#ifndef __PARTTHUMBS_H__
+#define __PARTTHUMBS_H__
+
+#include <map>
+
+#include <QObject>
+#include <QMutex>
+#include <QThreadPool>
+#include <QImage>
+#include <QVector>
+
+class QPainter;
+class QRect;
+
+namespace MusECore {
+class EventList;
+class MidiPart;
+class MidiTrack;
+}
+
+namespace MusEGui {
+
+//---------------------------------------------------------
+//   PartThumbEvent
+//    What the arranger draws of an event.
+//---------------------------------------------------------
+
+struct PartThumbEvent {
+      int tick;
+      int len;
+      int type;
+      int a;
+      int b;
+      };
+
+typedef QVector<PartThumbEvent> PartThumbEvents;
+
+//---------------------------------------------------------
+//   PartThumbPitches
+//    The note pitches of a whole part, for y-stretching.
+//---------------------------------------------------------
+
+struct PartThumbPitches {
+      bool used[128];
+      PartThumbPitches();
+      };
+
+//---------------------------------------------------------
+//   PartThumbStyle
+//    Everything besides the events the drawing depends on.
+//---------------------------------------------------------
+
+struct PartThumbStyle {
+      int showType;        // config.canvasShowPartType
+      int showEvent;       // config.canvasShowPartEvent
+      QRgb eventColor;
+      int colorBrightness;
+      bool isDrum;
+      int height;          // track height
+
+      PartThumbStyle(const MusECore::MidiTrack*, const MusECore::MidiPart*);
+      bool operator==(const PartThumbStyle&) const;
+      bool operator!=(const PartThumbStyle& s) const { return !(*this == s); }
+      };
+
+extern PartThumbEvents partThumbEvents(const MusECore::EventList&);
+extern PartThumbEvents partThumbEvents(const MusECore::EventList&, int from, int to,
+   const PartThumbStyle&);
+extern PartThumbPitches partThumbPitches(const MusECore::EventList&);
+extern PartThumbPitches partThumbPitches(const PartThumbEvents&);
+extern void drawPartEvents(QPainter&, const PartThumbEvents&, const PartThumbPitches&,
+   const PartThumbStyle&, const QRect& r, int pTick, int from, int to, int clipTick);
+
+//---------------------------------------------------------
+//   PartThumbCache
+//    Images of whole midi parts at the current zoom, drawn
+//    by worker threads from a copy of the events taken once
+//    per events revision. Until the image for a new zoom or
+//    height is done, the last one is shown stretched.
+//    Images asked for by the last paint are not dropped to
+//    keep within the memory cap, they are on screen.
+//---------------------------------------------------------
+
+class PartThumbCache : public QObject {
+      Q_OBJECT
+
+   public:
+      enum { MaxWidth = 8192 };
+
+   private:
+      struct Params {
+            unsigned revision;
+            int len;
+            int width;
+            PartThumbStyle style;
+            Params(unsigned r, int l, int w, const PartThumbStyle& s)
+               : revision(r), len(l), width(w), style(s) {}
+            bool operator==(const Params& p) const {
+                  return revision == p.revision && len == p.len && width == p.width && style == p.style;
+                  }
+            };
+
+      struct Entry {
+            int sn;
+            unsigned revision;         // of events
+            PartThumbEvents events;
+            QImage image;
+            Params imageParams;
+            Params wanted;
+            bool hasImage;
+            bool scheduled;            // a job for wanted is running
+            unsigned lastUse;
+            unsigned paintUse;         // paint generation of the last use
+            Entry(const Params& p)
+               : sn(-1), revision(0), imageParams(p), wanted(p),
+                 hasImage(false), scheduled(false), lastUse(0), paintUse(0) {}
+            };
+
+      struct PitchEntry {
+            int sn;
+            unsigned revision;
+            PartThumbPitches pitches;
+            PitchEntry() : sn(-1), revision(0) {}
+            };
+
+      QThreadPool _threads;
+      QMutex _lock;                       // guards _parts
+      std::map<const MusECore::MidiPart*, Entry> _parts;
+      unsigned _useCounter;
+      unsigned _paintGen;
+      size_t _bytes;
+      std::map<const MusECore::MidiPart*, PitchEntry> _pitches;   // gui thread
+
+      bool wanted(const MusECore::MidiPart*, int sn, const Params&);
+      void store(const MusECore::MidiPart*, int sn, const Params&, const QImage&);
+      void evict();
+
+      friend class PartThumbJob;
+
+   signals:
+      void thumbReady();
+
+   public:
+      PartThumbCache();
+      virtual ~PartThumbCache();
+
+      bool thumbnail(const MusECore::MidiPart*, int width, const PartThumbStyle&,
+         QImage* image, bool* exact);
+      const PartThumbPitches& pitches(const MusECore::MidiPart*);
+      void beginPaint();
+      void clear();
+      };
+
+} // namespace MusEGui
+
+#endif
@@ -29,6 +29,7 @@
 #include <uuid/uuid.h>
 #include <math.h>
 #include <map>
+#include <algorithm>
 #include <assert.h>
 
 #include <QClipboard>
@@ -52,6 +53,8 @@
 #include "icons.h"
 #include "event.h"
 #include "wave.h"
+#include "wavetiles.h"
+#include "partthumbs.h"
 #include "audio.h"
 #include "shortcuts.h"
 #include "gconfig.h"
@@ -121,10 +124,15 @@ PartCanvas::PartCanvas(int* r, QWidget* parent, int sx, int sy)
       automation.controllerState = doNothing;
       automation.moveController = false;
       partsChanged();
+      if (MusEGlobal::waveTiles)
+            connect(MusEGlobal::waveTiles, SIGNAL(tileReady()), SLOT(redraw()));
+      _thumbs = new PartThumbCache();
+      connect(_thumbs, SIGNAL(thumbReady()), SLOT(redraw()));
       }
 
 PartCanvas::~PartCanvas()
 {
+  delete _thumbs;
 }
 
 //---------------------------------------------------------
@@ -420,6 +428,7 @@ void PartCanvas::songIsClearing()
 {
   curItem=NULL;
   items.clearDelete();
+  _thumbs->clear();
 }
 
 //---------------------------------------------------------
@@ -1859,241 +1868,72 @@ void PartCanvas::drawMoving(QPainter& p, const CItem* item, const QRect&)
 //   drawMidiPart
 //    bb - bounding box of paint area
 //    pr - part rectangle
+//    Parts are drawn from images made by PartThumbCache,
+//    only when zoomed in too far for those the events are
+//    drawn directly.
 //---------------------------------------------------------
 
 void PartCanvas::drawMidiPart(QPainter& p, const QRect& rect, MusECore::MidiPart* midipart, const QRect& r, int from, int to)
 {
-	drawMidiPart(p, rect, midipart->events(), midipart->track(), midipart, r, midipart->tick(), from, to);
+      // Do not allow this, causes segfault.
+      if(from > to)
+            return;
+      const QRect pr = map(r);
+      if(pr.width() <= 0 || pr.width() > PartThumbCache::MaxWidth) {
+            drawMidiPart(p, rect, midipart->events(), midipart->track(), midipart, r, midipart->tick(), from, to);
+            return;
+            }
+      const PartThumbStyle style(midipart->track(), midipart);
+      QImage image;
+      bool exact;
+      if(!_thumbs->thumbnail(midipart, pr.width(), style, &image, &exact))
+            return;      // redrawn when it is ready
+      p.save();
+      p.setWorldMatrixEnabled(false);
+      if(exact)
+            p.drawImage(pr.topLeft(), image);
+      else
+            p.drawImage(QRect(pr.x(), pr.y(), pr.width(), style.height), image);
+      p.restore();
 }
 
 void PartCanvas::drawMidiPart(QPainter& p, const QRect&, const MusECore::EventList& events, MusECore::MidiTrack *mt, MusECore::MidiPart *pt, const QRect& r, int pTick, int from, int to)
 {
-  int color_brightness;
-  QColor eventColor;
-  
-  if(pt) 
-  {
-    int part_r, part_g, part_b, brightness;
-    MusEGlobal::config.partColors[pt->colorIndex()].getRgb(&part_r, &part_g, &part_b);
-    brightness =  part_r*29 + part_g*59 + part_b*12;
-    if (brightness >= 12000 && !pt->selected()) {
-      eventColor=MusEGlobal::config.partMidiDarkEventColor;
-      color_brightness=54; // 96;    // too bright: use dark color
-    }
-    else {
-      eventColor=MusEGlobal::config.partMidiLightEventColor;
-      color_brightness=200; //160;   // too dark: use lighter color
-    }
-  }
-  else {
-    eventColor=QColor(80,80,80);
-    color_brightness=80;
-  }
-    
-  if (MusEGlobal::config.canvasShowPartType & 2) {      // show events
-            p.setPen(eventColor);
-            // Do not allow this, causes segfault.
-            if(from <= to)
-            {
-              MusECore::ciEvent ito(events.lower_bound(to));
-
-              for (MusECore::ciEvent i = events.lower_bound(from); i != ito; ++i) {
-                    MusECore::EventType type = i->second.type();
-                    int a = i->second.dataA() | 0xff;
-                    if (
-                      ((MusEGlobal::config.canvasShowPartEvent & 1) && (type == MusECore::Note))
-                      || ((MusEGlobal::config.canvasShowPartEvent & (2 | 4)) == (2 | 4) &&
-                           type == MusECore::Controller && a == MusECore::CTRL_POLYAFTER)
-                      || ((MusEGlobal::config.canvasShowPartEvent & 4) && (type == MusECore::Controller) &&
-                          (a != MusECore::CTRL_POLYAFTER  || (MusEGlobal::config.canvasShowPartEvent & 2)) &&
-                          (a != MusECore::CTRL_AFTERTOUCH || (MusEGlobal::config.canvasShowPartEvent & 16)))
-                      || ((MusEGlobal::config.canvasShowPartEvent & (16 | 4)) == (16 | 4) &&
-                          type == MusECore::Controller && a == MusECore::CTRL_AFTERTOUCH)
-                      || ((MusEGlobal::config.canvasShowPartEvent & 64) && (type == MusECore::Sysex || type == MusECore::Meta))
-                      ) {
-                          int t = i->first + pTick;
-                          int th = mt->height();
-                          if(t >= r.left() && t <= r.right())
-                            p.drawLine(t, r.y()+2, t, r.y()+th-4);
-                          }
-                    }
-            }
-      }
-  else {      // show Cakewalk Style
-      using std::map;
-      using std::pair;
-      
-      MusECore::ciEvent ito(events.lower_bound(to));
-      bool isdrum = (mt->type() == MusECore::Track::DRUM  ||  mt->type() == MusECore::Track::NEW_DRUM);
-
-      // draw controllers ------------------------------------------
-      p.setPen(QColor(192,192,color_brightness/2));
-      for (MusECore::ciEvent i = events.begin(); i != ito; ++i) { // PITCH BEND
-            int t  = i->first + pTick;
-
-            MusECore::EventType type = i->second.type();
-            if (type == MusECore::Controller) {
-                  int ctrl_type=i->second.dataA();
-                  int val=i->second.dataB();
-                  
-                  int th = int(mt->height() * 0.75); // only draw on three quarters
-                  int hoffset = (mt->height() - th ) / 2; // offset from bottom
-
-                  if (ctrl_type == MusECore::CTRL_PITCH)
-                    p.drawLine(t, hoffset + r.y() + th/2, t, hoffset + r.y() - val*th/8192/2 + th/2);
-            }
-      }
-
-      p.setPen(QColor(192,color_brightness/2,color_brightness/2));
-      for (MusECore::ciEvent i = events.begin(); i != ito; ++i) { // PAN
-            int t  = i->first + pTick;
-
-            MusECore::EventType type = i->second.type();
-            if (type == MusECore::Controller) {
-                  int ctrl_type=i->second.dataA();
-                  int val=i->second.dataB();
-                  
-                  int th = int(mt->height() * 0.75); // only draw on three quarters
-                  int hoffset = (mt->height() - th ) / 2; // offset from bottom
-
-                  if (ctrl_type == 10)
-                    p.drawLine(t, hoffset + r.y() + th - val*th/127, t, hoffset + r.y() + th);
-            }
-      }
-
-      p.setPen(QColor(color_brightness/2,192,color_brightness/2));
-      for (MusECore::ciEvent i = events.begin(); i != ito; ++i) { // VOLUME
-            int t  = i->first + pTick;
-
-            MusECore::EventType type = i->second.type();
-            if (type == MusECore::Controller) {
-                  int ctrl_type=i->second.dataA();
-                  int val=i->second.dataB();
-                  
-                  int th = int(mt->height() * 0.75); // only draw on three quarters
-                  int hoffset = (mt->height() - th ) / 2; // offset from bottom
-
-                  if (ctrl_type == 7)
-                    p.drawLine(t, hoffset + r.y() + th - val*th/127, t, hoffset + r.y() + th);
-            }
-      }
-
-      p.setPen(QColor(0,0,255));
-      for (MusECore::ciEvent i = events.begin(); i != ito; ++i) { // PROGRAM CHANGE
-            int t  = i->first + pTick;
-
-            MusECore::EventType type = i->second.type();
-            if (type == MusECore::Controller) {
-                  int ctrl_type=i->second.dataA();
-                  
-                  int th = int(mt->height() * 0.75); // only draw on three quarters
-                  int hoffset = (mt->height() - th ) / 2; // offset from bottom
-
-                  if (ctrl_type == MusECore::CTRL_PROGRAM)
-                    p.drawLine(t, hoffset + r.y(), t, hoffset + r.y() + th);
-            }
-      }
-
-
-
-
-
-      // draw notes ------------------------------------------------
+  // Do not allow this, causes segfault.
+  if(from > to)
+    return;
+  const PartThumbStyle style(mt, pt);
+  // Y-stretching goes by the pitches of the whole part, not of the range drawn.
+  PartThumbPitches pitches;
+  if((style.showType & (2 | 4)) == 4)
+    pitches = pt ? _thumbs->pitches(pt) : partThumbPitches(events);
+  drawPartEvents(p, partThumbEvents(events, from, to, style), pitches, style, r, pTick, from, to,
+     lrint(rmapxDev_f(rmapx_f(to + pTick) - 1.0)));
+}
 
-      int lowest_pitch=127;
-      int highest_pitch=0;
-      map<int,int> y_mapper;
-      
-      if (MusEGlobal::config.canvasShowPartType & 4) //y-stretch?
-      {
-        for (MusECore::ciEvent i = events.begin(); i != events.end(); ++i)
-        {
-          if (i->second.type()==MusECore::Note)
-          {
-            int pitch=i->second.pitch();
+//---------------------------------------------------------
+//   drawWaveTiles
+//    Draw columns x1 to x2 of a wave event from cached
+//    tiles, x1 showing column col of the tile grid.
+//    Tiles not rendered yet are left out, the canvas is
+//    redrawn when they are ready.
+//---------------------------------------------------------
 
-            if (!isdrum)
-            {
-              if (pitch > highest_pitch) highest_pitch=pitch;
-              if (pitch < lowest_pitch) lowest_pitch=pitch;
-            }
-            else
-            {
-              y_mapper.insert(pair<int,int>(pitch, 0));
-            }
-          }
-        }
-        
-        if (isdrum)
-        {
-          int cnt=0;
-          for (map<int,int>::iterator it=y_mapper.begin(); it!=y_mapper.end(); it++)
-          {
-            it->second=cnt;
-            cnt++;
-          }
-          lowest_pitch=0;
-          highest_pitch=cnt-1;
-        }
-        
-        if (lowest_pitch==highest_pitch)
-        {
-          lowest_pitch--;
-          highest_pitch++;
-        }
-        
-        if (MusEGlobal::heavyDebugMsg)
-        {
-            if (!isdrum)
-                printf("DEBUG: arranger: cakewalk enabled, y-stretching from %i to %i.\n",lowest_pitch, highest_pitch);
-            else
-            {
-                printf("DEBUG: arranger: cakewalk enabled, y-stretching drums: ");;
-                for (map<int,int>::iterator it=y_mapper.begin(); it!=y_mapper.end(); it++)
-                    printf("%i ", it->first);
-                printf("\n"); 
-            }
-        }
-      }
-      else
+static void drawWaveTiles(QPainter& p, MusECore::SndFileR& f, int spp, int col,
+   int x1, int x2, int y, int hh)
       {
-        lowest_pitch=0;
-        highest_pitch=127;
-
-        if (isdrum)
-          for (int cnt=0;cnt<127;cnt++)
-            y_mapper[cnt]=cnt;
-        
-        if (MusEGlobal::heavyDebugMsg) printf("DEBUG: arranger: cakewalk enabled, y-stretch disabled\n");
-      }
-
-      p.setPen(eventColor);
-      for (MusECore::ciEvent i = events.begin(); i != ito; ++i) {
-            int t  = i->first + pTick;
-            int te = t + i->second.lenTick();
-
-            if (te < (from + pTick))
-                  continue;
-
-            if (te >= (to + pTick))
-                  te = lrint(rmapxDev_f(rmapx_f(to + pTick) - 1.0));
-            
-            MusECore::EventType type = i->second.type();
-            if (type == MusECore::Note) {
-                  int pitch = i->second.pitch();
-                  int th = int(mt->height() * 0.75); // only draw on three quarters
-                  int hoffset = (mt->height() - th ) / 2; // offset from bottom
-                  int y;
-                  if (!isdrum)
-                    y = hoffset + r.y() + th - (pitch-lowest_pitch)*th/(highest_pitch-lowest_pitch);
-                  else
-                    y = hoffset + r.y() + y_mapper[pitch]*th/(highest_pitch-lowest_pitch);
-                  
-                  p.drawLine(t, y, te, y);
+      const int tw = MusECore::WaveTileCache::TileWidth;
+      while (x1 < x2) {
+            const int off = col % tw;
+            const int n   = std::min(tw - off, x2 - x1);
+            QImage img;
+            if (MusEGlobal::waveTiles->tile(f, spp, col / tw, hh,
+               MusEGlobal::config.partWaveColorPeak, MusEGlobal::config.partWaveColorRms, &img))
+                  p.drawImage(QPoint(x1, y), img, QRect(off, 0, n, hh));
+            x1  += n;
+            col += n;
             }
       }
-  }
-}
 
 //---------------------------------------------------------
 //   drawWavePart
@@ -2155,6 +1995,18 @@ void PartCanvas::drawWavePart(QPainter& p,
             int ex = mapx(MusEGlobal::tempomap.frame2tick(wp->frame() + event.frame() + event.lenFrame()));
             if(ex > x2)
               ex = x2;
+
+            // Use the tile cache if every column covers the same number of
+            //  frames, that is unless the tempo changes inside the drawn range.
+            if (MusEGlobal::waveTiles && tickstep > 0 && i < ex) {
+                  const int spp = MusEGlobal::tempomap.deltaTick2frame(postick, postick + tickstep);
+                  const int span = MusEGlobal::tempomap.deltaTick2frame(postick, postick + tickstep * (ex - i));
+                  if (spp > 0 && abs(span - spp * (ex - i)) < spp) {
+                        drawWaveTiles(p, f, spp, pos / spp, i, ex, pr.y(), hh);
+                        continue;
+                        }
+                  }
+
             if (h < 20) {
                   //    combine multi channels into one waveform
                   
@@ -2801,6 +2653,9 @@ void PartCanvas::viewDropEvent(QDropEvent* event)
 
 void PartCanvas::drawCanvas(QPainter& p, const QRect& rect)
 {
+      // Drawn before the parts, which ask for their thumbnails.
+      _thumbs->beginPaint();
+
       int x = rect.x();
       int w = rect.width();
       
@@ -51,6 +51,7 @@ class Xml;
 namespace MusEGui {
 
 class MidiEditor;
+class PartThumbCache;
 
 //---------------------------------------------------------
 //   NPart
@@ -96,6 +97,7 @@ class PartCanvas : public Canvas {
       MusECore::TrackList* tracks;
 
       MusECore::Part* resizePart;
+      PartThumbCache* _thumbs;
       QLineEdit* lineEditor;
       NPart* editPart;
       int curColorIndex;
@@ -45,6 +45,8 @@
 #include "pos.h"
 #include "ticksynth.h"
 #include "operations.h"
+#include "recwriter.h"
+#include "pluginbridge.h"
 
 // Experimental for now - allow other Jack timebase masters to control our midi engine.
 // TODO: Be friendly to other apps and ask them to be kind to us by using jack_transport_reposition. 
@@ -326,6 +328,7 @@ void Audio::shutdown()
 void Audio::process(unsigned frames)
       {
       if (!MusEGlobal::checkAudioDevice()) return;
+      BridgedPlugin::startCycle();
       if (msg) {
             processMsg(msg);
             int sn = msg->serialNo;
@@ -486,6 +489,17 @@ void Audio::process(unsigned frames)
             if(MusEGlobal::extSyncFlag.value())        // p3.3.25
             {
               nextTickPos = curTickPos + MusEGlobal::midiExtSyncTicks;
+              // With the clock DLL locked, follow the estimated clock phase at the
+              //  end of this cycle instead of stepping a whole clock at a time.
+              // Fall back to counting clocks if the two disagree by much.
+              unsigned dll_tick;
+              if(MusEGlobal::midiSeq && 
+                 MusEGlobal::midiSeq->extClockTick(curTime() + double(frames) / MusEGlobal::sampleRate, &dll_tick))
+              {
+                const unsigned div2 = 2 * (MusEGlobal::config.division / 24);
+                if(dll_tick + div2 > nextTickPos && dll_tick < nextTickPos + div2)
+                  nextTickPos = dll_tick > curTickPos ? dll_tick : curTickPos;
+              }
               // Probably not good - interfere with midi thread.
               MusEGlobal::midiExtSyncTicks = 0;
             }
@@ -516,6 +530,11 @@ void Audio::process(unsigned frames)
       process1(samplePos, offset, frames);
       for (iAudioOutput i = ol->begin(); i != ol->end(); ++i)
             (*i)->processWrite();
+
+      // Meters of this cycle for the gui.
+      TrackList* tl = MusEGlobal::song->tracks();
+      for (iTrack it = tl->begin(); it != tl->end(); ++it)
+            (*it)->publishMeters();
       
 #ifdef _AUDIO_USE_TRUE_FRAME_
       _previousPos = _pos;
@@ -782,6 +801,7 @@ void Audio::seek(const Pos& p)
 
 // ALSA support       
 #if 1 
+      alsaMidiQueueFlush();               // drop what was sent ahead for the old position
       MusEGlobal::midiSeq->msgSeek();     // handle stuck notes and set controller for new position
 #else      
       if (curTickPos == 0 && !MusEGlobal::song->record())     // Moved here from MidiSeq::processStop()
@@ -801,28 +821,6 @@ void Audio::seek(const Pos& p)
       write(sigFd, "G", 1);   // signal seek to gui
       }
 
-//---------------------------------------------------------
-//   writeTick
-//    called from audio prefetch thread context
-//    write another buffer to soundfile
-//---------------------------------------------------------
-
-void Audio::writeTick()
-      {
-      AudioOutput* ao = MusEGlobal::song->bounceOutput;
-      if(ao && MusEGlobal::song->outputs()->find(ao) != MusEGlobal::song->outputs()->end())
-      {
-        if(ao->recordFlag())
-          ao->record();
-      }
-      WaveTrackList* tl = MusEGlobal::song->waves();
-      for (iWaveTrack t = tl->begin(); t != tl->end(); ++t) {
-            WaveTrack* track = *t;
-            if (track->recordFlag())
-                  track->record();
-            }
-      }
-
 //---------------------------------------------------------
 //   startRolling
 //---------------------------------------------------------
@@ -931,6 +929,7 @@ void Audio::stopRolling()
       
 // ALSA support      
 #if 1        
+      alsaMidiQueueFlush();
       MusEGlobal::midiSeq->msgStop();
 #else      
       MusEGlobal::midiSeq->setExternalPlayState(false); // not playing   Moved here from MidiSeq::processStop()   
@@ -946,6 +945,7 @@ void Audio::stopRolling()
             WaveTrack* track = *i;
             track->resetMeter();
             }
+      MusEGlobal::audioPrefetch->msgStop();
       recording    = false;
       endRecordPos = _pos;
       endExternalRecTick = curTickPos;
@@ -966,6 +966,9 @@ void Audio::recordStop()
 
       MusEGlobal::audio->msgIdle(true); // gain access to all data structures
 
+      // Whatever the writer threads have not written yet.
+      MusEGlobal::recordWriter->finish();
+
       MusEGlobal::song->startUndo();
       WaveTrackList* wl = MusEGlobal::song->waves();
 
@@ -197,7 +197,6 @@ class Audio {
       // Called whenever the audio needs to re-sync, such as after any tempo changes.
       void reSyncAudio();
       void shutdown();
-      void writeTick();
 
       // transport:
       bool start();
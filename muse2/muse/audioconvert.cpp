@@ -27,10 +27,14 @@
 
 #include <math.h>
 
+#include <set>
+
 #include "wave.h"
 #include "globals.h"
+#include "gconfig.h"
 #include "audioconvert.h"
 #include "eventbase.h"
+#include "event.h"
 
 //#define AUDIOCONVERT_DEBUG
 //#define AUDIOCONVERT_DEBUG_PRC
@@ -41,9 +45,35 @@ namespace MusECore {
 //   AudioConvertMap
 //---------------------------------------------------------
 
-void AudioConvertMap::remapEvents(const EventList* /*el*/)  
+AudioConvertMap::~AudioConvertMap()
 {
+  for(iAudioConvertMap i = begin(); i != end(); ++i)
+    delete i->second;
+}
 
+//---------------------------------------------------------
+//   remapEvents
+//    Drop the converters of events no longer in the list.
+//---------------------------------------------------------
+
+void AudioConvertMap::remapEvents(const EventList* el)  
+{
+  if(empty())
+    return;
+  std::set<EventBase*> live;
+  for(ciEvent ie = el->begin(); ie != el->end(); ++ie)
+    live.insert(ie->second.ev);
+  iAudioConvertMap i = begin();
+  while(i != end())
+  {
+    if(live.find(i->first) == live.end())
+    {
+      delete i->second;
+      erase(i++);
+    }
+    else
+      ++i;
+  }
 }
 
 iAudioConvertMap AudioConvertMap::addEvent(EventBase* eb)
@@ -53,7 +83,7 @@ iAudioConvertMap AudioConvertMap::addEvent(EventBase* eb)
   {
     AudioConverter* cv = 0;
     if(!eb->sndFile().isNull())
-      cv = new SRCAudioConverter(eb->sndFile().channels(), SRC_SINC_MEDIUM_QUALITY);
+      cv = new SRCAudioConverter(eb->sndFile().channels(), MusEGlobal::config.audioConverterType);
     
     // Use insert with hint for speed.
     return insert(iacm, std::pair<EventBase*, AudioConverter*> (eb, cv));
@@ -80,6 +110,25 @@ iAudioConvertMap AudioConvertMap::getConverter(EventBase* eb)
   return find(eb);
 }
 
+//---------------------------------------------------------
+//   converter
+//    The converter of the event, made on first use and
+//    made again when the file channels or the configured
+//    converter type changed.
+//---------------------------------------------------------
+
+AudioConverter* AudioConvertMap::converter(EventBase* eb)
+{
+  iAudioConvertMap iacm = addEvent(eb);
+  AudioConverter* cv = iacm->second;
+  if(cv && (cv->channels() != (int)eb->sndFile().channels() || cv->type() != MusEGlobal::config.audioConverterType))
+  {
+    removeEvent(eb);
+    cv = addEvent(eb)->second;
+  }
+  return cv;
+}
+
 //---------------------------------------------------------
 //   AudioConverter
 //---------------------------------------------------------
@@ -92,6 +141,7 @@ AudioConverter::AudioConverter()
 
   _refCount = 1;
   _sfCurFrame = 0;
+  _nextFrame = -1;
 }
 
 AudioConverter::~AudioConverter()
@@ -148,10 +198,17 @@ off_t AudioConverter::readAudio(MusECore::SndFileR& f, unsigned offset, float**
   if(!resample)
   {
     // Sample rates are the same. Just a regular seek + read, no conversion.
+    _nextFrame = -1;
     _sfCurFrame = f.seek(frame, 0);
     return _sfCurFrame + f.read(channel, buffer, n, overwrite);
   }
   
+  // A read not following the last one (first read, the event was skipped
+  //  for a while) needs a seek as well, the converter state is stale then.
+  if(frame != _nextFrame)
+    doSeek = true;
+  _nextFrame = frame + n;
+  
   // Is a 'transport' seek requested? (Not to be requested with every read! Should only be for 'first read' seeks, or positional 'transport' seeks.)
   // Due to the support of sound file references in MusE, seek must ALWAYS be done before read, as before,
   //  except now we alter the seek position if sample rate conversion is being used and remember the seek positions. 
@@ -463,8 +520,9 @@ off_t SRCAudioConverter::process(MusECore::SndFileR& f, float** buffer, int chan
         // SRC didn't give us the number of frames we requested. 
         // This can occasionally be radically different from the requested frames, or zero,
         //  even when ample excess input frames are supplied.
-        // Move the src output pointer to a new position.
-        srcdata.data_out += srcdata.output_frames_gen * channel;
+        // Move the src output pointer to a new position. The output is
+        //  interleaved with the file channels.
+        srcdata.data_out += srcdata.output_frames_gen * fchan;
         // Set new number of maximum out frames.
         outFrames -= srcdata.output_frames_gen;
         // Calculate the new number of file input frames required.
@@ -499,8 +557,8 @@ off_t SRCAudioConverter::process(MusECore::SndFileR& f, float** buffer, int chan
     #endif
           
     // Let's zero the rest of it.
-    long b = totalOutFrames * channel;
-    long e = n * channel;
+    long b = totalOutFrames * fchan;
+    long e = n * fchan;
     for(long i = b; i < e; ++i)
       outbuffer[i] = 0.0f;
   }
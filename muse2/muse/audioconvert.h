@@ -52,6 +52,7 @@ class AudioConverter
    protected:   
       int _refCount;
       off_t _sfCurFrame;
+      off_t _nextFrame;       // where the last read ended, -1 none yet
       
    public:   
       AudioConverter();
@@ -66,6 +67,8 @@ class AudioConverter
       virtual bool isValid() = 0;
       virtual void reset() = 0;
       virtual void setChannels(int ch) = 0;
+      virtual int channels() const = 0;
+      virtual int type() const = 0;
       virtual off_t process(MusECore::SndFileR& sf, float** buffer, 
                             int channels, int frames, bool overwrite) = 0; // Interleaved buffer if stereo.
 };
@@ -87,6 +90,8 @@ class SRCAudioConverter : public AudioConverter
       virtual bool isValid() { return _src_state != 0; }
       virtual void reset();
       virtual void setChannels(int ch);
+      virtual int channels() const { return _channels; }
+      virtual int type() const     { return _type; }
       virtual off_t process(MusECore::SndFileR& sf, float** buffer, 
                             int channels, int frames, bool overwrite); // Interleaved buffer if stereo.
 };
@@ -110,6 +115,8 @@ class RubberBandAudioConverter : public AudioConverter
       virtual bool isValid() { return _rbs != 0; }
       virtual void reset();
       virtual void setChannels(int ch);
+      virtual int channels() const { return _channels; }
+      virtual int type() const     { return _options; }
       virtual off_t process(MusECore::SndFileR& sf, float** buffer, 
                             int channels, int frames, bool overwrite); // Interleaved buffer if stereo.
 };
@@ -118,6 +125,9 @@ class RubberBandAudioConverter : public AudioConverter
 
 //---------------------------------------------------------
 //   AudioConvertMap
+//    The converters of the events of a wave part, owned by
+//    the map. Used from the prefetch thread only. A copy
+//    starts out empty, converter state is not shared.
 //---------------------------------------------------------
 
 typedef std::map<EventBase*, AudioConverter*, std::less<EventBase*> >::iterator iAudioConvertMap;
@@ -126,10 +136,16 @@ typedef std::map<EventBase*, AudioConverter*, std::less<EventBase*> >::const_ite
 class AudioConvertMap : public std::map<EventBase*, AudioConverter*, std::less<EventBase*> > 
 {
    public:
+      AudioConvertMap() {}
+      AudioConvertMap(const AudioConvertMap&) : std::map<EventBase*, AudioConverter*, std::less<EventBase*> >() {}
+      AudioConvertMap& operator=(const AudioConvertMap&) { return *this; }
+      ~AudioConvertMap();
+
       void remapEvents(const EventList*);  
       iAudioConvertMap addEvent(EventBase*);
       void removeEvent(EventBase*);
       iAudioConvertMap getConverter(EventBase*);
+      AudioConverter* converter(EventBase*);
 };
 
 } // namespace MusECore
@@ -32,6 +32,8 @@
 #include "song.h"
 #include "audio.h"
 #include "sync.h"
+#include "clipcache.h"
+#include "decoderpool.h"
 
 namespace MusEGlobal {
 MusECore::AudioPrefetch* audioPrefetch;
@@ -46,7 +48,7 @@ void initAudioPrefetch()
 
 //#define AUDIOPREFETCH_DEBUG
 
-enum { PREFETCH_TICK, PREFETCH_SEEK
+enum { PREFETCH_TICK, PREFETCH_SEEK, PREFETCH_STOP
       };
 
 //---------------------------------------------------------
@@ -107,9 +109,7 @@ void AudioPrefetch::processMsg1(const void* m)
       const PrefetchMsg* msg = (PrefetchMsg*)m;
       switch(msg->id) {
             case PREFETCH_TICK:
-                  if (MusEGlobal::audio->isRecording()) 
-                        MusEGlobal::audio->writeTick();
-
+                  // Recording is written by MusEGlobal::recordWriter.
                   // Indicate do not seek file before each read.
                   prefetch(false);
                   
@@ -123,6 +123,9 @@ void AudioPrefetch::processMsg1(const void* m)
                   // process seek in background
                   seek(msg->pos);
                   break;
+            case PREFETCH_STOP:
+                  releaseReaders();
+                  break;
             default:
                   printf("AudioPrefetch::processMsg1: unknown message\n");
             }
@@ -142,6 +145,34 @@ void AudioPrefetch::msgTick()
             }
       }
 
+//---------------------------------------------------------
+//   msgStop
+//    called from audio RT context
+//---------------------------------------------------------
+
+void AudioPrefetch::msgStop()
+      {
+      PrefetchMsg msg;
+      msg.id  = PREFETCH_STOP;
+      msg.pos = 0;
+      while (sendMsg1(&msg, sizeof(msg))) {
+            printf("AudioPrefetch::msgStop(): send failed!\n");
+            }
+      }
+
+//---------------------------------------------------------
+//   releaseReaders
+//    No event plays on after a stop: give back the file
+//    read positions, and with them their decode streams.
+//---------------------------------------------------------
+
+void AudioPrefetch::releaseReaders()
+      {
+      WaveTrackList* tl = MusEGlobal::song->waves();
+      for (iWaveTrack it = tl->begin(); it != tl->end(); ++it)
+            (*it)->releaseReaders();
+      }
+
 //---------------------------------------------------------
 //   msgSeek
 //    called from audio RT context
@@ -177,7 +208,12 @@ void AudioPrefetch::prefetch(bool doSeek)
             printf("AudioPrefetch::prefetch: invalid write position\n");
             return;
             }
-      if (MusEGlobal::song->loop() && !MusEGlobal::audio->bounce() && !MusEGlobal::extSyncFlag.value()) {
+      const bool looping = MusEGlobal::song->loop() && !MusEGlobal::audio->bounce() && !MusEGlobal::extSyncFlag.value();
+      // Where the decoder pool goes on after the loop end.
+      if (MusEGlobal::decoderPool)
+            MusEGlobal::decoderPool->setLoop(looping, MusEGlobal::song->lPos().frame(),
+               MusEGlobal::song->rPos().frame());
+      if (looping) {
             const Pos& loop = MusEGlobal::song->rPos();
             unsigned n = loop.frame() - writePos;
             if (n < MusEGlobal::segmentSize) {
@@ -192,8 +228,10 @@ void AudioPrefetch::prefetch(bool doSeek)
       for (iWaveTrack it = tl->begin(); it != tl->end(); ++it) {
             WaveTrack* track = *it;
             // Save time. Don't bother if track is off. Track On/Off not designed for rapid repeated response (but mute is). (p3.3.29)
-            if(track->off())
+            if(track->off()) {
+              track->releaseReaders();
               continue;
+            }
             
             int ch           = track->channels();
             float* bp[ch];
@@ -232,6 +270,28 @@ void AudioPrefetch::seek(unsigned seekTo)
         return;
       }
       
+      // The decoder pool waits until the last seek is done.
+      if (MusEGlobal::decoderPool)
+            MusEGlobal::decoderPool->setSeeking(true);
+
+      // How the last stretch of playback went, if there was any.
+      if (MusEGlobal::debugMsg && MusEGlobal::clipCache) {
+            static QString lastStats;
+            QString stats = MusEGlobal::clipCache->statistics();
+            if (stats != lastStats) {
+                  printf("%s\n", stats.toLatin1().constData());
+                  lastStats = stats;
+                  }
+            }
+      if (MusEGlobal::debugMsg && MusEGlobal::decoderPool) {
+            static QString lastStats;
+            QString stats = MusEGlobal::decoderPool->statistics();
+            if (stats != lastStats) {
+                  printf("%s\n", stats.toLocal8Bit().constData());
+                  lastStats = stats;
+                  }
+            }
+
       writePos = seekTo;
       WaveTrackList* tl = MusEGlobal::song->waves();
       for (iWaveTrack it = tl->begin(); it != tl->end(); ++it) {
@@ -257,6 +317,8 @@ void AudioPrefetch::seek(unsigned seekTo)
             
       seekPos  = seekTo;
       --seekCount;
+      if (MusEGlobal::decoderPool)
+            MusEGlobal::decoderPool->setSeeking(false);
       }
 
 } // namespace MusECore
@@ -39,6 +39,7 @@ class AudioPrefetch : public Thread {
       virtual void processMsg1(const void*);
       void prefetch(bool doSeek);
       void seek(unsigned pos);
+      void releaseReaders();
 
       volatile int seekCount;
       
@@ -50,6 +51,7 @@ class AudioPrefetch : public Thread {
 
       void msgTick();
       void msgSeek(unsigned samplePos, bool force=false);
+      void msgStop();
       
       bool seekDone() const { return seekCount == 0; }
       };
@@ -45,6 +45,7 @@
 #include "controlfifo.h"
 #include "fastlog.h"
 #include "gconfig.h"
+#include "recwriter.h"
 
 namespace MusECore {
 
@@ -374,6 +375,7 @@ void AudioTrack::internal_assign(const Track& t, int flags)
       
       if(flags & ASSIGN_PLUGINS)
       {
+        _efxPipe->cancelJobs();
         delete _efxPipe;
         _efxPipe = new Pipeline(*(at._efxPipe), this);  // Make copies of the plugins. 
       }  
@@ -519,6 +521,9 @@ void AudioTrack::assign(const Track& t, int flags)
 
 AudioTrack::~AudioTrack()
 {
+      if(MusEGlobal::recordWriter)
+        MusEGlobal::recordWriter->remove(this);
+      _efxPipe->cancelJobs();
       delete _efxPipe;
 
       if(audioInSilenceBuf)
@@ -2223,6 +2228,7 @@ bool AudioTrack::setRecordFlag1(bool f)
               //  recording, the _recFile pointer is made into an event, 
               //  then _recFile is made zero before this function is called.
               QString s = _recFile->path();
+              MusEGlobal::recordWriter->remove(this);
               setRecFile(NULL);
               
               remove(s.toLatin1().constData());
@@ -2246,6 +2252,11 @@ bool AudioTrack::prepareRecording()
       if(MusEGlobal::debugMsg)
         printf("prepareRecording for track %s\n", _name.toLatin1().constData());
 
+      // The audio thread puts into the ring as soon as there is a
+      //  file and the song is recording.
+      if (_recFile.isNull() || !MusEGlobal::audio->isRecording())
+            _recRing.resize(MusEGlobal::config.recBufferSeconds * MusEGlobal::sampleRate);
+
       if (_recFile.isNull()) {
             //
             // create soundfile for recording
@@ -2270,13 +2281,14 @@ bool AudioTrack::prepareRecording()
       if (MusEGlobal::debugMsg)
           printf("AudioNode::setRecordFlag1: init internal file %s\n", _recFile->path().toLatin1().constData());
 
-      if(_recFile->openWrite())
+      if(_recFile->openWrite(MusEGlobal::config.recPreallocSeconds * MusEGlobal::sampleRate))
             {
             QMessageBox::critical(NULL, "MusE write error.", "Error creating target wave file\n"
                                                             "Check your configuration.");
             return false;
 
             }
+      MusEGlobal::recordWriter->add(this);
       return true;      
 }
 double AudioTrack::auxSend(int idx) const
@@ -0,0 +1,455 @@
+//=========================================================
+//  MusE
+//  Linux Music Editor
+//
+//  batch.cpp
+//    Converts and analyzes midi files without the gui:
+//      muse2 --batch [flags] file.mid|dir...
+//
+//  This program is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU General Public License
+//  as published by the Free Software Foundation; version 2 of
+//  the License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+//
+//=========================================================
+
+//---------------------------------------------------------
+//    Every file goes through the same code as File/Import
+//    Midi and File/Export Midi. Reader threads read and
+//    parse the files, a few ahead of the main thread. The
+//    rest needs the one song, tempo map and midi ports and
+//    runs in the main thread, a file at a time: the
+//    tracks, ports and parts are built, and the song is
+//    written as .med or exported again as .mid, with the
+//    division and format of the midi file settings. Per
+//    file it prints
+//      tracks   midi tracks of the song
+//      events   events in all parts
+//      notes
+//      tempo    tempo changes, and the first one in bpm
+//      sig      time signatures
+//      sec      up to the end of the last note, at the
+//               tempo map of the song
+//      read     ms the reader thread took
+//      build    ms building the song
+//      write    ms writing the output
+//    -t prints the tempo map of each file as well.
+//---------------------------------------------------------
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <time.h>
+#include <vector>
+
+#include <QCoreApplication>
+#include <QDir>
+#include <QDirIterator>
+#include <QFileInfo>
+#include <QMutex>
+#include <QString>
+#include <QStringList>
+#include <QThread>
+#include <QWaitCondition>
+
+#include "al/sig.h"
+#include "batch.h"
+#include "conf.h"
+#include "gconfig.h"
+#include "globals.h"
+#include "midi.h"
+#include "midifile.h"
+#include "midiport.h"
+#include "minstrument.h"
+#include "part.h"
+#include "song.h"
+#include "tempo.h"
+#include "track.h"
+#include "xml.h"
+
+namespace MusECore {
+
+extern void initMidiController();
+
+//---------------------------------------------------------
+//   wallTime
+//---------------------------------------------------------
+
+static double wallTime()
+      {
+      struct timespec ts;
+      clock_gettime(CLOCK_MONOTONIC, &ts);
+      return ts.tv_sec + ts.tv_nsec * 1e-9;
+      }
+
+//---------------------------------------------------------
+//   BatchJob
+//---------------------------------------------------------
+
+struct BatchJob {
+      QString path;
+      QString out;            // empty: analyze only
+      MidiFile* mf;
+      bool failed;
+      QString error;
+      double readTime;
+      bool done;
+
+      BatchJob() : mf(0), failed(false), readTime(0.0), done(false) {}
+      };
+
+//---------------------------------------------------------
+//   BatchQueue
+//    The reader threads stay at most window files ahead
+//    of the main thread, that much parsed data is held.
+//---------------------------------------------------------
+
+struct BatchQueue {
+      std::vector<BatchJob> jobs;
+      QMutex lock;
+      QWaitCondition cond;
+      int next;               // to read
+      int consumed;           // by the main thread
+      int window;
+
+      BatchQueue() : next(0), consumed(0), window(1) {}
+      };
+
+//---------------------------------------------------------
+//   BatchReader
+//---------------------------------------------------------
+
+class BatchReader : public QThread {
+      BatchQueue* _queue;
+
+   public:
+      BatchReader(BatchQueue* q) : _queue(q) {}
+      virtual void run();
+      };
+
+//---------------------------------------------------------
+//   run
+//---------------------------------------------------------
+
+void BatchReader::run()
+      {
+      for (;;) {
+            _queue->lock.lock();
+            while (_queue->next < int(_queue->jobs.size())
+               && _queue->next >= _queue->consumed + _queue->window)
+                  _queue->cond.wait(&_queue->lock);
+            if (_queue->next >= int(_queue->jobs.size())) {
+                  _queue->lock.unlock();
+                  break;
+                  }
+            BatchJob& job = _queue->jobs[_queue->next++];
+            _queue->lock.unlock();
+
+            const double t0 = wallTime();
+            FILE* fp = fopen(job.path.toLocal8Bit().constData(), "r");
+            if (fp == 0) {
+                  job.failed = true;
+                  job.error  = QString(strerror(errno));
+                  }
+            else {
+                  job.mf = new MidiFile(fp);
+                  // The files are read in parallel already.
+                  job.mf->setThreads(1);
+                  // The rest of read() is left to the main thread.
+                  if (job.mf->parse()) {
+                        job.failed = true;
+                        job.error  = job.mf->error();
+                        }
+                  fclose(fp);
+                  }
+            job.readTime = wallTime() - t0;
+
+            _queue->lock.lock();
+            job.done = true;
+            _queue->cond.wakeAll();
+            _queue->lock.unlock();
+            }
+      }
+
+//---------------------------------------------------------
+//   deleteMidiFile
+//---------------------------------------------------------
+
+static void deleteMidiFile(MidiFile* mf)
+      {
+      if (mf == 0)
+            return;
+      MidiFileTrackList* tl = mf->trackList();
+      for (iMidiFileTrack i = tl->begin(); i != tl->end(); ++i)
+            delete *i;
+      tl->clear();
+      delete mf;
+      }
+
+//---------------------------------------------------------
+//   writeSong
+//    As MusE::write() does, without the gui parts.
+//    returns true on error
+//---------------------------------------------------------
+
+static bool writeSong(const QString& path)
+      {
+      FILE* f = fopen(path.toLocal8Bit().constData(), "w");
+      if (f == 0)
+            return true;
+      Xml xml(f);
+      xml.header();
+      int level = 0;
+      xml.tag(level++, "muse version=\"2.0\"");
+      writeSongConfiguration(level, xml);
+      MusEGlobal::song->write(level, xml);
+      xml.tag(level, "no_toplevels");
+      xml.etag(level, "no_toplevels");
+      xml.tag(level, "/muse");
+      bool rv = ferror(f) != 0;
+      fclose(f);
+      return rv;
+      }
+
+//---------------------------------------------------------
+//   writeMidi
+//    returns true on error
+//---------------------------------------------------------
+
+static bool writeMidi(const QString& path)
+      {
+      FILE* f = fopen(path.toLocal8Bit().constData(), "w");
+      if (f == 0)
+            return true;
+      bool rv = exportMidiFile(f);
+      fclose(f);
+      return rv;
+      }
+
+//---------------------------------------------------------
+//   printSong
+//---------------------------------------------------------
+
+static void printSong(const BatchJob& job, double build, double write, bool tempoMap)
+      {
+      MidiTrackList* tl = MusEGlobal::song->midis();
+      long events = 0, notes = 0;
+      unsigned lastTick = 0;
+      for (ciMidiTrack t = tl->begin(); t != tl->end(); ++t) {
+            PartList* pl = (*t)->parts();
+            for (ciPart p = pl->begin(); p != pl->end(); ++p) {
+                  const EventList& el = p->second->events();
+                  events += el.size();
+                  for (ciEvent e = el.begin(); e != el.end(); ++e) {
+                        if (!e->second.isNote())
+                              continue;
+                        ++notes;
+                        unsigned end = p->second->tick() + e->second.tick() + e->second.lenTick();
+                        if (end > lastTick)
+                              lastTick = end;
+                        }
+                  }
+            }
+      const double sec = double(MusEGlobal::tempomap.tick2frame(lastTick)) / MusEGlobal::sampleRate;
+      const int tempo = MusEGlobal::tempomap.tempo(0);
+      printf("%-40.40s %6d %8ld %8ld %4d %6.1f %4d %7.1f %8.2f %8.2f %8.2f\n",
+         job.path.toLocal8Bit().constData(), int(tl->size()), events, notes,
+         int(MusEGlobal::tempomap.size()), tempo > 0 ? 60000000.0 / tempo : 0.0,
+         int(AL::sigmap.size()), sec, job.readTime * 1000.0, build * 1000.0, write * 1000.0);
+
+      if (tempoMap) {
+            for (ciTEvent e = MusEGlobal::tempomap.begin(); e != MusEGlobal::tempomap.end(); ++e)
+                  printf("      tempo tick %8u  %7.2f bpm\n", e->second->tick,
+                     e->second->tempo > 0 ? 60000000.0 / e->second->tempo : 0.0);
+            }
+      }
+
+//---------------------------------------------------------
+//   addFiles
+//    The midi files of a directory, recursively, and
+//    where their output goes below outDir.
+//---------------------------------------------------------
+
+static void addFiles(BatchQueue* q, const QString& arg, const QString& outDir, const char* suffix)
+      {
+      QFileInfo fi(arg);
+      QStringList files;
+      QDir base;
+      if (fi.isDir()) {
+            base = QDir(fi.absoluteFilePath());
+            QStringList filter;
+            filter << "*.mid" << "*.midi" << "*.kar" << "*.MID";
+            QDirIterator it(fi.absoluteFilePath(), filter, QDir::Files, QDirIterator::Subdirectories);
+            while (it.hasNext())
+                  files << it.next();
+            files.sort();
+            }
+      else {
+            base = fi.absoluteDir();
+            files << fi.absoluteFilePath();
+            }
+      for (int i = 0; i < files.size(); ++i) {
+            BatchJob job;
+            job.path = files[i];
+            if (suffix) {
+                  QFileInfo f(base.relativeFilePath(files[i]));
+                  QString dir = outDir + "/" + f.path();
+                  QDir().mkpath(dir);
+                  job.out = dir + "/" + f.completeBaseName() + suffix;
+                  }
+            q->jobs.push_back(job);
+            }
+      }
+
+//---------------------------------------------------------
+//   usage
+//---------------------------------------------------------
+
+static void usage(const char* prog)
+      {
+      fprintf(stderr,
+         "usage: %s --batch [-j threads] [-f mid|med -o dir] [-t] file.mid|dir...\n"
+         "   -j n     reader threads (default: one per cpu)\n"
+         "   -f mid   export each file again as .mid, with the midi file settings\n"
+         "   -f med   write each file as a .med song\n"
+         "   -o dir   where the output goes, directories are mirrored below\n"
+         "   -t       print the tempo map of each file\n", prog);
+      }
+
+//---------------------------------------------------------
+//   batchMain
+//    argv[0] is "--batch". The configuration has been
+//    read already.
+//---------------------------------------------------------
+
+int batchMain(int argc, char* argv[])
+      {
+      QCoreApplication app(argc, argv);
+      const char* prog = "muse2";
+
+      int threads = QThread::idealThreadCount();
+      const char* suffix = 0;
+      QString outDir;
+      bool tempoMap = false;
+
+      int c;
+      while ((c = getopt(argc, argv, "j:f:o:th")) != EOF) {
+            switch (c) {
+                  case 'j': threads = atoi(optarg); break;
+                  case 'f':
+                        if (strcmp(optarg, "mid") == 0)
+                              suffix = ".mid";
+                        else if (strcmp(optarg, "med") == 0)
+                              suffix = ".med";
+                        else {
+                              usage(prog);
+                              return -1;
+                              }
+                        break;
+                  case 'o': outDir = QString(optarg); break;
+                  case 't': tempoMap = true; break;
+                  default:
+                        usage(prog);
+                        return -1;
+                  }
+            }
+      if (threads <= 0 || optind >= argc || (suffix != 0) != !outDir.isEmpty()) {
+            usage(prog);
+            return -1;
+            }
+
+      BatchQueue queue;
+      for (int i = optind; i < argc; ++i)
+            addFiles(&queue, QString::fromLocal8Bit(argv[i]), outDir, suffix);
+      if (queue.jobs.empty()) {
+            fprintf(stderr, "%s --batch: no midi files\n", prog);
+            return -1;
+            }
+      queue.window = 4 * threads;
+
+      //    what File/Import Midi needs
+
+      MusEGlobal::museUserInstruments = MusEGlobal::configPath + QString("/instruments");
+      initMidiController();
+      initMidiInstruments();
+      initMidiPorts();
+      MusEGlobal::song = new Song("song");
+      MusEGlobal::song->blockSignals(true);
+
+      std::vector<BatchReader*> readers;
+      for (int i = 0; i < threads; ++i) {
+            BatchReader* r = new BatchReader(&queue);
+            r->start();
+            readers.push_back(r);
+            }
+
+      printf("%-40s %6s %8s %8s %11s %4s %7s %8s %8s %8s\n", "file", "tracks", "events",
+         "notes", "tempo", "sig", "sec", "read", "build", "write");
+      const double t0 = wallTime();
+      int errors = 0;
+      for (int i = 0; i < int(queue.jobs.size()); ++i) {
+            BatchJob& job = queue.jobs[i];
+            queue.lock.lock();
+            while (!job.done)
+                  queue.cond.wait(&queue.lock);
+            queue.lock.unlock();
+
+            const double t1 = wallTime();
+            if (!job.failed && job.mf->readTracks()) {
+                  job.failed = true;
+                  job.error  = job.mf->error();
+                  }
+            if (job.failed) {
+                  fprintf(stderr, "%s: %s\n", job.path.toLocal8Bit().constData(),
+                     job.error.toLocal8Bit().constData());
+                  ++errors;
+                  }
+            else {
+                  MusEGlobal::song->clear(false);
+                  importMidiPorts(job.mf, false);
+                  importMidiTracks(job.mf);
+                  MusEGlobal::song->initLen();
+                  MusEGlobal::song->setMasterFlag(!MusEGlobal::tempomap.empty());
+                  const double t2 = wallTime();
+                  if (!job.out.isEmpty()) {
+                        bool rv = strcmp(suffix, ".med") == 0 ? writeSong(job.out) : writeMidi(job.out);
+                        if (rv) {
+                              fprintf(stderr, "%s: %s\n", job.out.toLocal8Bit().constData(), strerror(errno));
+                              ++errors;
+                              }
+                        }
+                  printSong(job, t2 - t1, wallTime() - t2, tempoMap);
+                  }
+            deleteMidiFile(job.mf);
+            job.mf = 0;
+
+            queue.lock.lock();
+            queue.consumed = i + 1;
+            queue.cond.wakeAll();
+            queue.lock.unlock();
+            }
+      const double wall = wallTime() - t0;
+
+      for (size_t i = 0; i < readers.size(); ++i) {
+            readers[i]->wait();
+            delete readers[i];
+            }
+      MusEGlobal::song->clear(false);
+
+      printf("\n%d files, %d failed, %.2f s, %.1f files/s\n", int(queue.jobs.size()), errors,
+         wall, wall > 0.0 ? queue.jobs.size() / wall : 0.0);
+      return errors ? 1 : 0;
+      }
+
+} // namespace MusECore
@@ -0,0 +1,256 @@
+//=========================================================
+//  MusE
+//  Linux Music Editor
+//
+//  clipcache.cpp
+//
+//  This program is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU General Public License
+//  as published by the Free Software Foundation; version 2 of
+//  the License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+//
+//=========================================================
+
+#include <string.h>
+#include <algorithm>
+
+#include <QMutexLocker>
+
+#include "clipcache.h"
+#include "wave.h"
+#include "gconfig.h"
+
+namespace MusEGlobal {
+MusECore::ClipCache* clipCache = 0;
+}
+
+namespace MusECore {
+
+//---------------------------------------------------------
+//   initClipCache
+//---------------------------------------------------------
+
+void initClipCache()
+{
+  MusEGlobal::clipCache = new ClipCache();
+}
+
+//---------------------------------------------------------
+//   Key::operator<
+//---------------------------------------------------------
+
+bool ClipCache::Key::operator<(const Key& k) const
+{
+  if(file != k.file)   return file < k.file;
+  if(start != k.start) return start < k.start;
+  return frames < k.frames;
+}
+
+//---------------------------------------------------------
+//   ClipCache
+//---------------------------------------------------------
+
+ClipCache::ClipCache()
+{
+  _useCounter = 0;
+  _bytes      = 0;
+  _hits       = 0;
+  _misses     = 0;
+  _evicted    = 0;
+  _tooLong    = 0;
+}
+
+//---------------------------------------------------------
+//   read
+//    Prefetch thread. Reads n frames at file frame pos of
+//    the event using frames start to start + len of the
+//    file into dst, like SndFile::read. Returns false if
+//    the event is not for the cache, the caller reads the
+//    file then.
+//---------------------------------------------------------
+
+bool ClipCache::read(SndFileR& f, int start, unsigned len, unsigned pos,
+   float** dst, int channels, unsigned n, bool overwrite)
+{
+  const size_t maxBytes = size_t(MusEGlobal::config.clipCacheMB) * 1024 * 1024;
+  const int fch = f.channels();
+  if(maxBytes == 0 || start < 0 || len == 0 || fch == 0)
+    return false;
+  if(pos < unsigned(start) || pos + n > unsigned(start) + len)
+    return false;
+  // Mono and stereo mappings only, others read the file.
+  if(fch != channels && !(channels == 1 && fch == 2) && !(channels == 2 && fch == 1))
+    return false;
+
+  QMutexLocker locker(&_lock);
+  const size_t bytes = size_t(len) * fch * sizeof(float);
+  if(len > unsigned(MusEGlobal::config.clipCacheSeconds) * f.samplerate() || bytes > maxBytes / 4)
+  {
+    ++_tooLong;
+    return false;
+  }
+
+  Key key;
+  key.file   = f.operator->();
+  key.start  = start;
+  key.frames = len;
+  std::map<Key, Clip>::iterator i = _clips.find(key);
+  if(i == _clips.end())
+  {
+    // Decode it all now, a clip is short. The lock is kept,
+    //  the gui only waits for it to invalidate.
+    ++_misses;
+    i = _clips.insert(std::make_pair(key, Clip())).first;
+    Clip& c = i->second;
+    c.data.resize(size_t(len) * fch);
+    c.channels = fch;
+    c.lastUse  = ++_useCounter;
+    float* bp[fch];
+    for(int ch = 0; ch < fch; ++ch)
+      bp[ch] = &c.data[size_t(ch) * len];
+    f.seek(start, 0);
+    c.frames = f.readWithHeap(fch, bp, len, true);
+    _bytes += bytes;
+    // The clip is at most a quarter, the newest and stays.
+    if(_bytes > maxBytes)
+      evict(maxBytes);
+  }
+  else
+    ++_hits;
+
+  Clip& c = i->second;
+  c.lastUse = ++_useCounter;
+
+  // Like the file, nothing past its end.
+  const unsigned off = pos - start;
+  if(off >= c.frames)
+    return true;
+  const unsigned m = std::min(n, c.frames - off);
+  const float* s0 = &c.data[off];
+  const float* s1 = fch > 1 ? &c.data[size_t(len) + off] : s0;
+
+  if(fch == channels)
+  {
+    for(int ch = 0; ch < channels; ++ch)
+    {
+      const float* s = &c.data[size_t(ch) * len + off];
+      float* d = dst[ch];
+      if(overwrite)
+        memcpy(d, s, m * sizeof(float));
+      else
+        for(unsigned k = 0; k < m; ++k)
+          d[k] += s[k];
+    }
+  }
+  else if(channels == 1)
+  {
+    // stereo to mono
+    float* d = dst[0];
+    if(overwrite)
+      for(unsigned k = 0; k < m; ++k)
+        d[k] = s0[k] + s1[k];
+    else
+      for(unsigned k = 0; k < m; ++k)
+        d[k] += s0[k] + s1[k];
+  }
+  else
+  {
+    // mono to stereo
+    float* d0 = dst[0];
+    float* d1 = dst[1];
+    if(overwrite)
+    {
+      memcpy(d0, s0, m * sizeof(float));
+      memcpy(d1, s0, m * sizeof(float));
+    }
+    else
+      for(unsigned k = 0; k < m; ++k)
+      {
+        d0[k] += s0[k];
+        d1[k] += s0[k];
+      }
+  }
+  return true;
+}
+
+//---------------------------------------------------------
+//   evict
+//    Must be called with _lock held. Drops the least
+//    recently used clips down to three quarters of
+//    maxBytes.
+//---------------------------------------------------------
+
+void ClipCache::evict(size_t maxBytes)
+{
+  std::vector<std::pair<unsigned, Key> > used;
+  for(std::map<Key, Clip>::const_iterator i = _clips.begin(); i != _clips.end(); ++i)
+    used.push_back(std::make_pair(i->second.lastUse, i->first));
+  std::sort(used.begin(), used.end());
+  for(size_t n = 0; n < used.size() && _bytes > maxBytes / 4 * 3; ++n)
+  {
+    std::map<Key, Clip>::iterator i = _clips.find(used[n].second);
+    _bytes -= i->second.data.size() * sizeof(float);
+    _clips.erase(i);
+    ++_evicted;
+  }
+}
+
+//---------------------------------------------------------
+//   invalidate
+//    The file data changed or the file goes away.
+//---------------------------------------------------------
+
+void ClipCache::invalidate(const SndFile* f)
+{
+  QMutexLocker locker(&_lock);
+  std::map<Key, Clip>::iterator i = _clips.begin();
+  while(i != _clips.end())
+  {
+    if(i->first.file == f)
+    {
+      _bytes -= i->second.data.size() * sizeof(float);
+      _clips.erase(i++);
+    }
+    else
+      ++i;
+  }
+}
+
+//---------------------------------------------------------
+//   clear
+//---------------------------------------------------------
+
+void ClipCache::clear()
+{
+  QMutexLocker locker(&_lock);
+  _clips.clear();
+  _bytes = 0;
+}
+
+//---------------------------------------------------------
+//   statistics
+//---------------------------------------------------------
+
+QString ClipCache::statistics()
+{
+  QMutexLocker locker(&_lock);
+  const unsigned long reads = _hits + _misses;
+  return QString("clip cache: %1% hits of %2 reads, %3 clips %4 MB, %5 evicted, %6 reads too long")
+     .arg(reads ? 100.0 * _hits / reads : 0.0, 0, 'f', 1)
+     .arg(reads)
+     .arg(_clips.size())
+     .arg(double(_bytes) / (1024 * 1024), 0, 'f', 1)
+     .arg(_evicted)
+     .arg(_tooLong);
+}
+
+} // namespace MusECore
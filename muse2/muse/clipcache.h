@@ -0,0 +1,90 @@
+//=========================================================
+//  MusE
+//  Linux Music Editor
+//
+//  clipcache.h
+//
+//  This program is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU General Public License
+//  as published by the Free Software Foundation; version 2 of
+//  the License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+//
+//=========================================================
+
+#ifndef __CLIPCACHE_H__
+#define __CLIPCACHE_H__
+
+#include <map>
+#include <vector>
+
+#include <QMutex>
+#include <QString>
+
+namespace MusECore {
+
+class SndFile;
+class SndFileR;
+
+//---------------------------------------------------------
+//   ClipCache
+//    Short wave events decoded and deinterleaved in memory,
+//    one copy per file range however often the range is
+//    used. The prefetch thread reads from here instead of
+//    the file. Bounded by config.clipCacheMB, least
+//    recently used clips go first.
+//---------------------------------------------------------
+
+class ClipCache {
+      struct Key {
+            const SndFile* file;
+            unsigned start;         // file frames
+            unsigned frames;
+            bool operator<(const Key&) const;
+            };
+
+      struct Clip {
+            std::vector<float> data;   // channel after channel
+            unsigned frames;           // as many as the file had
+            int channels;
+            unsigned lastUse;
+            };
+
+      QMutex _lock;                 // guards everything below
+      std::map<Key, Clip> _clips;
+      unsigned _useCounter;
+      size_t _bytes;
+
+      // Statistics, reads of events that qualify.
+      unsigned long _hits;
+      unsigned long _misses;
+      unsigned long _evicted;
+      unsigned long _tooLong;       // reads of events too long to keep
+
+      void evict(size_t maxBytes);
+
+   public:
+      ClipCache();
+
+      bool read(SndFileR& f, int start, unsigned len, unsigned pos,
+         float** dst, int channels, unsigned n, bool overwrite);
+      void invalidate(const SndFile*);
+      void clear();
+      QString statistics();
+      };
+
+} // namespace MusECore
+
+namespace MusEGlobal {
+extern MusECore::ClipCache* clipCache;
+}
+
+#endif
@@ -26,6 +26,7 @@
 #include "gui.h"
 #include "globals.h"
 #include "app.h"
+#include "song.h"
 #include "shortcuts.h"
 #include "songpos_toolbar.h"
 #include "sig_tempo_toolbar.h"
@@ -151,6 +152,9 @@ TopWin::TopWin(ToplevelType t, QWidget* parent, const char* name, Qt::WindowFlag
  actJackCpuLoad->setWhatsThis(tr("CPU load reported by JACK audio server"));
  QLabel *lbCpuLoad = new QLabel(tr("Not connected to JACK"));
  lbCpuLoad->setObjectName("JackCpuLoadToolbarLabel");
+ connect(MusEGlobal::song, SIGNAL(cpuLoadTextChanged(const QString&)), lbCpuLoad, SLOT(setText(const QString&)));
+ if(!MusEGlobal::song->cpuLoadText().isEmpty())
+   lbCpuLoad->setText(MusEGlobal::song->cpuLoadText());
  actJackCpuLoad->setDefaultWidget(lbCpuLoad);
  jackCpuToolbar->addAction(actJackCpuLoad);
 
@@ -1067,6 +1067,36 @@ void readConfiguration(Xml& xml, bool doReadMidiPortConfig, bool doReadGlobalCon
                               MusEGlobal::config.dummyAudioBufSize = xml.parseInt();
                         else if (tag == "minControlProcessPeriod")
                               MusEGlobal::config.minControlProcessPeriod = xml.parseUInt();
+                        else if (tag == "pluginPoolInstances")
+                              MusEGlobal::config.pluginPoolInstances = xml.parseInt();
+                        else if (tag == "pluginPoolPlugins")
+                              MusEGlobal::config.pluginPoolPlugins = xml.parseInt();
+                        else if (tag == "pluginScanCache")
+                              MusEGlobal::config.pluginScanCache = xml.parseInt();
+                        else if (tag == "pluginScanOutOfProcess")
+                              MusEGlobal::config.pluginScanOutOfProcess = xml.parseInt();
+                        else if (tag == "pluginBridgeLibs")
+                              MusEGlobal::config.pluginBridgeLibs = xml.parse1();
+                        else if (tag == "alsaMidiQueue")
+                              MusEGlobal::config.alsaMidiQueue = xml.parseInt();
+                        else if (tag == "recBufferSeconds")
+                              MusEGlobal::config.recBufferSeconds = xml.parseInt();
+                        else if (tag == "recWriterThreads")
+                              MusEGlobal::config.recWriterThreads = xml.parseInt();
+                        else if (tag == "recPreallocSeconds")
+                              MusEGlobal::config.recPreallocSeconds = xml.parseInt();
+                        else if (tag == "audioConverterType")
+                              MusEGlobal::config.audioConverterType = xml.parseInt();
+                        else if (tag == "clipCacheMB")
+                              MusEGlobal::config.clipCacheMB = xml.parseInt();
+                        else if (tag == "clipCacheSeconds")
+                              MusEGlobal::config.clipCacheSeconds = xml.parseInt();
+                        else if (tag == "decoderThreads")
+                              MusEGlobal::config.decoderThreads = xml.parseInt();
+                        else if (tag == "decoderAheadSeconds")
+                              MusEGlobal::config.decoderAheadSeconds = xml.parseInt();
+                        else if (tag == "undoMemoryLimit")
+                              MusEGlobal::config.undoMemoryLimit = xml.parseInt();
                         else if (tag == "guiRefresh")
                               MusEGlobal::config.guiRefresh = xml.parseInt();
                         else if (tag == "userInstrumentsDir")                        // Obsolete
@@ -1385,6 +1415,19 @@ static void writeSeqConfiguration(int level, Xml& xml, bool writePortInfo)
       xml.tag(level, "/sequencer");
       }
 
+//---------------------------------------------------------
+//   writeSongConfiguration
+//    The song specific configuration without the gui
+//    parts, for songs written by the batch mode.
+//---------------------------------------------------------
+
+void writeSongConfiguration(int level, Xml& xml)
+      {
+      xml.tag(level++, "configuration");
+      writeSeqConfiguration(level, xml, true);
+      xml.etag(level, "configuration");
+      }
+
 } // namespace MusECore
 
 namespace MusEGui {
@@ -1429,6 +1472,21 @@ void MusE::writeGlobalConfiguration(int level, MusECore::Xml& xml) const
       xml.intTag(level, "dummyAudioBufSize", MusEGlobal::config.dummyAudioBufSize);
       xml.intTag(level, "dummyAudioSampleRate", MusEGlobal::config.dummyAudioSampleRate);
       xml.uintTag(level, "minControlProcessPeriod", MusEGlobal::config.minControlProcessPeriod);
+      xml.intTag(level, "pluginPoolInstances", MusEGlobal::config.pluginPoolInstances);
+      xml.intTag(level, "pluginPoolPlugins", MusEGlobal::config.pluginPoolPlugins);
+      xml.intTag(level, "pluginScanCache", MusEGlobal::config.pluginScanCache);
+      xml.intTag(level, "pluginScanOutOfProcess", MusEGlobal::config.pluginScanOutOfProcess);
+      xml.strTag(level, "pluginBridgeLibs", MusEGlobal::config.pluginBridgeLibs);
+      xml.intTag(level, "alsaMidiQueue", MusEGlobal::config.alsaMidiQueue);
+      xml.intTag(level, "recBufferSeconds", MusEGlobal::config.recBufferSeconds);
+      xml.intTag(level, "recWriterThreads", MusEGlobal::config.recWriterThreads);
+      xml.intTag(level, "recPreallocSeconds", MusEGlobal::config.recPreallocSeconds);
+      xml.intTag(level, "audioConverterType", MusEGlobal::config.audioConverterType);
+      xml.intTag(level, "clipCacheMB", MusEGlobal::config.clipCacheMB);
+      xml.intTag(level, "clipCacheSeconds", MusEGlobal::config.clipCacheSeconds);
+      xml.intTag(level, "decoderThreads", MusEGlobal::config.decoderThreads);
+      xml.intTag(level, "decoderAheadSeconds", MusEGlobal::config.decoderAheadSeconds);
+      xml.intTag(level, "undoMemoryLimit", MusEGlobal::config.undoMemoryLimit);
       xml.intTag(level, "guiRefresh", MusEGlobal::config.guiRefresh);
       
       xml.intTag(level, "extendedMidi", MusEGlobal::config.extendedMidi);
@@ -56,6 +56,7 @@ class Xml;
 extern bool readConfiguration();
 extern bool readConfiguration(const char *configFile);
 extern void readConfiguration(Xml&, bool doReadMidiPorts, bool doReadGlobalConfig);
+extern void writeSongConfiguration(int level, Xml&);
 }
 
 #endif
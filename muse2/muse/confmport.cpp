@@ -34,6 +34,7 @@
 #include <QTableWidgetItem>
 #include <QHeaderView>
 #include <QSettings>
+#include <QTimer>
 
 #include "confmport.h"
 #include "app.h"
@@ -64,7 +65,7 @@ extern std::vector<MusECore::Synth*> synthis;
 namespace MusEGui {
 
 enum { DEVCOL_NO = 0, DEVCOL_GUI, DEVCOL_REC, DEVCOL_PLAY, DEVCOL_INSTR, DEVCOL_NAME,
-       DEVCOL_INROUTES, DEVCOL_OUTROUTES, DEVCOL_DEF_IN_CHANS, DEVCOL_DEF_OUT_CHANS, DEVCOL_STATE };  
+       DEVCOL_INROUTES, DEVCOL_OUTROUTES, DEVCOL_DEF_IN_CHANS, DEVCOL_DEF_OUT_CHANS, DEVCOL_STATE, DEVCOL_IN_TIMING };  
 
 //---------------------------------------------------------
 //   closeEvent
@@ -961,6 +962,7 @@ void MPConfig::setToolTip(QTableWidgetItem *item, int col)
             case DEVCOL_DEF_OUT_CHANS:  item->setToolTip(tr("Auto-connect new midi tracks to this channel")); break;
             #endif
             case DEVCOL_STATE:  item->setToolTip(tr("Device state")); break;
+            case DEVCOL_IN_TIMING: item->setToolTip(tr("Input delay / jitter in ms")); break;
             default: return;
             }
   }
@@ -1000,6 +1002,10 @@ void MPConfig::setWhatsThis(QTableWidgetItem *item, int col)
                   #endif                      
             case DEVCOL_STATE:
                   item->setWhatsThis(tr("State: result of opening the device")); break;
+            case DEVCOL_IN_TIMING:
+                  item->setWhatsThis(tr("Average delay from the arrival of input events until MusE handles them,"
+                                        " and its deviation (jitter). Recorded events are time stamped on arrival,"
+                                        " so neither ends up in the recording.")); break;
             default:
                   break;
             }
@@ -1049,7 +1055,8 @@ MPConfig::MPConfig(QWidget* parent)
 		  << tr("Out routes")
                   << tr("Def in ch")
                   << tr("Def out ch")
-		  << tr("State");
+		  << tr("State")
+		  << tr("In timing");
 
       mdevView->setColumnCount(columnnames.size());
       mdevView->setHorizontalHeaderLabels(columnnames);
@@ -1064,6 +1071,7 @@ MPConfig::MPConfig(QWidget* parent)
       connect(mdevView, SIGNAL(itemChanged(QTableWidgetItem*)),
          this, SLOT(mdevViewItemRenamed(QTableWidgetItem*)));
       connect(MusEGlobal::song, SIGNAL(songChanged(MusECore::SongChangedFlags_t)), SLOT(songChanged(MusECore::SongChangedFlags_t)));
+      connect(MusEGlobal::heartBeatTimer, SIGNAL(timeout()), SLOT(heartBeat()));
 
       connect(synthList, SIGNAL(itemSelectionChanged()), SLOT(selectionChanged()));
       connect(instanceList, SIGNAL(itemSelectionChanged()), SLOT(selectionChanged()));
@@ -1094,6 +1102,39 @@ void MPConfig::selectionChanged()
       removeInstance->setEnabled(instanceList->currentItem());
       }
 
+//---------------------------------------------------------
+//   inputTimingText
+//---------------------------------------------------------
+
+QString MPConfig::inputTimingText(const MusECore::MidiDevice* dev) const
+      {
+      if (!dev || dev->isSynti() || dev->inputStats().count() == 0)
+            return QString();
+      const MusECore::MidiInputStats& st = dev->inputStats();
+      return QString("%1 / %2").arg(st.latency() / 1000.0, 0, 'f', 2).arg(st.jitter() / 1000.0, 0, 'f', 2);
+      }
+
+//---------------------------------------------------------
+//   heartBeat
+//    refresh the input timing column
+//---------------------------------------------------------
+
+void MPConfig::heartBeat()
+      {
+      if (!isVisible())
+            return;
+      mdevView->blockSignals(true);
+      for (int i = 0; i < MIDI_PORTS; ++i) {
+            QTableWidgetItem* item = mdevView->item(i, DEVCOL_IN_TIMING);
+            if (!item)
+                  continue;
+            const QString s = inputTimingText(MusEGlobal::midiPorts[i].device());
+            if (item->text() != s)
+                  item->setText(s);
+            }
+      mdevView->blockSignals(false);
+      }
+
 //---------------------------------------------------------
 //   songChanged
 //---------------------------------------------------------
@@ -1131,6 +1172,9 @@ void MPConfig::songChanged(MusECore::SongChangedFlags_t flags)
             QTableWidgetItem* itemstate = new QTableWidgetItem(port->state());
             addItem(i, DEVCOL_STATE, itemstate, mdevView);
             itemstate->setFlags(Qt::ItemIsEnabled);
+            QTableWidgetItem* itemtiming = new QTableWidgetItem(inputTimingText(dev));
+            addItem(i, DEVCOL_IN_TIMING, itemtiming, mdevView);
+            itemtiming->setFlags(Qt::ItemIsEnabled);
             QTableWidgetItem* iteminstr = new QTableWidgetItem(port->instrument() ?
                            port->instrument()->iname() :
                            tr("<unknown>"));
@@ -38,6 +38,7 @@ class QAction;
 
 namespace MusECore {
 class Xml;
+class MidiDevice;
 }
 
 namespace MusEGui {
@@ -56,6 +57,7 @@ class MPConfig : public QDialog, Ui::SynthConfigBase {
       void setWhatsThis(QTableWidgetItem *item, int col);
       void setToolTip(QTableWidgetItem *item, int col);
       void addItem(int row, int col, QTableWidgetItem *item, QTableWidget *table);
+      QString inputTimingText(const MusECore::MidiDevice*) const;
 
       
 
@@ -63,6 +65,7 @@ class MPConfig : public QDialog, Ui::SynthConfigBase {
       void rbClicked(QTableWidgetItem*);
       void mdevViewItemRenamed(QTableWidgetItem*);
       void songChanged(MusECore::SongChangedFlags_t);
+      void heartBeat();
       void selectionChanged();
       void addInstanceClicked();
       void removeInstanceClicked();
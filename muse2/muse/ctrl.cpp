@@ -42,6 +42,8 @@
 
 namespace MusECore {
 
+QAtomicInt CtrlList::_anyGuiUpdatePending(0);
+
 void CtrlList::initColor(int i)
 {
   QColor collist[] = { Qt::red, Qt::yellow, Qt::blue , Qt::black, Qt::white, Qt::green };
@@ -388,7 +390,7 @@ void CtrlList::assign(const CtrlList& l, int flags)
   if(flags & ASSIGN_VALUES)
   {
     std::map<int, CtrlVal, std::less<int> >::operator=(l); // Let map copy the items.
-    _guiUpdatePending = true;
+    setGuiUpdatePending(true);
   }
 }
 
@@ -624,7 +626,7 @@ void CtrlList::setCurVal(double val)
   // If empty, any controller graphs etc. will be displaying this value.
   // Otherwise they'll be displaying the list, so update is not required.
   if(empty() && upd)     
-    _guiUpdatePending = true;
+    setGuiUpdatePending(true);
 }
 
 //---------------------------------------------------------
@@ -652,7 +654,7 @@ CtrlList& CtrlList::operator=(const CtrlList& cl)
   
   // Let map copy the items.
   std::map<int, CtrlVal, std::less<int> >::operator=(cl);
-  _guiUpdatePending = true;
+  setGuiUpdatePending(true);
   return *this;
 }
 
@@ -663,7 +665,7 @@ void CtrlList::swap(CtrlList& cl)
 #endif
   std::map<int, CtrlVal, std::less<int> >::swap(cl);
   cl.setGuiUpdatePending(true);
-  _guiUpdatePending = true;
+  setGuiUpdatePending(true);
 }
 
 std::pair<iCtrl, bool> CtrlList::insert(const std::pair<int, CtrlVal>& p)
@@ -672,7 +674,7 @@ std::pair<iCtrl, bool> CtrlList::insert(const std::pair<int, CtrlVal>& p)
   printf("CtrlList::insert frame:%d val:%f\n", p.first, p.second.val);  
 #endif
   std::pair<iCtrl, bool> res = std::map<int, CtrlVal, std::less<int> >::insert(p);
-  _guiUpdatePending = true;
+  setGuiUpdatePending(true);
   return res;
 }
 
@@ -682,7 +684,7 @@ iCtrl CtrlList::insert(iCtrl ic, const std::pair<int, CtrlVal>& p)
   printf("CtrlList::insert2 frame:%d val:%f\n", p.first, p.second.val); 
 #endif
   iCtrl res = std::map<int, CtrlVal, std::less<int> >::insert(ic, p);
-  _guiUpdatePending = true;
+  setGuiUpdatePending(true);
   return res;
 }
 
@@ -692,7 +694,7 @@ void CtrlList::erase(iCtrl ictl)
   printf("CtrlList::erase iCtrl frame:%d val:%f\n", ictl->second.frame, ictl->second.val);  
 #endif
   std::map<int, CtrlVal, std::less<int> >::erase(ictl);
-  _guiUpdatePending = true;
+  setGuiUpdatePending(true);
 }
 
 std::map<int, CtrlVal, std::less<int> >::size_type CtrlList::erase(int frame)
@@ -701,7 +703,7 @@ std::map<int, CtrlVal, std::less<int> >::size_type CtrlList::erase(int frame)
   printf("CtrlList::erase frame:%d\n", frame);  
 #endif
   size_type res = std::map<int, CtrlVal, std::less<int> >::erase(frame);
-  _guiUpdatePending = true;
+  setGuiUpdatePending(true);
   return res;
 }
 
@@ -713,7 +715,7 @@ void CtrlList::erase(iCtrl first, iCtrl last)
          last->second.frame, last->second.val);  
 #endif
   std::map<int, CtrlVal, std::less<int> >::erase(first, last);
-  _guiUpdatePending = true;
+  setGuiUpdatePending(true);
 }
 
 void CtrlList::clear()
@@ -722,7 +724,7 @@ void CtrlList::clear()
   printf("CtrlList::clear\n");  
 #endif
   std::map<int, CtrlVal, std::less<int> >::clear();
-  _guiUpdatePending = true;
+  setGuiUpdatePending(true);
 }
 
 //---------------------------------------------------------
@@ -741,7 +743,7 @@ void CtrlList::add(int frame, double val)
             printf("CtrlList::add frame:%d val:%f\n", frame, val);  
 #endif
             if(upd)
-              _guiUpdatePending = true;
+              setGuiUpdatePending(true);
       }
       else
             insert(std::pair<const int, CtrlVal> (frame, CtrlVal(frame, val)));
@@ -774,7 +776,7 @@ void CtrlList::updateCurValue(int frame)
   // If empty, any controller graphs etc. will be displaying this value.
   // Otherwise they'll be displaying the list, so update is not required.
   if(empty() && upd)     
-    _guiUpdatePending = true;
+    setGuiUpdatePending(true);
 }
       
 //---------------------------------------------------------
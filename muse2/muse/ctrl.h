@@ -31,6 +31,7 @@
 #include <list>
 #include <vector>
 #include <qcolor.h>
+#include <QAtomicInt>
 #include <lo/lo_osc_types.h>
 
 #define AC_PLUGIN_CTL_BASE         0x1000
@@ -179,6 +180,7 @@ class CtrlList : public std::map<int, CtrlVal, std::less<int> > {
       bool _visible;
       bool _dontShow; // when this is true the control exists but is not compatible with viewing in the arranger
       volatile bool _guiUpdatePending; // Gui heartbeat routines read this. Checked and cleared in Song::beat().
+      static QAtomicInt _anyGuiUpdatePending; // Set with any of the above, so Song::beat() can skip the search.
       void initColor(int i);
 
    public:
@@ -231,7 +233,8 @@ class CtrlList : public std::map<int, CtrlVal, std::less<int> > {
       bool isVisible() const { return _visible; }
       bool dontShow() const { return _dontShow; }
       bool guiUpdatePending() const { return _guiUpdatePending; }
-      void setGuiUpdatePending(bool v) { _guiUpdatePending = v; }
+      void setGuiUpdatePending(bool v) { _guiUpdatePending = v; if(v) _anyGuiUpdatePending.storeRelease(1); }
+      static bool takeAnyGuiUpdatePending() { return _anyGuiUpdatePending.fetchAndStoreOrdered(0) != 0; }
       };
 
 //---------------------------------------------------------
@@ -22,6 +22,8 @@
 
 #include <stdio.h>
 #include <limits.h>
+#include <algorithm>
+#include <set>
 
 #include <QPainter>
 #include <QCursor>
@@ -206,6 +208,10 @@ CtrlCanvas::CtrlCanvas(MidiEditor* e, QWidget* parent, int xmag,
       pos[1] = 0;
       pos[2] = 0;
       noEvents=false;
+      _selSerial  = 0;
+      _laneSerial = 0;
+      _itemsFrom  = 0;
+      _itemsTo    = -1;
       _perNoteVeloMode = MusEGlobal::config.velocityPerNote;
       if(_panel)
         _panel->setVeloPerNoteMode(_perNoteVeloMode);
@@ -332,6 +338,7 @@ void CtrlCanvas::setPos(int idx, unsigned val, bool adjustScrollbar)
 
 void CtrlCanvas::setMidiController(int num)
       {
+      ++_laneSerial;
       _cnum = num;    
       partControllers(curPart, _cnum, &_dnum, &_didx, &_controller, &ctrl);
       
@@ -373,6 +380,20 @@ void CtrlCanvas::deselectAll()
             (*i)->setSelected(false);
 
         selection.clear();
+        
+        // Selected events out of the item range have no items.
+        for (MusECore::iPart p = editor->parts()->begin(); p != editor->parts()->end(); ++p) 
+        {
+          MusECore::MidiPart* part = (MusECore::MidiPart*)(p->second);
+          if (filterTrack && part->track() != curTrack)
+            continue;
+          for (MusECore::ciEvent i = part->events().begin(); i != part->events().end(); ++i)
+            if (i->second.selected() && laneEvent(part, i->second))
+            {
+              MusECore::Event e = i->second;
+              MusEGlobal::song->selectEvent(e, part, false);
+            }
+        }
       }
 
 //---------------------------------------------------------
@@ -489,6 +510,9 @@ void CtrlCanvas::songChanged(MusECore::SongChangedFlags_t type)
   
   if(!curPart)         
     return;
+  
+  if(type & SC_SELECTION)
+    ++_selSerial;
               
   if(type & (SC_CONFIG | SC_DRUMMAP | SC_PART_MODIFIED | SC_EVENT_INSERTED | SC_EVENT_REMOVED | SC_EVENT_MODIFIED))   
     updateItems();
@@ -591,98 +615,179 @@ void CtrlCanvas::partControllers(const MusECore::MidiPart* part, int num, int* d
   }
 }
 
+//---------------------------------------------------------
+//   laneEvent
+//    Whether the event is shown in the current lane.
+//---------------------------------------------------------
+
+bool CtrlCanvas::laneEvent(const MusECore::MidiPart* part, const MusECore::Event& e) const
+{
+  if(_cnum == MusECore::CTRL_VELOCITY && e.type() == MusECore::Note) 
+    // if curDrumPitch==-2, dataA() == curDrumPitch is never true
+    return curDrumPitch == -1 || !_perNoteVeloMode || e.dataA() == curDrumPitch;
+  if(e.type() != MusECore::Controller)
+    return false;
+  
+  int ctl = e.dataA();
+  if(part->track() && part->track()->type() == MusECore::Track::DRUM && (_cnum & 0xff) == 0xff)
+  {
+    if(curDrumPitch < 0)
+      return false;
+    // Default to track port if -1 and track channel if -1.
+    int port = MusEGlobal::drumMap[ctl & 0x7f].port;
+    if(port == -1)
+      port = part->track()->outPort();
+    int chan = MusEGlobal::drumMap[ctl & 0x7f].channel;
+    if(chan == -1)
+      chan = part->track()->outChannel();
+    int cur_port = MusEGlobal::drumMap[curDrumPitch].port;
+    if(cur_port == -1)
+      cur_port = part->track()->outPort();
+    int cur_chan = MusEGlobal::drumMap[curDrumPitch].channel;
+    if(cur_chan == -1)
+      cur_chan = part->track()->outChannel();
+    if((port != cur_port) || (chan != cur_chan))
+      return false;
+    ctl = (ctl & ~0xff) | MusEGlobal::drumMap[ctl & 0x7f].anote;
+  }
+  return ctl == _dnum;
+}
+
 //---------------------------------------------------------
 //   updateItems
 //---------------------------------------------------------
 
 void CtrlCanvas::updateItems()
+      {
+      buildItems();
+      redraw();
+      }
+
+//---------------------------------------------------------
+//   buildItems
+//    Items for the events from a screen before to a screen
+//    after the visible range. A controller lane also gets
+//    the last event before the range, whose value goes in,
+//    and the first one after it, where the last value ends.
+//---------------------------------------------------------
+
+void CtrlCanvas::buildItems()
       {
       selection.clear();
       items.clearDelete();
       
+      const int w = width();
+      _itemsFrom = mapxDev(-w);
+      _itemsTo   = mapxDev(2 * w);
       
-      if(!editor->parts()->empty())
+      std::set<const MusECore::MidiPart*> parts;
+      for (MusECore::iPart p = editor->parts()->begin(); p != editor->parts()->end(); ++p) 
       {
-        CEvent *newev = 0;
-  
-        for (MusECore::iPart p = editor->parts()->begin(); p != editor->parts()->end(); ++p) 
-        {
-              MusECore::Event last;
-              CEvent* lastce  = 0;
-              
-              MusECore::MidiPart* part = (MusECore::MidiPart*)(p->second);
-              
-              if (filterTrack && part->track() != curTrack)
-                continue;
-              
-              MusECore::MidiCtrlValList* mcvl;
-              partControllers(part, _cnum, 0, 0, 0, &mcvl);
-              unsigned len = part->lenTick();
-
-              for (MusECore::ciEvent i = part->events().begin(); i != part->events().end(); ++i) 
+            MusECore::MidiPart* part = (MusECore::MidiPart*)(p->second);
+            parts.insert(part);
+            
+            if (filterTrack && part->track() != curTrack)
+              continue;
+            
+            const int from = _itemsFrom - int(part->tick());
+            const int to   = _itemsTo - int(part->tick());
+            const unsigned len = part->lenTick();
+            if (to < 0 || (from > 0 && unsigned(from) >= len))
+              continue;
+            
+            const MusECore::EventList& el = part->events();
+            MusECore::ciEvent i = from > 0 ? el.lower_bound(from) : el.begin();
+            
+            if(_cnum == MusECore::CTRL_VELOCITY) 
+            {
+              for ( ; i != el.end(); ++i) 
               {
                     const MusECore::Event& e = i->second;
                     // Do not add events which are past the end of the part.
-                    if(e.tick() >= len)
+                    if(e.tick() >= len || int(e.tick()) > to)
                       break;
-                    
-                    if(_cnum == MusECore::CTRL_VELOCITY && e.type() == MusECore::Note) 
-                    {
-                          newev = 0;
-                          if (curDrumPitch == -1 || !_perNoteVeloMode) // and NOT >=0
-                                items.add(newev = new CEvent(e, part, e.velo()));
-                          else if (e.dataA() == curDrumPitch) //same note. if curDrumPitch==-2, this never is true
-                                items.add(newev = new CEvent(e, part, e.velo()));
-                          if(newev && e.selected())
-                            selection.push_back(newev);
-                    }
-                    else if (e.type() == MusECore::Controller) 
-                    {
-                      int ctl = e.dataA();
-                      if(part->track() && part->track()->type() == MusECore::Track::DRUM && (_cnum & 0xff) == 0xff)
-                      {
-                        if(curDrumPitch < 0)
-                          continue;
-                        // Default to track port if -1 and track channel if -1.
-                        int port = MusEGlobal::drumMap[ctl & 0x7f].port;
-                        if(port == -1)
-                          port = part->track()->outPort();
-                        int chan = MusEGlobal::drumMap[ctl & 0x7f].channel;
-                        if(chan == -1)
-                          chan = part->track()->outChannel();
-                        int cur_port = MusEGlobal::drumMap[curDrumPitch].port;
-                        if(cur_port == -1)
-                          cur_port = part->track()->outPort();
-                        int cur_chan = MusEGlobal::drumMap[curDrumPitch].channel;
-                        if(cur_chan == -1)
-                          cur_chan = part->track()->outChannel();
-                        if((port != cur_port) || (chan != cur_chan))
-                          continue;
-                        ctl = (ctl & ~0xff) | MusEGlobal::drumMap[ctl & 0x7f].anote;
-                      }
-                      if(ctl == _dnum)
-                      {
-                          if(mcvl && last.empty()) 
-                          {
-                                lastce = new CEvent(MusECore::Event(), part, mcvl->value(part->tick()));
-                                items.add(lastce);
-                          }
-                          if (lastce)
-                                lastce->setEX(e.tick());
-                          lastce = new CEvent(e, part, e.dataB());
-                          lastce->setEX(-1);
-                          items.add(lastce);
-                          if(e.selected())
-                            selection.push_back(lastce);
-                          last = e;
-                      }
-                    }    
+                    if(e.type() != MusECore::Note || !laneEvent(part, e))
+                      continue;
+                    CEvent* newev = new CEvent(e, part, e.velo());
+                    items.add(newev);
+                    if(e.selected())
+                      selection.push_back(newev);
               }
-        }
-      }  
-      redraw();
+              continue;
+            }
+            
+            MusECore::MidiCtrlValList* mcvl;
+            partControllers(part, _cnum, 0, 0, 0, &mcvl);
+            
+            // The value going into the range.
+            CEvent* lastce = 0;
+            for (MusECore::ciEvent k = i; k != el.begin(); )
+            {
+                  --k;
+                  if (!laneEvent(part, k->second))
+                    continue;
+                  lastce = new CEvent(k->second, part, k->second.dataB());
+                  lastce->setEX(-1);
+                  items.add(lastce);
+                  if(k->second.selected())
+                    selection.push_back(lastce);
+                  break;
+            }
+            bool have_last = lastce != 0;
+            
+            for ( ; i != el.end(); ++i) 
+            {
+                  const MusECore::Event& e = i->second;
+                  // Do not add events which are past the end of the part.
+                  if(e.tick() >= len)
+                    break;
+                  if(!laneEvent(part, e))
+                    continue;
+                  if(mcvl && !have_last) 
+                  {
+                        lastce = new CEvent(MusECore::Event(), part, mcvl->value(part->tick()));
+                        items.add(lastce);
+                  }
+                  have_last = true;
+                  if (lastce)
+                        lastce->setEX(e.tick());
+                  lastce = new CEvent(e, part, e.dataB());
+                  lastce->setEX(-1);
+                  items.add(lastce);
+                  if(e.selected())
+                    selection.push_back(lastce);
+                  if(int(e.tick()) > to)
+                    break;
+            }
+      }
+      
+      // Forget the columns of parts which are gone.
+      for (std::map<const MusECore::MidiPart*, CtrlLod>::iterator l = _lod.begin(); l != _lod.end(); )
+      {
+            if (parts.find(l->first) == parts.end())
+              _lod.erase(l++);
+            else
+              ++l;
+      }
     }
 
+//---------------------------------------------------------
+//   partItems
+//    The part's items, valid while drawing.
+//---------------------------------------------------------
+
+void CtrlCanvas::partItems(const MusECore::MidiPart* part, iCEvent* begin, iCEvent* end)
+{
+  std::map<const MusECore::MidiPart*, std::pair<iCEvent, iCEvent> >::iterator i = _partItems.find(part);
+  if(i == _partItems.end())
+  {
+    *begin = *end = items.end();
+    return;
+  }
+  *begin = i->second.first;
+  *end   = i->second.second;
+}
+
 //---------------------------------------------------------
 //   updateSelections
 //---------------------------------------------------------
@@ -1592,17 +1697,16 @@ void CtrlCanvas::pdrawItems(QPainter& p, const QRect& rect, const MusECore::Midi
   int w = rect.width() + 2;
   int wh = height();
   
-  noEvents=true;
+  noEvents = items.empty();
+  iCEvent ib, ie;
+  partItems(part, &ib, &ie);
 
   if(velo) 
   {
     noEvents=false;
-    for(iCEvent i = items.begin(); i != items.end(); ++i) 
+    for(iCEvent i = ib; i != ie; ++i) 
     {
       CEvent* e = *i;
-      // Draw selected part velocity events on top of unselected part events.
-      if(e->part() != part)
-        continue;
       MusECore::Event event = e->event();
       int tick = mapx(event.tick() + e->part()->tick());
       if (tick <= x)
@@ -1662,16 +1766,25 @@ void CtrlCanvas::pdrawItems(QPainter& p, const QRect& rect, const MusECore::Midi
       max  = mc->maxVal();
       bias  = mc->bias();
     }
+    
+    // More events than pixels: draw the columns instead.
+    if(xmag < 0)
+    {
+      const CtrlLod& lod = partLod(part, cnum, is_drum_ctl);
+      if(lod.dense)
+      {
+        noEvents=false;
+        pdrawLod(p, lod, x, w, min, max, bias, fg);
+        return;
+      }
+    }
+    
     int x1   = rect.x();
     int lval = MusECore::CTRL_VAL_UNKNOWN;
     bool selected = false;
-    for (iCEvent i = items.begin(); i != items.end(); ++i) 
+    for (iCEvent i = ib; i != ie; ++i) 
     {
-      noEvents=false;
       CEvent* e = *i;
-      // Draw unselected part controller events (lines) on top of selected part events (bars).
-      if(e->part() != part)
-        continue;
       MusECore::Event ev = e->event();
       // Draw drum controllers from another drum on top of ones from this drum.
       if(is_drum_ctl && ev.type() == MusECore::Controller && ev.dataA() != _didx)
@@ -1751,6 +1864,209 @@ void CtrlCanvas::pdrawItems(QPainter& p, const QRect& rect, const MusECore::Midi
   }       
 }
 
+//---------------------------------------------------------
+//   addToColumn
+//---------------------------------------------------------
+
+static void addToColumn(CtrlLod& lod, int col, int val, bool selected)
+{
+  if(lod.columns.empty() || lod.columns.back().col != col)
+  {
+    CtrlColumn c;
+    c.col = col;
+    c.min = c.max = c.last = val;
+    c.selected = c.lastSelected = selected;
+    lod.columns.push_back(c);
+    return;
+  }
+  CtrlColumn& c = lod.columns.back();
+  if(val != MusECore::CTRL_VAL_UNKNOWN)
+  {
+    if(c.min == MusECore::CTRL_VAL_UNKNOWN || val < c.min)
+      c.min = val;
+    if(c.max == MusECore::CTRL_VAL_UNKNOWN || val > c.max)
+      c.max = val;
+  }
+  c.last = val;
+  c.lastSelected = selected;
+  if(selected)
+    c.selected = true;
+}
+
+//---------------------------------------------------------
+//   partLod
+//    Collects the part's lane events into pixel columns at
+//    the current zoom (xmag < 0). Kept until the zoom, the
+//    part's events, the selection or the lane change.
+//---------------------------------------------------------
+
+const CtrlLod& CtrlCanvas::partLod(const MusECore::MidiPart* part, int cnum, bool is_drum_ctl)
+{
+  const int tpp = -xmag;
+  CtrlLod& lod = _lod[part];
+  if(lod.tpp == tpp && lod.revision == part->eventsRevision()
+     && lod.selSerial == _selSerial && lod.laneSerial == _laneSerial)
+    return lod;
+  lod.tpp        = tpp;
+  lod.revision   = part->eventsRevision();
+  lod.selSerial  = _selSerial;
+  lod.laneSerial = _laneSerial;
+  lod.columns.clear();
+  
+  MusECore::MidiCtrlValList* mcvl;
+  partControllers(part, _cnum, 0, 0, 0, &mcvl);
+  const unsigned len  = part->lenTick();
+  const int part_tick = part->tick();
+  
+  int events = 0;
+  bool have_first = false;
+  const MusECore::EventList& el = part->events();
+  for(MusECore::ciEvent i = el.begin(); i != el.end(); ++i) 
+  {
+    const MusECore::Event& ev = i->second;
+    if(ev.tick() >= len)
+      break;
+    if(!laneEvent(part, ev))
+      continue;
+    // The value at the part start, drawn from the left edge as its item is.
+    if(mcvl && !have_first)
+    {
+      int val = mcvl->value(part_tick);
+      if(cnum == MusECore::CTRL_PROGRAM && val != MusECore::CTRL_VAL_UNKNOWN)
+        val = (val & 0xff) == 0xff ? 1 : (val & 0x7f) + 1;
+      addToColumn(lod, 0, val, false);
+      ++events;
+    }
+    have_first = true;
+    if(is_drum_ctl && ev.dataA() != _didx)
+      continue;
+    int val = ev.dataB();
+    if(cnum == MusECore::CTRL_PROGRAM && val != MusECore::CTRL_VAL_UNKNOWN)
+      val = (val & 0xff) == 0xff ? 1 : (val & 0x7f) + 1;
+    addToColumn(lod, (ev.tick() + part_tick) / tpp, val, ev.selected());
+    ++events;
+  }
+  lod.dense = events > int(lod.columns.size());
+  return lod;
+}
+
+//---------------------------------------------------------
+//   pdrawLod
+//    Same drawing as pdrawItems, with each column drawn
+//    as the range of the values set in it: a bar up to the
+//    highest one, or a line over the range for fg.
+//---------------------------------------------------------
+
+static bool columnBefore(const CtrlColumn& c, int col)
+{
+  return c.col < col;
+}
+
+void CtrlCanvas::pdrawLod(QPainter& p, const CtrlLod& lod, int x, int w, int min, int max, int bias, bool fg)
+{
+  const int wh = height();
+  const int tpp = lod.tpp;
+  
+  // Start one column early, mapx() rounds.
+  std::vector<CtrlColumn>::const_iterator i = std::lower_bound(lod.columns.begin(), lod.columns.end(),
+     mapxDev(x) / tpp - 1, columnBefore);
+  int val = MusECore::CTRL_VAL_UNKNOWN;
+  bool selected = false;
+  if(i != lod.columns.begin())
+  {
+    val = (i - 1)->last;
+    selected = (i - 1)->lastSelected;
+  }
+  
+  int x1 = x + 1;   // rect.x()
+  for( ; i != lod.columns.end(); ++i)
+  {
+    int cx = mapx(i->col * tpp);
+    if(cx <= x)
+    {
+      val = i->last;
+      selected = i->lastSelected;
+      continue;
+    }
+    if(cx > x + w)
+      break;
+    
+    // The value held up to this column.
+    if(cx <= x1)
+      ;
+    else if(val == MusECore::CTRL_VAL_UNKNOWN)
+    {
+      if(!fg)
+        p.fillRect(x1, 0, cx - x1, wh, Qt::darkGray);
+    }
+    else
+    {
+      const int y = wh - ((val - min - bias) * wh / (max - min));
+      if(fg)
+      {
+        p.setPen(Qt::gray);
+        p.drawLine(x1, y, cx, y);
+      }
+      else
+        p.fillRect(x1, y, cx - x1, wh - y, selected ? Qt::blue : MusEGlobal::config.ctrlGraphFg);
+    }
+    
+    // The column, including the value going in.
+    int cw = mapx((i->col + 1) * tpp) - cx;
+    if(cw < 1)
+      cw = 1;
+    int lo = i->min;
+    int hi = i->max;
+    if(val != MusECore::CTRL_VAL_UNKNOWN)
+    {
+      if(lo == MusECore::CTRL_VAL_UNKNOWN || val < lo)
+        lo = val;
+      if(hi == MusECore::CTRL_VAL_UNKNOWN || val > hi)
+        hi = val;
+    }
+    if(hi == MusECore::CTRL_VAL_UNKNOWN)
+    {
+      if(!fg)
+        p.fillRect(cx, 0, cw, wh, Qt::darkGray);
+    }
+    else
+    {
+      const int yhi = wh - ((hi - min - bias) * wh / (max - min));
+      const int ylo = wh - ((lo - min - bias) * wh / (max - min));
+      if(fg)
+      {
+        p.setPen(Qt::gray);
+        p.drawLine(cx, yhi, cx, ylo);
+      }
+      else
+        p.fillRect(cx, yhi, cw, wh - yhi, i->selected ? Qt::blue : MusEGlobal::config.ctrlGraphFg);
+    }
+    
+    x1 = cx + cw;
+    val = i->last;
+    selected = i->lastSelected;
+  }
+  
+  if(x1 >= x + w)
+    return;
+  if(val == MusECore::CTRL_VAL_UNKNOWN)
+  {
+    if(!fg)
+      p.fillRect(x1, 0, (x+w) - x1, wh, Qt::darkGray);
+  }
+  else
+  {
+    const int y = wh - ((val - min - bias) * wh / (max - min));
+    if(fg)
+    {
+      p.setPen(Qt::gray);
+      p.drawLine(x1, y, x + w, y);
+    }
+    else
+      p.fillRect(x1, y, (x+w) - x1, wh - y, selected ? Qt::blue : MusEGlobal::config.ctrlGraphFg);
+  }
+}
+
 //---------------------------------------------------------
 //   pdrawExtraDrumCtrlItems
 //---------------------------------------------------------
@@ -1761,7 +2077,9 @@ void CtrlCanvas::pdrawExtraDrumCtrlItems(QPainter& p, const QRect& rect, const M
   int w = rect.width() + 2;
   int wh = height();
   
-  noEvents=true;
+  noEvents = items.empty();
+  iCEvent ib, ie;
+  partItems(part, &ib, &ie);
 
   {
     if(!part)         
@@ -1804,13 +2122,9 @@ void CtrlCanvas::pdrawExtraDrumCtrlItems(QPainter& p, const QRect& rect, const M
     int x1   = rect.x();
     int lval = MusECore::CTRL_VAL_UNKNOWN;
     //bool selected = false;
-    for (iCEvent i = items.begin(); i != items.end(); ++i) 
+    for (iCEvent i = ib; i != ie; ++i) 
     {
-      noEvents=false;
       CEvent* e = *i;
-      // Draw unselected part controller events (lines) on top of selected part events (bars).
-      if(e->part() != part)
-        continue;
       MusECore::Event ev = e->event();
       // Draw drum controllers from another drum on top of ones from this drum.
       // FIXME TODO Finish this off, not correct yet.
@@ -1886,6 +2200,24 @@ void CtrlCanvas::pdraw(QPainter& p, const QRect& rect)
       int w = rect.width() + 2;
       int h = rect.height();
       
+      // Scrolled or zoomed out of the item range, or zoomed in
+      //  far from it: make the items for the new range.
+      const int from = mapxDev(x);
+      const int to   = mapxDev(x + w);
+      const int vis  = mapxDev(width()) - mapxDev(0);
+      if(from < _itemsFrom || to > _itemsTo || _itemsTo - _itemsFrom > 6 * vis)
+        buildItems();
+      
+      _partItems.clear();
+      for(iCEvent i = items.begin(); i != items.end(); )
+      {
+        const MusECore::MidiPart* part = (*i)->part();
+        iCEvent b = i;
+        while(i != items.end() && (*i)->part() == part)
+          ++i;
+        _partItems[part] = std::make_pair(b, i);
+      }
+      
       //---------------------------------------------------
       // draw Canvas Items
       //---------------------------------------------------
@@ -2073,6 +2405,7 @@ void CtrlCanvas::draw(QPainter& p, const QRect& rect)
 
 void CtrlCanvas::setCurDrumPitch(int instrument)
 {
+      ++_laneSerial;
       DrumEdit* drumedit = dynamic_cast<DrumEdit*>(editor);
       if (drumedit == NULL || drumedit->old_style_drummap_mode())
         curDrumPitch = instrument;
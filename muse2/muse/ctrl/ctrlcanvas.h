@@ -24,7 +24,8 @@
 #define __CTRLCANVAS_H__
 
 #include <list>
-
+#include <map>
+#include <vector>
 
 #include "type_defs.h"
 #include "view.h"
@@ -76,6 +77,39 @@ class CEvent {
       int x()                      { return ex; }
       };
 
+//---------------------------------------------------------
+//   CtrlColumn
+//    The controller values set within one pixel column,
+//    program numbers already made 1 based.
+//---------------------------------------------------------
+
+struct CtrlColumn {
+      int col;              // tick / ticks per pixel
+      int min, max;         // CTRL_VAL_UNKNOWN if none known
+      int last;             // value in effect at the column end
+      bool selected;        // any of its events
+      bool lastSelected;
+      };
+
+//---------------------------------------------------------
+//   CtrlLod
+//    A part's controller lane decimated to pixel columns,
+//    made from the part's events. Used for drawing when
+//    there are more events than columns, editing always
+//    works on the items. Made again when anything it was
+//    made from changes.
+//---------------------------------------------------------
+
+struct CtrlLod {
+      int tpp;              // ticks per pixel it was made for
+      unsigned revision;    // of the part's events
+      unsigned selSerial;   // CtrlCanvas::_selSerial
+      unsigned laneSerial;  // CtrlCanvas::_laneSerial
+      bool dense;
+      std::vector<CtrlColumn> columns;
+      CtrlLod() : tpp(0), revision(0), selSerial(0), laneSerial(0), dense(false) {}
+      };
+
 typedef std::list<CEvent*>::iterator iCEvent;
 typedef std::list<CEvent*>::const_iterator ciCEvent;
 
@@ -115,6 +149,16 @@ class CtrlCanvas : public MusEGui::View {
       bool drawLineMode;
       bool noEvents;
       bool filterTrack;
+      std::map<const MusECore::MidiPart*, CtrlLod> _lod;
+      unsigned _selSerial;    // bumped when the selection may have changed
+      unsigned _laneSerial;   // bumped when the lane shown changes
+      // Items are only made for the events in this tick range,
+      //  the visible one and a screen on either side.
+      int _itemsFrom;
+      int _itemsTo;
+      // Range of each part's items in the item list, made
+      //  before drawing.
+      std::map<const MusECore::MidiPart*, std::pair<iCEvent, iCEvent> > _partItems;
 
       void viewMousePressEvent(QMouseEvent* event);
       void viewMouseMoveEvent(QMouseEvent*);
@@ -134,7 +178,12 @@ class CtrlCanvas : public MusEGui::View {
       void deleteVal(int x1, int x2, int y);
 
       bool setCurTrackAndPart();
+      bool laneEvent(const MusECore::MidiPart* part, const MusECore::Event& e) const;
+      void buildItems();
+      void partItems(const MusECore::MidiPart* part, iCEvent* begin, iCEvent* end);
       void pdrawItems(QPainter& p, const QRect& rect, const MusECore::MidiPart* part, bool velo, bool fg);
+      const CtrlLod& partLod(const MusECore::MidiPart* part, int cnum, bool is_drum_ctl);
+      void pdrawLod(QPainter& p, const CtrlLod& lod, int x, int w, int min, int max, int bias, bool fg);
       void pdrawExtraDrumCtrlItems(QPainter& p, const QRect& rect, const MusECore::MidiPart* part, int drum_ctl);
       void partControllers(const MusECore::MidiPart*, int, int*, int*, MusECore::MidiController**, MusECore::MidiCtrlValList**);
       
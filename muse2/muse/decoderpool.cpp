@@ -0,0 +1,507 @@
+//=========================================================
+//  MusE
+//  Linux Music Editor
+//
+//  decoderpool.cpp
+//
+//  This program is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU General Public License
+//  as published by the Free Software Foundation; version 2 of
+//  the License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+//
+//=========================================================
+
+#include <string.h>
+#include <time.h>
+#include <algorithm>
+
+#include <QThread>
+#include <QMutexLocker>
+#include <QReadLocker>
+#include <QWriteLocker>
+#include <QStringList>
+
+#include "decoderpool.h"
+#include "sampleconv.h"
+#include "gconfig.h"
+
+namespace MusEGlobal {
+MusECore::DecoderPool* decoderPool = 0;
+}
+
+namespace MusECore {
+
+//---------------------------------------------------------
+//   initDecoderPool
+//    No threads, no pool: the prefetch thread decodes.
+//---------------------------------------------------------
+
+void initDecoderPool()
+{
+  if (MusEGlobal::config.decoderThreads > 0)
+    MusEGlobal::decoderPool = new DecoderPool(MusEGlobal::config.decoderThreads);
+}
+
+//---------------------------------------------------------
+//   cpuTime
+//---------------------------------------------------------
+
+static double cpuTime()
+      {
+      struct timespec ts;
+      clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+      return ts.tv_sec + ts.tv_nsec * 1e-9;
+      }
+
+//---------------------------------------------------------
+//   DecodeStream
+//---------------------------------------------------------
+
+DecodeStream::DecodeStream(const SndFileR& f, sf_count_t start, sf_count_t len,
+   sf_count_t songOffset, unsigned aheadFrames)
+   : _refs(1), _closed(0), _file(f)
+      {
+      _channels   = _file.channels();
+      _start      = start;
+      _end        = start + len;
+      _songOffset = songOffset;
+
+      _sf         = 0;
+      _generation = 0;
+      _sfPos      = -1;
+      _cpu        = 0.0;
+      _decoded    = 0;
+
+      _size       = std::max(aheadFrames, unsigned(DecoderPool::ChunkSamples));
+      _ring.resize(size_t(_size) * _channels);
+      _head       = start;
+      _fill       = 0;
+      _loopSize   = std::min(_size / 4, _file.samplerate());
+      _loop.resize(size_t(_loopSize) * _channels);
+      _loopHead   = -1;
+      _loopFill   = 0;
+      _misses     = 0;
+      }
+
+DecodeStream::~DecodeStream()
+      {
+      if (_sf)
+            _file->giveBackReadHandle(_sf, _generation);
+      }
+
+//---------------------------------------------------------
+//   decode
+//    n frames from file frame pos on, interleaved. Must be
+//    called with _decodeLock held.
+//---------------------------------------------------------
+
+unsigned DecodeStream::decode(sf_count_t pos, float* buffer, unsigned n)
+      {
+      if (_sf && _generation != _file->readGeneration.load()) {
+            // The file data changed, so did what is decoded.
+            sf_close(_sf);
+            _sf = 0;
+            QMutexLocker locker(&_lock);
+            _fill     = 0;
+            _loopHead = -1;
+            _loopFill = 0;
+            }
+      if (!_sf) {
+            _sf = _file->takeReadHandle(&_generation);
+            if (!_sf)
+                  return 0;
+            _sfPos = -1;
+            }
+      const double t0 = cpuTime();
+      if (pos != _sfPos) {
+            _sfPos = sf_seek(_sf, pos, SEEK_SET);
+            if (_sfPos != pos) {
+                  _sfPos = -1;
+                  return 0;
+                  }
+            }
+      sf_count_t rn = sf_readf_float(_sf, buffer, n);
+      if (rn < 0)
+            rn = 0;
+      _sfPos   += rn;
+      _decoded += rn;
+      _cpu     += cpuTime() - t0;
+      return rn;
+      }
+
+//---------------------------------------------------------
+//   put
+//    Into the ring. Must be called with _lock held.
+//---------------------------------------------------------
+
+void DecodeStream::put(sf_count_t pos, const float* src, unsigned n)
+      {
+      unsigned done = 0;
+      while (done < n) {
+            unsigned slot = (pos + done) % _size;
+            unsigned m    = std::min(n - done, _size - slot);
+            memcpy(&_ring[size_t(slot) * _channels], src + size_t(done) * _channels,
+               size_t(m) * _channels * sizeof(float));
+            done += m;
+            }
+      }
+
+//---------------------------------------------------------
+//   take
+//    Out of the ring into the track buffers. Must be
+//    called with _lock held.
+//---------------------------------------------------------
+
+void DecodeStream::take(int channels, float** dst, sf_count_t pos, unsigned n, bool overwrite)
+      {
+      unsigned done = 0;
+      while (done < n) {
+            unsigned slot = (pos + done) % _size;
+            unsigned m    = std::min(n - done, _size - slot);
+            float* d[channels];
+            for (int ch = 0; ch < channels; ++ch)
+                  d[ch] = dst[ch] + done;
+            deinterleave(&_ring[size_t(slot) * _channels], _channels, d, channels, m, overwrite);
+            done += m;
+            }
+      }
+
+//---------------------------------------------------------
+//   read
+//    Prefetch thread. Like SndFileReader::read.
+//---------------------------------------------------------
+
+size_t DecodeStream::read(int channels, float** dst, size_t n, sf_count_t pos, bool overwrite)
+      {
+      {
+      QMutexLocker locker(&_lock);
+      const bool inRing = pos >= _head && pos + sf_count_t(n) <= _head + _fill;
+      if (!inRing && _loopFill && pos >= _loopHead && pos + sf_count_t(n) <= _loopHead + _loopFill) {
+            // The song looped, as predicted.
+            _head = _loopHead;
+            _fill = _loopFill;
+            put(_loopHead, &_loop[0], _loopFill);
+            _loopHead = -1;
+            _loopFill = 0;
+            }
+      if (pos >= _head && pos + sf_count_t(n) <= _head + _fill) {
+            take(channels, dst, pos, n, overwrite);
+            _fill -= pos + n - _head;
+            _head  = pos + n;
+            return n;
+            }
+      }
+
+      // Not decoded yet: after a seek, or the pool is behind.
+      QMutexLocker decodeLocker(&_decodeLock);
+      float buffer[n * _channels];
+      unsigned rn = decode(pos, buffer, n);
+      deinterleave(buffer, _channels, dst, channels, rn, overwrite);
+      QMutexLocker locker(&_lock);
+      ++_misses;
+      _head = pos + rn;
+      _fill = 0;
+      return rn;
+      }
+
+//---------------------------------------------------------
+//   decodeAhead
+//    Decoder thread. Decodes a chunk of chunkSamples
+//    samples into the ring or, when the ring is filled up
+//    to the loop end, into the loop buffer. False if there
+//    was nothing to do.
+//---------------------------------------------------------
+
+bool DecodeStream::decodeAhead(float* chunk, unsigned chunkSamples, bool loop,
+   sf_count_t loopStart, sf_count_t loopEnd)
+      {
+      const unsigned chunkFrames = chunkSamples / _channels;
+      if (chunkFrames == 0 || _closed.load() || !_decodeLock.tryLock())
+            return false;     // the prefetch thread decodes itself
+
+      // The loop in file frames, if it ends inside the event.
+      sf_count_t stop    = _end;
+      sf_count_t restart = -1;
+      if (loop) {
+            sf_count_t from = loopEnd - _songOffset;
+            sf_count_t to   = std::max(loopStart - _songOffset, _start);
+            if (from > _start && from <= _end) {
+                  stop = from;
+                  if (to < from)
+                        restart = to;
+                  }
+            }
+
+      sf_count_t at = 0;
+      unsigned n    = 0;
+      bool toLoop   = false;
+      {
+      QMutexLocker locker(&_lock);
+      at = _head + _fill;
+      if (at < stop && _fill < _size)
+            n = std::min(sf_count_t(std::min(chunkFrames, _size - _fill)), stop - at);
+      else if (restart >= 0) {
+            if (_loopHead != restart) {
+                  _loopHead = restart;
+                  _loopFill = 0;
+                  }
+            at = _loopHead + _loopFill;
+            if (_loopFill < _loopSize && at < stop) {
+                  n = std::min(sf_count_t(std::min(chunkFrames, _loopSize - _loopFill)), stop - at);
+                  toLoop = true;
+                  }
+            }
+      }
+      if (n == 0) {
+            _decodeLock.unlock();
+            return false;
+            }
+
+      unsigned rn = decode(at, chunk, n);
+      {
+      // Reading on only moves _head, not where the decoded
+      //  frames go. If the loop buffer went into the ring
+      //  meanwhile, they go there.
+      QMutexLocker locker(&_lock);
+      if (toLoop && _loopHead + _loopFill == at) {
+            memcpy(&_loop[size_t(_loopFill) * _channels], chunk, size_t(rn) * _channels * sizeof(float));
+            _loopFill += rn;
+            }
+      else if (_head + _fill == at && _fill + rn <= _size) {
+            put(at, chunk, rn);
+            _fill += rn;
+            }
+      }
+      _decodeLock.unlock();
+      return rn > 0;
+      }
+
+//---------------------------------------------------------
+//   fill
+//---------------------------------------------------------
+
+unsigned DecodeStream::fill()
+      {
+      QMutexLocker locker(&_lock);
+      return _fill;
+      }
+
+//---------------------------------------------------------
+//   DecoderThread
+//---------------------------------------------------------
+
+class DecoderThread : public QThread {
+      DecoderPool* _pool;
+      float* _chunk;
+
+   public:
+      volatile bool quit;
+
+      DecoderThread(DecoderPool* p) : _pool(p), quit(false) {
+            _chunk = new float[DecoderPool::ChunkSamples];
+            }
+      ~DecoderThread() {
+            delete[] _chunk;
+            }
+      virtual void run() {
+            while (!quit) {
+                  if (!_pool->pass(_chunk))
+                        msleep(5);
+                  }
+            }
+      };
+
+//---------------------------------------------------------
+//   DecoderPool
+//---------------------------------------------------------
+
+DecoderPool::DecoderPool(int threads)
+      {
+      _loopOn    = false;
+      _loopStart = 0;
+      _loopEnd   = 0;
+      _seeking.store(0);
+      for (int i = 0; i < threads; ++i) {
+            DecoderThread* t = new DecoderThread(this);
+            t->start(QThread::HighPriority);
+            _threads.push_back(t);
+            }
+      }
+
+//---------------------------------------------------------
+//   ~DecoderPool
+//    The open streams belong to their readers.
+//---------------------------------------------------------
+
+DecoderPool::~DecoderPool()
+      {
+      for (size_t i = 0; i < _threads.size(); ++i)
+            _threads[i]->quit = true;
+      for (size_t i = 0; i < _threads.size(); ++i) {
+            _threads[i]->wait();
+            delete _threads[i];
+            }
+      collect();
+      }
+
+//---------------------------------------------------------
+//   pass
+//    One round over the streams of a decoder thread, the
+//    one with the fewest decoded frames first. Decodes
+//    from a referenced copy of the list, so that open()
+//    and close() of the prefetch thread never wait for a
+//    decode.
+//---------------------------------------------------------
+
+bool DecoderPool::pass(float* chunk)
+      {
+      // What would be decoded now is thrown away by the seek.
+      if (_seeking.load())
+            return false;
+
+      bool loop;
+      sf_count_t loopStart, loopEnd;
+      {
+      QMutexLocker locker(&_loopLock);
+      loop      = _loopOn;
+      loopStart = _loopStart;
+      loopEnd   = _loopEnd;
+      }
+
+      std::vector<DecodeStream*> streams;
+      {
+      QReadLocker locker(&_lock);
+      streams = _streams;
+      for (size_t i = 0; i < streams.size(); ++i)
+            streams[i]->_refs.ref();
+      }
+
+      std::vector<std::pair<unsigned, DecodeStream*> > order;
+      for (size_t i = 0; i < streams.size(); ++i)
+            order.push_back(std::make_pair(streams[i]->fill(), streams[i]));
+      std::sort(order.begin(), order.end());
+      bool work = false;
+      for (size_t i = 0; i < order.size(); ++i)
+            if (order[i].second->decodeAhead(chunk, ChunkSamples, loop, loopStart, loopEnd))
+                  work = true;
+
+      for (size_t i = 0; i < streams.size(); ++i)
+            streams[i]->_refs.deref();
+      return work;
+      }
+
+//---------------------------------------------------------
+//   collect
+//    Prefetch thread. Deletes the closed streams no pass
+//    decodes any more, keeping their statistics. The
+//    file references they hold are dropped here, not in
+//    a decoder thread.
+//---------------------------------------------------------
+
+void DecoderPool::collect()
+      {
+      std::vector<DecodeStream*>::iterator i = _closing.begin();
+      while (i != _closing.end()) {
+            DecodeStream* s = *i;
+            if (s->_refs.loadAcquire() != 1) {
+                  ++i;
+                  continue;
+                  }
+            {
+            QMutexLocker locker(&_statsLock);
+            FileStats& st = _stats[s->_file.path()];
+            st.cpu     += s->_cpu;
+            st.seconds += double(s->_decoded) / s->_file.samplerate();
+            st.streams += 1;
+            st.misses  += s->_misses;
+            }
+            delete s;
+            i = _closing.erase(i);
+            }
+      }
+
+//---------------------------------------------------------
+//   open
+//    Prefetch thread. A stream for the event playing file
+//    frames start to start + len, the event's song frame
+//    minus its file frame is songOffset.
+//---------------------------------------------------------
+
+DecodeStream* DecoderPool::open(const SndFileR& f, sf_count_t start, sf_count_t len,
+   sf_count_t songOffset)
+      {
+      unsigned ahead = MusEGlobal::config.decoderAheadSeconds * f.samplerate();
+      DecodeStream* s = new DecodeStream(f, start, len, songOffset, ahead);
+      QWriteLocker locker(&_lock);
+      _streams.push_back(s);
+      return s;
+      }
+
+//---------------------------------------------------------
+//   close
+//    Prefetch thread, the event is done. The stream goes
+//    away now, or after the pass decoding it.
+//---------------------------------------------------------
+
+void DecoderPool::close(DecodeStream* s)
+      {
+      s->_closed.store(1);
+      {
+      QWriteLocker locker(&_lock);
+      std::vector<DecodeStream*>::iterator i = std::find(_streams.begin(), _streams.end(), s);
+      if (i != _streams.end())
+            _streams.erase(i);
+      }
+      _closing.push_back(s);
+      collect();
+      }
+
+//---------------------------------------------------------
+//   setLoop
+//    Prefetch thread, the loop it plays, in song frames.
+//---------------------------------------------------------
+
+void DecoderPool::setLoop(bool on, unsigned start, unsigned end)
+      {
+      {
+      QMutexLocker locker(&_loopLock);
+      _loopOn    = on;
+      _loopStart = start;
+      _loopEnd   = end;
+      }
+      // Called for each prefetch, so closed streams go soon.
+      collect();
+      }
+
+//---------------------------------------------------------
+//   statistics
+//    Decoding cpu time per file, of the streams done with.
+//---------------------------------------------------------
+
+QString DecoderPool::statistics()
+      {
+      QMutexLocker locker(&_statsLock);
+      QStringList l;
+      for (std::map<QString, FileStats>::const_iterator i = _stats.begin(); i != _stats.end(); ++i) {
+            const FileStats& st = i->second;
+            l.append(QString("decoder: %1: %2 s cpu for %3 s audio (%4%), %5 streams, %6 misses")
+               .arg(i->first)
+               .arg(st.cpu, 0, 'f', 3)
+               .arg(st.seconds, 0, 'f', 1)
+               .arg(st.seconds > 0.0 ? 100.0 * st.cpu / st.seconds : 0.0, 0, 'f', 2)
+               .arg(st.streams)
+               .arg(st.misses));
+            }
+      return l.join("\n");
+      }
+
+} // namespace MusECore
@@ -0,0 +1,148 @@
+//=========================================================
+//  MusE
+//  Linux Music Editor
+//
+//  decoderpool.h
+//
+//  This program is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU General Public License
+//  as published by the Free Software Foundation; version 2 of
+//  the License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+//
+//=========================================================
+
+#ifndef __DECODERPOOL_H__
+#define __DECODERPOOL_H__
+
+#include <map>
+#include <vector>
+
+#include <QAtomicInt>
+#include <QMutex>
+#include <QReadWriteLock>
+#include <QString>
+
+#include "wave.h"
+
+namespace MusECore {
+
+class DecoderThread;
+
+//---------------------------------------------------------
+//   DecodeStream
+//    One playing event of a compressed file. The pool
+//    decodes the frames after the read position into a
+//    ring, and, when the song loops inside the event, the
+//    frames at the loop start into a second buffer. The
+//    prefetch thread takes them from there. What is not
+//    decoded yet it decodes itself, like before.
+//    Referenced by its reader and by each pass decoding
+//    it. Deleted by the prefetch thread once closed and
+//    no pass holds it any more.
+//---------------------------------------------------------
+
+class DecodeStream {
+      QAtomicInt _refs;
+      QAtomicInt _closed;           // the event is done, decode no more
+      SndFileR _file;
+      int _channels;                // of the file
+      sf_count_t _start, _end;      // file frames of the event
+      sf_count_t _songOffset;       // song frame - file frame
+
+      QMutex _decodeLock;           // the handle below
+      SNDFILE* _sf;
+      int _generation;
+      sf_count_t _sfPos;
+      double _cpu;                  // decoding, thread cpu seconds
+      sf_count_t _decoded;
+
+      QMutex _lock;                 // everything below
+      std::vector<float> _ring;     // interleaved, frame f at f % _size
+      unsigned _size;
+      sf_count_t _head;             // next frame the prefetch thread reads
+      unsigned _fill;               // decoded frames from _head on
+      std::vector<float> _loop;     // interleaved, from _loopHead on
+      unsigned _loopSize;
+      sf_count_t _loopHead;
+      unsigned _loopFill;
+      unsigned _misses;
+
+      unsigned decode(sf_count_t pos, float* buffer, unsigned n);
+      void put(sf_count_t pos, const float* src, unsigned n);
+      void take(int channels, float** dst, sf_count_t pos, unsigned n, bool overwrite);
+
+      friend class DecoderPool;
+
+   public:
+      DecodeStream(const SndFileR& f, sf_count_t start, sf_count_t len, sf_count_t songOffset,
+         unsigned aheadFrames);
+      ~DecodeStream();
+
+      size_t read(int channels, float** dst, size_t n, sf_count_t pos, bool overwrite);
+      bool decodeAhead(float* chunk, unsigned chunkSamples, bool loop, sf_count_t loopStart,
+         sf_count_t loopEnd);
+      unsigned fill();
+      };
+
+//---------------------------------------------------------
+//   DecoderPool
+//    Threads decoding compressed files (FLAC, Ogg) ahead
+//    of the play position, the emptiest stream first.
+//    Idle while the prefetch thread seeks. Keeps the
+//    decoding cpu time per file.
+//---------------------------------------------------------
+
+class DecoderPool {
+      struct FileStats {
+            double cpu;
+            double seconds;         // of audio decoded
+            unsigned streams;
+            unsigned misses;
+            };
+
+      std::vector<DecoderThread*> _threads;
+      std::vector<DecodeStream*> _streams;
+      QReadWriteLock _lock;         // _streams; a pass copies it
+      std::vector<DecodeStream*> _closing;      // prefetch thread
+
+      QMutex _loopLock;
+      bool _loopOn;
+      sf_count_t _loopStart, _loopEnd;    // song frames
+      QAtomicInt _seeking;
+
+      QMutex _statsLock;
+      std::map<QString, FileStats> _stats;
+
+      friend class DecoderThread;
+      bool pass(float* chunk);
+      void collect();
+
+   public:
+      enum { ChunkSamples = 32768 };     // decoded by a thread at once
+
+      DecoderPool(int threads);
+      ~DecoderPool();
+
+      DecodeStream* open(const SndFileR& f, sf_count_t start, sf_count_t len, sf_count_t songOffset);
+      void close(DecodeStream*);
+      void setLoop(bool on, unsigned start, unsigned end);
+      void setSeeking(bool f)       { _seeking.store(f); }
+      QString statistics();
+      };
+
+} // namespace MusECore
+
+namespace MusEGlobal {
+extern MusECore::DecoderPool* decoderPool;
+}
+
+#endif
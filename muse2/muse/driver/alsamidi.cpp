@@ -22,6 +22,8 @@
 //=========================================================
 
 #include <stdio.h>
+#include <stdlib.h>
+#include <errno.h>
 
 #include "alsamidi.h"
 #include "globals.h"
@@ -61,6 +63,24 @@ snd_seq_t* alsaSeq = 0;
 static snd_seq_addr_t musePort;
 static snd_seq_addr_t announce_adr;
 
+// Output queue for config.alsaMidiQueue. Its real time is related to
+//  the audio frame clock once per cycle, see alsaQueueTime().
+static int alsaQueue = -1;
+static unsigned alsaQueueSyncFrame = 0;
+static unsigned alsaQueueAnchorFrame = 0;
+static long long alsaQueueAnchorNs = 0;
+static bool alsaQueueAnchored = false;
+
+// Set in the audio thread while it writes a batch of queue
+//  output, see processMidi(). Thread local: a gui or midi
+//  thread sending meanwhile must not write into the batch.
+enum { AlsaBatchNone, AlsaBatchDirect, AlsaBatchStamped };
+static __thread int alsaQueueBatch = AlsaBatchNone;
+// Queue time stamped input, see alsaInputFrame().
+static unsigned alsaInputAnchorFrame = 0;
+static long long alsaInputAnchorNs = 0;
+static bool alsaInputAnchored = false;
+
 // REMOVE Tim. Persistent routes. Added.
 //---------------------------------------------------------
 //   createAlsaMidiDevice
@@ -108,6 +128,7 @@ MidiAlsaDevice::MidiAlsaDevice(const snd_seq_addr_t& a, const QString& n)
    : MidiDevice(n)
       {
       adr = a;
+      _queueOut.store(0);
       init();
       }
 
@@ -361,6 +382,72 @@ void MidiAlsaDevice::writeRouting(int level, Xml& xml) const
       }
 }
     
+//---------------------------------------------------------
+//   alsaMidiQueueActive
+//    True if ALSA midi output is scheduled on the queue by
+//    the audio thread instead of the midi thread.
+//---------------------------------------------------------
+
+bool alsaMidiQueueActive()
+      {
+      return MusEGlobal::config.alsaMidiQueue && alsaQueue >= 0;
+      }
+
+//---------------------------------------------------------
+//   alsaMidiQueueFlush
+//    Audio thread, on stop, seek and loop wrap. Removes the
+//    events sent ahead on the queue, so the note offs and
+//    controllers of the new position are not followed by
+//    notes of the old one. Note offs stay queued, their
+//    notes are already sounding.
+//---------------------------------------------------------
+
+void alsaMidiQueueFlush()
+      {
+      if (!alsaMidiQueueActive())
+            return;
+      snd_seq_remove_events_t* remove;
+      snd_seq_remove_events_alloca(&remove);
+      snd_seq_remove_events_set_queue(remove, alsaQueue);
+      snd_seq_remove_events_set_condition(remove, SND_SEQ_REMOVE_OUTPUT | SND_SEQ_REMOVE_IGNORE_OFF);
+      int error = snd_seq_remove_events(alsaSeq, remove);
+      if (error < 0)
+            fprintf(stderr, "alsaMidiQueueFlush: %s\n", snd_strerror(error));
+      alsaQueueAnchored = false;
+      }
+
+//---------------------------------------------------------
+//   alsaQueueTime
+//    Queue real time of an audio frame. The queue position
+//    is read together with curFrame() once per cycle and
+//    frames are mapped relative to that anchor, so the queue
+//    follows the audio clock. Past frames play immediately.
+//---------------------------------------------------------
+
+static bool alsaQueueTime(unsigned frame, snd_seq_real_time_t* rt)
+      {
+      const unsigned syncFrame = MusEGlobal::audio->curSyncFrame();
+      if (!alsaQueueAnchored || syncFrame != alsaQueueSyncFrame) {
+            snd_seq_queue_status_t* status;
+            snd_seq_queue_status_alloca(&status);
+            if (snd_seq_get_queue_status(alsaSeq, alsaQueue, status) < 0)
+                  return false;
+            const unsigned f = MusEGlobal::audio->curFrame();
+            const snd_seq_real_time_t* t = snd_seq_queue_status_get_real_time(status);
+            alsaQueueAnchorNs    = (long long)t->tv_sec * 1000000000LL + t->tv_nsec;
+            alsaQueueAnchorFrame = f;
+            alsaQueueSyncFrame   = syncFrame;
+            alsaQueueAnchored    = true;
+            }
+      long long ns = alsaQueueAnchorNs;
+      const int d  = int(frame - alsaQueueAnchorFrame);
+      if (d > 0)
+            ns += (long long)d * 1000000000LL / MusEGlobal::sampleRate;
+      rt->tv_sec  = ns / 1000000000LL;
+      rt->tv_nsec = ns % 1000000000LL;
+      return true;
+      }
+
 //---------------------------------------------------------
 //   putEvent
 //---------------------------------------------------------
@@ -386,6 +473,12 @@ bool MidiAlsaDevice::putMidiEvent(const MidiPlayEvent& e)
       event.source  = musePort;
       event.dest    = adr;
 
+      if (alsaQueueBatch == AlsaBatchStamped) {
+            snd_seq_real_time_t rt;
+            if (alsaQueueTime(e.time(), &rt))
+                  snd_seq_ev_schedule_real(&event, alsaQueue, 0, &rt);
+            }
+
       switch(e.type()) {
             case ME_NOTEON:
                   snd_seq_ev_set_noteon(&event, chn, a, b);
@@ -537,6 +630,17 @@ bool MidiAlsaDevice::putAlsaEvent(snd_seq_event_t* event)
       fprintf(stderr, "MidiAlsaDevice::putEvent\n");  
 #endif
 
+      if (alsaQueueBatch != AlsaBatchNone) {
+            // Buffered, processMidi() drains the batch.
+            error = snd_seq_event_output(alsaSeq, event);
+            if (error >= 0)
+                  return false;
+            if (error != -EAGAIN && error != -ENOMEM)
+                  fprintf(stderr, "MidiAlsaDevice::%p putEvent(): midi queue write error: %s\n",
+                     this, snd_strerror(error));
+            return true;
+            }
+
       do {
             error   = snd_seq_event_output_direct(alsaSeq, event);
             int len = snd_seq_event_length(event);
@@ -563,9 +667,32 @@ bool MidiAlsaDevice::putAlsaEvent(snd_seq_event_t* event)
       return true;
       }
 
+//---------------------------------------------------------
+//   putEvent
+//    While the audio thread owns the output, events from
+//    other threads wait in eventFifo for its next batch.
+//    return true if event cannot be delivered
+//---------------------------------------------------------
+
+bool MidiAlsaDevice::putEvent(const MidiPlayEvent& ev)
+      {
+      if (alsaQueueBatch != AlsaBatchNone || !_queueOut.loadAcquire())
+            return MidiDevice::putEvent(ev);
+      if (!_writeEnable)
+            return false;
+      QMutexLocker locker(&_fifoLock);
+      if (eventFifo.put(ev)) {
+            fprintf(stderr, "MidiAlsaDevice::putEvent: fifo overflow\n");
+            return true;
+            }
+      return false;
+      }
+
 //---------------------------------------------------------
 //   processMidi
-//   Called from ALSA midi sequencer thread only.
+//   Called from ALSA midi sequencer thread, or from the
+//    audio thread if alsaMidiQueueActive(). Then all output
+//    is written by the audio thread, in one batch.
 //---------------------------------------------------------
 
 void MidiAlsaDevice::processMidi()
@@ -743,10 +870,32 @@ void MidiAlsaDevice::processMidi()
     processStuckNotes();  
   }
   
-  if(_playEvents.empty())
-    return;
+  // With the output queue the events of this and the next cycle are
+  //  sent ahead in one batch, timestamped. Ext sync times are ticks,
+  //  those are buffered too but played directly.
+  const bool queued = alsaMidiQueueActive();
+  if(queued)
+  {
+    _queueOut.storeRelease(1);
+    alsaQueueBatch = ext_sync ? AlsaBatchDirect : AlsaBatchStamped;
+  }
+  else
+    _queueOut.storeRelease(0);
+  
+  // Events other threads sent while the audio thread owned the output,
+  //  the note offs of a stop or seek among them. Immediate.
+  while(!eventFifo.isEmpty())
+  {
+    MidiPlayEvent ev(eventFifo.peek());
+    ev.setTime(0);
+    if(MidiDevice::putEvent(ev))
+      break;
+    eventFifo.remove();
+  }
   
   unsigned curFrame = MusEGlobal::audio->curFrame();
+  if(queued && !ext_sync)
+    curFrame += 2 * MusEGlobal::segmentSize;
   
   // Play all events up to current frame.
   iMPEvent i = _playEvents.begin();            
@@ -762,6 +911,12 @@ void MidiAlsaDevice::processMidi()
             break;
         }
   _playEvents.erase(_playEvents.begin(), i);
+  
+  if(queued)
+  {
+    alsaQueueBatch = AlsaBatchNone;
+    snd_seq_drain_output(alsaSeq);
+  }
 }
 
 /*
@@ -1091,14 +1246,37 @@ bool initMidiAlsa()
       alsaSeqFdo = pfdo[0].fd;
       alsaSeqFdi = pfdi[0].fd;
 
-      int port  = snd_seq_create_simple_port(alsaSeq, "MusE Port 0",
-         inCap | outCap | SND_SEQ_PORT_CAP_READ | SND_SEQ_PORT_CAP_WRITE,
-         SND_SEQ_PORT_TYPE_APPLICATION);
-      if (port < 0) {
+      //-----------------------------------------
+      //    queue, runs all the time. Stamps input,
+      //    schedules output if config.alsaMidiQueue
+      //-----------------------------------------
+
+      alsaQueue = snd_seq_alloc_named_queue(alsaSeq, "MusE");
+      if (alsaQueue < 0) {
+            fprintf(stderr, "Alsa: Could not allocate queue: %s\n", snd_strerror(alsaQueue));
+            alsaQueue = -1;
+            }
+      else {
+            snd_seq_start_queue(alsaSeq, alsaQueue, NULL);
+            snd_seq_drain_output(alsaSeq);
+            }
+
+      snd_seq_port_info_t* mpinfo;
+      snd_seq_port_info_alloca(&mpinfo);
+      snd_seq_port_info_set_name(mpinfo, "MusE Port 0");
+      snd_seq_port_info_set_capability(mpinfo, inCap | outCap | SND_SEQ_PORT_CAP_READ | SND_SEQ_PORT_CAP_WRITE);
+      snd_seq_port_info_set_type(mpinfo, SND_SEQ_PORT_TYPE_APPLICATION);
+      if (alsaQueue >= 0) {
+            // Input events get the queue real time of their arrival.
+            snd_seq_port_info_set_timestamping(mpinfo, 1);
+            snd_seq_port_info_set_timestamp_real(mpinfo, 1);
+            snd_seq_port_info_set_timestamp_queue(mpinfo, alsaQueue);
+            }
+      if (snd_seq_create_port(alsaSeq, mpinfo) < 0) {
             perror("create port");
             exit(1);
             }
-      musePort.port   = port;
+      musePort.port   = snd_seq_port_info_get_port(mpinfo);
       musePort.client = snd_seq_client_id(alsaSeq);
 
       //-----------------------------------------
@@ -1157,6 +1335,15 @@ void exitMidiAlsa()
     if(error < 0) 
       fprintf(stderr, "MusE: Could not delete ALSA simple port: %s\n", snd_strerror(error));
     
+    if(alsaQueue >= 0)
+    {
+      snd_seq_stop_queue(alsaSeq, alsaQueue, NULL);
+      snd_seq_drain_output(alsaSeq);
+      snd_seq_free_queue(alsaSeq, alsaQueue);
+      alsaQueue = -1;
+      alsaQueueAnchored = false;
+    }
+    
     error = snd_seq_close(alsaSeq);  
     if(error < 0) 
       fprintf(stderr, "MusE: Could not close ALSA sequencer: %s\n", snd_strerror(error));
@@ -1466,7 +1653,77 @@ int alsaSelectWfd()
       }
 
 //---------------------------------------------------------
-//   processInput
+//   alsaInputFrame
+//    Arrival frame of a time stamped input event on the
+//    curFrame() clock, and how long ago that was. The queue
+//    clock is related to the audio clock on every call, the
+//    relation is smoothed and slowly follows the drift
+//    between the two. Returns false if the event has no
+//    queue time stamp.
+//---------------------------------------------------------
+
+static bool alsaInputFrame(const snd_seq_event_t* ev, unsigned* frame, float* delayUs)
+{
+      if (alsaQueue < 0 || ev->queue != alsaQueue
+         || (ev->flags & SND_SEQ_TIME_STAMP_MASK) != SND_SEQ_TIME_STAMP_REAL)
+            return false;
+      snd_seq_queue_status_t* status;
+      snd_seq_queue_status_alloca(&status);
+      if (snd_seq_get_queue_status(alsaSeq, alsaQueue, status) < 0)
+            return false;
+      const unsigned nowFrame = MusEGlobal::audio->curFrame();
+      const snd_seq_real_time_t* t = snd_seq_queue_status_get_real_time(status);
+      const long long nowNs = (long long)t->tv_sec * 1000000000LL + t->tv_nsec;
+      const long long sr    = MusEGlobal::sampleRate;
+
+      unsigned f = nowFrame;
+      if (alsaInputAnchored) {
+            const unsigned predicted = alsaInputAnchorFrame
+               + unsigned((nowNs - alsaInputAnchorNs) * sr / 1000000000LL);
+            const int err = int(nowFrame - predicted);
+            // Large jumps (xrun, restart of the audio driver) are taken as they are.
+            if (abs(err) < sr / 100)
+                  f = predicted + err / 8;
+            }
+      alsaInputAnchorFrame = f;
+      alsaInputAnchorNs    = nowNs;
+      alsaInputAnchored    = true;
+
+      long long age = nowNs - ((long long)ev->time.time.tv_sec * 1000000000LL + ev->time.time.tv_nsec);
+      if (age < 0)
+            age = 0;
+      *delayUs = age / 1000.0f;
+      *frame   = f - unsigned(age * sr / 1000000000LL);
+      return true;
+}
+
+//---------------------------------------------------------
+//   alsaInputTime
+//    Arrival time of an input event on the curTime() clock,
+//    for the sync input. The time of reading if the event
+//    has no queue time stamp.
+//---------------------------------------------------------
+
+static double alsaInputTime(const snd_seq_event_t* ev)
+{
+      const double now = curTime();
+      if (alsaQueue < 0 || ev->queue != alsaQueue
+         || (ev->flags & SND_SEQ_TIME_STAMP_MASK) != SND_SEQ_TIME_STAMP_REAL)
+            return now;
+      snd_seq_queue_status_t* status;
+      snd_seq_queue_status_alloca(&status);
+      if (snd_seq_get_queue_status(alsaSeq, alsaQueue, status) < 0)
+            return now;
+      const snd_seq_real_time_t* t = snd_seq_queue_status_get_real_time(status);
+      const long long nowNs = (long long)t->tv_sec * 1000000000LL + t->tv_nsec;
+      long long age = nowNs - ((long long)ev->time.time.tv_sec * 1000000000LL + ev->time.time.tv_nsec);
+      if (age < 0)
+            age = 0;
+      return now - age / 1000000000.0;
+}
+
+//---------------------------------------------------------
+//   alsaProcessMidiInput
 //---------------------------------------------------------
 
 void alsaProcessMidiInput()
@@ -1644,6 +1901,7 @@ void alsaProcessMidiInput()
             event.setType(0);      // mark as unused
             event.setPort(curPort);
             event.setB(0);
+            event.setTime(0);
 
             switch(ev->type) 
             {
@@ -1694,24 +1952,24 @@ void alsaProcessMidiInput()
                         break;
 
                   case SND_SEQ_EVENT_CLOCK:
-                        MusEGlobal::midiSeq->realtimeSystemInput(curPort, ME_CLOCK, curTime());
+                        MusEGlobal::midiSeq->realtimeSystemInput(curPort, ME_CLOCK, alsaInputTime(ev));
                         //mdev->syncInfo().trigMCSyncDetect();
                         break;
 
                   case SND_SEQ_EVENT_START:
-                        MusEGlobal::midiSeq->realtimeSystemInput(curPort, ME_START, curTime());
+                        MusEGlobal::midiSeq->realtimeSystemInput(curPort, ME_START, alsaInputTime(ev));
                         break;
 
                   case SND_SEQ_EVENT_CONTINUE:
-                        MusEGlobal::midiSeq->realtimeSystemInput(curPort, ME_CONTINUE, curTime());
+                        MusEGlobal::midiSeq->realtimeSystemInput(curPort, ME_CONTINUE, alsaInputTime(ev));
                         break;
 
                   case SND_SEQ_EVENT_STOP:
-                        MusEGlobal::midiSeq->realtimeSystemInput(curPort, ME_STOP, curTime());
+                        MusEGlobal::midiSeq->realtimeSystemInput(curPort, ME_STOP, alsaInputTime(ev));
                         break;
 
                   case SND_SEQ_EVENT_TICK:
-                        MusEGlobal::midiSeq->realtimeSystemInput(curPort, ME_TICK, curTime());
+                        MusEGlobal::midiSeq->realtimeSystemInput(curPort, ME_TICK, alsaInputTime(ev));
                         //mdev->syncInfo().trigTickDetect();
                         break;
 
@@ -1740,7 +1998,7 @@ void alsaProcessMidiInput()
                   case SND_SEQ_EVENT_SENSING:
                         break;
                   case SND_SEQ_EVENT_QFRAME:
-                        MusEGlobal::midiSeq->mtcInputQuarter(curPort, ev->data.control.value);
+                        MusEGlobal::midiSeq->mtcInputQuarter(curPort, ev->data.control.value, alsaInputTime(ev));
                         break;
                   // case SND_SEQ_EVENT_CLIENT_START:
                   // case SND_SEQ_EVENT_CLIENT_EXIT:
@@ -1764,7 +2022,18 @@ void alsaProcessMidiInput()
                         break;
             }
             if(event.type())
+            {
+              unsigned frame;
+              float delay;
+              if(alsaInputFrame(ev, &frame, &delay))
+              {
+                event.setTime(frame ? frame : 1);
+                mdev->inputStats().add(delay);
+              }
+              else
+                event.setTime(0);
               mdev->recordEvent(event);
+            }
                   
             snd_seq_free_event(ev);
             if (rv == 0)
@@ -27,6 +27,9 @@
 #include <config.h>
 #include <alsa/asoundlib.h>
 
+#include <QAtomicInt>
+#include <QMutex>
+
 #include "mpevent.h"
 #include "mididev.h"
 
@@ -52,6 +55,13 @@ class MidiAlsaDevice : public MidiDevice {
       virtual int selectRfd()      { return -1; }
       virtual int selectWfd();
 
+      // Set while the audio thread owns the output (queue mode).
+      //  Other threads put their events into eventFifo then,
+      //  the audio thread sends them with its next batch.
+      QAtomicInt _queueOut;
+      // Serializes the threads writing eventFifo.
+      QMutex _fifoLock;
+
       bool putAlsaEvent(snd_seq_event_t*);
       virtual bool putMidiEvent(const MidiPlayEvent&);
 
@@ -76,6 +86,7 @@ class MidiAlsaDevice : public MidiDevice {
       //virtual bool addStuckNote(const MidiPlayEvent& ev) { return !stuckNotesFifo.put(ev); }
       // Play all events up to current frame.
       virtual void processMidi();
+      virtual bool putEvent(const MidiPlayEvent&);
       //virtual void handleStop();
       //virtual void handleSeek();
 
@@ -90,6 +101,8 @@ extern int alsaSelectWfd();
 extern void alsaProcessMidiInput();
 extern void alsaScanMidiPorts();
 extern void setAlsaClientName(const char*);
+extern bool alsaMidiQueueActive();
+extern void alsaMidiQueueFlush();
 
 } // namespace MusECore
 
@@ -67,6 +67,9 @@ MidiJackDevice::MidiJackDevice(const QString& n)
 {
   _in_client_jackport  = NULL;
   _out_client_jackport = NULL;
+  _cycleBase      = 0;
+  _cycleExtSync   = false;
+  _cycleLastFrame = 0;
   init();
 }
 
@@ -325,6 +328,10 @@ void MidiJackDevice::close()
   
   _writeEnable = false;
   _readEnable = false;
+  
+  if(_droppedEvents.load() || _lateEvents.load())
+    fprintf(stderr, "MidiJackDevice::close %s: %d events dropped, %d late\n", 
+            name().toLatin1().constData(), _droppedEvents.load(), _lateEvents.load());
 }
 
 //---------------------------------------------------------
@@ -526,6 +533,10 @@ void MidiJackDevice::eventReceived(jack_midi_event_t* ev)
       event.setTime(MusEGlobal::audio->pos().frame() + ev->time);
 #endif
       event.setTick(MusEGlobal::lastExtMidiSyncTick);    
+      
+      // Jack times are frame accurate already. For the statistics: the event
+      //  waited from its frame in the previous period until this process.
+      _inputStats.add(float(MusEGlobal::segmentSize - ev->time) * 1000000.0f / float(MusEGlobal::sampleRate));
 
       event.setChannel(*(ev->buffer) & 0xf);
       int type = *(ev->buffer) & 0xf0;
@@ -572,7 +583,16 @@ void MidiJackDevice::eventReceived(jack_midi_event_t* ev)
                                 break;
                           case ME_MTC_QUARTER:
                                 if(_port != -1)
-                                  MusEGlobal::midiSeq->mtcInputQuarter(_port, *(ev->buffer + 1)); 
+                                {
+                                  double abs_ev_t = 0.0;
+                                  if(MusEGlobal::audioDevice && MusEGlobal::audioDevice->deviceType() == JACK_MIDI)
+                                  {
+                                    jack_client_t* jc = static_cast<MusECore::JackAudioDevice*>(MusEGlobal::audioDevice)->jackClient();
+                                    if(jc)
+                                      abs_ev_t = double(jack_frames_to_time(jc, jack_last_frame_time(jc) + ev->time)) / 1000000.0;
+                                  }
+                                  MusEGlobal::midiSeq->mtcInputQuarter(_port, *(ev->buffer + 1), abs_ev_t); 
+                                }
                                 return;
                           case ME_SONGPOS:    
                                 if(_port != -1)
@@ -655,6 +675,8 @@ void MidiJackDevice::collectMidiEvents()
 
 //---------------------------------------------------------
 //   putEvent
+//    The event is encoded to raw midi here, in the calling
+//    thread. The audio thread only copies the bytes.
 //    return true if event cannot be delivered
 //---------------------------------------------------------
 
@@ -667,469 +689,233 @@ bool MidiJackDevice::putEvent(const MidiPlayEvent& ev)
   printf("MidiJackDevice::putEvent time:%d type:%d ch:%d A:%d B:%d\n", ev.time(), ev.type(), ev.channel(), ev.dataA(), ev.dataB());
   #endif  
       
-  bool rv = eventFifo.put(ev);
+  if(MusEGlobal::midiOutputTrace) 
+  {
+    fprintf(stderr, "MidiOut: Jack: <%s>: ", name().toLatin1().constData());
+    ev.dump();
+  }
+  
+  bool rv;
+  if(ev.type() == ME_SYSEX)
+    rv = _outFifo.putSysex(ev.time(), ev.data(), ev.len());
+  else
+  {
+    EncodedMsg m[MaxEncodedMsgs];
+    const int n = encodeEvent(ev, m);
+    // All or nothing, an expansion must not be cut in half.
+    int bytes = 0;
+    for(int i = 0; i < n; ++i)
+      bytes += MidiByteFifo::headerSize + m[i].len;
+    rv = !_outFifo.canPut(bytes - MidiByteFifo::headerSize);
+    for(int i = 0; !rv && i < n; ++i)
+      rv = _outFifo.put(ev.time(), m[i].data, m[i].len);
+  }
   if(rv)
+  {
+    _droppedEvents.ref();
     printf("MidiJackDevice::putEvent: port overflow\n");
+  }
   
   return rv;
 }
 
 //---------------------------------------------------------
-//   queueEvent
-//   return true if successful
+//   encodeEvent
+//    Translate a play event into raw midi messages. Bank
+//    and program changes, pitch, 14 bit and (N)RPN
+//    controllers are expanded. Returns the number of
+//    messages. Sysex events are not handled here.
 //---------------------------------------------------------
 
-bool MidiJackDevice::queueEvent(const MidiPlayEvent& e)
+int MidiJackDevice::encodeEvent(const MidiPlayEvent& e, EncodedMsg* m) const
 {
-      // Perhaps we can find use for this value later, together with the Jack midi MusE port(s).
-      // No big deal if not. Not used for now.
-      //int port = e.port();
-      
-      //if(port >= JACK_MIDI_CHANNELS)
-      //  return false;
-        
-      if(!_out_client_jackport)   
-        return false;
-      void* pb = jack_port_get_buffer(_out_client_jackport, MusEGlobal::segmentSize);  
-    
-      //unsigned frameCounter = ->frameTime();
-      int frameOffset = MusEGlobal::audio->getFrameOffset();
-      unsigned pos = MusEGlobal::audio->pos().frame();
-      int ft = e.time() - frameOffset - pos;
-      
-      if (ft < 0)
-            ft = 0;
-      if (ft >= (int)MusEGlobal::segmentSize) {
-            printf("MidiJackDevice::queueEvent: Event time:%d out of range. offset:%d ft:%d (seg=%d)\n", e.time(), frameOffset, ft, MusEGlobal::segmentSize);
-            if (ft > (int)MusEGlobal::segmentSize)
-                  ft = MusEGlobal::segmentSize - 1;
-            }
-      
-      #ifdef JACK_MIDI_DEBUG
-      printf("MidiJackDevice::queueEvent pos:%d fo:%d ft:%d time:%d type:%d ch:%d A:%d B:%d\n", pos, frameOffset, ft, e.time(), e.type(), e.channel(), e.dataA(), e.dataB());
-      #endif  
-      
-      if (MusEGlobal::midiOutputTrace) {
-            fprintf(stderr, "MidiOut: Jack: <%s>: ", name().toLatin1().constData());
-            e.dump();
-            }
-            
-      switch(e.type()) {
-            case ME_NOTEON:
-            case ME_NOTEOFF:
-            case ME_POLYAFTER:
-            case ME_CONTROLLER:
-            case ME_PITCHBEND:
-                  {
-                  #ifdef JACK_MIDI_DEBUG
-                  printf("MidiJackDevice::queueEvent note on/off polyafter controller or pitch\n");
-                  #endif  
-                    
-                  unsigned char* p = jack_midi_event_reserve(pb, ft, 3);
-                  if (p == 0) {
-                        #ifdef JACK_MIDI_DEBUG
-                        fprintf(stderr, "MidiJackDevice::queueEvent NOTE CTL PAT or PB: buffer overflow, stopping until next cycle\n");  
-                        #endif  
-                        return false;
-                        }
-                  p[0] = e.type() | e.channel();
-                  p[1] = e.dataA();
-                  p[2] = e.dataB();
-                  }
-                  break;
-
-            case ME_PROGRAM:
-            case ME_AFTERTOUCH:
-                  {
-                  #ifdef JACK_MIDI_DEBUG
-                  printf("MidiJackDevice::queueEvent program or aftertouch\n");
-                  #endif  
-                    
-                  unsigned char* p = jack_midi_event_reserve(pb, ft, 2);
-                  if (p == 0) {
-                        #ifdef JACK_MIDI_DEBUG
-                        fprintf(stderr, "MidiJackDevice::queueEvent PROG or AT: buffer overflow, stopping until next cycle\n");  
-                        #endif  
-                        return false;
-                        }
-                  p[0] = e.type() | e.channel();
-                  p[1] = e.dataA();
-                  }
-                  break;
-            case ME_SYSEX:
-                  {
-                  #ifdef JACK_MIDI_DEBUG
-                  printf("MidiJackDevice::queueEvent sysex\n");
-                  #endif  
-                  
-                  const unsigned char* data = e.data();
-                  int len = e.len();
-                  unsigned char* p = jack_midi_event_reserve(pb, ft, len+2);
-                  if (p == 0) {
-                        fprintf(stderr, "MidiJackDevice::queueEvent ME_SYSEX: buffer overflow, sysex too big, event lost\n");
-                        
-                        //return false;
-                        // Changed to true. Absorb the sysex if it is too big, to avoid attempting 
-                        //  to resend repeatedly. If the sysex is too big, it would just stay in the 
-                        //  list and never be processed, because Jack could never reserve enough space.
-                        // Other types of events should be OK since they are small and can be resent
-                        //  next cycle.     p4.0.15 Tim.
-                        // FIXME: We really need to chunk sysex events properly. It's tough. Investigating...
-                        return true;
-                        }
-                  p[0] = 0xf0;
-                  p[len+1] = 0xf7;
-                  memcpy(p+1, data, len);
-                  }
-                  break;
-            case ME_SONGPOS:
-                  {
-                  #ifdef JACK_MIDI_DEBUG
-                  printf("MidiJackDevice::queueEvent songpos %d\n", e.dataA());
-                  #endif  
-                    
-                  unsigned char* p = jack_midi_event_reserve(pb, ft, 3);
-                  if (p == 0) {
-                        #ifdef JACK_MIDI_DEBUG
-                        fprintf(stderr, "MidiJackDevice::queueEvent songpos: buffer overflow, stopping until next cycle\n");  
-                        #endif  
-                        return false;
-                        }
-                  int pos = e.dataA();      
-                  p[0] = e.type();
-                  p[1] = pos & 0x7f;         // LSB
-                  p[2] = (pos >> 7) & 0x7f;  // MSB
-                  }
-                  break;
-            case ME_CLOCK:
-            case ME_START:
-            case ME_CONTINUE:
-            case ME_STOP:
-                  {
-                  #ifdef JACK_MIDI_DEBUG
-                  printf("MidiJackDevice::queueEvent realtime %x\n", e.type());
-                  #endif  
-                    
-                  unsigned char* p = jack_midi_event_reserve(pb, ft, 1);
-                  if (p == 0) {
-                        #ifdef JACK_MIDI_DEBUG
-                        fprintf(stderr, "MidiJackDevice::queueEvent realtime: buffer overflow, stopping until next cycle\n");  
-                        #endif  
-                        return false;
-                        }
-                  p[0] = e.type();
-                  }
-                  break;
-            default:
-                  if(MusEGlobal::debugMsg)
-                    printf("MidiJackDevice::queueEvent: event type %x not supported\n", e.type());
-                  return true;   // Absorb the event. Don't want it hanging around in the list. 
-            }
-            
-            return true;
-}
-      
-//---------------------------------------------------------
-//    processEvent
-//    return true if successful
-//---------------------------------------------------------
-
-bool MidiJackDevice::processEvent(const MidiPlayEvent& event)
-{    
-  //int frameOffset = MusEGlobal::audio->getFrameOffset();
-  //unsigned pos = MusEGlobal::audio->pos().frame();
-
-  int chn    = event.channel();
-  unsigned t = event.time();
-  int a      = event.dataA();
-  int b      = event.dataB();
-  // Perhaps we can find use for this value later, together with the Jack midi MusE port(s).
-  // No big deal if not. Not used for now.
-  int port   = event.port();
+  const int chn = e.channel();
+  const int a   = e.dataA();
+  const int b   = e.dataB();
+  int n = 0;
   
-  // TODO: No sub-tick playback resolution yet, with external sync.
-  // Just do this 'standard midi 64T timing thing' for now until we figure out more precise external timings. 
-  // Does require relatively short audio buffers, in order to catch the resolution, but buffer <= 256 should be OK... 
-  // Tested OK so far with 128. 
-  //if(MusEGlobal::extSyncFlag.value()) 
-  // p4.0.15 Or, is the event marked to be played immediately?
-  // Nothing to do but stamp the event to be queued for frame 0+.
-  if(t == 0 || MusEGlobal::extSyncFlag.value())    
-    t = MusEGlobal::audio->getFrameOffset() + MusEGlobal::audio->pos().frame();
-    //t = frameOffset + pos;
-      
-  #ifdef JACK_MIDI_DEBUG
-  //printf("MidiJackDevice::processEvent time:%d type:%d ch:%d A:%d B:%d\n", t, event.type(), chn, a, b);  
-  #endif  
-      
-  if(event.type() == ME_PROGRAM) 
-  {
-    // don't output program changes for GM drum channel
-    //if (!(MusEGlobal::song->mtype() == MT_GM && chn == 9)) {
-          int hb = (a >> 16) & 0xff;
-          int lb = (a >> 8) & 0xff;
-          int pr = a & 0x7f;
-          
-          //printf("MidiJackDevice::processEvent ME_PROGRAM time:%d type:%d ch:%d A:%d B:%d hb:%d lb:%d pr:%d\n", 
-          //       event.time(), event.type(), event.channel(), event.dataA(), event.dataB(), hb, lb, pr);
-          
-          if (hb != 0xff)
-          {  
-                if(!queueEvent(MidiPlayEvent(t, port, chn, ME_CONTROLLER, CTRL_HBANK, hb)))
-                  return false;  // p4.0.15 Inform that processing the event in general failed. Ditto all below... 
-///            t += 1;      
-          }
-          if (lb != 0xff)
-          {
-                if(!queueEvent(MidiPlayEvent(t, port, chn, ME_CONTROLLER, CTRL_LBANK, lb)))
-                  return false;
-///            t += 1;      
-          }
-          if(!queueEvent(MidiPlayEvent(t, port, chn, ME_PROGRAM, pr, 0)))
-            return false;
-            
-    //      }
-  }
-  else
-  if(event.type() == ME_PITCHBEND) 
+  switch(e.type()) 
   {
+    case ME_NOTEON:
+    case ME_NOTEOFF:
+    case ME_POLYAFTER:
+      m[n++].set(e.type() | chn, a, b);
+      break;
+    case ME_AFTERTOUCH:
+      m[n++].set(ME_AFTERTOUCH | chn, a);
+      break;
+    case ME_PITCHBEND:
+    {
       int v = a + 8192;
-      //printf("MidiJackDevice::processEvent ME_PITCHBEND v:%d time:%d type:%d ch:%d A:%d B:%d\n", v, event.time(), event.type(), event.channel(), event.dataA(), event.dataB());
-      if(!queueEvent(MidiPlayEvent(t, port, chn, ME_PITCHBEND, v & 0x7f, (v >> 7) & 0x7f)))
-        return false;
-  }
-  else
-  if(event.type() == ME_CONTROLLER) 
-  {
-    // Perhaps we can find use for this value later, together with the Jack midi MusE port(s).
-    // No big deal if not. Not used for now.
-    //int port   = event.port();
-
-    int nvh = 0xff;
-    int nvl = 0xff;
-    if(_port != -1)
+      m[n++].set(ME_PITCHBEND | chn, v & 0x7f, (v >> 7) & 0x7f);
+      break;
+    }
+    case ME_PROGRAM:
+      n = encodeProgram(chn, a, m);
+      break;
+    case ME_SONGPOS:
+      m[n++].set(ME_SONGPOS, a & 0x7f, (a >> 7) & 0x7f);   // LSB, MSB
+      break;
+    case ME_CLOCK:
+    case ME_START:
+    case ME_CONTINUE:
+    case ME_STOP:
+      m[n].data[0] = e.type();
+      m[n++].len = 1;
+      break;
+    case ME_CONTROLLER:
     {
-      int nv = MusEGlobal::midiPorts[_port].nullSendValue();
-      if(nv != -1)
+      int nvh = 0xff;
+      int nvl = 0xff;
+      if(_port != -1)
       {
-        nvh = (nv >> 8) & 0xff;
-        nvl = nv & 0xff;
+        int nv = MusEGlobal::midiPorts[_port].nullSendValue();
+        if(nv != -1)
+        {
+          nvh = (nv >> 8) & 0xff;
+          nvl = nv & 0xff;
+        }
       }
-    }
-      
-    if((a | 0xff) == CTRL_POLYAFTER) 
-    {
-      //printf("MidiJackDevice::processEvent CTRL_POLYAFTER v:%d time:%d type:%d ch:%d A:%d B:%d\n", v, event.time(), event.type(), event.channel(), event.dataA(), event.dataB());
-      if(!queueEvent(MidiPlayEvent(t, port, chn, ME_POLYAFTER, a & 0x7f, b & 0x7f)))
-        return false;
-    }
-    else if(a == CTRL_AFTERTOUCH) 
-    {
-      //printf("MidiJackDevice::processEvent CTRL_AFTERTOUCH v:%d time:%d type:%d ch:%d A:%d B:%d\n", v, event.time(), event.type(), event.channel(), event.dataA(), event.dataB());
-      if(!queueEvent(MidiPlayEvent(t, port, chn, ME_AFTERTOUCH, b & 0x7f, 0)))
-        return false;
-    }
-    else if(a == CTRL_PITCH) 
-    {
-      int v = b + 8192;
-      //printf("MidiJackDevice::processEvent CTRL_PITCH v:%d time:%d type:%d ch:%d A:%d B:%d\n", v, event.time(), event.type(), event.channel(), event.dataA(), event.dataB());
-      if(!queueEvent(MidiPlayEvent(t, port, chn, ME_PITCHBEND, v & 0x7f, (v >> 7) & 0x7f)))
-        return false;
-    }
-    else if (a == CTRL_PROGRAM) 
-    {
-      // don't output program changes for GM drum channel
-      //if (!(MusEGlobal::song->mtype() == MT_GM && chn == 9)) {
-            int hb = (b >> 16) & 0xff;
-            int lb = (b >> 8) & 0xff;
-            int pr = b & 0x7f;
-            //printf("MidiJackDevice::processEvent CTRL_PROGRAM time:%d type:%d ch:%d A:%d B:%d hb:%d lb:%d pr:%d\n", 
-            //       event.time(), event.type(), event.channel(), event.dataA(), event.dataB(), hb, lb, pr);
-          
-            if (hb != 0xff)
-            {
-                  if(!queueEvent(MidiPlayEvent(t, port, chn, ME_CONTROLLER, CTRL_HBANK, hb)))
-                    return false;
-///                  t += 1;      
-            }
-            if (lb != 0xff)
-            {
-                  if(!queueEvent(MidiPlayEvent(t, port, chn, ME_CONTROLLER, CTRL_LBANK, lb)))
-                    return false;
-///                  t += 1;      
-            }
-            if(!queueEvent(MidiPlayEvent(t, port, chn, ME_PROGRAM, pr, 0)))
-              return false;
-              
-      //      }
-    }
-    else if (a == CTRL_MASTER_VOLUME) 
-    {
-      unsigned char sysex[] = {
-            0x7f, 0x7f, 0x04, 0x01, 0x00, 0x00
-            };
-      //sysex[1] = deviceId(); TODO FIXME p4.0.15 Grab the ID from midi port sync info.
-      sysex[4] = b & 0x7f;
-      sysex[5] = (b >> 7) & 0x7f;
-      if(!queueEvent(MidiPlayEvent(t, port, ME_SYSEX, sysex, 6)))
-        return false;
-    }
-    else if (a < CTRL_14_OFFSET) 
-    {              // 7 Bit Controller
-      //queueEvent(museport, MidiPlayEvent(t, port, chn, event));
-      if(!queueEvent(event))
-        return false;
-    }
-    else if (a < CTRL_RPN_OFFSET) 
-    {     // 14 bit high resolution controller
-      int ctrlH = (a >> 8) & 0x7f;
-      int ctrlL = a & 0x7f;
-      int dataH = (b >> 7) & 0x7f;
-      int dataL = b & 0x7f;
-      if(!queueEvent(MidiPlayEvent(t,   port, chn, ME_CONTROLLER, ctrlH, dataH)))
-        return false;
-///     t += 1;      
-      if(!queueEvent(MidiPlayEvent(t, port, chn, ME_CONTROLLER, ctrlL, dataL)))
-        return false;
-    }
-    else if (a < CTRL_NRPN_OFFSET) 
-    {     // RPN 7-Bit Controller
-      int ctrlH = (a >> 8) & 0x7f;
-      int ctrlL = a & 0x7f;
-      if(!queueEvent(MidiPlayEvent(t,   port, chn, ME_CONTROLLER, CTRL_HRPN, ctrlH)))
-        return false;
-///     t += 1;      
-      if(!queueEvent(MidiPlayEvent(t, port, chn, ME_CONTROLLER, CTRL_LRPN, ctrlL)))
-        return false;
-///     t += 1;      
-      if(!queueEvent(MidiPlayEvent(t, port, chn, ME_CONTROLLER, CTRL_HDATA, b)))
-        return false;
-///     t += 1;      
+      const int cc    = ME_CONTROLLER | chn;
+      const int ctrlH = (a >> 8) & 0x7f;
+      const int ctrlL = a & 0x7f;
+      const int dataH = (b >> 7) & 0x7f;
+      const int dataL = b & 0x7f;
       
-      //t += 3;  
-      // Select null parameters so that subsequent data controller events do not upset the last *RPN controller.
-      //sendNullRPNParams(chn, false);
-      if(nvh != 0xff)
+      if((a | 0xff) == CTRL_POLYAFTER) 
+        m[n++].set(ME_POLYAFTER | chn, a & 0x7f, b & 0x7f);
+      else if(a == CTRL_AFTERTOUCH) 
+        m[n++].set(ME_AFTERTOUCH | chn, b & 0x7f);
+      else if(a == CTRL_PITCH) 
       {
-        if(!queueEvent(MidiPlayEvent(t, port, chn, ME_CONTROLLER, CTRL_HRPN, nvh & 0x7f)))
-          return false;
-///        t += 1;  
+        int v = b + 8192;
+        m[n++].set(ME_PITCHBEND | chn, v & 0x7f, (v >> 7) & 0x7f);
       }
-      if(nvl != 0xff)
+      else if(a == CTRL_PROGRAM) 
+        n = encodeProgram(chn, b, m);
+      else if(a == CTRL_MASTER_VOLUME) 
       {
-        if(!queueEvent(MidiPlayEvent(t, port, chn, ME_CONTROLLER, CTRL_LRPN, nvl & 0x7f)))
-          return false;
-      }    
-    }
-    //else if (a < CTRL_RPN14_OFFSET) 
-    else if (a < CTRL_INTERNAL_OFFSET) 
-    {     // NRPN 7-Bit Controller
-      int ctrlH = (a >> 8) & 0x7f;
-      int ctrlL = a & 0x7f;
-      if(!queueEvent(MidiPlayEvent(t,   port, chn, ME_CONTROLLER, CTRL_HNRPN, ctrlH)))
-        return false;
-///     t += 1;      
-      if(!queueEvent(MidiPlayEvent(t, port, chn, ME_CONTROLLER, CTRL_LNRPN, ctrlL)))
-        return false;
-///     t += 1;      
-      if(!queueEvent(MidiPlayEvent(t, port, chn, ME_CONTROLLER, CTRL_HDATA, b)))
-        return false;
-///     t += 1;      
-                  
-      //t += 3;  
-      //sendNullRPNParams(chn, true);
-      if(nvh != 0xff)
-      {
-        if(!queueEvent(MidiPlayEvent(t, port, chn, ME_CONTROLLER, CTRL_HNRPN, nvh & 0x7f)))
-          return false;
-///        t += 1;  
+        //sysex[1] = deviceId(); TODO FIXME p4.0.15 Grab the ID from midi port sync info.
+        static const unsigned char sysex[] = { 0xf0, 0x7f, 0x7f, 0x04, 0x01, 0x00, 0x00, 0xf7 };
+        memcpy(m[n].data, sysex, sizeof(sysex));
+        m[n].data[5] = b & 0x7f;
+        m[n].data[6] = (b >> 7) & 0x7f;
+        m[n++].len = sizeof(sysex);
       }
-      if(nvl != 0xff)
-      {
-        if(!queueEvent(MidiPlayEvent(t, port, chn, ME_CONTROLLER, CTRL_LNRPN, nvl & 0x7f)))
-          return false;
-      }    
-    }
-    else if (a < CTRL_NRPN14_OFFSET) 
-    {     // RPN14 Controller
-      int ctrlH = (a >> 8) & 0x7f;
-      int ctrlL = a & 0x7f;
-      int dataH = (b >> 7) & 0x7f;
-      int dataL = b & 0x7f;
-      if(!queueEvent(MidiPlayEvent(t,   port, chn, ME_CONTROLLER, CTRL_HRPN, ctrlH)))
-        return false;
-///     t += 1;      
-      if(!queueEvent(MidiPlayEvent(t, port, chn, ME_CONTROLLER, CTRL_LRPN, ctrlL)))
-        return false;
-///     t += 1;      
-      if(!queueEvent(MidiPlayEvent(t, port, chn, ME_CONTROLLER, CTRL_HDATA, dataH)))
-        return false;
-///     t += 1;      
-      if(!queueEvent(MidiPlayEvent(t, port, chn, ME_CONTROLLER, CTRL_LDATA, dataL)))
-        return false;
-///     t += 1;      
-      
-      //t += 4;  
-      //sendNullRPNParams(chn, false);
-      if(nvh != 0xff)
+      else if(a < CTRL_14_OFFSET)                   // 7 Bit Controller
+        m[n++].set(cc, a, b);
+      else if(a < CTRL_RPN_OFFSET)                  // 14 bit high resolution controller
       {
-        if(!queueEvent(MidiPlayEvent(t, port, chn, ME_CONTROLLER, CTRL_HRPN, nvh & 0x7f)))
-          return false;
-///        t += 1;  
+        m[n++].set(cc, ctrlH, dataH);
+        m[n++].set(cc, ctrlL, dataL);
       }
-      if(nvl != 0xff)
+      else if(a < CTRL_INTERNAL_OFFSET)             // RPN or NRPN 7-Bit Controller
       {
-        if(!queueEvent(MidiPlayEvent(t, port, chn, ME_CONTROLLER, CTRL_LRPN, nvl & 0x7f)))
-          return false;
-      }    
-    }
-    else if (a < CTRL_NONE_OFFSET) 
-    {     // NRPN14 Controller
-      int ctrlH = (a >> 8) & 0x7f;
-      int ctrlL = a & 0x7f;
-      int dataH = (b >> 7) & 0x7f;
-      int dataL = b & 0x7f;
-      if(!queueEvent(MidiPlayEvent(t,   port, chn, ME_CONTROLLER, CTRL_HNRPN, ctrlH)))
-        return false;
-///     t += 1;      
-      if(!queueEvent(MidiPlayEvent(t, port, chn, ME_CONTROLLER, CTRL_LNRPN, ctrlL)))
-        return false;
-///     t += 1;      
-      if(!queueEvent(MidiPlayEvent(t, port, chn, ME_CONTROLLER, CTRL_HDATA, dataH)))
-        return false;
-///     t += 1;      
-      if(!queueEvent(MidiPlayEvent(t, port, chn, ME_CONTROLLER, CTRL_LDATA, dataL)))
-        return false;
-///     t += 1;      
-    
-      //t += 4;  
-      //sendNullRPNParams(chn, true);
-      if(nvh != 0xff)
-      {
-        if(!queueEvent(MidiPlayEvent(t, port, chn, ME_CONTROLLER, CTRL_HNRPN, nvh & 0x7f)))
-          return false;
-///        t += 1;  
+        const bool nrpn = a >= CTRL_NRPN_OFFSET;
+        m[n++].set(cc, nrpn ? CTRL_HNRPN : CTRL_HRPN, ctrlH);
+        m[n++].set(cc, nrpn ? CTRL_LNRPN : CTRL_LRPN, ctrlL);
+        m[n++].set(cc, CTRL_HDATA, b);
+        // Select null parameters so that subsequent data controller events do not upset the last *RPN controller.
+        if(nvh != 0xff)
+          m[n++].set(cc, nrpn ? CTRL_HNRPN : CTRL_HRPN, nvh & 0x7f);
+        if(nvl != 0xff)
+          m[n++].set(cc, nrpn ? CTRL_LNRPN : CTRL_LRPN, nvl & 0x7f);
       }
-      if(nvl != 0xff)
+      else if(a < CTRL_NONE_OFFSET)                 // RPN14 or NRPN14 Controller
       {
-        if(!queueEvent(MidiPlayEvent(t, port, chn, ME_CONTROLLER, CTRL_LNRPN, nvl & 0x7f)))
-         return false;
-      }   
+        const bool nrpn = a >= CTRL_NRPN14_OFFSET;
+        m[n++].set(cc, nrpn ? CTRL_HNRPN : CTRL_HRPN, ctrlH);
+        m[n++].set(cc, nrpn ? CTRL_LNRPN : CTRL_LRPN, ctrlL);
+        m[n++].set(cc, CTRL_HDATA, dataH);
+        m[n++].set(cc, CTRL_LDATA, dataL);
+        if(nvh != 0xff)
+          m[n++].set(cc, nrpn ? CTRL_HNRPN : CTRL_HRPN, nvh & 0x7f);
+        if(nvl != 0xff)
+          m[n++].set(cc, nrpn ? CTRL_LNRPN : CTRL_LRPN, nvl & 0x7f);
+      }
+      else if(MusEGlobal::debugMsg)
+        printf("MidiJackDevice::encodeEvent: unknown controller type 0x%x\n", a);
+      break;
     }
-    else 
-    {
+    default:
       if(MusEGlobal::debugMsg)
-        printf("MidiJackDevice::processEvent: unknown controller type 0x%x\n", a);
-      //return false;  // Just ignore it.
-    }
+        printf("MidiJackDevice::encodeEvent: event type %x not supported\n", e.type());
+      break;
   }
-  else 
+  return n;
+}
+
+//---------------------------------------------------------
+//   encodeProgram
+//    Bank select high and low (if not 0xff) and program.
+//---------------------------------------------------------
+
+int MidiJackDevice::encodeProgram(int chn, int val, EncodedMsg* m) const
+{
+  // don't output program changes for GM drum channel
+  //if (!(MusEGlobal::song->mtype() == MT_GM && chn == 9)) {
+  int n = 0;
+  int hb = (val >> 16) & 0xff;
+  int lb = (val >> 8) & 0xff;
+  int pr = val & 0x7f;
+  if(hb != 0xff)
+    m[n++].set(ME_CONTROLLER | chn, CTRL_HBANK, hb);
+  if(lb != 0xff)
+    m[n++].set(ME_CONTROLLER | chn, CTRL_LBANK, lb);
+  m[n++].set(ME_PROGRAM | chn, pr);
+  return n;
+}
+
+//---------------------------------------------------------
+//   reserveMsg
+//    Reserve space for one raw message in the Jack port
+//    buffer. Event time 0, or any time with external sync,
+//    means 'now'. Times before this cycle are counted as
+//    late. Returns 0 if the buffer is full.
+//---------------------------------------------------------
+
+unsigned char* MidiJackDevice::reserveMsg(void* port_buf, unsigned time, int len)
+{
+  int ft = 0;
+  if(time != 0 && !_cycleExtSync)
   {
-    //queueEvent(MidiPlayEvent(t, port, chn, event));
-    if(!queueEvent(event))
-      return false;
+    ft = int(time - _cycleBase);
+    if(ft < 0)
+    {
+      _lateEvents.ref();
+      ft = 0;
+    }
+    else if(ft >= (int)MusEGlobal::segmentSize)
+      ft = MusEGlobal::segmentSize - 1;
   }
+  // Jack wants the events in order.
+  if(ft < _cycleLastFrame)
+    ft = _cycleLastFrame;
   
+  unsigned char* dst = jack_midi_event_reserve(port_buf, ft, len);
+  if(dst)
+    _cycleLastFrame = ft;
+  #ifdef JACK_MIDI_DEBUG
+  else
+    fprintf(stderr, "MidiJackDevice::reserveMsg: buffer overflow, stopping until next cycle\n");  
+  #endif  
+  return dst;
+}
+
+//---------------------------------------------------------
+//   reserveFailed
+//    A message which does not even fit into an empty
+//    buffer is dropped, otherwise it waits for the next
+//    cycle. Returns true if it was dropped.
+//---------------------------------------------------------
+
+bool MidiJackDevice::reserveFailed(void* port_buf, int len)
+{
+  if(jack_midi_get_event_count(port_buf) != 0)
+    return false;
+  // FIXME: We really need to chunk sysex events properly. It's tough. Investigating...
+  fprintf(stderr, "MidiJackDevice::processMidi: buffer overflow, message of %d bytes too big, event lost\n", len);
+  _droppedEvents.ref();
   return true;
 }
     
@@ -1284,14 +1070,26 @@ void MidiJackDevice::processMidi()
   }
   */
   
-  while(!eventFifo.isEmpty())
+  // Per cycle values for reserveMsg().
+  _cycleBase      = MusEGlobal::audio->getFrameOffset() + MusEGlobal::audio->pos().frame();
+  _cycleExtSync   = MusEGlobal::extSyncFlag.value();
+  _cycleLastFrame = 0;
+  
+  // Events from putEvent() are already encoded, copy them straight into the buffer.
+  unsigned t;
+  int len;
+  while((len = _outFifo.peek(&t)) >= 0)
   {
-    MidiPlayEvent e(eventFifo.peek()); 
-    //printf("MidiJackDevice::processMidi FIFO event time:%d type:%d ch:%d A:%d B:%d\n", e.time(), e.type(), e.channel(), e.dataA(), e.dataB()); 
     // Try to process only until full, keep rest for next cycle. If no out client port or no write enable, eat up events.  p4.0.15 
-    if(port_buf && !processEvent(e))  
-      return;            // Give up. The Jack buffer is full. Nothing left to do.  
-    eventFifo.remove();  // Successfully processed event. Remove it from FIFO.
+    if(port_buf)
+    {
+      unsigned char* dst = reserveMsg(port_buf, t, len);
+      if(dst)
+        _outFifo.copy(dst);
+      else if(!reserveFailed(port_buf, len))
+        return;            // Give up. The Jack buffer is full. Nothing left to do.  
+    }
+    _outFifo.remove();     // Successfully processed event. Remove it from FIFO.
   }
   
   //if(!(stop || (seek && is_playing)))
@@ -1309,7 +1107,41 @@ void MidiJackDevice::processMidi()
       continue;
   
     // Try to process only until full, keep rest for next cycle. If no out client port or no write enable, eat up events.  p4.0.15 
-    if(port_buf && !processEvent(*i)) 
+    if(!port_buf)
+      continue;
+    
+    if(MusEGlobal::midiOutputTrace) 
+    {
+      fprintf(stderr, "MidiOut: Jack: <%s>: ", name().toLatin1().constData());
+      i->dump();
+    }
+    
+    if(i->type() == ME_SYSEX)
+    {
+      const int n = i->len();
+      unsigned char* dst = reserveMsg(port_buf, i->time(), n + 2);
+      if(dst)
+      {
+        dst[0] = 0xf0;
+        memcpy(dst + 1, i->data(), n);
+        dst[n + 1] = 0xf7;
+      }
+      else if(!reserveFailed(port_buf, n + 2))
+        break;
+      continue;
+    }
+    
+    EncodedMsg m[MaxEncodedMsgs];
+    const int n = encodeEvent(*i, m);
+    int k = 0;
+    for( ; k < n; ++k)
+    {
+      unsigned char* dst = reserveMsg(port_buf, i->time(), m[k].len);
+      if(!dst)
+        break;
+      memcpy(dst, m[k].data, m[k].len);
+    }
+    if(k < n)
       break;
   }
   _playEvents.erase(_playEvents.begin(), i);
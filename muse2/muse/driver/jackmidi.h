@@ -31,7 +31,10 @@
 #include <jack/jack.h>
 #include <jack/midiport.h>
 
+#include <QAtomicInt>
+
 #include "mididev.h"
+#include "mpevent.h"
 #include "route.h"
 
 class QString;
@@ -63,9 +66,30 @@ class MidiJackDevice : public MidiDevice {
       virtual void close();
       //bool putEvent(int*);
       
-      bool processEvent(const MidiPlayEvent&);
-      // Port is not midi port, it is the port(s) created for MusE.
-      bool queueEvent(const MidiPlayEvent&);
+      // One raw short message, or the master volume sysex.
+      struct EncodedMsg {
+            unsigned char data[8];
+            int len;
+            void set(int s, int a)        { data[0] = s; data[1] = a; len = 2; }
+            void set(int s, int a, int b) { data[0] = s; data[1] = a; data[2] = b; len = 3; }
+            };
+      // Longest expansion: (N)RPN14 with null parameters.
+      enum { MaxEncodedMsgs = 6 };
+      
+      // Events from putEvent(), encoded by the calling thread.
+      MidiByteFifo _outFifo;
+      QAtomicInt _droppedEvents;    // Fifo overflow or too big for the Jack buffer.
+      QAtomicInt _lateEvents;       // Time was before the current cycle.
+      
+      // Valid during processMidi().
+      unsigned _cycleBase;
+      bool _cycleExtSync;
+      int _cycleLastFrame;
+      
+      int encodeEvent(const MidiPlayEvent&, EncodedMsg*) const;
+      int encodeProgram(int chn, int val, EncodedMsg*) const;
+      unsigned char* reserveMsg(void* port_buf, unsigned time, int len);
+      bool reserveFailed(void* port_buf, int len);
       
       virtual bool putMidiEvent(const MidiPlayEvent&);
       //bool sendEvent(const MidiPlayEvent&);
@@ -89,6 +113,9 @@ class MidiJackDevice : public MidiDevice {
       virtual bool putEvent(const MidiPlayEvent&);
       virtual void collectMidiEvents();
       
+      int droppedEvents() const { return _droppedEvents.load(); }
+      int lateEvents() const    { return _lateEvents.load(); }
+      
       virtual void* inClientPort()  { return (void*)  _in_client_jackport; }
       virtual void* outClientPort() { return (void*) _out_client_jackport; }
       
@@ -0,0 +1,304 @@
+//=========================================================
+//  MusE
+//  Linux Music Editor
+//
+//  midijitter.cpp
+//    ALSA sequencer loopback timing measurement
+//
+//  This program is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU General Public License
+//  as published by the Free Software Foundation; version 2 of
+//  the License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+//
+//=========================================================
+
+//---------------------------------------------------------
+//    Loop mode (default):
+//      notes are sent to <port> and read back from it, either
+//      timestamped on a queue (as with config.alsaMidiQueue)
+//      or directly from a sleeping thread (-d, like the timer
+//      driven midi thread). Use "Midi Through" for the
+//      sequencer alone or a cable loop for a real interface.
+//    Listen mode (-l):
+//      notes coming from <port> (for example a MusE output
+//      playing a steady pattern) are timestamped on arrival,
+//      the error is the deviation of each interval from the
+//      median interval.
+//    Both print a histogram of the timing error.
+//---------------------------------------------------------
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <math.h>
+#include <time.h>
+#include <poll.h>
+#include <algorithm>
+#include <vector>
+
+#include <alsa/asoundlib.h>
+
+static snd_seq_t* seq;
+static int queue;
+static int outPort;
+static int inPort;
+
+//---------------------------------------------------------
+//   usage
+//---------------------------------------------------------
+
+static void usage(const char* prog)
+      {
+      fprintf(stderr,
+         "usage: %s [-l] [-d] [-n count] [-i ms] [-b us] client:port\n"
+         "   -l        listen only, measure interval deviation\n"
+         "   -d        send directly from a sleeping thread instead of the queue\n"
+         "   -n count  number of notes (default 500)\n"
+         "   -i ms     note interval in loop mode (default 10)\n"
+         "   -b us     histogram bin width (default 100)\n", prog);
+      exit(1);
+      }
+
+//---------------------------------------------------------
+//   queueNs
+//---------------------------------------------------------
+
+static long long queueNs()
+      {
+      snd_seq_queue_status_t* status;
+      snd_seq_queue_status_alloca(&status);
+      snd_seq_get_queue_status(seq, queue, status);
+      const snd_seq_real_time_t* t = snd_seq_queue_status_get_real_time(status);
+      return (long long)t->tv_sec * 1000000000LL + t->tv_nsec;
+      }
+
+//---------------------------------------------------------
+//   receive
+//    Returns the queue time stamp of the next note on,
+//    -1 on timeout.
+//---------------------------------------------------------
+
+static long long receive(int timeoutMs)
+      {
+      int npfd = snd_seq_poll_descriptors_count(seq, POLLIN);
+      struct pollfd pfd[npfd];
+      snd_seq_poll_descriptors(seq, pfd, npfd, POLLIN);
+      for (;;) {
+            snd_seq_event_t* ev;
+            while (snd_seq_event_input_pending(seq, 1) > 0) {
+                  if (snd_seq_event_input(seq, &ev) < 0)
+                        break;
+                  if (ev->type == SND_SEQ_EVENT_NOTEON && ev->data.note.velocity)
+                        return (long long)ev->time.time.tv_sec * 1000000000LL + ev->time.time.tv_nsec;
+                  }
+            if (poll(pfd, npfd, timeoutMs) <= 0)
+                  return -1;
+            }
+      }
+
+//---------------------------------------------------------
+//   sendNote
+//---------------------------------------------------------
+
+static void sendNote(int note, const snd_seq_real_time_t* at)
+      {
+      snd_seq_event_t ev;
+      snd_seq_ev_clear(&ev);
+      snd_seq_ev_set_source(&ev, outPort);
+      snd_seq_ev_set_subs(&ev);
+      snd_seq_ev_set_noteon(&ev, 0, note, 100);
+      if (at) {
+            snd_seq_ev_schedule_real(&ev, queue, 0, at);
+            snd_seq_event_output(seq, &ev);
+            }
+      else {
+            snd_seq_ev_set_direct(&ev);
+            snd_seq_event_output_direct(seq, &ev);
+            }
+      }
+
+//---------------------------------------------------------
+//   report
+//---------------------------------------------------------
+
+static void report(std::vector<double>& err, double binUs)
+      {
+      if (err.empty()) {
+            printf("no events received\n");
+            return;
+            }
+      double sum = 0.0, sum2 = 0.0;
+      for (size_t i = 0; i < err.size(); ++i) {
+            sum  += err[i];
+            sum2 += err[i] * err[i];
+            }
+      const double mean = sum / err.size();
+      const double sdev = sqrt(std::max(0.0, sum2 / err.size() - mean * mean));
+      std::sort(err.begin(), err.end());
+      printf("events %zu  mean %.1f us  stddev %.1f us  min %.1f us  max %.1f us  p99 %.1f us\n",
+         err.size(), mean, sdev, err.front(), err.back(), err[(err.size() * 99) / 100]);
+
+      const int bins = 20;
+      int hist[bins + 1];
+      memset(hist, 0, sizeof(hist));
+      for (size_t i = 0; i < err.size(); ++i) {
+            int b = int(fabs(err[i]) / binUs);
+            hist[std::min(b, bins)]++;
+            }
+      int peak = *std::max_element(hist, hist + bins + 1);
+      for (int b = 0; b <= bins; ++b) {
+            if (b < bins)
+                  printf("%7.0f - %7.0f us %6d ", b * binUs, (b + 1) * binUs, hist[b]);
+            else
+                  printf("        > %7.0f us %6d ", bins * binUs, hist[b]);
+            int n = peak ? (hist[b] * 50 + peak - 1) / peak : 0;
+            for (int i = 0; i < n; ++i)
+                  putchar('#');
+            putchar('\n');
+            }
+      }
+
+//---------------------------------------------------------
+//   main
+//---------------------------------------------------------
+
+int main(int argc, char* argv[])
+      {
+      bool listen = false;
+      bool direct = false;
+      int count   = 500;
+      int interval = 10;
+      double binUs = 100.0;
+      int c;
+      while ((c = getopt(argc, argv, "ldn:i:b:")) != EOF) {
+            switch (c) {
+                  case 'l': listen = true; break;
+                  case 'd': direct = true; break;
+                  case 'n': count = atoi(optarg); break;
+                  case 'i': interval = atoi(optarg); break;
+                  case 'b': binUs = atof(optarg); break;
+                  default:  usage(argv[0]);
+                  }
+            }
+      if (optind != argc - 1 || count < 2 || interval < 1 || binUs <= 0.0)
+            usage(argv[0]);
+
+      if (snd_seq_open(&seq, "default", SND_SEQ_OPEN_DUPLEX, 0) < 0) {
+            fprintf(stderr, "cannot open ALSA sequencer\n");
+            return 1;
+            }
+      snd_seq_set_client_name(seq, "midijitter");
+      snd_seq_addr_t peer;
+      if (snd_seq_parse_address(seq, &peer, argv[optind]) < 0) {
+            fprintf(stderr, "bad port address <%s>\n", argv[optind]);
+            return 1;
+            }
+
+      queue = snd_seq_alloc_named_queue(seq, "midijitter");
+      snd_seq_start_queue(seq, queue, 0);
+      snd_seq_drain_output(seq);
+
+      // Input events are stamped with the queue real time on arrival.
+      snd_seq_port_info_t* pinfo;
+      snd_seq_port_info_alloca(&pinfo);
+      snd_seq_port_info_set_name(pinfo, "in");
+      snd_seq_port_info_set_capability(pinfo, SND_SEQ_PORT_CAP_WRITE | SND_SEQ_PORT_CAP_SUBS_WRITE);
+      snd_seq_port_info_set_type(pinfo, SND_SEQ_PORT_TYPE_APPLICATION);
+      snd_seq_port_info_set_timestamping(pinfo, 1);
+      snd_seq_port_info_set_timestamp_real(pinfo, 1);
+      snd_seq_port_info_set_timestamp_queue(pinfo, queue);
+      snd_seq_create_port(seq, pinfo);
+      inPort = snd_seq_port_info_get_port(pinfo);
+      if (snd_seq_connect_from(seq, inPort, peer.client, peer.port) < 0) {
+            fprintf(stderr, "cannot connect from %d:%d\n", peer.client, peer.port);
+            return 1;
+            }
+
+      std::vector<double> err;
+      err.reserve(count);
+
+      if (listen) {
+            printf("listening on %d:%d for %d notes\n", peer.client, peer.port, count);
+            std::vector<long long> t;
+            t.reserve(count);
+            while (int(t.size()) < count) {
+                  long long ns = receive(t.empty() ? -1 : 5000);
+                  if (ns < 0)
+                        break;
+                  t.push_back(ns);
+                  }
+            std::vector<double> iv;
+            for (size_t i = 1; i < t.size(); ++i)
+                  iv.push_back((t[i] - t[i-1]) / 1000.0);
+            if (!iv.empty()) {
+                  std::vector<double> s(iv);
+                  std::nth_element(s.begin(), s.begin() + s.size() / 2, s.end());
+                  const double median = s[s.size() / 2];
+                  printf("median interval %.1f us\n", median);
+                  for (size_t i = 0; i < iv.size(); ++i)
+                        err.push_back(iv[i] - median);
+                  }
+            report(err, binUs);
+            snd_seq_close(seq);
+            return 0;
+            }
+
+      outPort = snd_seq_create_simple_port(seq, "out",
+         SND_SEQ_PORT_CAP_READ | SND_SEQ_PORT_CAP_SUBS_READ, SND_SEQ_PORT_TYPE_APPLICATION);
+      if (snd_seq_connect_to(seq, outPort, peer.client, peer.port) < 0) {
+            fprintf(stderr, "cannot connect to %d:%d\n", peer.client, peer.port);
+            return 1;
+            }
+
+      printf("%s: %d notes every %d ms through %d:%d\n",
+         direct ? "direct" : "queued", count, interval, peer.client, peer.port);
+
+      const long long step  = interval * 1000000LL;
+      const long long start = queueNs() + 100000000LL;
+      int received = 0;
+      for (int i = 0; i < count; ++i) {
+            const long long due = start + i * step;
+            if (direct) {
+                  // Sleep on the system timer until due, like a timer tick.
+                  long long now = queueNs();
+                  if (due > now) {
+                        struct timespec ts;
+                        ts.tv_sec  = (due - now) / 1000000000LL;
+                        ts.tv_nsec = (due - now) % 1000000000LL;
+                        nanosleep(&ts, 0);
+                        }
+                  sendNote(60 + (i % 24), 0);
+                  }
+            else {
+                  snd_seq_real_time_t rt;
+                  rt.tv_sec  = due / 1000000000LL;
+                  rt.tv_nsec = due % 1000000000LL;
+                  sendNote(60 + (i % 24), &rt);
+                  snd_seq_drain_output(seq);
+                  }
+            // Keep a few queued events ahead, the pools are small.
+            while (received < count && (i + 1 - received > (direct ? 0 : 8) || i == count - 1)) {
+                  long long ns = receive(interval + 1000);
+                  if (ns < 0) {
+                        fprintf(stderr, "event %d lost\n", received);
+                        received = count;
+                        break;
+                        }
+                  err.push_back((ns - (start + received * step)) / 1000.0);
+                  ++received;
+                  }
+            }
+      report(err, binUs);
+      snd_seq_close(seq);
+      return 0;
+      }
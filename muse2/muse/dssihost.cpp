@@ -61,42 +61,30 @@
 #include "globaldefs.h"
 #include "gconfig.h"
 #include "popupmenu.h"
+#include "pluginscan.h"
 
 namespace MusECore {
 
 //---------------------------------------------------------
 //   scanDSSILib
+//   The descriptors come from the plugin scan cache, the
+//    library is only loaded if it is new or has changed.
 //---------------------------------------------------------
 
 static void scanDSSILib(QFileInfo& fi) // ddskrjo removed const for argument
       {
-      void* handle = dlopen(fi.filePath().toLatin1().constData(), RTLD_NOW);
-      
-      if (handle == 0) {
-            fprintf(stderr, "scanDSSILib: dlopen(%s) failed: %s\n",
-              fi.filePath().toLatin1().constData(), dlerror());
-              
+      PluginScanLib* lib = MusEGlobal::pluginScanCache.lib(fi);
+      if (lib == 0)
             return;
-            }
-      DSSI_Descriptor_Function dssi = (DSSI_Descriptor_Function)dlsym(handle, "dssi_descriptor");
 
-      if (!dssi) 
+      for (std::vector<PluginScanInfo>::iterator i = lib->plugins.begin(); i != lib->plugins.end(); ++i)
       {
-        dlclose(handle);
-        return;
-      }
-      else
-      {
-        for (int i = 0;; ++i) 
-        {
-          const DSSI_Descriptor* descr;
-          
-          descr = dssi(i);
-          if (descr == 0)
-                break;
-          
+          // Not a DSSI library. Effects are listed by the ladspa scan.
+          if (!i->isDssi)
+                return;
+
           #ifdef DSSI_DEBUG 
-          fprintf(stderr, "scanDSSILib: name:%s inPlaceBroken:%d\n", descr->LADSPA_Plugin->Name, LADSPA_IS_INPLACE_BROKEN(descr->LADSPA_Plugin->Properties));
+          fprintf(stderr, "scanDSSILib: name:%s inPlaceBroken:%d\n", i->name.constData(), LADSPA_IS_INPLACE_BROKEN(i->properties));
           #endif
           
           // Listing synths only while excluding effect plugins:
@@ -104,13 +92,10 @@ static void scanDSSILib(QFileInfo& fi) // ddskrjo removed const for argument
           // That way we cover all bases - effect plugins and synths. 
           // Non-synths will show up in the ladspa effect dialog, while synths will show up here...
           // There should be nothing left out...
-          // TIP: Until we add programs to plugins, comment these four checks to load dssi effects as synths, in order to have programs. 
-          if(descr->run_synth ||                  
-            descr->run_synth_adding ||
-            descr->run_multiple_synths ||
-            descr->run_multiple_synths_adding) 
+          // TIP: Until we add programs to plugins, comment this check to load dssi effects as synths, in order to have programs. 
+          if(i->isDssiSynth)
           {
-            const QString label(descr->LADSPA_Plugin->Label);
+            const QString label(i->label);
             
             // Make sure it doesn't already exist.
             std::vector<Synth*>::iterator is;
@@ -123,16 +108,20 @@ static void scanDSSILib(QFileInfo& fi) // ddskrjo removed const for argument
             if(is != MusEGlobal::synthis.end())
               continue;
 
-            DssiSynth* s = new DssiSynth(fi, descr);
+            // DssiSynth only looks at the ladspa part here.
+            DSSI_Descriptor d;
+            memset(&d, 0, sizeof(d));
+            d.LADSPA_Plugin = i->descriptor();
+            DssiSynth* s = new DssiSynth(fi, &d);
             
             if(MusEGlobal::debugMsg)
             {
               fprintf(stderr, "scanDSSILib: name:%s listname:%s lib:%s listlib:%s\n", 
                       label.toLatin1().constData(), s->name().toLatin1().constData(), fi.completeBaseName().toLatin1().constData(), s->baseName().toLatin1().constData());
               int ai = 0, ao = 0, ci = 0, co = 0;
-              for(unsigned long pt = 0; pt < descr->LADSPA_Plugin->PortCount; ++pt)
+              for(unsigned long pt = 0; pt < i->portDescr.size(); ++pt)
               {
-                LADSPA_PortDescriptor pd = descr->LADSPA_Plugin->PortDescriptors[pt];
+                LADSPA_PortDescriptor pd = i->portDescr[pt];
                 if(LADSPA_IS_PORT_INPUT(pd) && LADSPA_IS_PORT_AUDIO(pd))
                   ai++;
                 else  
@@ -150,9 +139,7 @@ static void scanDSSILib(QFileInfo& fi) // ddskrjo removed const for argument
             
             MusEGlobal::synthis.push_back(s);
           }
-        }
-      }  
-      dlclose(handle);
+      }
       }
 
 //---------------------------------------------------------
@@ -50,6 +50,7 @@ enum EventType { Note=0, Controller=1, Sysex=2, /*PAfter=3,*/ /*CAfter=4,*/ Meta
 
 class Event {
       EventBase* ev;
+      friend class AudioConvertMap;
 
    public:
       Event();
@@ -168,6 +169,7 @@ class EventList : public EL {
       iEvent findWithId(const Event&);        // Finds event base or event id. Fast, index t is known.
       
       iEvent add(Event event);
+      iEvent append(Event event);
       void move(Event& event, unsigned tick);
       void dump() const;
       void read(Xml& xml, const char* name, bool midi);
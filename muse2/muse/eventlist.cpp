@@ -93,6 +93,19 @@ iEvent EventList::add(Event event)
       }
       }
 
+//---------------------------------------------------------
+//   append
+//    Adds at the end without searching, in constant time.
+//    The event must not sort before the last one the way
+//    add() sorts.
+//---------------------------------------------------------
+
+iEvent EventList::append(Event event)
+      {
+      unsigned key = event.type() == Wave ? event.frame() : event.tick();
+      return insert(end(), std::pair<const unsigned, Event> (key, event));
+      }
+
 //---------------------------------------------------------
 //   move
 //---------------------------------------------------------
@@ -219,50 +219,14 @@ static void addEventList(const MusECore::EventList& evlist, MusECore::MPEventLis
 }
       
       
-} // namespace MusECore
-
-namespace MusEGui {
-
 //---------------------------------------------------------
-//   exportMidi
+//   exportMidiFile
+//    Writes the midi tracks of the song as a standard midi
+//    file. Returns true on error.
 //---------------------------------------------------------
 
-void MusE::exportMidi()
+bool exportMidiFile(FILE* fp)
       {
-      if(MusEGlobal::config.smfFormat == 0)  // Want single track? Warn if multiple ports in song...
-      {
-        MusECore::MidiTrackList* mtl = MusEGlobal::song->midis();       
-        int prev_port = -1;
-        for(MusECore::ciMidiTrack im = mtl->begin(); im != mtl->end(); ++im) 
-        {
-          int port = (*im)->outPort();
-          if(prev_port == -1)
-          {
-            prev_port = port;
-            continue;
-          }
-          if(port != prev_port)
-          {
-            if(QMessageBox::warning(this, 
-              tr("MusE: Warning"), 
-              tr("The song uses multiple ports but export format 0 (single track) is set.\n"
-                 "The first track's port will be used. Playback will likely be wrong\n"
-                 " unless the channels used in one port are different from all other ports.\n"
-                 "Canceling and setting a different export format would be better.\nContinue?"), 
-                 QMessageBox::Ok | QMessageBox::Cancel, QMessageBox::Ok) 
-                != QMessageBox::Ok) 
-              return;
-            break;
-          }
-        }
-      }
-      
-      MusEGui::MFile file(QString("midis"), QString(".mid"));
-
-      FILE* fp = file.open("w", MusEGlobal::midi_file_save_pattern, this, false, true,
-         tr("MusE: Export Midi"));
-      if (fp == 0)
-            return;
       MusECore::MidiFile mf(fp);
 
       MusECore::TrackList* tl = MusEGlobal::song->tracks();       // Changed to full track list so user can rearrange tracks.
@@ -527,8 +491,54 @@ void MusE::exportMidi()
             
       mf.setDivision(MusEGlobal::config.midiDivision);
       mf.setTrackList(mtl, i);
-      mf.write();
+      return mf.write();
+      }
+
+} // namespace MusECore
 
+namespace MusEGui {
+
+//---------------------------------------------------------
+//   exportMidi
+//---------------------------------------------------------
+
+void MusE::exportMidi()
+      {
+      if(MusEGlobal::config.smfFormat == 0)  // Want single track? Warn if multiple ports in song...
+      {
+        MusECore::MidiTrackList* mtl = MusEGlobal::song->midis();       
+        int prev_port = -1;
+        for(MusECore::ciMidiTrack im = mtl->begin(); im != mtl->end(); ++im) 
+        {
+          int port = (*im)->outPort();
+          if(prev_port == -1)
+          {
+            prev_port = port;
+            continue;
+          }
+          if(port != prev_port)
+          {
+            if(QMessageBox::warning(this, 
+              tr("MusE: Warning"), 
+              tr("The song uses multiple ports but export format 0 (single track) is set.\n"
+                 "The first track's port will be used. Playback will likely be wrong\n"
+                 " unless the channels used in one port are different from all other ports.\n"
+                 "Canceling and setting a different export format would be better.\nContinue?"), 
+                 QMessageBox::Ok | QMessageBox::Cancel, QMessageBox::Ok) 
+                != QMessageBox::Ok) 
+              return;
+            break;
+          }
+        }
+      }
+      
+      MusEGui::MFile file(QString("midis"), QString(".mid"));
+
+      FILE* fp = file.open("w", MusEGlobal::midi_file_save_pattern, this, false, true,
+         tr("MusE: Export Midi"));
+      if (fp == 0)
+            return;
+      MusECore::exportMidiFile(fp);
       }
 
 } // namespace MusEGui
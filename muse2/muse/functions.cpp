@@ -55,6 +55,11 @@
 #include <QMessageBox>
 #include <QClipboard>
 #include <QSet>
+#include <QThread>
+#include <QAtomicInt>
+
+#include <algorithm>
+#include <vector>
 
 
 using namespace std;
@@ -150,6 +155,148 @@ map<const Event*, const Part*> get_events(const set<const Part*>& parts, int ran
 }
 
 
+//---------------------------------------------------------
+//   EventEditJob
+//    A part and its clones among the edited parts, the
+//    overlap and legato functions look at them together.
+//---------------------------------------------------------
+
+struct EventEditJob {
+	vector<const Part*> parts;
+	vector<EventEdit> events;
+};
+
+static void run_event_edit_job(EventEditJob& job, const EventFunction& f, int range)
+{
+	for (vector<const Part*>::const_iterator part=job.parts.begin(); part!=job.parts.end(); part++)
+		for (ciEvent event=(*part)->events().begin(); event!=(*part)->events().end(); event++)
+			if (is_relevant(event->second, *part, range))
+			{
+				const Event& e=event->second;
+				EventEdit edit;
+				edit.event=&e;
+				edit.part=*part;
+				edit.del=false;
+				edit.tick=e.tick();
+				edit.len=e.lenTick();
+				edit.velo=e.velo();
+				edit.veloOff=e.veloOff();
+				edit.pitch=e.pitch();
+				job.events.push_back(edit);
+			}
+	
+	if (!job.events.empty())
+		f.edit(job.events);
+}
+
+//---------------------------------------------------------
+//   EventEditor
+//    Takes the next job until all are taken.
+//---------------------------------------------------------
+
+class EventEditor : public QThread
+{
+	vector<EventEditJob>* jobs;
+	const EventFunction* f;
+	int range;
+	QAtomicInt* next;
+	
+	public:
+		EventEditor(vector<EventEditJob>* jobs_, const EventFunction* f_, int range_, QAtomicInt* next_)
+		   : jobs(jobs_), f(f_), range(range_), next(next_) {}
+		
+		virtual void run()
+		{
+			for (;;)
+			{
+				int i = next->fetchAndAddRelaxed(1);
+				if (i >= int(jobs->size()))
+					break;
+				run_event_edit_job((*jobs)[i], *f, range);
+			}
+		}
+};
+
+void edit_events(const set<const Part*>& parts, int range, const EventFunction& f, Undo& operations)
+{
+	vector<EventEditJob> jobs;
+	size_t n_events=0;
+	
+	for (set<const Part*>::const_iterator part=parts.begin(); part!=parts.end(); part++)
+	{
+		vector<EventEditJob>::iterator job;
+		for (job=jobs.begin(); job!=jobs.end(); job++)
+			if (job->parts.front()->isCloneOf(*part))
+				break;
+		if (job==jobs.end())
+		{
+			jobs.push_back(EventEditJob());
+			job=jobs.end()-1;
+		}
+		job->parts.push_back(*part);
+		n_events+=(*part)->events().size();
+	}
+	
+	// the parts in as many threads as it pays
+	QAtomicInt next(0);
+	vector<EventEditor*> editors;
+	int threads = min(QThread::idealThreadCount(), int(jobs.size())) - 1;
+	if (n_events < 16384)
+		threads = 0;
+	for (int i=0; i<threads; i++)
+	{
+		EventEditor* editor = new EventEditor(&jobs, &f, range, &next);
+		editor->start();
+		editors.push_back(editor);
+	}
+	EventEditor(&jobs, &f, range, &next).run();
+	for (size_t i=0; i<editors.size(); i++)
+	{
+		editors[i]->wait();
+		delete editors[i];
+	}
+	
+	// each event is changed once, so the operations need not be
+	// checked against each other while they are appended
+	map<const Part*, unsigned> partlen;
+	
+	for (vector<EventEditJob>::const_iterator job=jobs.begin(); job!=jobs.end(); job++)
+		for (vector<EventEdit>::const_iterator it=job->events.begin(); it!=job->events.end(); it++)
+		{
+			const Event& event=*(it->event);
+			const Part* part=it->part;
+			
+			if (it->del)
+			{
+				operations.append(UndoOp(UndoOp::DeleteEvent, event, part, false, false));
+				continue;
+			}
+			
+			if (f.expandsParts() && (it->tick+it->len > part->lenTick()) && (!part->hasHiddenEvents()))
+			{
+				unsigned& len=partlen[part];
+				if (it->tick+it->len > len)
+					len=it->tick+it->len; // schedule auto-expanding
+			}
+			
+			if ( (it->tick!=event.tick()) || (it->len!=event.lenTick()) || (it->velo!=event.velo()) ||
+			     (it->veloOff!=event.veloOff()) || (it->pitch!=event.pitch()) )
+			{
+				Event newEvent = event.clone();
+				newEvent.setTick(it->tick);
+				newEvent.setLenTick(it->len);
+				newEvent.setVelo(it->velo);
+				newEvent.setVeloOff(it->veloOff);
+				newEvent.setPitch(it->pitch);
+				operations.append(UndoOp(UndoOp::ModifyEvent, newEvent, event, part, false, false));
+			}
+		}
+	
+	for (map<const Part*, unsigned>::iterator it=partlen.begin(); it!=partlen.end(); it++)
+		schedule_resize_all_same_len_clone_parts(it->first, it->second, operations);
+}
+
+
 
 
 bool modify_notelen(const set<const Part*>& parts)
@@ -439,117 +586,66 @@ bool legato()
 
 
 
-bool modify_velocity(const set<const Part*>& parts, int range, int rate, int offset)
+void VelocityFunction::edit(vector<EventEdit>& events) const
 {
-	map<const Event*, const Part*> events = get_events(parts, range);
-	Undo operations;
-	
-	if ( (!events.empty()) && ((rate!=100) || (offset!=0)) )
+	for (vector<EventEdit>::iterator it=events.begin(); it!=events.end(); it++)
 	{
-		for (map<const Event*, const Part*>::iterator it=events.begin(); it!=events.end(); it++)
-		{
-			const Event& event=*(it->first);
-			const Part* part=it->second;
-			
-			int velo = event.velo();
+		int& velo = off ? it->veloOff : it->velo;
 
-			velo = (velo * rate) / 100;
-			velo += offset;
+		velo = (velo * rate) / 100;
+		velo += offset;
 
-			if (velo <= 0)
-				velo = 1;
-			else if (velo > 127)
-				velo = 127;
-				
-			if (event.velo() != velo)
-			{
-				Event newEvent = event.clone();
-				newEvent.setVelo(velo);
-				operations.push_back(UndoOp(UndoOp::ModifyEvent, newEvent, event, part, false, false));
-			}
-		}
-		
-		return MusEGlobal::song->applyOperationGroup(operations);
+		if (velo <= 0)
+			velo = 1;
+		else if (velo > 127)
+			velo = 127;
 	}
-	else
-		return false;
 }
 
-bool modify_off_velocity(const set<const Part*>& parts, int range, int rate, int offset)
+bool modify_velocity(const set<const Part*>& parts, int range, int rate, int offset)
 {
-	map<const Event*, const Part*> events = get_events(parts, range);
-	Undo operations;
+	if ((rate==100) && (offset==0))
+		return false;
 	
-	if ( (!events.empty()) && ((rate!=100) || (offset!=0)) )
-	{
-		for (map<const Event*, const Part*>::iterator it=events.begin(); it!=events.end(); it++)
-		{
-			const Event& event=*(it->first);
-			const Part* part=it->second;
-			
-			int velo = event.veloOff();
-
-			velo = (velo * rate) / 100;
-			velo += offset;
-
-			if (velo <= 0)
-				velo = 1;
-			else if (velo > 127)
-				velo = 127;
-				
-			if (event.veloOff() != velo)
-			{
-				Event newEvent = event.clone();
-				newEvent.setVeloOff(velo);
-				operations.push_back(UndoOp(UndoOp::ModifyEvent, newEvent, event, part, false, false));
-			}
-		}
+	Undo operations;
+	edit_events(parts, range, VelocityFunction(rate, offset, false), operations);
+	return MusEGlobal::song->applyOperationGroup(operations);
+}
 
-		return MusEGlobal::song->applyOperationGroup(operations);
-	}
-	else
+bool modify_off_velocity(const set<const Part*>& parts, int range, int rate, int offset)
+{
+	if ((rate==100) && (offset==0))
 		return false;
+	
+	Undo operations;
+	edit_events(parts, range, VelocityFunction(rate, offset, true), operations);
+	return MusEGlobal::song->applyOperationGroup(operations);
 }
 
-bool modify_notelen(const set<const Part*>& parts, int range, int rate, int offset)
+void NotelenFunction::edit(vector<EventEdit>& events) const
 {
-	map<const Event*, const Part*> events = get_events(parts, range);
-	Undo operations;
-	map<const Part*, int> partlen;
-	
-	if ( (!events.empty()) && ((rate!=100) || (offset!=0)) )
+	for (vector<EventEdit>::iterator it=events.begin(); it!=events.end(); it++)
 	{
-		for (map<const Event*, const Part*>::iterator it=events.begin(); it!=events.end(); it++)
-		{
-			const Event& event=*(it->first);
-			const Part* part=it->second;
-
-			unsigned int len = event.lenTick(); //prevent compiler warning: comparison singed/unsigned
+		unsigned int len = it->len; //prevent compiler warning: comparison singed/unsigned
 
-			len = (len * rate) / 100;
-			len += offset;
+		len = (len * rate) / 100;
+		len += offset;
 
-			if (len <= 0)
-				len = 1;
-			
-			if ((event.tick()+len > part->lenTick()) && (!part->hasHiddenEvents()))
-				partlen[part]=event.tick()+len; // schedule auto-expanding
-				
-			if (event.lenTick() != len)
-			{
-				Event newEvent = event.clone();
-				newEvent.setLenTick(len);
-				operations.push_back(UndoOp(UndoOp::ModifyEvent, newEvent, event, part, false, false));
-			}
-		}
+		if (len <= 0)
+			len = 1;
 		
-		for (map<const Part*, int>::iterator it=partlen.begin(); it!=partlen.end(); it++)
-			schedule_resize_all_same_len_clone_parts(it->first, it->second, operations);
-
-		return MusEGlobal::song->applyOperationGroup(operations);
+		it->len = len;
 	}
-	else
+}
+
+bool modify_notelen(const set<const Part*>& parts, int range, int rate, int offset)
+{
+	if ((rate==100) && (offset==0))
 		return false;
+	
+	Undo operations;
+	edit_events(parts, range, NotelenFunction(rate, offset), operations);
+	return MusEGlobal::song->applyOperationGroup(operations);
 }
 
 bool set_notelen(const set<const Part*>& parts, int range, int len)
@@ -579,296 +675,218 @@ unsigned quantize_tick(unsigned tick, unsigned raster, int swing)
 		return tick_dest1;
 }
 
-bool quantize_notes(const set<const Part*>& parts, int range, int raster, bool quant_len, int strength, int swing, int threshold)
+void QuantizeFunction::edit(vector<EventEdit>& events) const
 {
-	map<const Event*, const Part*> events = get_events(parts, range);
-	Undo operations;
-	
-	if (!events.empty())
+	for (vector<EventEdit>::iterator it=events.begin(); it!=events.end(); it++)
 	{
-		for (map<const Event*, const Part*>::iterator it=events.begin(); it!=events.end(); it++)
-		{
-			const Event& event=*(it->first);
-			const Part* part=it->second;
+		const Part* part=it->part;
 
-			unsigned begin_tick = event.tick() + part->tick();
-			int begin_diff = quantize_tick(begin_tick, raster, swing) - begin_tick;
+		unsigned begin_tick = it->tick + part->tick();
+		int begin_diff = quantize_tick(begin_tick, raster, swing) - begin_tick;
 
-			if (abs(begin_diff) > threshold)
-				begin_tick = begin_tick + begin_diff*strength/100;
+		if (abs(begin_diff) > threshold)
+			begin_tick = begin_tick + begin_diff*strength/100;
 
 
-			unsigned len=event.lenTick();
+		unsigned len=it->len;
+		
+		unsigned end_tick = begin_tick + len;
+		int len_diff = quantize_tick(end_tick, raster, swing) - end_tick;
 			
-			unsigned end_tick = begin_tick + len;
-			int len_diff = quantize_tick(end_tick, raster, swing) - end_tick;
-				
-			if ((abs(len_diff) > threshold) && quant_len)
-				len = len + len_diff*strength/100;
+		if ((abs(len_diff) > threshold) && quant_len)
+			len = len + len_diff*strength/100;
 
-			if (len <= 0)
-				len = 1;
+		if (len <= 0)
+			len = 1;
 
-				
-			if ( (event.lenTick() != len) || (event.tick() + part->tick() != begin_tick) )
-			{
-				Event newEvent = event.clone();
-				newEvent.setTick(begin_tick - part->tick());
-				newEvent.setLenTick(len);
-				operations.push_back(UndoOp(UndoOp::ModifyEvent, newEvent, event, part, false, false));
-			}
-		}
-		
-		return MusEGlobal::song->applyOperationGroup(operations);
+		it->tick = begin_tick - part->tick();
+		it->len = len;
 	}
-	else
-		return false;
+}
+
+bool quantize_notes(const set<const Part*>& parts, int range, int raster, bool quant_len, int strength, int swing, int threshold)
+{
+	Undo operations;
+	edit_events(parts, range, QuantizeFunction(raster, quant_len, strength, swing, threshold), operations);
+	return MusEGlobal::song->applyOperationGroup(operations);
+}
+
+void EraseFunction::edit(vector<EventEdit>& events) const
+{
+	for (vector<EventEdit>::iterator it=events.begin(); it!=events.end(); it++)
+		it->del = (!velo_thres_used && !len_thres_used) ||
+		          (velo_thres_used && it->velo < velo_threshold) ||
+		          (len_thres_used && int(it->len) < len_threshold);
 }
 
 bool erase_notes(const set<const Part*>& parts, int range, int velo_threshold, bool velo_thres_used, int len_threshold, bool len_thres_used)
 {
-	map<const Event*, const Part*> events = get_events(parts, range);
 	Undo operations;
-	
-	if (!events.empty())
-	{
-		for (map<const Event*, const Part*>::iterator it=events.begin(); it!=events.end(); it++)
-		{
-			const Event& event=*(it->first);
-			const Part* part=it->second;
+	edit_events(parts, range, EraseFunction(velo_threshold, velo_thres_used, len_threshold, len_thres_used), operations);
+	return MusEGlobal::song->applyOperationGroup(operations);
+}
 
-			if ( (!velo_thres_used && !len_thres_used) ||
-			     (velo_thres_used && event.velo() < velo_threshold) ||
-			     (len_thres_used && int(event.lenTick()) < len_threshold) )
-				operations.push_back(UndoOp(UndoOp::DeleteEvent, event, part, false, false));
-		}
-		
-		return MusEGlobal::song->applyOperationGroup(operations);
+void TransposeFunction::edit(vector<EventEdit>& events) const
+{
+	for (vector<EventEdit>::iterator it=events.begin(); it!=events.end(); it++)
+	{
+		int pitch = it->pitch+halftonesteps;
+		if (pitch > 127) pitch=127;
+		if (pitch < 0) pitch=0;
+		it->pitch = pitch;
 	}
-	else
-		return false;
 }
 
 bool transpose_notes(const set<const Part*>& parts, int range, signed int halftonesteps)
 {
-	map<const Event*, const Part*> events = get_events(parts, range);
-	Undo operations;
+	if (halftonesteps==0)
+		return false;
 	
-	if ( (!events.empty()) && (halftonesteps!=0) )
+	Undo operations;
+	edit_events(parts, range, TransposeFunction(halftonesteps), operations);
+	return MusEGlobal::song->applyOperationGroup(operations);
+}
+
+void CrescendoFunction::edit(vector<EventEdit>& events) const
+{
+	for (vector<EventEdit>::iterator it=events.begin(); it!=events.end(); it++)
 	{
-		for (map<const Event*, const Part*>::iterator it=events.begin(); it!=events.end(); it++)
-		{
-			const Event& event=*(it->first);
-			const Part* part=it->second;
-
-			Event newEvent = event.clone();
-			int pitch = event.pitch()+halftonesteps;
-			if (pitch > 127) pitch=127;
-			if (pitch < 0) pitch=0;
-			newEvent.setPitch(pitch);
-			operations.push_back(UndoOp(UndoOp::ModifyEvent, newEvent, event, part, false, false));
-		}
+		unsigned tick = it->tick + it->part->tick();
+		float curr_val= (float)start_val  +  (float)(end_val-start_val) * (tick-from) / (to-from);
 		
-		return MusEGlobal::song->applyOperationGroup(operations);
+		int velo = it->velo;
+
+		if (absolute)
+			velo=curr_val;
+		else
+			velo=curr_val*velo/100;
+
+		if (velo > 127) velo=127;
+		if (velo <= 0) velo=1;
+		it->velo = velo;
 	}
-	else
-		return false;
 }
 
 bool crescendo(const set<const Part*>& parts, int range, int start_val, int end_val, bool absolute)
 {
-	map<const Event*, const Part*> events = get_events(parts, range);
-	Undo operations;
-	
 	int from=MusEGlobal::song->lpos();
 	int to=MusEGlobal::song->rpos();
 	
-	if ( (!events.empty()) && (to>from) )
+	if (to<=from)
+		return false;
+	
+	Undo operations;
+	edit_events(parts, range, CrescendoFunction(from, to, start_val, end_val, absolute), operations);
+	return MusEGlobal::song->applyOperationGroup(operations);
+}
+
+void MoveFunction::edit(vector<EventEdit>& events) const
+{
+	for (vector<EventEdit>::iterator it=events.begin(); it!=events.end(); it++)
 	{
-		for (map<const Event*, const Part*>::iterator it=events.begin(); it!=events.end(); it++)
-		{
-			const Event& event=*(it->first);
-			const Part* part=it->second;
-			
-			unsigned tick = event.tick() + part->tick();
-			float curr_val= (float)start_val  +  (float)(end_val-start_val) * (tick-from) / (to-from);
-			
-			Event newEvent = event.clone();
-			int velo = event.velo();
+		const Part* part=it->part;
 
-			if (absolute)
-				velo=curr_val;
+		if ((signed)it->tick+ticks < 0) //don't allow moving before the part's begin
+			it->tick=0;
+		else
+			it->tick+=ticks;
+		
+		if ((it->tick+it->len > part->lenTick()) && part->hasHiddenEvents()) //if exceeding the part's end, and
+		{                                                                     //auto-expanding is forbidden, clip
+			if (part->lenTick() > it->tick)
+				it->len=part->lenTick() - it->tick;
 			else
-				velo=curr_val*velo/100;
-
-			if (velo > 127) velo=127;
-			if (velo <= 0) velo=1;
-			newEvent.setVelo(velo);
-			operations.push_back(UndoOp(UndoOp::ModifyEvent, newEvent, event, part, false, false));
+				it->del=true; //if the new length would be <= 0, erase the note
 		}
-		
-		return MusEGlobal::song->applyOperationGroup(operations);
 	}
-	else
-		return false;
 }
 
 bool move_notes(const set<const Part*>& parts, int range, signed int ticks)
 {
-	map<const Event*, const Part*> events = get_events(parts, range);
+	if (ticks==0)
+		return false;
+	
 	Undo operations;
-	map<const Part*, int> partlen;
+	edit_events(parts, range, MoveFunction(ticks), operations);
+	return MusEGlobal::song->applyOperationGroup(operations);
+}
+
+
+// orders indices into an EventEdit vector by pitch, then tick
+struct pitch_tick_less
+{
+	const vector<EventEdit>& events;
 	
-	if ( (!events.empty()) && (ticks!=0) )
+	pitch_tick_less(const vector<EventEdit>& events_) : events(events_) {}
+	bool operator()(int a, int b) const
 	{
-		for (map<const Event*, const Part*>::iterator it=events.begin(); it!=events.end(); it++)
-		{
-			const Event& event=*(it->first);
-			const Part* part=it->second;
-			bool del=false;
+		if (events[a].pitch != events[b].pitch)
+			return events[a].pitch < events[b].pitch;
+		return events[a].tick < events[b].tick;
+	}
+};
 
-			Event newEvent = event.clone();
-			if ((signed)event.tick()+ticks < 0) //don't allow moving before the part's begin
-				newEvent.setTick(0);
-			else
-				newEvent.setTick(event.tick()+ticks);
-			
-			if (newEvent.endTick() > part->lenTick()) //if exceeding the part's end:
-			{
-				if (part->hasHiddenEvents()) // auto-expanding is forbidden, clip
-				{
-					if (part->lenTick() > newEvent.tick())
-						newEvent.setLenTick(part->lenTick() - newEvent.tick());
-					else
-						del=true; //if the new length would be <= 0, erase the note
-				}
-				else
-					partlen[part]=newEvent.endTick(); // schedule auto-expanding
-			}
-			
-			if (del==false)
-				operations.push_back(UndoOp(UndoOp::ModifyEvent, newEvent, event, part, false, false));
-			else
-				operations.push_back(UndoOp(UndoOp::DeleteEvent, event, part, false, false));
-		}
+void DeleteOverlapsFunction::edit(vector<EventEdit>& events) const
+{
+	// one sorted run per pitch: a note is only overlapped by the
+	// note following it in its run
+	vector<int> order(events.size());
+	for (size_t i=0; i<order.size(); i++)
+		order[i]=i;
+	stable_sort(order.begin(), order.end(), pitch_tick_less(events));
+	
+	for (size_t i=0; i+1<order.size(); i++)
+	{
+		EventEdit& event1=events[order[i]];
+		const EventEdit& event2=events[order[i+1]];
 		
-		for (map<const Part*, int>::iterator it=partlen.begin(); it!=partlen.end(); it++)
-			schedule_resize_all_same_len_clone_parts(it->first, it->second, operations);
+		if (event1.pitch != event2.pitch)
+			continue;
 		
-		return MusEGlobal::song->applyOperationGroup(operations);
+		if (event1.tick == event2.tick) // of the notes starting together, the last is kept
+			event1.del=true;
+		else if (event1.tick+event1.len > event2.tick) //they overlap
+			event1.len=event2.tick-event1.tick;
 	}
-	else
-		return false;
 }
 
-
 bool delete_overlaps(const set<const Part*>& parts, int range)
 {
-	map<const Event*, const Part*> events = get_events(parts, range);
 	Undo operations;
+	edit_events(parts, range, DeleteOverlapsFunction(), operations);
+	return MusEGlobal::song->applyOperationGroup(operations);
+}
+
+void LegatoFunction::edit(vector<EventEdit>& events) const
+{
+	vector<unsigned> ticks(events.size());
+	for (size_t i=0; i<ticks.size(); i++)
+		ticks[i]=events[i].tick;
+	sort(ticks.begin(), ticks.end());
 	
-	set<const Event*> deleted_events;
-	
-	if (!events.empty())
+	for (vector<EventEdit>::iterator it=events.begin(); it!=events.end(); it++)
 	{
-		for (map<const Event*, const Part*>::iterator it1=events.begin(); it1!=events.end(); it1++)
-		{
-			const Event& event1=*(it1->first);
-			const Part* part1=it1->second;
-			
-			// we may NOT optimize by letting it2 start at (it1 +1); this optimisation
-			// is only allowed when events was sorted by time. it is, however, sorted
-			// randomly by pointer.
-			for (map<const Event*, const Part*>::iterator it2=events.begin(); it2!=events.end(); it2++)
-			{
-				const Event& event2=*(it2->first);
-				const Part* part2=it2->second;
-				
-				if ( (part1->isCloneOf(part2)) &&          // part1 and part2 are the same or are duplicates
-				     (&event1 != &event2) &&               // and event1 and event2 aren't the same
-				     (deleted_events.find(&event2) == deleted_events.end()) ) //and event2 hasn't been deleted before
-				{
-					if ( (event1.pitch() == event2.pitch()) &&
-					     (event1.tick() <= event2.tick()) &&
-						   (event1.endTick() > event2.tick()) ) //they overlap
-					{
-						int new_len = event2.tick() - event1.tick();
-
-						if (new_len==0)
-						{
-							operations.push_back(UndoOp(UndoOp::DeleteEvent, event1, part1, false, false));
-							deleted_events.insert(&event1);
-						}
-						else
-						{
-							Event new_event1 = event1.clone();
-							new_event1.setLenTick(new_len);
-							
-							operations.push_back(UndoOp(UndoOp::ModifyEvent, new_event1, event1, part1, false, false));
-						}
-					}
-				}
-			}
-		}
+		// the nearest following note not too near (respect min_len and dont_shorten)
+		unsigned first=it->tick+min_len;
+		if (dont_shorten && (it->tick+it->len > first))
+			first=it->tick+it->len;
 		
-		return MusEGlobal::song->applyOperationGroup(operations);
+		vector<unsigned>::const_iterator next=lower_bound(ticks.begin(), ticks.end(), first);
+		if (next!=ticks.end()) // if no following note was found, keep the length
+			it->len=*next-it->tick;
 	}
-	else
-		return false;
 }
 
 bool legato(const set<const Part*>& parts, int range, int min_len, bool dont_shorten)
 {
-	map<const Event*, const Part*> events = get_events(parts, range);
-	Undo operations;
-	
 	if (min_len<=0) min_len=1;
 	
-	if (!events.empty())
-	{
-		for (map<const Event*, const Part*>::iterator it1=events.begin(); it1!=events.end(); it1++)
-		{
-			const Event& event1=*(it1->first);
-			const Part* part1=it1->second;
-			
-			unsigned len=INT_MAX;
-			// we may NOT optimize by letting it2 start at (it1 +1); this optimisation
-			// is only allowed when events was sorted by time. it is, however, sorted
-			// randomly by pointer.
-			for (map<const Event*, const Part*>::iterator it2=events.begin(); it2!=events.end(); it2++)
-			{
-				const Event& event2=*(it2->first);
-				const Part* part2=it2->second;
-				
-				bool relevant = (event2.tick() >= event1.tick() + min_len);
-				if (dont_shorten)
-					relevant = relevant && (event2.tick() >= event1.endTick());
-				
-				if ( (part1->isCloneOf(part2)) &&           // part1 and part2 are the same or are duplicates
-				      relevant &&                           // they're not too near (respect min_len and dont_shorten)
-				     (event2.tick()-event1.tick() < len ) ) // that's the nearest relevant following note
-					len=event2.tick()-event1.tick();
-			}
-			
-			if (len==INT_MAX) len=event1.lenTick(); // if no following note was found, keep the length
-			
-			if (event1.lenTick() != len)
-			{
-				Event new_event1 = event1.clone();
-				new_event1.setLenTick(len);
-				
-				operations.push_back(UndoOp(UndoOp::ModifyEvent, new_event1, event1, part1, false, false));
-			}
-		}
-		
-		return MusEGlobal::song->applyOperationGroup(operations);
-	}
-	else
-		return false;
+	Undo operations;
+	edit_events(parts, range, LegatoFunction(min_len, dont_shorten), operations);
+	return MusEGlobal::song->applyOperationGroup(operations);
 }
 
 
-
 void copy_notes(const set<const Part*>& parts, int range)
 {
 	QMimeData* drag = selected_events_to_mime(parts,range);
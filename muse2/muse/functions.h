@@ -24,6 +24,7 @@
 #define __FUNCTIONS_H__
 
 #include <set>
+#include <vector>
 #include "part.h"
 #include "dialogs.h"
 #include <QWidget>
@@ -43,6 +44,115 @@ std::set<const Part*> partlist_to_set(PartList* pl);
 std::set<const Part*> part_to_set(const Part* p);
 std::map<const Event*, const Part*> get_events(const std::set<const Part*>& parts, int range);
 
+//---------------------------------------------------------
+//   EventEdit
+//    A relevant event and what a function makes of it.
+//    tick and len are in the part, like Event::tick().
+//---------------------------------------------------------
+
+struct EventEdit {
+	const Event* event;
+	const Part* part;
+	bool del;
+	unsigned tick;
+	unsigned len;
+	int velo;
+	int veloOff;
+	int pitch;
+};
+
+//---------------------------------------------------------
+//   EventFunction
+//    A bulk edit. edit() gets the relevant events of a part
+//    and of its clones among the edited parts, sorted by
+//    part and tick. It runs in a worker thread and must
+//    only read the song.
+//---------------------------------------------------------
+
+class EventFunction {
+   public:
+	virtual ~EventFunction() {}
+	virtual void edit(std::vector<EventEdit>& events) const = 0;
+	// parts without hidden events grow to hold the edited notes
+	virtual bool expandsParts() const { return false; }
+};
+
+class VelocityFunction : public EventFunction {
+	int rate, offset;
+	bool off;
+   public:
+	VelocityFunction(int rate_, int offset_, bool off_) : rate(rate_), offset(offset_), off(off_) {}
+	virtual void edit(std::vector<EventEdit>& events) const;
+};
+
+class NotelenFunction : public EventFunction {
+	int rate, offset;
+   public:
+	NotelenFunction(int rate_, int offset_) : rate(rate_), offset(offset_) {}
+	virtual void edit(std::vector<EventEdit>& events) const;
+	virtual bool expandsParts() const { return true; }
+};
+
+class QuantizeFunction : public EventFunction {
+	int raster, strength, swing, threshold;
+	bool quant_len;
+   public:
+	QuantizeFunction(int raster_, bool quant_len_, int strength_, int swing_, int threshold_)
+	   : raster(raster_), strength(strength_), swing(swing_), threshold(threshold_), quant_len(quant_len_) {}
+	virtual void edit(std::vector<EventEdit>& events) const;
+};
+
+class EraseFunction : public EventFunction {
+	int velo_threshold, len_threshold;
+	bool velo_thres_used, len_thres_used;
+   public:
+	EraseFunction(int velo_threshold_, bool velo_thres_used_, int len_threshold_, bool len_thres_used_)
+	   : velo_threshold(velo_threshold_), len_threshold(len_threshold_),
+	     velo_thres_used(velo_thres_used_), len_thres_used(len_thres_used_) {}
+	virtual void edit(std::vector<EventEdit>& events) const;
+};
+
+class TransposeFunction : public EventFunction {
+	int halftonesteps;
+   public:
+	TransposeFunction(int halftonesteps_) : halftonesteps(halftonesteps_) {}
+	virtual void edit(std::vector<EventEdit>& events) const;
+};
+
+class CrescendoFunction : public EventFunction {
+	int from, to, start_val, end_val;
+	bool absolute;
+   public:
+	CrescendoFunction(int from_, int to_, int start_val_, int end_val_, bool absolute_)
+	   : from(from_), to(to_), start_val(start_val_), end_val(end_val_), absolute(absolute_) {}
+	virtual void edit(std::vector<EventEdit>& events) const;
+};
+
+class MoveFunction : public EventFunction {
+	int ticks;
+   public:
+	MoveFunction(int ticks_) : ticks(ticks_) {}
+	virtual void edit(std::vector<EventEdit>& events) const;
+	virtual bool expandsParts() const { return true; }
+};
+
+class DeleteOverlapsFunction : public EventFunction {
+   public:
+	virtual void edit(std::vector<EventEdit>& events) const;
+};
+
+class LegatoFunction : public EventFunction {
+	int min_len;
+	bool dont_shorten;
+   public:
+	LegatoFunction(int min_len_, bool dont_shorten_) : min_len(min_len_), dont_shorten(dont_shorten_) {}
+	virtual void edit(std::vector<EventEdit>& events) const;
+};
+
+// runs f over the parts, one part and its clones per job and thread,
+// and appends the resulting operations, a run of them per part
+void edit_events(const std::set<const Part*>& parts, int range, const EventFunction& f, Undo& operations);
+
 //these functions simply do their job, non-interactively
 bool modify_velocity(const std::set<const Part*>& parts, int range, int rate, int offset=0);
 bool modify_off_velocity(const std::set<const Part*>& parts, int range, int rate, int offset=0);
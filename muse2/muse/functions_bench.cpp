@@ -0,0 +1,189 @@
+//=========================================================
+//  MusE
+//  Linux Music Editor
+//
+//  functions_bench.cpp
+//    How fast the bulk edit functions of functions.cpp
+//    work out their operations on a large song
+//
+//  This program is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU General Public License
+//  as published by the Free Software Foundation; version 2 of
+//  the License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+//
+//=========================================================
+
+//---------------------------------------------------------
+//    Builds -p midi parts of -n random notes each, with
+//    overlapping notes of the same pitch, and runs each
+//    function over all of them, -r times. Prints per
+//    function:
+//      ms       wall time of one edit_events(), from the
+//               events to the operations
+//      cpu      cpu time of all threads over wall time
+//      ops      operations made
+//      Mev/s    million events per second of wall time
+//    Applying the operations to the song needs the audio
+//    thread and is not measured.
+//---------------------------------------------------------
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <time.h>
+
+#include "functions.h"
+#include "track.h"
+#include "undo.h"
+
+//---------------------------------------------------------
+//   wallTime
+//---------------------------------------------------------
+
+static double wallTime()
+      {
+      struct timespec ts;
+      clock_gettime(CLOCK_MONOTONIC, &ts);
+      return ts.tv_sec + ts.tv_nsec * 1e-9;
+      }
+
+//---------------------------------------------------------
+//   cpuTime
+//    Of the process, all threads.
+//---------------------------------------------------------
+
+static double cpuTime()
+      {
+      struct timespec ts;
+      clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &ts);
+      return ts.tv_sec + ts.tv_nsec * 1e-9;
+      }
+
+//---------------------------------------------------------
+//   makePart
+//    Notes a 16th or so apart, 24 pitches, lengths up to
+//    a half note.
+//---------------------------------------------------------
+
+static MusECore::MidiPart* makePart(MusECore::MidiTrack* track, int notes)
+      {
+      MusECore::MidiPart* part = new MusECore::MidiPart(track);
+      unsigned tick = 0;
+      for (int i = 0; i < notes; ++i) {
+            tick += rand() % 192;
+            MusECore::Event e(MusECore::Note);
+            e.setTick(tick);
+            e.setLenTick(1 + rand() % 768);
+            e.setPitch(48 + rand() % 24);
+            e.setVelo(1 + rand() % 127);
+            e.setVeloOff(64);
+            part->appendEvent(e);
+            }
+      part->setTick(0);
+      part->setLenTick(tick + 768);
+      return part;
+      }
+
+//---------------------------------------------------------
+//   usage
+//---------------------------------------------------------
+
+static void usage(const char* prog)
+      {
+      fprintf(stderr,
+         "usage: %s [-p parts] [-n notes per part] [-r rounds]\n"
+         "   defaults: -p 16 -n 65536 -r 3\n", prog);
+      }
+
+//---------------------------------------------------------
+//   main
+//---------------------------------------------------------
+
+int main(int argc, char* argv[])
+      {
+      int nparts = 16;
+      int notes  = 65536;
+      int rounds = 3;
+
+      int c;
+      while ((c = getopt(argc, argv, "p:n:r:h")) != EOF) {
+            switch (c) {
+                  case 'p': nparts = atoi(optarg); break;
+                  case 'n': notes  = atoi(optarg); break;
+                  case 'r': rounds = atoi(optarg); break;
+                  default:
+                        usage(argv[0]);
+                        return 1;
+                  }
+            }
+      if (nparts <= 0 || notes <= 0 || rounds <= 0) {
+            usage(argv[0]);
+            return 1;
+            }
+
+      srand(1);
+      MusECore::MidiTrack* track = new MusECore::MidiTrack();
+      std::set<const MusECore::Part*> parts;
+      for (int i = 0; i < nparts; ++i)
+            parts.insert(makePart(track, notes));
+      const double events = double(nparts) * notes;
+
+      struct Function {
+            const char* name;
+            const MusECore::EventFunction* f;
+            };
+      const MusECore::VelocityFunction velocity(80, 10, false);
+      const MusECore::NotelenFunction notelen(50, 0);
+      const MusECore::QuantizeFunction quantize(96, true, 100, 0, 0);
+      const MusECore::EraseFunction erase(64, true, 0, false);
+      const MusECore::TransposeFunction transpose(7);
+      const MusECore::CrescendoFunction crescendo(0, notes * 96, 20, 120, false);
+      const MusECore::MoveFunction move(48);
+      const MusECore::DeleteOverlapsFunction overlaps;
+      const MusECore::LegatoFunction legato(1, false);
+      const Function functions[] = {
+            { "modify_velocity", &velocity },
+            { "modify_notelen",  &notelen },
+            { "quantize_notes",  &quantize },
+            { "erase_notes",     &erase },
+            { "transpose_notes", &transpose },
+            { "crescendo",       &crescendo },
+            { "move_notes",      &move },
+            { "delete_overlaps", &overlaps },
+            { "legato",          &legato },
+            };
+
+      printf("%d parts, %.0f notes\n\n", nparts, events);
+      printf("%-16s %9s %5s %9s %7s\n", "function", "ms", "cpu", "ops", "Mev/s");
+      for (size_t i = 0; i < sizeof(functions) / sizeof(*functions); ++i) {
+            double wall = 0.0, cpu = 0.0;
+            size_t ops = 0;
+            for (int r = 0; r < rounds; ++r) {
+                  MusECore::Undo operations;
+                  const double w0 = wallTime();
+                  const double c0 = cpuTime();
+                  MusECore::edit_events(parts, 0, *functions[i].f, operations);
+                  cpu  += cpuTime() - c0;
+                  wall += wallTime() - w0;
+                  ops = operations.size();
+                  }
+            wall /= rounds;
+            cpu  /= rounds;
+            printf("%-16s %9.1f %5.2f %9zu %7.2f\n", functions[i].name, wall * 1000.0,
+               wall > 0.0 ? cpu / wall : 0.0, ops, wall > 0.0 ? events / wall * 1e-6 : 0.0);
+            }
+
+      for (std::set<const MusECore::Part*>::iterator i = parts.begin(); i != parts.end(); ++i)
+            delete *i;
+      delete track;
+      return 0;
+      }
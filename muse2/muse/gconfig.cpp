@@ -235,6 +235,21 @@ GlobalConfigValues config = {
       QString("klick2.wav"),        // beatSample
       QString("klick3.wav"),        // accent1Sample
       QString("klick4.wav"),        // accent2Sample
+      1,                            // pluginPoolInstances
+      8,                            // pluginPoolPlugins
+      true,                         // pluginScanCache
+      false,                        // pluginScanOutOfProcess
+      QString(),                    // pluginBridgeLibs
+      false,                        // alsaMidiQueue
+      10,                           // recBufferSeconds
+      2,                            // recWriterThreads
+      0,                            // recPreallocSeconds
+      1,                            // audioConverterType: SRC_SINC_MEDIUM_QUALITY
+      128,                          // clipCacheMB
+      10,                           // clipCacheSeconds
+      2,                            // decoderThreads
+      4,                            // decoderAheadSeconds
+      512,                          // undoMemoryLimit
     };
 
 } // namespace MusEGlobal
@@ -241,6 +241,22 @@ struct GlobalConfigValues {
       QString beatSample;
       QString accent1Sample;
       QString accent2Sample;
+
+      int pluginPoolInstances;  // Pre-instantiated handles per pooled plugin.
+      int pluginPoolPlugins;    // Number of most used plugins kept in the pool.
+      bool pluginScanCache;     // Keep LADSPA/DSSI descriptors in plugincache.xml.
+      bool pluginScanOutOfProcess;  // Scan new libraries in a child process.
+      QString pluginBridgeLibs; // Effect libraries run in a child process, comma separated, "*" all.
+      bool alsaMidiQueue;       // Schedule ALSA midi output on a timestamped queue from the audio thread.
+      int recBufferSeconds;     // Record ring per track, in seconds.
+      int recWriterThreads;     // Threads writing recorded audio to disk.
+      int recPreallocSeconds;   // Disk space reserved for a take up front, 0 = off.
+      int audioConverterType;   // libsamplerate converter for clips of another rate, 0 best .. 4 linear.
+      int clipCacheMB;          // Memory for decoded short clips, 0 = off.
+      int clipCacheSeconds;     // Longest event kept in the clip cache.
+      int decoderThreads;       // Threads decoding FLAC/Ogg ahead of playback, 0 = off.
+      int decoderAheadSeconds;  // Audio decoded ahead per playing compressed event.
+      int undoMemoryLimit;      // MB of undo history kept, oldest steps dropped first. 0 = no limit.
       };
 
 
@@ -53,76 +53,18 @@ using std::set;
 using std::pair;
 
 
-namespace MusEGui {
+namespace MusECore {
 
 //---------------------------------------------------------
-//   importMidi
+//   importMidiPorts
+//    Sets up the ports and instruments a read midi file
+//    uses. Returns true if a device was assigned to an
+//    empty port. Without assignDevices (batch mode, there
+//    are no devices) empty ports stay empty.
 //---------------------------------------------------------
 
-void MusE::importMidi()
-      {
-      QString empty("");
-      importMidi(empty);
-      }
-
-void MusE::importMidi(const QString &file)
+bool importMidiPorts(MidiFile* mf, bool assignDevices)
       {
-      QString fn;
-      if (file.isEmpty()) {
-               fn = MusEGui::getOpenFileName(MusEGlobal::lastMidiPath, MusEGlobal::midi_file_pattern, this,
-               tr("MusE: Import Midi"), 0);
-            if (fn.isEmpty())
-                  return;
-            MusEGlobal::lastMidiPath = fn;
-            }
-      else
-            fn = file;
-
-      int n = QMessageBox::question(this, appName,
-         tr("Add midi file to current project?\n"),
-         tr("&Add to Project"),
-         tr("&Replace"),
-         tr("&Abort"), 0, 2);
-
-      switch (n) {
-            case 0:
-                  importMidi(fn, true);
-                  MusEGlobal::song->update();
-                  break;
-            case 1:
-                  loadProjectFile(fn, false, false);    // replace
-                  break;
-            default:
-                  return;
-            }
-      }
-
-//---------------------------------------------------------
-//   importMidi
-//    return true on error
-//---------------------------------------------------------
-
-bool MusE::importMidi(const QString name, bool merge)
-      {
-      bool popenFlag;
-      FILE* fp = MusEGui::fileOpen(this, name, QString(".mid"), "r", popenFlag);
-      if (fp == 0)
-            return true;
-      MusECore::MidiFile mf(fp);
-      bool rv = mf.read();
-      popenFlag ? pclose(fp) : fclose(fp);
-      if (rv) {
-            QString s(tr("reading midifile\n  "));
-            s += name;
-            s += tr("\nfailed: ");
-            s += mf.error();
-            QMessageBox::critical(this, QString("MusE"), s);
-            return rv;
-            }
-            
-      MusECore::MidiFileTrackList* etl = mf.trackList();
-      int division     = mf.division();
-
       // Find the default instrument, we may need it later...
       MusECore::MidiInstrument* def_instr = 0;
       if(!MusEGlobal::config.importMidiDefaultInstr.isEmpty())
@@ -141,7 +83,7 @@ bool MusE::importMidi(const QString name, bool merge)
       // Need to set up ports and instruments first
       //
       
-      MusECore::MidiFilePortMap* usedPortMap = mf.usedPortMap();
+      MusECore::MidiFilePortMap* usedPortMap = mf->usedPortMap();
       bool dev_changed = false;
       for(MusECore::iMidiFilePort imp = usedPortMap->begin(); imp != usedPortMap->end(); ++imp) 
       {
@@ -167,7 +109,7 @@ bool MusE::importMidi(const QString name, bool merge)
         // Take care of assigning devices to empty ports here rather than in midifile.
         //if(MusEGlobal::config.importDevNameMetas)  // TODO
         {
-          if(!md)
+          if(!md && assignDevices)
           {
             QString dev_name = imp->second._subst4DevName;
             md = MusEGlobal::midiDevices.find(dev_name); // Find any type of midi device - HW, synth etc.
@@ -182,7 +124,7 @@ bool MusE::importMidi(const QString name, bool merge)
               dev_changed = true;
             }
             else
-              printf("importMidi error: assign to empty port: device not found: %s\n", dev_name.toLatin1().constData());
+              fprintf(stderr, "importMidi error: assign to empty port: device not found: %s\n", dev_name.toLatin1().constData());
           }
         }
 
@@ -233,16 +175,21 @@ bool MusE::importMidi(const QString name, bool merge)
             mp->setInstrument(instr);
         }
       }
-      
-      if(dev_changed)
-      {
-        // TEST: Hopefully can get away with this here instead of inside the loop above...
-        // TEST: Are these really necessary as in midi port config set device name?
-        MusEGlobal::muse->changeConfig(true);     // save configuration file 
-        MusEGlobal::audio->msgUpdateSoloStates(); // 
-        MusEGlobal::song->update();
+      return dev_changed;
       }
-      
+
+//---------------------------------------------------------
+//   importMidiTracks
+//    Adds the tracks of a read midi file to the song.
+//    The ports must be set up before.
+//---------------------------------------------------------
+
+void importMidiTracks(MidiFile* mf)
+      {
+      MusECore::MidiFileTrackList* etl = mf->trackList();
+      int division     = mf->division();
+      MusECore::MidiFilePortMap* usedPortMap = mf->usedPortMap();
+
       //
       // create MidiTrack and copy events to ->events()
       //    - combine note on/off events
@@ -321,7 +268,7 @@ bool MusE::importMidi(const QString name, bool merge)
                            }
                         }
                               
-                        processTrack(track);
+                        MusECore::processTrack(track);
                         
                         MusEGlobal::song->insertTrack0(track, -1);
                 }
@@ -337,39 +284,10 @@ bool MusE::importMidi(const QString name, bool merge)
                   track->setOutChannel(0);
                   track->setOutPort(0);
                   buildMidiEventList(&track->events, el, track, division, true, false); // Do SysexMeta. Don't do loops.
-                  processTrack(track);
+                  MusECore::processTrack(track);
                   MusEGlobal::song->insertTrack0(track, -1);
                   }
             }
-            
-      if (!merge) {
-            MusECore::TrackList* tl = MusEGlobal::song->tracks();
-            if (!tl->empty()) {
-                  MusECore::Track* track = tl->front();
-                  track->setSelected(true);
-                  }
-            MusEGlobal::song->initLen();
-
-            int z, n;
-            AL::sigmap.timesig(0, z, n);
-
-            int tempo = MusEGlobal::tempomap.tempo(0);
-            transport->setTimesig(z, n);
-            transport->setTempo(tempo);
-
-            bool masterF = !MusEGlobal::tempomap.empty();
-            MusEGlobal::song->setMasterFlag(masterF);
-            transport->setMasterFlag(masterF);
-
-            MusEGlobal::song->updatePos();
-
-            _arranger->reset();
-            }
-      else {
-            MusEGlobal::song->initLen();
-           }
-
-      return false;
       }
 
 //---------------------------------------------------------
@@ -377,7 +295,7 @@ bool MusE::importMidi(const QString name, bool merge)
 //    divide events into parts
 //---------------------------------------------------------
 
-void MusE::processTrack(MusECore::MidiTrack* track)
+void processTrack(MidiTrack* track)
       {
       MusECore::EventList& tevents = track->events;
       if (tevents.empty())
@@ -480,11 +398,12 @@ void MusE::processTrack(MusECore::MidiTrack* track)
             MusECore::iEvent r2 = tevents.lower_bound(etick);
             int startTick = part->tick();
 
+            // Already in order, shifting them all keeps it.
             for (MusECore::iEvent i = r1; i != r2; ++i) {
                   MusECore::Event& ev = i->second;
                   int ntick = ev.tick() - startTick;
                   ev.setTick(ntick);
-                  part->addEvent(ev);
+                  part->appendEvent(ev);
                   }
             tevents.erase(r1, r2);
             }
@@ -497,7 +416,116 @@ void MusE::processTrack(MusECore::MidiTrack* track)
             }
       // all events should be processed:
       if (!tevents.empty())
-        printf("THIS SHOULD NEVER HAPPEN: not all events processed at the end of MusE::processTrack()!\n");
+        printf("THIS SHOULD NEVER HAPPEN: not all events processed at the end of processTrack()!\n");
+      }
+
+} // namespace MusECore
+
+namespace MusEGui {
+
+//---------------------------------------------------------
+//   importMidi
+//---------------------------------------------------------
+
+void MusE::importMidi()
+      {
+      QString empty("");
+      importMidi(empty);
+      }
+
+void MusE::importMidi(const QString &file)
+      {
+      QString fn;
+      if (file.isEmpty()) {
+               fn = MusEGui::getOpenFileName(MusEGlobal::lastMidiPath, MusEGlobal::midi_file_pattern, this,
+               tr("MusE: Import Midi"), 0);
+            if (fn.isEmpty())
+                  return;
+            MusEGlobal::lastMidiPath = fn;
+            }
+      else
+            fn = file;
+
+      int n = QMessageBox::question(this, appName,
+         tr("Add midi file to current project?\n"),
+         tr("&Add to Project"),
+         tr("&Replace"),
+         tr("&Abort"), 0, 2);
+
+      switch (n) {
+            case 0:
+                  importMidi(fn, true);
+                  MusEGlobal::song->update();
+                  break;
+            case 1:
+                  loadProjectFile(fn, false, false);    // replace
+                  break;
+            default:
+                  return;
+            }
+      }
+
+//---------------------------------------------------------
+//   importMidi
+//    return true on error
+//---------------------------------------------------------
+
+bool MusE::importMidi(const QString name, bool merge)
+      {
+      bool popenFlag;
+      FILE* fp = MusEGui::fileOpen(this, name, QString(".mid"), "r", popenFlag);
+      if (fp == 0)
+            return true;
+      MusECore::MidiFile mf(fp);
+      bool rv = mf.read();
+      popenFlag ? pclose(fp) : fclose(fp);
+      if (rv) {
+            QString s(tr("reading midifile\n  "));
+            s += name;
+            s += tr("\nfailed: ");
+            s += mf.error();
+            QMessageBox::critical(this, QString("MusE"), s);
+            return rv;
+            }
+            
+      if(MusECore::importMidiPorts(&mf))
+      {
+        // TEST: Hopefully can get away with this here instead of inside the loop in importMidiPorts...
+        // TEST: Are these really necessary as in midi port config set device name?
+        MusEGlobal::muse->changeConfig(true);     // save configuration file 
+        MusEGlobal::audio->msgUpdateSoloStates(); // 
+        MusEGlobal::song->update();
+      }
+      MusECore::importMidiTracks(&mf);
+            
+      if (!merge) {
+            MusECore::TrackList* tl = MusEGlobal::song->tracks();
+            if (!tl->empty()) {
+                  MusECore::Track* track = tl->front();
+                  track->setSelected(true);
+                  }
+            MusEGlobal::song->initLen();
+
+            int z, n;
+            AL::sigmap.timesig(0, z, n);
+
+            int tempo = MusEGlobal::tempomap.tempo(0);
+            transport->setTimesig(z, n);
+            transport->setTempo(tempo);
+
+            bool masterF = !MusEGlobal::tempomap.empty();
+            MusEGlobal::song->setMasterFlag(masterF);
+            transport->setMasterFlag(masterF);
+
+            MusEGlobal::song->updatePos();
+
+            _arranger->reset();
+            }
+      else {
+            MusEGlobal::song->initLen();
+           }
+
+      return false;
       }
 
 //---------------------------------------------------------
@@ -40,6 +40,7 @@
 #include <iostream>
 
 #include <unistd.h>
+#include <string.h>
 #include <time.h>
 #include <sys/mman.h>
 #include <alsa/asoundlib.h>
@@ -48,6 +49,7 @@
 #include "app.h"
 #include "audio.h"
 #include "audiodev.h"
+#include "batch.h"
 #include "config.h"
 #include "gconfig.h"
 #include "globals.h"
@@ -60,6 +62,8 @@
 #include "midiport.h"
 #include "mididev.h"
 #include "plugin.h"
+#include "pluginscan.h"
+#include "pluginbridge.h"
 #include "wavepreview.h"
 
 #ifdef HAVE_LASH
@@ -75,6 +79,11 @@ extern void initOSC();
 extern void initVST();
 extern void initVST_Native();
 extern void initPlugins();
+extern void initPluginPool();
+extern void initWaveTiles();
+extern void initRecordWriter();
+extern void initClipCache();
+extern void initDecoderPool();
 extern void initDSSI();
 #ifdef LV2_SUPPORT
 extern void initLV2();
@@ -289,6 +298,9 @@ static void usage(const char* prog, const char* txt)
       fprintf(stderr, "   -M       Debug mode: trace midi Output\n");
       fprintf(stderr, "   -s       Debug mode: trace sync\n");
       fprintf(stderr, "\n");
+      fprintf(stderr, "   --batch  Convert or analyze midi files without the gui,\n");
+      fprintf(stderr, "            as the first argument. --batch -h for its flags\n");
+      fprintf(stderr, "\n");
 #ifdef HAVE_LASH
       fprintf(stderr, "LASH and ");
 #endif
@@ -331,6 +343,13 @@ static void usage(const char* prog, const char* txt)
 
 int main(int argc, char* argv[])
       {
+      // Child process of the out-of-process plugin scanner.
+      if (argc == 3 && strcmp(argv[1], "--scan-plugin") == 0)
+            return MusECore::pluginScanMain(argv[2]);
+      // Child process of a bridged plugin.
+      if (argc == 3 && strcmp(argv[1], "--plugin-bridge") == 0)
+            return MusECore::pluginBridgeMain(argv[2]);
+
       MusEGlobal::museUser = QString(getenv("HOME"));
       MusEGlobal::museGlobalLib   = QString(LIBDIR);
       MusEGlobal::museGlobalShare = QString(SHAREDIR);
@@ -375,6 +394,10 @@ int main(int argc, char* argv[])
         MusEGlobal::config.startSong = MusEGlobal::museGlobalShare + QString("/templates/default.med");
       }
       
+      // Midi file conversion without the gui.
+      if (argc >= 2 && strcmp(argv[1], "--batch") == 0)
+            return MusECore::batchMain(argc - 1, argv + 1);
+
       // May need this. Tested OK. Grab the default style BEFORE calling setStyle and creating the app.   
       //{  int dummy_argc = 1; char** dummy_argv = &argv[0];
       //  QApplication dummy_app(dummy_argc, dummy_argv);
@@ -706,9 +729,17 @@ int main(int argc, char* argv[])
       MusECore::initMidiSequencer();   
       MusEGlobal::midiSeq->checkAndReportTimingResolution();  
 
+      MusEGlobal::pluginScanCache.read();
+
       if (MusEGlobal::loadPlugins)
             MusECore::initPlugins();
 
+      MusECore::initPluginPool();
+      MusECore::initWaveTiles();
+      MusECore::initRecordWriter();
+      MusECore::initClipCache();
+      MusECore::initDecoderPool();
+
       if (MusEGlobal::loadVST)
             MusECore::initVST();
 
@@ -717,6 +748,8 @@ int main(int argc, char* argv[])
 
       if(MusEGlobal::loadDSSI)
             MusECore::initDSSI();
+
+      MusEGlobal::pluginScanCache.write(MusEGlobal::loadPlugins && MusEGlobal::loadDSSI);
 #ifdef LV2_SUPPORT
       if(MusEGlobal::loadLV2)
             MusECore::initLV2();
@@ -0,0 +1,78 @@
+//=========================================================
+//  MusE
+//  Linux Music Editor
+//
+//  metersnapshot.cpp
+//
+//  This program is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU General Public License
+//  as published by the Free Software Foundation; version 2 of
+//  the License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+//
+//=========================================================
+
+#include <string.h>
+
+#include "metersnapshot.h"
+
+namespace MusECore {
+
+//---------------------------------------------------------
+//   MeterSnapshot
+//---------------------------------------------------------
+
+MeterSnapshot::MeterSnapshot()
+   : _middle(1)
+      {
+      memset(_frames, 0, sizeof(_frames));
+      memset(&_last, 0, sizeof(_last));
+      _back  = 0;
+      _front = 2;
+      }
+
+//---------------------------------------------------------
+//   publish
+//    Audio thread.
+//---------------------------------------------------------
+
+void MeterSnapshot::publish(int channels, const double* meter, const double* peak)
+      {
+      if (channels > MAX_CHANNELS)
+            channels = MAX_CHANNELS;
+      if (channels == _last.channels
+         && memcmp(meter, _last.meter, channels * sizeof(double)) == 0
+         && memcmp(peak, _last.peak, channels * sizeof(double)) == 0)
+            return;
+      _last.channels = channels;
+      memcpy(_last.meter, meter, channels * sizeof(double));
+      memcpy(_last.peak, peak, channels * sizeof(double));
+      ++_last.serial;
+
+      _frames[_back] = _last;
+      _back = _middle.fetchAndStoreOrdered(_back | Fresh) & ~Fresh;
+      }
+
+//---------------------------------------------------------
+//   fetch
+//    Gui thread. Returns true if front() is a frame not
+//    seen before.
+//---------------------------------------------------------
+
+bool MeterSnapshot::fetch()
+      {
+      if (!(_middle.load() & Fresh))
+            return false;
+      _front = _middle.fetchAndStoreOrdered(_front) & ~Fresh;
+      return true;
+      }
+
+} // namespace MusECore
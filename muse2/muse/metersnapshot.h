@@ -0,0 +1,69 @@
+//=========================================================
+//  MusE
+//  Linux Music Editor
+//
+//  metersnapshot.h
+//
+//  This program is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU General Public License
+//  as published by the Free Software Foundation; version 2 of
+//  the License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+//
+//=========================================================
+
+#ifndef __METERSNAPSHOT_H__
+#define __METERSNAPSHOT_H__
+
+#include <QAtomicInt>
+
+#include "globaldefs.h"
+
+namespace MusECore {
+
+//---------------------------------------------------------
+//   MeterFrame
+//---------------------------------------------------------
+
+struct MeterFrame {
+      unsigned serial;       // bumped for every published frame
+      int channels;
+      double meter[MAX_CHANNELS];
+      double peak[MAX_CHANNELS];
+      };
+
+//---------------------------------------------------------
+//   MeterSnapshot
+//    Triple buffer of the meter values of a track. The
+//    audio thread publishes once per cycle, if the values
+//    changed. The gui takes the latest frame. Neither side
+//    ever waits for the other.
+//---------------------------------------------------------
+
+class MeterSnapshot {
+      enum { Fresh = 4 };
+
+      MeterFrame _frames[3];
+      MeterFrame _last;       // last published, audio thread only
+      int _back;              // audio thread only
+      int _front;             // gui only
+      QAtomicInt _middle;     // buffer index, | Fresh until taken
+
+   public:
+      MeterSnapshot();
+      void publish(int channels, const double* meter, const double* peak);
+      bool fetch();
+      const MeterFrame& front() const { return _frames[_front]; }
+      };
+
+} // namespace MusECore
+
+#endif
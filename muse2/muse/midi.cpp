@@ -578,7 +578,6 @@ void buildMidiEventList(EventList* del, const MPEventList& el, MidiTrack* track,
                             printf("ERROR: THIS SHOULD NEVER HAPPEN: k==i in midi.cpp:buildMidiEventList()\n");
                           else
                             mel.erase(k);
-                            i = mel.begin();
                           continue;
                           }
                     }
@@ -1447,8 +1446,9 @@ void Audio::processMidi()
         // We are done with the 'frozen' recording fifos, remove the events. 
         (*id)->afterProcess();
         
-        // ALSA devices handled by another thread.
-        if((*id)->deviceType() != MidiDevice::ALSA_MIDI)
+        // ALSA devices handled by another thread, unless they are
+        //  scheduled on the ALSA output queue from here.
+        if((*id)->deviceType() != MidiDevice::ALSA_MIDI || alsaMidiQueueActive())
           (*id)->processMidi();
       }
       MusEGlobal::midiBusy=false;
@@ -135,6 +135,12 @@ struct MPEventList;
 class MidiTrack;
 extern void buildMidiEventList(EventList* mel, const MPEventList& el, MidiTrack* track, int division, bool addSysexMeta, bool doLoops);
 
+class MidiFile;
+extern bool importMidiPorts(MidiFile* mf, bool assignDevices = true);
+extern void importMidiTracks(MidiFile* mf);
+extern void processTrack(MidiTrack* track);
+extern bool exportMidiFile(FILE* fp);
+
 } // namespace MusECore
 
 #endif
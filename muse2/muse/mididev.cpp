@@ -225,8 +225,10 @@ void MidiDevice::beforeProcess()
 
 void MidiDevice::recordEvent(MidiRecordEvent& event)
       {
-      // TODO: Tested, but record resolution not so good. Switch to wall clock based separate list in MidiDevice. 
-      unsigned frame_ts = MusEGlobal::audio->timestamp();
+      // An event with a time carries its arrival frame on the curFrame() clock
+      //  (time stamped ALSA input), otherwise it arrived now.
+      unsigned frame_ts = event.time() ? event.time() - MusEGlobal::audio->getFrameOffset() 
+                                       : MusEGlobal::audio->timestamp();
 #ifndef _AUDIO_USE_TRUE_FRAME_
       if(MusEGlobal::audio->isPlaying())
        frame_ts += MusEGlobal::segmentSize;  // Shift forward into this period if playing
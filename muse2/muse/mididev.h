@@ -26,6 +26,7 @@
 #define __MIDIDEV_H__
 
 #include <list>
+#include <math.h>
 
 #include "mpevent.h"
 #include "route.h"
@@ -39,6 +40,39 @@ namespace MusECore {
 class Xml;
 class PendingOperationList;
 
+//---------------------------------------------------------
+//   MidiInputStats
+//    Delay from the arrival of an input event until it is
+//    handled, in microseconds, averaged over the last few
+//    dozen events. Recorded times are corrected by it, the
+//    jitter is the timing error recording would have had
+//    without time stamps.
+//---------------------------------------------------------
+
+class MidiInputStats {
+      unsigned _count;
+      float _mean;
+      float _var;
+      float _max;
+
+   public:
+      MidiInputStats() { clear(); }
+      void clear()     { _count = 0; _mean = _var = _max = 0.0f; }
+      void add(float us) {
+            if (_count++ == 0)
+                  _mean = us;
+            const float d = us - _mean;
+            _mean += d / 32.0f;
+            _var  += (d * d - _var) / 32.0f;
+            if (us > _max)
+                  _max = us;
+            }
+      unsigned count() const { return _count; }
+      float latency() const  { return _mean; }
+      float jitter() const   { return sqrtf(_var); }
+      float max() const      { return _max; }
+      };
+
 //---------------------------------------------------------
 //   MidiDevice
 //---------------------------------------------------------
@@ -65,6 +99,7 @@ class MidiDevice {
       MidiFifo eventFifo;  
       // Recording fifos. To speed up processing, one per channel plus one special system 'channel' for channel-less events like sysex.
       MidiRecFifo _recordFifo[MIDI_CHANNELS + 1];   
+      MidiInputStats _inputStats;
 
       volatile bool stopPending;         
       volatile bool seekPending;
@@ -149,6 +184,9 @@ class MidiDevice {
       bool sysexReadingChunks() { return _sysexReadingChunks; }
       void setSysexReadingChunks(bool v) { _sysexReadingChunks = v; }
       bool sendNullRPNParams(unsigned time, int port, int chan, bool);
+      
+      const MidiInputStats& inputStats() const      { return _inputStats; }
+      MidiInputStats& inputStats()                  { return _inputStats; }
       };
 
 //---------------------------------------------------------
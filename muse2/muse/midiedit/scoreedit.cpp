@@ -1287,6 +1287,7 @@ ScoreCanvas::ScoreCanvas(ScoreEdit* pr, QWidget* parent_widget) : View(parent_wi
 	x_pos=0;
 	x_left=0;
 	y_pos=0;
+	layout_step_pending=false;
 	have_lasso=false;
 	inserting=false;
 	dragging=false;
@@ -1534,7 +1535,64 @@ set<const MusECore::Part*> ScoreCanvas::get_all_parts()
 
 void ScoreCanvas::fully_recalculate()
 {
-	song_changed(SC_EVENT_MODIFIED);
+	calc_pos_add_list();
+	
+	for (list<staff_t>::iterator it=staves.begin(); it!=staves.end(); it++)
+		it->recalculate();
+		
+	layout_visible();
+	recalc_staff_pos();
+	
+	redraw();
+	emit canvas_width_changed(canvas_width());
+}
+
+// lays out what is on screen now, the rest of the score is
+// done in the background by layout_step()
+void ScoreCanvas::layout_visible()
+{
+	unsigned from=x_to_tick(x_pos);
+	unsigned to=x_to_tick(x_pos+width()-x_left);
+	
+	bool pending=false;
+	for (list<staff_t>::iterator it=staves.begin(); it!=staves.end(); it++)
+	{
+		it->layout_pending(from, to);
+		if (!it->pending_measures.empty())
+			pending=true;
+	}
+	
+	if (pending && !layout_step_pending)
+	{
+		layout_step_pending=true;
+		QTimer::singleShot(0, this, SLOT(layout_step()));
+	}
+}
+
+void ScoreCanvas::layout_step()
+{
+	// measures per staff and step. small enough to keep the
+	// gui responsive between the steps.
+	const int MEASURES_PER_STEP=16;
+
+	layout_step_pending=false;
+	
+	bool pending=false;
+	for (list<staff_t>::iterator it=staves.begin(); it!=staves.end(); it++)
+	{
+		it->layout_pending(0, UINT_MAX, MEASURES_PER_STEP);
+		if (!it->pending_measures.empty())
+			pending=true;
+	}
+	
+	recalc_staff_pos();
+	redraw();
+	
+	if (pending)
+	{
+		layout_step_pending=true;
+		QTimer::singleShot(0, this, SLOT(layout_step()));
+	}
 }
 
 void ScoreCanvas::song_changed(MusECore::SongChangedFlags_t flags)
@@ -1556,25 +1614,27 @@ void ScoreCanvas::song_changed(MusECore::SongChangedFlags_t flags)
 			for (list<staff_t>::iterator it=staves.begin(); it!=staves.end(); it++)
 				it->recalculate();
 
+			layout_visible();
 			recalc_staff_pos();
 
 			redraw();
 		}
 	}
 	
-	if (flags & (SC_PART_MODIFIED |
-	             SC_EVENT_INSERTED | SC_EVENT_MODIFIED | SC_EVENT_REMOVED |
-	             SC_SIG  | SC_KEY) )
+	if (flags & (SC_PART_MODIFIED | SC_SIG  | SC_KEY) )
 	{
-		calc_pos_add_list();
-		
+		fully_recalculate();
+	}
+	else if (flags & (SC_EVENT_INSERTED | SC_EVENT_MODIFIED | SC_EVENT_REMOVED))
+	{
+		// only the measures with changed notes, in the staves showing them
 		for (list<staff_t>::iterator it=staves.begin(); it!=staves.end(); it++)
-			it->recalculate();
-			
+			it->layout_changes();
+		
+		layout_visible();
 		recalc_staff_pos();
 		
 		redraw();
-		emit canvas_width_changed(canvas_width());
 	}
 	
 	if (flags & SC_SELECTION)
@@ -2263,21 +2323,27 @@ void ScoreCanvas::draw_accidentials(QPainter& p, int x, int y_offset, const list
 	}
 }
 
-void staff_t::create_itemlist()
+// lays out the measures in events, beginning with a bar. key and
+// emphasize_list are the ones in effect at the first bar. a bar at
+// end_tick is the last thing processed, the items are appended to items.
+// events is a copy, it gets the note offs and the note parts which
+// continue in the next measure.
+void staff_t::create_itemlist(ScoreEventList events, ScoreItemList& itemlist, MusECore::key_enum tmp_key,
+                              vector<int> emphasize_list, unsigned end_tick)
 {
-	MusECore::key_enum tmp_key=MusECore::KEY_C;
 	int lastevent=0;
 	int next_measure=-1;
 	int last_measure=-1;
-	vector<int> emphasize_list=create_emphasize_list(4,4); //actually unneccessary, for safety
-
-	itemlist.clear();
 
-	for (ScoreEventList::iterator it=eventlist.begin(); it!=eventlist.end(); it++)
+	for (ScoreEventList::iterator it=events.begin(); it!=events.end(); it++)
 	{
 		int t, pitch, len, velo, actual_tick;
 		FloEvent::typeEnum type;
 		t=it->first;
+		
+		if ( (unsigned(t) > end_tick) ||
+		     ((unsigned(t) == end_tick) && (it->second.type != FloEvent::NOTE_OFF) && (it->second.type != FloEvent::BAR)) )
+			break;
 		pitch=it->second.pitch;
 		velo=it->second.vel;
 		len=it->second.len;
@@ -2367,8 +2433,8 @@ void staff_t::create_itemlist()
 				//append the "remainder" of the note to our EventList, so that
 				//it gets processed again when entering the new measure
 				int newlen=len-tmplen;
-				eventlist.insert(pair<unsigned, FloEvent>(next_measure, FloEvent(actual_tick,pitch, velo,0,FloEvent::NOTE_OFF, it->second.source_part, it->second.source_event)));
-				eventlist.insert(pair<unsigned, FloEvent>(next_measure, FloEvent(actual_tick,pitch, velo,newlen,FloEvent::NOTE_ON, it->second.source_part, it->second.source_event)));
+				events.insert(pair<unsigned, FloEvent>(next_measure, FloEvent(actual_tick,pitch, velo,0,FloEvent::NOTE_OFF, it->second.source_part, it->second.source_event)));
+				events.insert(pair<unsigned, FloEvent>(next_measure, FloEvent(actual_tick,pitch, velo,newlen,FloEvent::NOTE_ON, it->second.source_part, it->second.source_event)));
 
 				if (heavyDebugMsg) cout << "\t\tnote was split to length "<<tmplen<<" + " << newlen<<endl;
 			}
@@ -2378,7 +2444,7 @@ void staff_t::create_itemlist()
 				tied_note=false;
 				
 				if (heavyDebugMsg) cout << "\t\tinserting NOTE OFF at "<<t+len<<endl;
-				eventlist.insert(pair<unsigned, FloEvent>(t+len,   FloEvent(t+len,pitch, velo,0,FloEvent::NOTE_OFF,it->second.source_part, it->second.source_event)));
+				events.insert(pair<unsigned, FloEvent>(t+len,   FloEvent(t+len,pitch, velo,0,FloEvent::NOTE_OFF,it->second.source_part, it->second.source_event)));
 			}
 							
 			list<note_len_t> lens=parse_note_len(tmplen,t-last_measure,emphasize_list,true,true);
@@ -2422,11 +2488,10 @@ void staff_t::create_itemlist()
 	}	
 }
 
-void staff_t::process_itemlist()
+void staff_t::process_itemlist(ScoreItemList& itemlist, vector<int> emphasize_list)
 {
 	map<int,int> occupied;
 	int last_measure=0;
-	vector<int> emphasize_list=create_emphasize_list(4,4); //unneccessary, only for safety
 
 	//iterate through all times with items
 	for (ScoreItemList::iterator it2=itemlist.begin(); it2!=itemlist.end(); it2++)
@@ -2901,14 +2966,15 @@ void staff_t::calc_item_pos()
 	//this has to be KEY_C or KEY_C_B and nothing else,
 	//because only with these two keys the next (initial)
 	//key signature is properly drawn.
-	MusECore::key_enum curr_key=MusECore::KEY_C; 
+	calc_item_pos(itemlist.begin(), itemlist.end(), 0, MusECore::KEY_C);
+	calc_y_range();
+}
 
-	int pos_add=0;
-	
-	max_y_coord=0;
-	min_y_coord=0;
-	
-	for (ScoreItemList::iterator it2=itemlist.begin(); it2!=itemlist.end(); it2++)
+// pos_add and curr_key are the ones in effect before from_it
+void staff_t::calc_item_pos(ScoreItemList::iterator from_it, ScoreItemList::iterator to_it,
+                            int pos_add, MusECore::key_enum curr_key)
+{
+	for (ScoreItemList::iterator it2=from_it; it2!=to_it; it2++)
 	{
 		for (set<FloItem, floComp>::iterator it=it2->second.begin(); it!=it2->second.end();it++)
 		{
@@ -2918,9 +2984,6 @@ void staff_t::calc_item_pos()
 			
 			if (it->type==FloItem::NOTE)
 			{
-				if (it->y > max_y_coord) max_y_coord=it->y;
-				if (it->y < min_y_coord) min_y_coord=it->y;
-				
 				it->x+=parent->note_x_indent() + it->shift*NOTE_SHIFT;
 				
 				switch (it->len)
@@ -2941,10 +3004,13 @@ void staff_t::calc_item_pos()
 				}
 				
 				//if there's a tie, try to find the tie's destination and set is_tie_dest
-				if (it->tied)
+				//the destination's measure may not be laid out yet, then this
+				//is done when it is.
+				ScoreItemList::iterator destit;
+				if (it->tied && (destit=itemlist.find(it2->first+calc_len(it->len,it->dots))) != itemlist.end())
 				{
 					set<FloItem, floComp>::iterator dest;
-					set<FloItem, floComp>& desttime = itemlist[it2->first+calc_len(it->len,it->dots)];
+					set<FloItem, floComp>& desttime = destit->second;
 					for (dest=desttime.begin(); dest!=desttime.end();dest++)
 						if ((dest->type==FloItem::NOTE) && (dest->pos==it->pos))
 						{
@@ -2953,7 +3019,7 @@ void staff_t::calc_item_pos()
 							break;
 						}
 					
-					if (dest==desttime.end())
+					if (dest==desttime.end() && pending_measures.empty())
 						cerr << "ERROR: THIS SHOULD NEVER HAPPEN: did not find destination note for tie!" << endl;		
 				}
 			}
@@ -2994,11 +3060,278 @@ void staff_t::calc_item_pos()
 			}
 		}
 	}		
+}
+
+void staff_t::calc_y_range()
+{
+	max_y_coord=0;
+	min_y_coord=0;
+	
+	for (ScoreItemList::iterator it2=itemlist.begin(); it2!=itemlist.end(); it2++)
+		for (set<FloItem, floComp>::iterator it=it2->second.begin(); it!=it2->second.end();it++)
+			if (it->type==FloItem::NOTE)
+			{
+				if (it->y > max_y_coord) max_y_coord=it->y;
+				if (it->y < min_y_coord) min_y_coord=it->y;
+			}
 
 	max_y_coord+= (pix_quarter->height()/2 +NOTE_YDIST/2);
 	min_y_coord-= (pix_quarter->height()/2 +NOTE_YDIST/2);
 }
 
+// the state create_itemlist, process_itemlist and calc_item_pos
+// have when arriving at tick
+void staff_t::layout_state_at(unsigned tick, int* pos_add, MusECore::key_enum* key, vector<int>* emphasize_list)
+{
+	*pos_add=0;
+	*key=MusECore::KEY_C;
+	*emphasize_list=create_emphasize_list(4,4);
+	
+	for (ScoreEventList::iterator it=eventlist.begin(); it!=eventlist.end() && it->first<tick; it++)
+	{
+		if (it->second.type==FloEvent::TIME_SIG)
+		{
+			*pos_add+=calc_timesig_width(it->second.num, it->second.denom);
+			*emphasize_list=create_emphasize_list(it->second.num, it->second.denom);
+		}
+		else if (it->second.type==FloEvent::KEY_CHANGE)
+		{
+			list<int> aufloes_list=calc_accidentials(*key, clef, it->second.key);
+			list<int> new_acc_list=calc_accidentials(it->second.key, clef);
+			int n_acc_drawn=aufloes_list.size() + new_acc_list.size();
+			*pos_add+=n_acc_drawn*KEYCHANGE_ACC_DIST+ KEYCHANGE_ACC_LEFTDIST+ KEYCHANGE_ACC_RIGHTDIST;
+			*key=it->second.key;
+		}
+	}
+}
+
+// lays out the measures beginning at the bars from (inclusive) to
+// to (exclusive, UINT_MAX for "until the end") and replaces their
+// items. the items at the bar ticks are shared with the neighbour
+// measures: the _END items there belong to the measure before.
+void staff_t::layout_measures(unsigned from, unsigned to)
+{
+	int pos_add;
+	MusECore::key_enum key;
+	vector<int> emphasize_list;
+	layout_state_at(from, &pos_add, &key, &emphasize_list);
+	
+	// the measures' events, and the rest of the notes begun before
+	ScoreEventList events;
+	for (ScoreEventList::iterator it=eventlist.begin(); it!=eventlist.end(); it++)
+	{
+		if (it->first < from)
+		{
+			if ((it->second.type==FloEvent::NOTE_ON) && (it->first + it->second.len > from))
+			{
+				int actual_tick=it->second.tick;
+				events.insert(pair<unsigned, FloEvent>(from, FloEvent(actual_tick,it->second.pitch, it->second.vel,0,FloEvent::NOTE_OFF, it->second.source_part, it->second.source_event)));
+				events.insert(pair<unsigned, FloEvent>(from, FloEvent(actual_tick,it->second.pitch, it->second.vel,it->first + it->second.len - from,FloEvent::NOTE_ON, it->second.source_part, it->second.source_event)));
+			}
+		}
+		else if ( (it->first < to) || ((it->first == to) && (it->second.type==FloEvent::BAR)) )
+			events.insert(*it);
+		else
+			break;
+	}
+	
+	ScoreItemList items;
+	create_itemlist(events, items, key, emphasize_list, to);
+	
+	// the bar at "to" begins the next measure
+	ScoreItemList::iterator last_it=items.find(to);
+	if (last_it!=items.end())
+		for (set<FloItem, floComp>::iterator it=last_it->second.begin(); it!=last_it->second.end();)
+			if ((it->type==FloItem::NOTE_END) || (it->type==FloItem::REST_END))
+				it++;
+			else
+				last_it->second.erase(it++);
+	
+	process_itemlist(items, emphasize_list);
+	
+	// replace the old items
+	ScoreItemList::iterator first=itemlist.lower_bound(from);
+	if (first!=itemlist.end() && first->first==from)
+	{
+		for (set<FloItem, floComp>::iterator it=first->second.begin(); it!=first->second.end();)
+			if ((it->type==FloItem::NOTE_END) || (it->type==FloItem::REST_END))
+				it++;
+			else
+				first->second.erase(it++);
+		first++;
+	}
+	ScoreItemList::iterator last=(to==UINT_MAX) ? itemlist.end() : itemlist.lower_bound(to);
+	itemlist.erase(first, last);
+	if (last!=itemlist.end() && last->first==to)
+		for (set<FloItem, floComp>::iterator it=last->second.begin(); it!=last->second.end();)
+			if ((it->type==FloItem::NOTE_END) || (it->type==FloItem::REST_END))
+				last->second.erase(it++);
+			else
+				it++;
+	
+	for (ScoreItemList::iterator it=items.begin(); it!=items.end(); it++)
+		itemlist[it->first].insert(it->second.begin(), it->second.end());
+	
+	for (set<unsigned>::iterator it=pending_measures.lower_bound(from); it!=pending_measures.end() && *it<to;)
+		pending_measures.erase(it++);
+	
+	// positions, starting with the measure before, whose ties may end
+	// in the first new measure
+	unsigned pos_from=from;
+	for (ScoreEventList::iterator it=eventlist.begin(); it!=eventlist.end() && it->first<from; it++)
+		if (it->second.type==FloEvent::BAR)
+			pos_from=it->first;
+	if (pending_measures.count(pos_from))
+		pos_from=from;
+	else if (pos_from!=from)
+		layout_state_at(pos_from, &pos_add, &key, &emphasize_list);
+	
+	calc_item_pos(itemlist.lower_bound(pos_from), (to==UINT_MAX) ? itemlist.end() : itemlist.upper_bound(to), pos_add, key);
+	calc_y_range();
+}
+
+// lays out up to max_measures pending measures overlapping
+// [from_tick, to_tick]. returns how many were done.
+int staff_t::layout_pending(unsigned from_tick, unsigned to_tick, int max_measures)
+{
+	// the measure containing from_tick begins at the last bar before
+	unsigned start_bar=0;
+	for (ScoreEventList::iterator ev=eventlist.begin(); ev!=eventlist.end() && ev->first<=from_tick; ev++)
+		if (ev->second.type==FloEvent::BAR)
+			start_bar=ev->first;
+	
+	// runs of pending measures are laid out at once
+	int n=0;
+	unsigned run_from=UINT_MAX;
+	for (ScoreEventList::iterator ev=eventlist.lower_bound(pair<unsigned, FloEvent>(start_bar, FloEvent(start_bar,0,0,0,FloEvent::BAR))); ev!=eventlist.end(); ev++)
+	{
+		if (ev->second.type!=FloEvent::BAR)
+			continue;
+		
+		bool pending=pending_measures.count(ev->first);
+		bool done=(n>=max_measures) || (ev->first>to_tick);
+		if ((run_from!=UINT_MAX) && (!pending || done))
+		{
+			layout_measures(run_from, ev->first);
+			run_from=UINT_MAX;
+		}
+		if (done)
+			break;
+		if (pending)
+		{
+			if (run_from==UINT_MAX)
+				run_from=ev->first;
+			n++;
+		}
+	}
+	if (run_from!=UINT_MAX)
+		layout_measures(run_from, UINT_MAX);
+	
+	return n;
+}
+
+void staff_t::recalculate()
+{
+	create_appropriate_eventlist();
+	remember_revisions();
+	itemlist.clear();
+	
+	pending_measures.clear();
+	for (ScoreEventList::iterator it=eventlist.begin(); it!=eventlist.end(); it++)
+		if (it->second.type==FloEvent::BAR)
+			pending_measures.insert(it->first);
+	
+	calc_y_range();
+}
+
+bool staff_t::events_changed() const
+{
+	for (set<const MusECore::Part*>::const_iterator it=parts.begin(); it!=parts.end(); it++)
+	{
+		map<const MusECore::Part*, unsigned>::const_iterator rev=part_revisions.find(*it);
+		if (rev==part_revisions.end() || rev->second!=(*it)->eventsRevision())
+			return true;
+	}
+	return false;
+}
+
+void staff_t::remember_revisions()
+{
+	part_revisions.clear();
+	for (set<const MusECore::Part*>::const_iterator it=parts.begin(); it!=parts.end(); it++)
+		part_revisions[*it]=(*it)->eventsRevision();
+}
+
+// compares the new events with the ones laid out and redoes the
+// measures touched by the differences. changed bars or signatures
+// need everything to be redone.
+void staff_t::layout_changes()
+{
+	if (!events_changed())
+		return;
+	
+	ScoreEventList old_events;
+	old_events.swap(eventlist);
+	create_appropriate_eventlist();
+	remember_revisions();
+	
+	floComp comp;
+	unsigned lo=UINT_MAX, hi=0;
+	ScoreEventList::iterator o=old_events.begin(), n=eventlist.begin();
+	while (o!=old_events.end() || n!=eventlist.end())
+	{
+		const pair<unsigned, FloEvent>* diff[2]={NULL, NULL};
+		
+		if (n==eventlist.end() || (o!=old_events.end() && comp(*o, *n)))
+			diff[0]=&*o++;
+		else if (o==old_events.end() || comp(*n, *o))
+			diff[0]=&*n++;
+		else
+		{
+			const FloEvent& a=o->second;
+			const FloEvent& b=n->second;
+			if ( (a.len!=b.len) || (a.vel!=b.vel) || (a.tick!=b.tick) || (a.num!=b.num) || (a.denom!=b.denom) ||
+			     (a.key!=b.key) || (a.source_part!=b.source_part) || (a.source_event!=b.source_event) )
+			{
+				diff[0]=&*o;
+				diff[1]=&*n;
+			}
+			o++;
+			n++;
+		}
+		
+		for (int i=0; i<2 && diff[i]; i++)
+		{
+			if (diff[i]->second.type!=FloEvent::NOTE_ON)
+			{
+				recalculate();
+				return;
+			}
+			if (diff[i]->first < lo) lo=diff[i]->first;
+			if (diff[i]->first + diff[i]->second.len > hi) hi=diff[i]->first + diff[i]->second.len;
+		}
+	}
+	
+	if (lo==UINT_MAX)
+		return;
+	
+	unsigned from=0, to=UINT_MAX;
+	for (ScoreEventList::iterator it=eventlist.begin(); it!=eventlist.end(); it++)
+		if (it->second.type==FloEvent::BAR)
+		{
+			if (it->first<=lo)
+				from=it->first;
+			else if (it->first>=hi)
+			{
+				to=it->first;
+				break;
+			}
+		}
+	
+	if (heavyDebugMsg) cout << "relayouting measures from "<<from<<" to "<<to<<endl;
+	layout_measures(from, to);
+}
+
 void ScoreCanvas::calc_pos_add_list()
 {
 	using AL::sigmap;
@@ -4220,6 +4553,7 @@ void ScoreCanvas::x_scroll_event(int x)
 {
 	if (debugMsg) cout << "SCROLL EVENT: x="<<x<<endl;
 	x_pos=x;
+	layout_visible();
 	redraw();
 }
 
@@ -548,8 +548,11 @@ struct staff_t
 {
 	set<const MusECore::Part*> parts;
 	set<int> part_indices;
-	ScoreEventList eventlist;
-	ScoreItemList itemlist;
+	ScoreEventList eventlist; // notes, bars, time and key signatures. not altered by the layout
+	ScoreItemList itemlist;   // the layout, measure by measure
+	
+	set<unsigned> pending_measures; // bar ticks of the measures not laid out yet
+	map<const MusECore::Part*, unsigned> part_revisions; // events revisions the eventlist was made from
 	
 	int y_top;
 	int y_draw;
@@ -564,19 +567,27 @@ struct staff_t
 	ScoreCanvas* parent;
 	
 	void create_appropriate_eventlist();
-	void create_itemlist();
-	void process_itemlist();
+	void create_itemlist(ScoreEventList events, ScoreItemList& items, MusECore::key_enum key,
+	                     vector<int> emphasize_list, unsigned end_tick);
+	void process_itemlist(ScoreItemList& items, vector<int> emphasize_list);
 	void calc_item_pos();
+	void calc_item_pos(ScoreItemList::iterator from_it, ScoreItemList::iterator to_it,
+	                   int pos_add, MusECore::key_enum curr_key);
+	void calc_y_range();
+	void layout_state_at(unsigned tick, int* pos_add, MusECore::key_enum* key, vector<int>* emphasize_list);
 	
 	void apply_lasso(QRect rect, set<const MusECore::Event*>& already_processed);
 	
-	void recalculate()
-	{
-		create_appropriate_eventlist();
-		create_itemlist();
-		process_itemlist();
-		calc_item_pos();
-	}
+	// the layout is done measure by measure. recalculate() throws it away,
+	// the measures are then laid out by layout_pending(), the visible ones
+	// first. layout_changes() only redoes the measures touched by changed
+	// events.
+	void recalculate();
+	void layout_measures(unsigned from, unsigned to);
+	int layout_pending(unsigned from_tick, unsigned to_tick, int max_measures=INT_MAX);
+	bool events_changed() const;
+	void remember_revisions();
+	void layout_changes();
 	
 	staff_t(ScoreCanvas* parent_)
 	{
@@ -656,6 +667,9 @@ class ScoreCanvas : public MusEGui::View
 		
 		void recalc_staff_pos();
 		list<staff_t>::iterator staff_at_y(int y);
+		
+		void layout_visible();
+		bool layout_step_pending;
 
 
 
@@ -791,6 +805,8 @@ class ScoreCanvas : public MusEGui::View
 		void midi_note(int pitch, int velo);
 		
 		void add_new_parts(const std::map< const MusECore::Part*, std::set<const MusECore::Part*> >&);
+		
+		void layout_step();
 
 	public slots:
 		void x_scroll_event(int);
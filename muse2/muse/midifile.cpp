@@ -23,6 +23,13 @@
 //=========================================================
 
 #include <errno.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <algorithm>
+
+#include <QAtomicInt>
+#include <QThread>
 
 #include "song.h"
 #include "midi.h"
@@ -75,8 +82,9 @@ QString MidiFile::error()
 MidiFile::MidiFile(FILE* f)
       {
       fp        = f;
-      curPos    = 0;
-      lastMtype = MT_UNKNOWN;
+      status    = -1;
+      _threads  = 0;
+      _jobs     = 0;
       _error    = MF_NO_ERROR;
       _tracks   = new MidiFileTrackList;
       _usedPortMap = new MidiFilePortMap;
@@ -84,32 +92,124 @@ MidiFile::MidiFile(FILE* f)
 
 MidiFile::~MidiFile()
       {
+      delete _jobs;
       delete _tracks;
       delete _usedPortMap;
       }
 
 //---------------------------------------------------------
-//   read
-//    return true on error
+//   MidiFileReader
+//    Where a track is read in the file data, and what its
+//    events said about ports and instruments. One per
+//    track, tracks are parsed in parallel.
 //---------------------------------------------------------
 
-bool MidiFile::read(void* p, size_t len)
-      {
-      for (;;) {
-            curPos += len;
-            size_t rv = fread(p, 1, len, fp);
-            if (rv == len)
-                  return false;
-            if (feof(fp)) {
-                  _error = MF_EOF;
+struct MidiFileReader {
+      const unsigned char* p;
+      const unsigned char* end;
+      int error;
+      int status, sstatus, click;
+      int lastport, lastchannel;
+      MType lastMtype;
+      QString lastInstrName;
+      QString lastDeviceName;
+
+      MidiFileReader(const unsigned char* data, size_t len) {
+            p      = data;
+            end    = data + len;
+            error  = MF_NO_ERROR;
+            status = -1;
+            sstatus = -1;     // running status, not reset scanning meta or sysex
+            click  = 0;
+            }
+
+      //    return true on error
+      bool read(void* dst, size_t len) {
+            if (size_t(end - p) < len) {
+                  p = end;
+                  error = MF_EOF;
                   return true;
                   }
-            _error = MF_READ;
-            return true;
+            memcpy(dst, p, len);
+            p += len;
+            return false;
             }
-      return false;
+      int getvl();
+      };
+
+/*---------------------------------------------------------
+ *    getvl
+ *    Read variable-length number (7 bits per byte, MSB first)
+ *---------------------------------------------------------*/
+
+int MidiFileReader::getvl()
+      {
+      int l = 0;
+      for (int i = 0; i < 16; i++) {
+            if (p == end) {
+                  error = MF_EOF;
+                  return -1;
+                  }
+            uchar c = *p++;
+            l += (c & 0x7f);
+            if (!(c & 0x80))
+                  return l;
+            l <<= 7;
+            }
+      return -1;
       }
 
+//---------------------------------------------------------
+//   MidiFileRecord
+//    An event of a track as readEvent returned it, with
+//    the port and instrument hints read before it.
+//---------------------------------------------------------
+
+struct MidiFileRecord {
+      MidiPlayEvent event;
+      int rv;
+      int lastport, lastchannel;
+      MType lastMtype;
+      QString lastInstrName;
+      QString lastDeviceName;
+      };
+
+//---------------------------------------------------------
+//   MidiFileTrackJob
+//---------------------------------------------------------
+
+struct MidiFileTrackJob {
+      MidiFileTrack* track;
+      const unsigned char* data;    // after "MTrk" and length
+      size_t len;
+      size_t offset;                // of data in the file
+      std::vector<MidiFileRecord> records;
+      int error;
+      };
+
+//---------------------------------------------------------
+//   MidiFileParser
+//    Takes the next track to parse until all are taken.
+//---------------------------------------------------------
+
+class MidiFileParser : public QThread {
+      MidiFile* _mf;
+      std::vector<MidiFileTrackJob>* _jobs;
+      QAtomicInt* _next;
+
+   public:
+      MidiFileParser(MidiFile* mf, std::vector<MidiFileTrackJob>* jobs, QAtomicInt* next)
+         : _mf(mf), _jobs(jobs), _next(next) {}
+      virtual void run() {
+            for (;;) {
+                  int i = _next->fetchAndAddRelaxed(1);
+                  if (i >= int(_jobs->size()))
+                        break;
+                  _mf->parseTrack(&(*_jobs)[i]);
+                  }
+            }
+      };
+
 //---------------------------------------------------------
 //   write
 //    return true on error
@@ -146,61 +246,6 @@ bool MidiFile::writeLong(int i)
       return write(&format, 4);
       }
 
-//---------------------------------------------------------
-//   readShort
-//---------------------------------------------------------
-
-int MidiFile::readShort()
-      {
-      short format;
-      read(&format, 2);
-      return BE_SHORT(format);
-      }
-
-//---------------------------------------------------------
-//   readLong
-//   writeLong
-//---------------------------------------------------------
-
-int MidiFile::readLong()
-      {
-      int format;
-      read(&format, 4);
-      return BE_LONG(format);
-      }
-
-/*---------------------------------------------------------
- *    skip
- *    This is meant for skipping a few bytes in a
- *    file or fifo.
- *---------------------------------------------------------*/
-
-bool MidiFile::skip(size_t len)
-      {
-      char tmp[len];
-      return read(tmp, len);
-      }
-
-/*---------------------------------------------------------
- *    getvl
- *    Read variable-length number (7 bits per byte, MSB first)
- *---------------------------------------------------------*/
-
-int MidiFile::getvl()
-      {
-      int l = 0;
-      for (int i = 0; i < 16; i++) {
-            uchar c;
-            if (read(&c, 1))
-                  return -1;
-            l += (c & 0x7f);
-            if (!(c & 0x80))
-                  return l;
-            l <<= 7;
-            }
-      return -1;
-      }
-
 /*---------------------------------------------------------
  *    putvl
  *    Write variable-length number (7 bits per byte, MSB first)
@@ -224,59 +269,81 @@ void MidiFile::putvl(unsigned val)
       }
 
 //---------------------------------------------------------
-//   readTrack
-//    return true on error
+//   parseTrack
+//    Reads the events of a track, in a parser thread or
+//    the caller's. Leaves everything that depends on the
+//    other tracks to readTrack.
 //---------------------------------------------------------
 
-bool MidiFile::readTrack(MidiFileTrack* t)
+void MidiFile::parseTrack(MidiFileTrackJob* job)
       {
-      MPEventList* el = &(t->events);
-      char tmp[4];
-      if (read(tmp, 4))
-            return true;
-      if (memcmp(tmp, "MTrk", 4)) {
-            _error = MF_MTRK;
-            return true;
+      MidiFileReader r(job->data, job->len);
+      // A guess, events take a few bytes each.
+      job->records.reserve(job->len / 8 + 1);
+      for (;;) {
+            MidiFileRecord rec;
+            r.lastport    = -1;
+            r.lastchannel = -1;
+            r.lastMtype   = MT_UNKNOWN;
+            r.lastInstrName.clear();
+            r.lastDeviceName.clear();
+
+            rec.rv          = readEvent(&rec.event, job->track, &r);
+            rec.lastport    = r.lastport;
+            rec.lastchannel = r.lastchannel;
+            rec.lastMtype   = r.lastMtype;
+            rec.lastInstrName  = r.lastInstrName;
+            rec.lastDeviceName = r.lastDeviceName;
+            job->records.push_back(rec);
+            if (rec.rv == 0)
+                  break;
+            if (rec.rv == -2) {
+                  job->error = r.error != MF_NO_ERROR ? r.error : MF_READ;
+                  return;
+                  }
             }
-      int len    = readLong();       // len
-      int endPos = curPos + len;
-      status     = -1;
-      sstatus    = -1;     // running status, not reset scanning meta or sysex
-      click      = 0;
+      size_t end = r.p - job->data;
+      if (end != job->len)
+            printf("MidiFile::readTrack(): TRACKLEN does not fit %zu+%zu != %zu, %zu too much\n",
+               job->offset, job->len, job->offset + end, job->len - end);
+      }
+
+//---------------------------------------------------------
+//   readTrack
+//    Assigns ports and channels to the parsed events of a
+//    track, in file order, and adds them to the track.
+//---------------------------------------------------------
 
+void MidiFile::readTrack(MidiFileTrack* t, const std::vector<MidiFileRecord>& records)
+      {
+      MPEventList* el = &(t->events);
       int port    = 0;
       int channel = 0;
-      
-      for (;;) {
-            MidiPlayEvent event;
-            lastport    = -1;
-            lastchannel = -1;
-            lastMtype = MT_UNKNOWN;
-            lastInstrName.clear();
-            lastDeviceName.clear();
-
-            int rv = readEvent(&event, t);
-            if (lastport != -1) {
-                  port = lastport;
+
+      for (std::vector<MidiFileRecord>::const_iterator ir = records.begin(); ir != records.end(); ++ir) {
+            const MidiFileRecord& rec = *ir;
+            const int rv = rec.rv;
+            if (rec.lastport != -1) {
+                  port = rec.lastport;
                   if (port >= MIDI_PORTS) {
                         printf("port %d >= %d, reset to 0\n", port, MIDI_PORTS);
                         port = 0;
                         }
                   }
-            if (lastchannel != -1) {
-                  channel = lastchannel;
+            if (rec.lastchannel != -1) {
+                  channel = rec.lastchannel;
                   if (channel >= MIDI_CHANNELS) {
                         printf("channel %d >= %d, reset to 0\n", port, MIDI_CHANNELS);
                         channel = 0;
                         }
                   }
                 
-            if(!lastDeviceName.isEmpty())
+            if(!rec.lastDeviceName.isEmpty())
             {
               iMidiFilePort iup = _usedPortMap->begin();
               for( ; iup != _usedPortMap->end(); ++iup)
               {
-                if(iup->second._subst4DevName == lastDeviceName)
+                if(iup->second._subst4DevName == rec.lastDeviceName)
                 {
                   port = iup->first;
                   break;
@@ -284,7 +351,7 @@ bool MidiFile::readTrack(MidiFileTrack* t)
               }
               if(iup == _usedPortMap->end())
               {
-                MidiDevice* md = MusEGlobal::midiDevices.find(lastDeviceName);
+                MidiDevice* md = MusEGlobal::midiDevices.find(rec.lastDeviceName);
                 if(md)
                 {
                   int pn = md->midiPort();
@@ -313,47 +380,38 @@ bool MidiFile::readTrack(MidiFileTrack* t)
             if(iup == _usedPortMap->end())
             {
               MidiFilePort up;
-              if(lastMtype != MT_UNKNOWN)
-                up._midiType = lastMtype;
-              if(!lastInstrName.isEmpty())
-                up._instrName = lastInstrName;
-              if(!lastDeviceName.isEmpty())
-                up._subst4DevName = lastDeviceName;
+              if(rec.lastMtype != MT_UNKNOWN)
+                up._midiType = rec.lastMtype;
+              if(!rec.lastInstrName.isEmpty())
+                up._instrName = rec.lastInstrName;
+              if(!rec.lastDeviceName.isEmpty())
+                up._subst4DevName = rec.lastDeviceName;
               _usedPortMap->insert(std::pair<int, MidiFilePort>(port, up));
             }
             else
             {
-              if(lastMtype != MT_UNKNOWN)
-                iup->second._midiType = lastMtype;
-              if(!lastInstrName.isEmpty())
-                iup->second._instrName = lastInstrName;
-              if(!lastDeviceName.isEmpty())
-                iup->second._subst4DevName = lastDeviceName;
+              if(rec.lastMtype != MT_UNKNOWN)
+                iup->second._midiType = rec.lastMtype;
+              if(!rec.lastInstrName.isEmpty())
+                iup->second._instrName = rec.lastInstrName;
+              if(!rec.lastDeviceName.isEmpty())
+                iup->second._subst4DevName = rec.lastDeviceName;
             }
             
-            if (rv == 0)
+            if (rv == 0 || rv == -2)
                   break;
             else if (rv == -1)
                   continue;
-            else if (rv == -2)          // error
-                  return true;
 
+            MidiPlayEvent event(rec.event);
             event.setPort(port);
             if (event.type() == ME_SYSEX || event.type() == ME_META)
                   event.setChannel(channel);
             else
                   channel = event.channel();
-            el->add(event);
-            }
-   
-      int end = curPos;
-      if (end != endPos) {
-            printf("MidiFile::readTrack(): TRACKLEN does not fit %d+%d != %d, %d too much\n",
-               endPos-len, len, end, endPos-end);
-            if (end < endPos)
-                  skip(endPos - end);
+            // Ticks only grow within a track.
+            el->insert(el->end(), event);
             }
-      return false;
       }
 
 //---------------------------------------------------------
@@ -364,18 +422,18 @@ bool MidiFile::readTrack(MidiFileTrack* t)
 //          -2    Error
 //---------------------------------------------------------
 
-int MidiFile::readEvent(MidiPlayEvent* event, MidiFileTrack* t)
+int MidiFile::readEvent(MidiPlayEvent* event, MidiFileTrack* t, MidiFileReader* r)
       {
       uchar me, type, a, b;
 
-      int nclick = getvl();
+      int nclick = r->getvl();
       if (nclick == -1) {
             printf("readEvent: error 1\n");
             return 0;
             }
-      click += nclick;
+      r->click += nclick;
       for (;;) {
-            if (read(&me, 1)) {
+            if (r->read(&me, 1)) {
                   printf("readEvent: error 2\n");
                   return 0;
                   }
@@ -385,7 +443,7 @@ int MidiFile::readEvent(MidiPlayEvent* event, MidiFileTrack* t)
                   break;
             }
 
-      event->setTime(click);
+      event->setTime(r->click);
       int len;
       unsigned char* buffer;
 
@@ -394,15 +452,15 @@ int MidiFile::readEvent(MidiPlayEvent* event, MidiFileTrack* t)
                   //
                   //    SYSEX
                   //
-                  status = -1;                  // no running status
-                  len = getvl();
+                  r->status = -1;                  // no running status
+                  len = r->getvl();
                   if (len == -1) {
                         printf("readEvent: error 3\n");
                         return -2;
                         }
                   // Buffer can be deleted by caller's event when it goes out of scope.
                   buffer = new unsigned char[len];
-                  if (read(buffer, len)) {
+                  if (r->read(buffer, len)) {
                         printf("readEvent: error 4\n");
                         delete[] buffer;
                         return -2;
@@ -416,26 +474,26 @@ int MidiFile::readEvent(MidiPlayEvent* event, MidiFileTrack* t)
                   event->setType(ME_SYSEX);
                   event->setData(buffer, len);
                   if (((unsigned)len == gmOnMsgLen) && memcmp(buffer, gmOnMsg, gmOnMsgLen) == 0) {
-                        lastMtype = MT_GM;
+                        r->lastMtype = MT_GM;
                         return -1;
                         }
                   if (((unsigned)len == gm2OnMsgLen) && memcmp(buffer, gm2OnMsg, gm2OnMsgLen) == 0) {
-                        lastMtype = MT_GM2;
+                        r->lastMtype = MT_GM2;
                         return -1;
                         }
                   if (((unsigned)len == gsOnMsgLen) && memcmp(buffer, gsOnMsg, gsOnMsgLen) == 0) {
-                        lastMtype = MT_GS;
+                        r->lastMtype = MT_GS;
                         return -1;
                         }
                   if (((unsigned)len == xgOnMsgLen) && memcmp(buffer, xgOnMsg, xgOnMsgLen) == 0) {
-                        lastMtype = MT_XG;
+                        r->lastMtype = MT_XG;
                         return -1;
                         }
                   if (buffer[0] == 0x41) {   // Roland
-                              lastMtype = MT_GS;
+                              r->lastMtype = MT_GS;
                         }
                   else if (buffer[0] == 0x43) {    // Yamaha
-                              lastMtype = MT_XG;
+                              r->lastMtype = MT_XG;
                         int type   = buffer[1] & 0xf0;
                         switch (type) {
                               case 0x00:  // bulk dump
@@ -477,19 +535,19 @@ int MidiFile::readEvent(MidiPlayEvent* event, MidiFileTrack* t)
                   //
                   //    META
                   //
-                  status = -1;                  // no running status
-                  if (read(&type, 1)) {         // read type
+                  r->status = -1;                  // no running status
+                  if (r->read(&type, 1)) {         // read type
                         printf("readEvent: error 5\n");
                         return -2;
                         }
-                  len = getvl();                // read len
+                  len = r->getvl();                // read len
                   if (len == -1) {
                         printf("readEvent: error 6\n");
                         return -2;
                         }
                   buffer = new unsigned char[len+1];
                   if (len) {
-                        if (read(buffer, len)) {
+                        if (r->read(buffer, len)) {
                               printf("readEvent: error 7\n");
                               delete[] buffer;
                               return -2;
@@ -498,19 +556,19 @@ int MidiFile::readEvent(MidiPlayEvent* event, MidiFileTrack* t)
                   buffer[len] = 0;
                   switch(type) {
                         case ME_META_TEXT_9_DEVICE_NAME:        // device name
-                                lastDeviceName = QString((const char*)buffer);
+                                r->lastDeviceName = QString((const char*)buffer);
                                 delete[] buffer;
                                 return -1;
                         case ME_META_TEXT_4_INSTRUMENT_NAME:        // instrument name
-                                lastInstrName = QString((const char*)buffer);
+                                r->lastInstrName = QString((const char*)buffer);
                                 delete[] buffer;
                                 return -1;
                         case ME_META_PORT_CHANGE:        // switch port
-                              lastport = buffer[0];
+                              r->lastport = buffer[0];
                               delete[] buffer;
                               return -1;
                         case ME_META_CHANNEL_CHANGE:        // switch channel
-                              lastchannel = buffer[0];
+                              r->lastchannel = buffer[0];
                               delete[] buffer;
                               return -1;
                         case ME_META_END_OF_TRACK:        // End of Track
@@ -532,31 +590,31 @@ int MidiFile::readEvent(MidiPlayEvent* event, MidiFileTrack* t)
             }
 
       if (me & 0x80) {                     // status byte
-            status   = me;
-            sstatus  = status;
-            if (read(&a, 1)) {
+            r->status   = me;
+            r->sstatus  = r->status;
+            if (r->read(&a, 1)) {
                   printf("readEvent: error 9\n");
                   return -2;
                   }
             a &= 0x7F;
             }
       else {
-            if (status == -1) {
-                  printf("readEvent: no running status, read 0x%02x sstatus %x\n", me, sstatus);
-                  if (sstatus == -1)
+            if (r->status == -1) {
+                  printf("readEvent: no running status, read 0x%02x sstatus %x\n", me, r->sstatus);
+                  if (r->sstatus == -1)
                         return -1;
-                  status = sstatus;
+                  r->status = r->sstatus;
                   }
             a = me;
             }
       b = 0;
-      switch (status & 0xf0) {
+      switch (r->status & 0xf0) {
             case ME_NOTEOFF:
             case ME_NOTEON:
             case ME_POLYAFTER:
             case ME_CONTROLLER:
             case ME_PITCHBEND:
-                  if (read(&b, 1)) {
+                  if (r->read(&b, 1)) {
                         printf("readEvent: error 15\n");
                         return -2;
                         }
@@ -566,20 +624,20 @@ int MidiFile::readEvent(MidiPlayEvent* event, MidiFileTrack* t)
             case ME_AFTERTOUCH:
                   break;
             default:          // f1 f2 f3 f4 f5 f6 f7 f8 f9
-                  printf("BAD STATUS 0x%02x, me 0x%02x\n", status, me);
+                  printf("BAD STATUS 0x%02x, me 0x%02x\n", r->status, me);
                   return -2;
             }
       event->setA(a & 0x7f);
-      event->setType(status & 0xf0);
-      event->setChannel(status & 0xf);
+      event->setType(r->status & 0xf0);
+      event->setChannel(r->status & 0xf);
       if ((a & 0x80) || (b & 0x80)) {
             printf("8'tes Bit in Daten(%02x %02x): tick %d read 0x%02x  status:0x%02x\n",
-               a & 0xff, b & 0xff, click, me, status);
+               a & 0xff, b & 0xff, r->click, me, r->status);
             printf("readEvent: error 16\n");
             if (b & 0x80) {
                   // Try to fix: interpret as channel byte
-                  status   = b & 0xf0;
-                  sstatus  = status;
+                  r->status   = b & 0xf0;
+                  r->sstatus  = r->status;
                   return 3;
                   }
             return -1;
@@ -745,54 +803,184 @@ bool MidiFile::write()
       }
 
 //---------------------------------------------------------
-//   readMidi
+//   read
 //    returns true on error
 //---------------------------------------------------------
 
 bool MidiFile::read()
+      {
+      if (parse())
+            return true;
+      return readTracks();
+      }
+
+//---------------------------------------------------------
+//   parse
+//    returns true on error
+//    The first half of read(), safe in any thread. A
+//    regular file is mapped, anything else (a pipe from a
+//    decompressor) read into memory first.
+//---------------------------------------------------------
+
+bool MidiFile::parse()
       {
       _error = MF_NO_ERROR;
-      int i;
+
+      struct stat st;
+      int fd = fileno(fp);
+      void* map = MAP_FAILED;
+      size_t size = 0;
+      if (fd != -1 && fstat(fd, &st) == 0 && S_ISREG(st.st_mode) && st.st_size > 0) {
+            size = st.st_size;
+            map = mmap(0, size, PROT_READ, MAP_PRIVATE, fd, 0);
+            }
+      if (map != MAP_FAILED) {
+            madvise(map, size, MADV_SEQUENTIAL);
+            bool rv = readData((const unsigned char*)map, size);
+            munmap(map, size);
+            return rv;
+            }
+
+      std::vector<unsigned char> buffer;
+      unsigned char tmp[64 * 1024];
+      size_t n;
+      while ((n = fread(tmp, 1, sizeof(tmp), fp)) > 0)
+            buffer.insert(buffer.end(), tmp, tmp + n);
+      if (ferror(fp)) {
+            _error = MF_READ;
+            return true;
+            }
+      return readData(buffer.empty() ? 0 : &buffer[0], buffer.size());
+      }
+
+//---------------------------------------------------------
+//   readData
+//    returns true on error
+//    The tracks are parsed in parallel, readTracks() gives
+//    them their ports afterwards.
+//---------------------------------------------------------
+
+bool MidiFile::readData(const unsigned char* data, size_t size)
+      {
+      MidiFileReader r(data, size);
       char tmp[4];
+      unsigned char h[6];
 
-      if (read(tmp, 4))
+      if (r.read(tmp, 4) || r.read(h, 4)) {
+            _error = r.error;
             return true;
-      int len = readLong();
+            }
+      int len = (h[0] << 24) | (h[1] << 16) | (h[2] << 8) | h[3];
       if (memcmp(tmp, "MThd", 4) || len < 6) {
             _error = MF_MTHD;
             return true;
             }
-      format   = readShort();
-      ntracks  = readShort();
-      _division = readShort();
+      if (r.read(h, 6)) {
+            _error = r.error;
+            return true;
+            }
+      format    = (h[0] << 8) | h[1];
+      ntracks   = (h[2] << 8) | h[3];
+      _division = (h[4] << 8) | h[5];
 
       if (_division < 0)
             _division = (-(_division/256)) * (_division & 0xff);
-      if (len > 6)
-            skip(len-6); // skip excess bytes
+      if (len > 6) {
+            // skip excess bytes
+            if (size_t(r.end - r.p) < size_t(len - 6)) {
+                  _error = MF_EOF;
+                  return true;
+                  }
+            r.p += len - 6;
+            }
 
+      int n;
       switch (format) {
             case 0:
-                  {
-                  MidiFileTrack* t = new MidiFileTrack;
-                  _tracks->push_back(t);
-                  if (readTrack(t))
-                        return true;
-                  }
+                  n = 1;
                   break;
             case 1:
-                  for (i = 0; i < ntracks; i++) {
-                        MidiFileTrack* t = new MidiFileTrack;
-                        _tracks->push_back(t);
-                        if (readTrack(t))
-                              return true;
-                        }
+                  n = ntracks;
                   break;
             default:
                   _error = MF_FORMAT;
                   return true;
             }
+
+      //    find the tracks
+
+      delete _jobs;
+      _jobs = new std::vector<MidiFileTrackJob>(n);
+      std::vector<MidiFileTrackJob>& jobs = *_jobs;
+      for (int i = 0; i < n; ++i) {
+            MidiFileTrackJob& job = jobs[i];
+            job.track = new MidiFileTrack;
+            job.error = MF_NO_ERROR;
+            _tracks->push_back(job.track);
+            if (r.read(tmp, 4) || r.read(h, 4)) {
+                  _error = r.error;
+                  return true;
+                  }
+            if (memcmp(tmp, "MTrk", 4)) {
+                  _error = MF_MTRK;
+                  return true;
+                  }
+            size_t tlen = (unsigned(h[0]) << 24) | (h[1] << 16) | (h[2] << 8) | h[3];
+            // A short last track is read as far as it goes.
+            if (tlen > size_t(r.end - r.p))
+                  tlen = r.end - r.p;
+            job.data   = r.p;
+            job.len    = tlen;
+            job.offset = r.p - data;
+            r.p += tlen;
+            }
+
+      //    parse them, in as many threads as it pays
+
+      QAtomicInt next(0);
+      std::vector<MidiFileParser*> parsers;
+      int threads = std::min(_threads > 0 ? _threads : QThread::idealThreadCount(), n) - 1;
+      if (size < 64 * 1024)
+            threads = 0;
+      for (int i = 0; i < threads; ++i) {
+            MidiFileParser* p = new MidiFileParser(this, &jobs, &next);
+            p->start();
+            parsers.push_back(p);
+            }
+      MidiFileParser(this, &jobs, &next).run();
+      for (size_t i = 0; i < parsers.size(); ++i) {
+            parsers[i]->wait();
+            delete parsers[i];
+            }
+
       return false;
       }
 
+//---------------------------------------------------------
+//   readTracks
+//    returns true on error
+//    The second half of read(): ports and channels, in
+//    file order. The track lists allocate from the audio
+//    memory pool, one thread at a time only.
+//---------------------------------------------------------
+
+bool MidiFile::readTracks()
+      {
+      if (!_jobs)
+            return false;
+      bool rv = false;
+      for (std::vector<MidiFileTrackJob>::iterator i = _jobs->begin(); i != _jobs->end(); ++i) {
+            readTrack(i->track, i->records);
+            std::vector<MidiFileRecord>().swap(i->records);
+            if (i->error != MF_NO_ERROR) {
+                  _error = i->error;
+                  rv = true;
+                  break;
+                  }
+            }
+      delete _jobs;
+      _jobs = 0;
+      return rv;
+      }
+
 } // namespace MusECore
@@ -29,6 +29,7 @@
 
 #include <stdio.h>
 #include <list>
+#include <vector>
 
 #include "globaldefs.h"
 #include "mpevent.h"
@@ -38,6 +39,9 @@ namespace MusECore {
 struct MPEventList;
 class MidiPlayEvent;
 class MidiInstrument;
+struct MidiFileReader;
+struct MidiFileRecord;
+struct MidiFileTrackJob;
 
 //---------------------------------------------------------
 //   MidiFileTrack
@@ -87,39 +91,35 @@ class MidiFile {
       //MType _mtype;
       MidiFileTrackList* _tracks;
 
-      int status, click;
-      int sstatus;
-      int lastport, lastchannel;
-      MType lastMtype;
-      //QString lastMtypeInstrument;
-      QString lastInstrName;
-      QString lastDeviceName;
+      int status;       // running status when writing
       //MidiInstrument* def_instr;
       MidiFilePortMap* _usedPortMap;
       FILE* fp;
-      int curPos;
+      int _threads;     // parsing the tracks, 0 = one per cpu
+      std::vector<MidiFileTrackJob>* _jobs;     // between parse() and readTracks()
 
-      bool read(void*, size_t);
       bool write(const void*, size_t);
       void put(unsigned char c) { write(&c, 1); }
-      bool skip(size_t);
-      int readShort();
       bool writeShort(int);
-      int readLong();
       bool writeLong(int);
-      int getvl();
       void putvl(unsigned);
 
-      bool readTrack(MidiFileTrack*);
+      bool readData(const unsigned char* data, size_t size);
+      void parseTrack(MidiFileTrackJob*);
+      void readTrack(MidiFileTrack*, const std::vector<MidiFileRecord>&);
       bool writeTrack(const MidiFileTrack*);
 
-      int readEvent(MidiPlayEvent*, MidiFileTrack*);
+      int readEvent(MidiPlayEvent*, MidiFileTrack*, MidiFileReader*);
       void writeEvent(const MidiPlayEvent*);
 
+      friend class MidiFileParser;
+
    public:
       MidiFile(FILE* f);
       ~MidiFile();
       bool read();
+      bool parse();
+      bool readTracks();
       bool write();
       QString error();
       MidiFilePortMap* usedPortMap() { return _usedPortMap; }
@@ -130,6 +130,7 @@ class MidiFile {
             ntracks = n;
             }
       void setDivision(int d)         { _division = d; }
+      void setThreads(int n)          { _threads = n; }
       int division() const            { return _division; }
       };
 
@@ -0,0 +1,161 @@
+//=========================================================
+//  MusE
+//  Linux Music Editor
+//
+//  midifile_bench.cpp
+//    How fast MidiFile reads a corpus of standard midi
+//    files
+//
+//  This program is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU General Public License
+//  as published by the Free Software Foundation; version 2 of
+//  the License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+//
+//=========================================================
+
+//---------------------------------------------------------
+//    Reads each file given on the command line the way
+//    importMidi does, -r times, and prints per file:
+//      KB       file size
+//      tracks   MTrk chunks
+//      events   events in all tracks
+//      ms       wall time of one MidiFile::read()
+//      cpu      cpu time of all threads over wall time,
+//               how much of the tracks were read in
+//               parallel
+//      MB/s     file bytes per second of wall time
+//    and the totals. Large files with many tracks gain
+//    from parallel parsing, files under 64 KB are read in
+//    one thread.
+//---------------------------------------------------------
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <time.h>
+#include <sys/stat.h>
+
+#include "midifile.h"
+
+//---------------------------------------------------------
+//   wallTime
+//---------------------------------------------------------
+
+static double wallTime()
+      {
+      struct timespec ts;
+      clock_gettime(CLOCK_MONOTONIC, &ts);
+      return ts.tv_sec + ts.tv_nsec * 1e-9;
+      }
+
+//---------------------------------------------------------
+//   cpuTime
+//    Of the process, all threads.
+//---------------------------------------------------------
+
+static double cpuTime()
+      {
+      struct timespec ts;
+      clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &ts);
+      return ts.tv_sec + ts.tv_nsec * 1e-9;
+      }
+
+//---------------------------------------------------------
+//   usage
+//---------------------------------------------------------
+
+static void usage(const char* prog)
+      {
+      fprintf(stderr,
+         "usage: %s [-r rounds] file.mid...\n"
+         "   defaults: -r 5\n", prog);
+      }
+
+//---------------------------------------------------------
+//   main
+//---------------------------------------------------------
+
+int main(int argc, char* argv[])
+      {
+      int rounds = 5;
+
+      int c;
+      while ((c = getopt(argc, argv, "r:h")) != EOF) {
+            switch (c) {
+                  case 'r': rounds = atoi(optarg); break;
+                  default:
+                        usage(argv[0]);
+                        return 1;
+                  }
+            }
+      if (rounds <= 0 || optind >= argc) {
+            usage(argv[0]);
+            return 1;
+            }
+
+      printf("%-32s %8s %6s %9s %9s %5s %8s\n", "file", "KB", "tracks", "events", "ms", "cpu", "MB/s");
+      double totalBytes = 0.0, totalWall = 0.0;
+      long totalEvents = 0;
+      for (int i = optind; i < argc; ++i) {
+            const char* path = argv[i];
+            struct stat st;
+            if (stat(path, &st)) {
+                  perror(path);
+                  continue;
+                  }
+            double wall = 0.0, cpu = 0.0;
+            int tracks = 0;
+            long events = 0;
+            bool failed = false;
+            for (int r = 0; r < rounds && !failed; ++r) {
+                  FILE* fp = fopen(path, "r");
+                  if (!fp) {
+                        perror(path);
+                        failed = true;
+                        break;
+                        }
+                  MusECore::MidiFile mf(fp);
+                  const double w0 = wallTime();
+                  const double c0 = cpuTime();
+                  if (mf.read()) {
+                        fprintf(stderr, "%s: %s\n", path, mf.error().toLocal8Bit().constData());
+                        failed = true;
+                        }
+                  cpu  += cpuTime() - c0;
+                  wall += wallTime() - w0;
+                  fclose(fp);
+
+                  MusECore::MidiFileTrackList* tl = mf.trackList();
+                  tracks = tl->size();
+                  events = 0;
+                  for (MusECore::iMidiFileTrack t = tl->begin(); t != tl->end(); ++t) {
+                        events += (*t)->events.size();
+                        delete *t;
+                        }
+                  }
+            if (failed)
+                  continue;
+            wall /= rounds;
+            cpu  /= rounds;
+            printf("%-32.32s %8.0f %6d %9ld %9.2f %5.2f %8.1f\n", path, st.st_size / 1024.0,
+               tracks, events, wall * 1000.0, wall > 0.0 ? cpu / wall : 0.0,
+               wall > 0.0 ? st.st_size / wall / (1024 * 1024) : 0.0);
+            totalBytes  += st.st_size;
+            totalWall   += wall;
+            totalEvents += events;
+            }
+      printf("\ntotal: %.1f MB, %ld events in %.1f ms, %.1f MB/s, %.0f events/s\n",
+         totalBytes / (1024 * 1024), totalEvents, totalWall * 1000.0,
+         totalWall > 0.0 ? totalBytes / totalWall / (1024 * 1024) : 0.0,
+         totalWall > 0.0 ? totalEvents / totalWall : 0.0);
+      return 0;
+      }
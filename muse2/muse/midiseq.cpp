@@ -143,7 +143,7 @@ void MidiSeq::processSeek()
 //---------------------------------------------------------
 
 MidiSeq::MidiSeq(const char* name)
-   : Thread(name)
+   : Thread(name), _mtcDll(1.0)
       {
       prio = 0;
       
@@ -155,6 +155,12 @@ MidiSeq::MidiSeq(const char* name)
       lastTempo = 0;
       storedtimediffs = 0;
       playStateExt = false; // not playing
+      _clockLocked = false;
+      _mtcLocked = false;
+      _mtcOffset = 0.0;
+      _mtcOffsetValid = false;
+      _mtcHoldOff = 0;
+      _extClock.valid = false;
 
       _clockAveragerStages = new int[16]; // Max stages is 16!
       setSyncRecFilterPreset(MusEGlobal::syncRecFilterPreset);
@@ -426,6 +432,11 @@ void MidiSeq::setSyncRecFilterPreset(MidiSyncInfo::SyncRecFilterPresetType type)
       _clockAveragerStages[3] = 48; 
       _preDetect = true;
     break;  
+    case MidiSyncInfo::PLL:
+      // Tempo comes from the period of the clock DLL.
+      _clockAveragerPoles = 0;    
+      _preDetect = false;
+    break;  
     
     default:
       printf("MidiSeq::setSyncRecFilterPreset unknown preset type:%d\n", (int)type);
@@ -514,6 +525,9 @@ void MidiSeq::processTimerTick()
             }
 
       // play all events upto curFrame
+      // With the ALSA output queue the audio thread does this.
+      if (alsaMidiQueueActive())
+            return;
       for (iMidiDevice id = MusEGlobal::midiDevices.begin(); id != MusEGlobal::midiDevices.end(); ++id)
             if((*id)->deviceType() == MidiDevice::ALSA_MIDI)
               (*id)->processMidi();
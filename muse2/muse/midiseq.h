@@ -24,11 +24,14 @@
 #ifndef __MIDISEQ_H__
 #define __MIDISEQ_H__
 
+#include <QAtomicInt>
+
 #include "thread.h"
 #include "mpevent.h"
 #include "driver/alsatimer.h"
 #include "driver/rtctimer.h"
 #include "sync.h"
+#include "syncdll.h"
 
 namespace MusECore {
 
@@ -70,6 +73,29 @@ class MidiSeq : public Thread {
       void alignAllTicks(int frameOverride = 0);
 /* Testing */
 
+      // External clock and MTC tracking.
+      SyncDll _clockDll;
+      SyncDll _mtcDll;
+      bool _clockLocked;
+      bool _mtcLocked;
+      double _mtcOffset;        // MTC minus song time when MTC locked
+      bool _mtcOffsetValid;
+      int _mtcHoldOff;          // full frames to skip after relocating
+      // Last clock for the audio thread, written by the thread
+      //  receiving the clock. Sequence lock: _extClockSeq is odd
+      //  while a writer is busy, the reader retries if it changed.
+      struct ExtClock {
+            unsigned tick;
+            double time;
+            double period;
+            bool valid;
+            };
+      ExtClock _extClock;
+      QAtomicInt _extClockSeq;
+      void publishExtClock(bool valid);
+      void recordExtTempo(double realTempo, int tick);
+      void clockLockReport(const char* what);
+
       Timer *timer;
 
       signed int selectTimer();
@@ -96,7 +122,7 @@ class MidiSeq : public Thread {
       bool externalPlayState() const { return playStateExt; }
       void setExternalPlayState(bool v) { playStateExt = v; }
       void realtimeSystemInput(int port, int type, double time = 0.0);
-      void mtcInputQuarter(int, unsigned char);
+      void mtcInputQuarter(int, unsigned char, double time = 0.0);
       void setSongPosition(int, int);
       void mmcInput(int, const unsigned char*, int);
       void mtcInputFull(int, const unsigned char*, int);
@@ -106,6 +132,7 @@ class MidiSeq : public Thread {
       void setSyncRecFilterPreset(MidiSyncInfo::SyncRecFilterPresetType type);
       double recTempoValQuant() const { return _tempoQuantizeAmount; }
       void setRecTempoValQuant(double q) { _tempoQuantizeAmount = q; }
+      bool extClockTick(double time, unsigned* tick) const;
 
       void msgMsg(int id);
       void msgSeek();
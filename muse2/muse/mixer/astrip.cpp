@@ -104,12 +104,15 @@ QSize AudioStrip::sizeHint () const
 
 void AudioStrip::heartBeat()
       {
-        for (int ch = 0; ch < track->channels(); ++ch) {
-          if (meter[ch]) {
-            //int meterVal = track->meter(ch);
-            //int peak  = track->peak(ch);
-            //meter[ch]->setVal(meterVal, peak, false);
-            meter[ch]->setVal(track->meter(ch), track->peak(ch), false);
+        // Only when the audio thread published new values since.
+        MusECore::MeterSnapshot& ms = track->meterSnapshot();
+        ms.fetch();
+        const MusECore::MeterFrame& f = ms.front();
+        if (f.serial != _meterSerial) {
+          _meterSerial = f.serial;
+          for (int ch = 0; ch < track->channels() && ch < f.channels; ++ch) {
+            if (meter[ch])
+              meter[ch]->setVal(f.meter[ch], f.peak[ch], false);
           }
         }
         Strip::heartBeat();
@@ -1094,8 +1097,6 @@ AudioStrip::AudioStrip(QWidget* parent, MusECore::AudioTrack* at)
             updateOffState();   // init state
             off->blockSignals(false);
             }
-      connect(MusEGlobal::heartBeatTimer, SIGNAL(timeout()), SLOT(heartBeat()));
-
       updateRouteButtons();
 
       }
@@ -400,7 +400,6 @@ MidiStrip::MidiStrip(QWidget* parent, MusECore::MidiTrack* t)
       autoType->setCurrentItem(AUTO_OFF);    //
 
       grid->addWidget(autoType, _curGridRow++, 0, 1, 2);
-      connect(MusEGlobal::heartBeatTimer, SIGNAL(timeout()), SLOT(heartBeat()));
       inHeartBeat = false;
       }
 
@@ -25,6 +25,7 @@
 #include <QDrag>
 #include <QDragEnterEvent>
 #include <QDropEvent>
+#include <QHelpEvent>
 #include <QMenu>
 #include <QMessageBox>
 #include <QMimeData>
@@ -32,6 +33,7 @@
 #include <QPainter>
 #include <QPalette>
 #include <QStyledItemDelegate>
+#include <QToolTip>
 #include <QUrl>
 #include "widgets/popupmenu.h"
 
@@ -202,6 +204,38 @@ void EffectRack::updateContents()
             }	
       }
 
+//---------------------------------------------------------
+//   viewportEvent
+//    Tooltips show the current DSP load of the slot and
+//    the round trip time of bridged plugins.
+//---------------------------------------------------------
+
+bool EffectRack::viewportEvent(QEvent* event)
+      {
+      if (event->type() == QEvent::ToolTip) {
+            QHelpEvent* he = static_cast<QHelpEvent*>(event);
+            QListWidgetItem* it = itemAt(he->pos());
+            if (it) {
+                  int idx = row(it);
+                  MusECore::Pipeline* pipe = track->efxPipe();
+                  QString name = pipe->name(idx);
+                  if (name == QString("empty"))
+                        QToolTip::showText(he->globalPos(), tr("effect rack"), viewport());
+                  else if (pipe->isOn(idx)) {
+                        QString tip = tr("%1\nDSP load: %2 %").arg(name).arg(pipe->cpuLoad(idx), 0, 'f', 1);
+                        float avg, max;
+                        if (pipe->bridgeRoundTrip(idx, &avg, &max))
+                              tip += tr("\nBridge round trip: %1 us (max %2 us)").arg(avg, 0, 'f', 0).arg(max, 0, 'f', 0);
+                        QToolTip::showText(he->globalPos(), tip, viewport());
+                        }
+                  else
+                        QToolTip::showText(he->globalPos(), name, viewport());
+                  return true;
+                  }
+            }
+      return QListWidget::viewportEvent(event);
+      }
+
 //---------------------------------------------------------
 //   EffectRack
 //---------------------------------------------------------
@@ -246,7 +280,9 @@ void EffectRack::choosePlugin(QListWidgetItem* it, bool replace)
       MusECore::Plugin* plugin = PluginDialog::getPlugin(this);
       if (plugin) {
             MusECore::PluginI* plugi = new MusECore::PluginI();
-            if (plugi->initPluginInstance(plugin, track->channels())) {
+            // Handles are created by the plugin pool, the slot shows the plugin
+            //  right away. A failure takes it out of the rack again.
+            if (plugi->initPluginInstance(plugin, track->channels(), true)) {
                   printf("cannot instantiate plugin <%s>\n",
                       plugin->name().toLatin1().constData());
                   delete plugi;
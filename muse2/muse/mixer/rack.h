@@ -28,6 +28,7 @@
 #include "type_defs.h"
 
 class QDragEnterEvent;
+class QEvent;
 class QDragLeaveEvent;
 class QDropEvent;
 class QMouseEvent;
@@ -67,6 +68,7 @@ class EffectRack : public QListWidget {
       void updateContents();
 
    protected:
+      virtual bool viewportEvent(QEvent* event);
       void dropEvent(QDropEvent *event);
       void dragEnterEvent(QDragEnterEvent *event);
       void mousePressEvent(QMouseEvent *event);
@@ -31,6 +31,10 @@
 #include <QFrame>
 #include <QMouseEvent>
 #include <QMenu>
+#include <QTimer>
+
+#include <stdio.h>
+#include <algorithm>
 
 #include "globals.h"
 #include "gconfig.h"
@@ -48,6 +52,73 @@ using MusECore::UndoOp;
 
 namespace MusEGui {
 
+//---------------------------------------------------------
+//   StripBeat
+//---------------------------------------------------------
+
+StripBeat::StripBeat()
+   : QObject(0)
+      {
+      _time       = 0.0;
+      _beats      = 0;
+      _stripBeats = 0;
+      _lastReport = MusECore::curTime();
+      connect(MusEGlobal::heartBeatTimer, SIGNAL(timeout()), SLOT(beat()));
+      }
+
+//---------------------------------------------------------
+//   instance
+//    Not a child of the heartbeat timer: the timer goes
+//    before the mixers when MusE is deleted, and each strip
+//    still removes itself here. Lives until exit.
+//---------------------------------------------------------
+
+StripBeat* StripBeat::instance()
+      {
+      static StripBeat beat;
+      return &beat;
+      }
+
+void StripBeat::add(Strip* s)
+      {
+      _strips.push_back(s);
+      }
+
+void StripBeat::remove(Strip* s)
+      {
+      std::vector<Strip*>::iterator i = std::find(_strips.begin(), _strips.end(), s);
+      if (i != _strips.end())
+            _strips.erase(i);
+      }
+
+//---------------------------------------------------------
+//   beat
+//---------------------------------------------------------
+
+void StripBeat::beat()
+      {
+      const double t0 = MusECore::curTime();
+      for (std::vector<Strip*>::const_iterator i = _strips.begin(); i != _strips.end(); ++i) {
+            if (!(*i)->isVisible())
+                  continue;
+            (*i)->heartBeat();
+            ++_stripBeats;
+            }
+      const double t1 = MusECore::curTime();
+      _time += t1 - t0;
+      ++_beats;
+
+      if (MusEGlobal::debugMsg && t1 - _lastReport >= 10.0) {
+            printf("strip heartbeat: %d strips, %.1f us per beat, %.2f us per strip\n",
+               int(_strips.size()), _time * 1e6 / _beats,
+               _stripBeats ? _time * 1e6 / _stripBeats : 0.0);
+            _time       = 0.0;
+            _beats      = 0;
+            _stripBeats = 0;
+            _lastReport = t1;
+            }
+      }
+
 //---------------------------------------------------------
 //   setRecordFlag
 //---------------------------------------------------------
@@ -231,6 +302,8 @@ Strip::Strip(QWidget* parent, MusECore::Track* t)
       track    = t;
       meter[0] = 0;
       meter[1] = 0;
+      _meterSerial = 0;
+      StripBeat::instance()->add(this);
       //setFixedWidth(STRIP_WIDTH);
       //setMinimumWidth(STRIP_WIDTH);     // TESTING Tim.
       //setSizePolicy(QSizePolicy(QSizePolicy::MinimumExpanding, QSizePolicy::Expanding)); // TESTING Tim.
@@ -297,6 +370,7 @@ Strip::Strip(QWidget* parent, MusECore::Track* t)
 
 Strip::~Strip()
       {
+      StripBeat::instance()->remove(this);
       }
 
 //---------------------------------------------------------
@@ -31,6 +31,8 @@
 #include <QGridLayout>
 #include <QLabel>
 
+#include <vector>
+
 #include "type_defs.h"
 #include "globaldefs.h"
 //#include "route.h"
@@ -50,6 +52,36 @@ class Meter;
 
 static const int STRIP_WIDTH = 65;
 
+class Strip;
+
+//---------------------------------------------------------
+//   StripBeat
+//    The one heartbeat slot of all strips, instead of one
+//    connection per strip. Hidden strips are skipped.
+//    With debugMsg the cost per strip is printed now and
+//    then.
+//---------------------------------------------------------
+
+class StripBeat : public QObject {
+      Q_OBJECT
+
+      std::vector<Strip*> _strips;
+      double _time;           // spent in beat() since the last report
+      unsigned _beats;
+      unsigned _stripBeats;   // strips served since the last report
+      double _lastReport;
+
+      StripBeat();
+
+   private slots:
+      void beat();
+
+   public:
+      static StripBeat* instance();
+      void add(Strip*);
+      void remove(Strip*);
+      };
+
 //---------------------------------------------------------
 //   Strip
 //---------------------------------------------------------
@@ -64,6 +96,7 @@ class Strip : public QFrame {
       QGridLayout* grid;
       int _curGridRow;
       MusEGui::Meter* meter[MAX_CHANNELS];
+      unsigned _meterSerial;  // of the track's meter frame shown
       
       QToolButton* record;
       QToolButton* solo;
@@ -90,6 +123,8 @@ class Strip : public QFrame {
       virtual void songChanged(MusECore::SongChangedFlags_t) = 0;
       virtual void configChanged() = 0;
 
+      friend class StripBeat;
+
    public:
       Strip(QWidget* parent, MusECore::Track* t);
       ~Strip();
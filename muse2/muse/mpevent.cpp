@@ -22,6 +22,8 @@
 //=========================================================
 
 #include <stdio.h>
+#include <string.h>
+#include <algorithm>
 
 #include "mpevent.h"
 
@@ -222,11 +224,10 @@ bool MEvent::operator<(const MEvent& e) const
 
 bool MidiFifo::put(const MidiPlayEvent& event)
       {
-      if (size < MIDI_FIFO_SIZE) {
+      if (size.loadAcquire() < MIDI_FIFO_SIZE) {
             fifo[wIndex] = event;
             wIndex = (wIndex + 1) % MIDI_FIFO_SIZE;
-            // q_atomic_increment(&size);
-            ++size;
+            size.ref();
             return false;
             }
       return true;
@@ -240,7 +241,7 @@ MidiPlayEvent MidiFifo::get()
       {
       MidiPlayEvent event(fifo[rIndex]);
       rIndex = (rIndex + 1) % MIDI_FIFO_SIZE;
-      --size;
+      size.deref();
       return event;
       }
 
@@ -261,7 +262,7 @@ const MidiPlayEvent& MidiFifo::peek(int n)
 void MidiFifo::remove()
       {
       rIndex = (rIndex + 1) % MIDI_FIFO_SIZE;
-      --size;
+      size.deref();
       }
 
 
@@ -313,4 +314,93 @@ void MidiRecFifo::remove()
       --size;
       }
 
+//---------------------------------------------------------
+//   MidiByteFifo
+//---------------------------------------------------------
+
+void MidiByteFifo::write(const void* p, int n)
+      {
+      const int n1 = std::min(n, MIDI_BYTE_FIFO_SIZE - wIndex);
+      memcpy(fifo + wIndex, p, n1);
+      memcpy(fifo, (const unsigned char*)p + n1, n - n1);
+      wIndex = (wIndex + n) % MIDI_BYTE_FIFO_SIZE;
+      }
+
+void MidiByteFifo::read(void* p, int n, int offset) const
+      {
+      const int idx = (rIndex + offset) % MIDI_BYTE_FIFO_SIZE;
+      const int n1  = std::min(n, MIDI_BYTE_FIFO_SIZE - idx);
+      memcpy(p, fifo + idx, n1);
+      memcpy((unsigned char*)p + n1, fifo, n - n1);
+      }
+
+//---------------------------------------------------------
+//   put
+//    return true on fifo overflow
+//---------------------------------------------------------
+
+bool MidiByteFifo::put(unsigned time, const unsigned char* data, int len)
+      {
+      if (!canPut(len))
+            return true;
+      write(&time, sizeof(time));
+      write(&len, sizeof(len));
+      write(data, len);
+      size.fetchAndAddOrdered(headerSize + len);
+      return false;
+      }
+
+bool MidiByteFifo::putSysex(unsigned time, const unsigned char* data, int len)
+      {
+      const int n = len + 2;
+      if (!canPut(n))
+            return true;
+      const unsigned char f0 = 0xf0, f7 = 0xf7;
+      write(&time, sizeof(time));
+      write(&n, sizeof(n));
+      write(&f0, 1);
+      write(data, len);
+      write(&f7, 1);
+      size.fetchAndAddOrdered(headerSize + n);
+      return false;
+      }
+
+//---------------------------------------------------------
+//   peek
+//---------------------------------------------------------
+
+int MidiByteFifo::peek(unsigned* time) const
+      {
+      if (isEmpty())
+            return -1;
+      int len;
+      read(time, sizeof(*time), 0);
+      read(&len, sizeof(len), sizeof(*time));
+      return len;
+      }
+
+//---------------------------------------------------------
+//   copy
+//    copy the bytes of the next record
+//---------------------------------------------------------
+
+void MidiByteFifo::copy(unsigned char* dst) const
+      {
+      int len;
+      read(&len, sizeof(len), sizeof(unsigned));
+      read(dst, len, headerSize);
+      }
+
+//---------------------------------------------------------
+//   remove
+//---------------------------------------------------------
+
+void MidiByteFifo::remove()
+      {
+      int len;
+      read(&len, sizeof(len), sizeof(unsigned));
+      rIndex = (rIndex + headerSize + len) % MIDI_BYTE_FIFO_SIZE;
+      size.fetchAndAddOrdered(-(headerSize + len));
+      }
+
 } // namespace MusECore
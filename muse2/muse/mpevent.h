@@ -27,6 +27,7 @@
 
 #include <set>
 #include <list>
+#include <QAtomicInt>
 #include "evdata.h"
 #include "memory.h"
 
@@ -36,6 +37,9 @@
 // Record events ring buffer size
 #define MIDI_REC_FIFO_SIZE  256
 
+// Pre-encoded output bytes ring buffer size
+#define MIDI_BYTE_FIFO_SIZE 32768
+
 namespace MusECore {
 
 class Event;
@@ -191,7 +195,7 @@ typedef MREventList::const_iterator ciMREvent;
 
 class MidiFifo {
       MidiPlayEvent fifo[MIDI_FIFO_SIZE];
-      volatile int size;
+      QAtomicInt size;
       int wIndex;
       int rIndex;
 
@@ -201,9 +205,9 @@ class MidiFifo {
       MidiPlayEvent get();
       const MidiPlayEvent& peek(int = 0);
       void remove();
-      bool isEmpty() const { return size == 0; }
-      void clear()         { size = 0, wIndex = 0, rIndex = 0; }
-      int getSize() const  { return size; }
+      bool isEmpty() const { return size.loadAcquire() == 0; }
+      void clear()         { size.store(0); wIndex = 0; rIndex = 0; }
+      int getSize() const  { return size.loadAcquire(); }
       };
 
 //---------------------------------------------------------
@@ -227,6 +231,39 @@ class MidiRecFifo {
       int getSize() const  { return size; }
       };
 
+//---------------------------------------------------------
+//   MidiByteFifo
+//    Raw midi messages with their event time, one writer
+//    and one reader thread. Each record is a time, a length
+//    and the message bytes.
+//---------------------------------------------------------
+
+class MidiByteFifo {
+      unsigned char fifo[MIDI_BYTE_FIFO_SIZE];
+      QAtomicInt size;
+      int wIndex;
+      int rIndex;
+
+      void write(const void* p, int n);
+      void read(void* p, int n, int offset) const;
+
+   public:
+      static const int headerSize = sizeof(unsigned) + sizeof(int);
+
+      MidiByteFifo()  { clear(); }
+      // Room for a record of len bytes?
+      bool canPut(int len) const { return headerSize + len <= MIDI_BYTE_FIFO_SIZE - size.loadAcquire(); }
+      // Returns true on fifo overflow. A sysex gets its f0/f7 framing added.
+      bool put(unsigned time, const unsigned char* data, int len);
+      bool putSysex(unsigned time, const unsigned char* data, int len);
+      // Length of the next record, -1 if empty.
+      int peek(unsigned* time) const;
+      void copy(unsigned char* dst) const;
+      void remove();
+      bool isEmpty() const { return size.loadAcquire() == 0; }
+      void clear()         { size.store(0); wIndex = 0; rIndex = 0; }
+      };
+
 } // namespace MusECore
 
 #endif
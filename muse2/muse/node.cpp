@@ -1197,7 +1197,7 @@ void AudioOutput::setChannels(int n)
 
 void AudioTrack::putFifo(int channels, unsigned long n, float** bp)
       {
-      if (fifo.put(channels, n, bp, MusEGlobal::audio->pos().frame())) {
+      if (_recRing.put(channels, n, bp, MusEGlobal::audio->pos().frame())) {
             printf("   overrun ???\n");
             }
       }
@@ -1419,75 +1419,90 @@ bool WaveTrack::canEnableRecord() const
 
 //---------------------------------------------------------
 //   record
+//    Record writer thread context. Writes the recorded
+//    blocks waiting in the record ring to the take file.
+//    Blocks following each other in the file are collected
+//    in chunk, so a write covers up to chunkFrames frames.
 //---------------------------------------------------------
 
-void AudioTrack::record()
+void AudioTrack::record(float** chunk, unsigned chunkFrames)
       {
-      unsigned pos = 0;
-      float* buffer[_channels];
+      unsigned n       = 0;     // frames in chunk
+      unsigned filePos = 0;     // of the first frame in chunk
+      int chans        = 0;
 
-      while(fifo.getCount()) {
-
-            if (fifo.get(_channels, MusEGlobal::segmentSize, buffer, &pos)) {
-                  printf("AudioTrack::record(): empty fifo\n");
-                  return;
-                  }
-            if (_recFile) {
-                  // Line removed by Tim. Oct 28, 2009
-                  //_recFile->seek(pos, 0);
-                  //
-                  // Fix for recorded waves being shifted ahead by an amount
-                  //  equal to start record position.
-                  //
-                  // From libsndfile ChangeLog:
-                  // 2008-05-11  Erik de Castro Lopo  <erikd AT mega-nerd DOT com>
-                  //    * src/sndfile.c
-                  //    Allow seeking past end of file during write.
-                  //    
-                  // I don't know why this line would even be called, because the FIFOs'
-                  //  'pos' members operate in absolute frames, which at this point 
-                  //  would be shifted ahead by the start of the wave part.
-                  // So if you begin recording a new wave part at bar 4, for example, then
-                  //  this line is seeking the record file to frame 288000 even before any audio is written!
-                  // Therefore, just let the write do its thing and progress naturally,
-                  //  it should work OK since everything was OK before the libsndfile change...
-                  //
-                  // Tested: With the line, audio record looping sort of works, albiet with the start offset added to
-                  //  the wave file. And it overwrites existing audio. (Check transport window 'overwrite' function. Tie in somehow...)
-                  // With the line, looping does NOT work with libsndfile from around early 2007 (my distro's version until now).
-                  // Therefore it seems sometime between libsndfile ~2007 and today, libsndfile must have allowed 
-                  //  "seek (behind) on write", as well as the "seek past end" change of 2008...
-                  //
-                  // Ok, so removing that line breaks *possible* record audio 'looping' functionality, revealed with
-                  //  later libsndfile. 
-                  // Try this... And while we're at it, honour the punchin/punchout, and loop functions !
-                  //
-                  // If punchin is on, or we have looped at least once, use left marker as offset.
-                  // Note that audio::startRecordPos is reset to (roughly) the left marker pos upon loop !
-                  // (Not any more! I changed Audio::Process)
-                  // Since it is possible to start loop recording before the left marker (with punchin off), we must 
-                  //  use startRecordPos or loopFrame or left marker, depending on punchin and whether we have looped yet.
-                  unsigned fr;
-                  if(MusEGlobal::song->punchin() && (MusEGlobal::audio->loopCount() == 0))
-                    fr = MusEGlobal::song->lPos().frame();
-                  else  
-                  if((MusEGlobal::audio->loopCount() > 0) && (MusEGlobal::audio->getStartRecordPos().frame() > MusEGlobal::audio->loopFrame()))
-                    fr = MusEGlobal::audio->loopFrame();
-                  else
-                    fr = MusEGlobal::audio->getStartRecordPos().frame();
-                  // Now seek and write. If we are looping and punchout is on, don't let punchout point interfere with looping point.
-                  if( (pos >= fr) && (!MusEGlobal::song->punchout() || (!MusEGlobal::song->loop() && pos < MusEGlobal::song->rPos().frame())) )
-                  {
-                    pos -= fr;
-                    
-                    _recFile->seek(pos, 0);
-                    _recFile->write(_channels, buffer, MusEGlobal::segmentSize);
+      while (_recRing.blocks()) {
+            const RecordBlock& b = _recRing.block();
+            if (_recFile.isNull()) {
+                  printf("AudioNode::record(): no recFile\n");
+                  _recRing.drop();
+                  continue;
                   }
-                    
+            // Line removed by Tim. Oct 28, 2009
+            //_recFile->seek(pos, 0);
+            //
+            // Fix for recorded waves being shifted ahead by an amount
+            //  equal to start record position.
+            //
+            // From libsndfile ChangeLog:
+            // 2008-05-11  Erik de Castro Lopo  <erikd AT mega-nerd DOT com>
+            //    * src/sndfile.c
+            //    Allow seeking past end of file during write.
+            //    
+            // I don't know why this line would even be called, because the FIFOs'
+            //  'pos' members operate in absolute frames, which at this point 
+            //  would be shifted ahead by the start of the wave part.
+            // So if you begin recording a new wave part at bar 4, for example, then
+            //  this line is seeking the record file to frame 288000 even before any audio is written!
+            // Therefore, just let the write do its thing and progress naturally,
+            //  it should work OK since everything was OK before the libsndfile change...
+            //
+            // Tested: With the line, audio record looping sort of works, albiet with the start offset added to
+            //  the wave file. And it overwrites existing audio. (Check transport window 'overwrite' function. Tie in somehow...)
+            // With the line, looping does NOT work with libsndfile from around early 2007 (my distro's version until now).
+            // Therefore it seems sometime between libsndfile ~2007 and today, libsndfile must have allowed 
+            //  "seek (behind) on write", as well as the "seek past end" change of 2008...
+            //
+            // Ok, so removing that line breaks *possible* record audio 'looping' functionality, revealed with
+            //  later libsndfile. 
+            // Try this... And while we're at it, honour the punchin/punchout, and loop functions !
+            //
+            // If punchin is on, or we have looped at least once, use left marker as offset.
+            // Note that audio::startRecordPos is reset to (roughly) the left marker pos upon loop !
+            // (Not any more! I changed Audio::Process)
+            // Since it is possible to start loop recording before the left marker (with punchin off), we must 
+            //  use startRecordPos or loopFrame or left marker, depending on punchin and whether we have looped yet.
+            unsigned fr;
+            if(MusEGlobal::song->punchin() && (MusEGlobal::audio->loopCount() == 0))
+              fr = MusEGlobal::song->lPos().frame();
+            else  
+            if((MusEGlobal::audio->loopCount() > 0) && (MusEGlobal::audio->getStartRecordPos().frame() > MusEGlobal::audio->loopFrame()))
+              fr = MusEGlobal::audio->loopFrame();
+            else
+              fr = MusEGlobal::audio->getStartRecordPos().frame();
+            // Now seek and write. If we are looping and punchout is on, don't let punchout point interfere with looping point.
+            const unsigned pos = b.pos;
+            if( !((pos >= fr) && (!MusEGlobal::song->punchout() || (!MusEGlobal::song->loop() && pos < MusEGlobal::song->rPos().frame()))) )
+            {
+              _recRing.drop();
+              continue;
+            }
+
+            // Not following the chunk in the file, or no more room: write the chunk.
+            if (n && (pos - fr != filePos + n || b.channels != chans || n + b.frames > chunkFrames)) {
+                  _recFile->seek(filePos, 0);
+                  _recFile->write(chans, chunk, n);
+                  n = 0;
                   }
-            else {
-                  printf("AudioNode::record(): no recFile\n");
+            if (n == 0) {
+                  filePos = pos - fr;
+                  chans   = b.channels;
                   }
+            n += _recRing.take(chunk, n);
+            }
+      if (n) {
+            _recFile->seek(filePos, 0);
+            _recFile->write(chans, chunk, n);
             }
       }
 
@@ -669,6 +669,7 @@ void PendingOperationItem::executeRTStage()
       _ev.dump();
 #endif      
       _part->nonconst_events().erase(_iev);
+      _part->eventsChanged();
 #ifdef _PENDING_OPS_DEBUG_
       fprintf(stderr, "PendingOperationItem::executeRTStage DeleteEvent post:   ");
       _ev.dump();
@@ -617,9 +617,16 @@ void modifyPortCtrlEvents(const Event& old_event, const Event& event, Part* part
 
 iEvent Part::addEvent(Event& p)
       {
+      ++_eventsRevision;
       return _events.add(p);
       }
 
+iEvent Part::appendEvent(Event& p)
+      {
+      ++_eventsRevision;
+      return _events.append(p);
+      }
+
 //---------------------------------------------------------
 //   index
 //---------------------------------------------------------
@@ -652,6 +659,7 @@ Part* PartList::find(int idx)
 Part::Part(Track* t)
       {
       _hiddenEvents = NoEventsHidden;
+      _eventsRevision = 0;
       _prevClone = this;
       _nextClone = this;
       _backupClone = NULL;
@@ -744,6 +752,77 @@ WavePart::WavePart(WaveTrack* t)
    : Part(t)
       {
       setType(FRAMES);
+      _cycle = 0;
+      }
+
+WavePart::~WavePart()
+      {
+      releaseReaders();
+      }
+
+//---------------------------------------------------------
+//   reader
+//    The read position of the event in its file, taken
+//    when the event starts playing, given back when it
+//    ends, on seeks, or after a fetch that did not read
+//    the event. Prefetch thread.
+//---------------------------------------------------------
+
+SndFileReader* WavePart::reader(EventBase* eb, const SndFileR& f)
+      {
+      std::map<EventBase*, EventReader>::iterator i = _readers.find(eb);
+      if (i != _readers.end()) {
+            if (i->second.reader->file() == f) {
+                  i->second.cycle = _cycle;
+                  return i->second.reader;
+                  }
+            // The event got another file.
+            delete i->second.reader;
+            _readers.erase(i);
+            }
+      EventReader er;
+      er.reader = new SndFileReader(f);
+      er.cycle  = _cycle;
+      _readers.insert(std::make_pair(eb, er));
+      return er.reader;
+      }
+
+void WavePart::releaseReader(EventBase* eb)
+      {
+      std::map<EventBase*, EventReader>::iterator i = _readers.find(eb);
+      if (i != _readers.end()) {
+            delete i->second.reader;
+            _readers.erase(i);
+            }
+      }
+
+void WavePart::releaseReaders()
+      {
+      for (std::map<EventBase*, EventReader>::iterator i = _readers.begin(); i != _readers.end(); ++i)
+            delete i->second.reader;
+      _readers.clear();
+      }
+
+//---------------------------------------------------------
+//   releaseUnread
+//    Called after each fetch of the track. Gives back the
+//    readers of events the fetch did not read: the part
+//    or track got muted, the loop wrapped, the part ended
+//    before the event did.
+//---------------------------------------------------------
+
+void WavePart::releaseUnread()
+      {
+      std::map<EventBase*, EventReader>::iterator i = _readers.begin();
+      while (i != _readers.end()) {
+            if (i->second.cycle != _cycle) {
+                  delete i->second.reader;
+                  _readers.erase(i++);
+                  }
+            else
+                  ++i;
+            }
+      ++_cycle;
       }
 
 
@@ -82,6 +82,7 @@ class Part : public PosLen {
       Part* _nextClone;
       Part* _backupClone; // when a part gets removed, it's still there; and for undo-ing the remove, it must know about where it was clone-chained to.
       mutable int _hiddenEvents;   // Combination of HiddenEventsType.
+      unsigned _eventsRevision;    // Changes whenever an event is added or removed.
 
    public:
       Part(Track*);
@@ -106,6 +107,8 @@ class Part : public PosLen {
       void setTrack(Track*t)           { _track = t; }
       const EventList& events() const  { return _events; }
       EventList& nonconst_events()     { return _events; }
+      unsigned eventsRevision() const  { return _eventsRevision; }
+      void eventsChanged()             { ++_eventsRevision; }
       int colorIndex() const           { return _colorIndex; }
       void setColorIndex(int idx)      { _colorIndex = idx; }
       
@@ -124,6 +127,7 @@ class Part : public PosLen {
       virtual int hasHiddenEvents() const { return _hiddenEvents; }
       
       iEvent addEvent(Event& p); // this does not care about clones! If the part is a clone, be sure to execute this on all clones (with duplicated Events, that is!)
+      iEvent appendEvent(Event& p); // like addEvent, for events coming in sorted order
 
       virtual void write(int, Xml&, bool isCopy = false, bool forceWavePaths = false) const;
       
@@ -159,16 +163,30 @@ class MidiPart : public Part {
 
 class WavePart : public Part {
 
-      // p3.3.31
+      // Per event state of the prefetch thread: sample rate
+      //  converters and read positions in the files.
+      struct EventReader {
+            SndFileReader* reader;
+            unsigned cycle;         // the last fetch that read through it
+            };
       AudioConvertMap _converters;
+      std::map<EventBase*, EventReader> _readers;
+      unsigned _cycle;
 
    public:
       WavePart(WaveTrack* t);
-      virtual ~WavePart() {}
+      virtual ~WavePart();
       virtual WavePart* duplicate() const;
       virtual WavePart* duplicateEmpty() const;
       virtual WavePart* createNewClone() const;
 
+      AudioConverter* converter(EventBase* eb) { return _converters.converter(eb); }
+      void remapConverters()                   { _converters.remapEvents(&events()); }
+      SndFileReader* reader(EventBase*, const SndFileR&);
+      void releaseReader(EventBase*);
+      void releaseReaders();
+      void releaseUnread();
+
       WaveTrack* track() const   { return (WaveTrack*)Part::track(); }
       // Returns combination of HiddenEventsType enum.
       int hasHiddenEvents() const;
@@ -24,11 +24,13 @@
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <assert.h>
 #include <dlfcn.h>
 #include <cmath>
 #include <string>
 #include <math.h>
 #include <sys/stat.h>
+#include <time.h>
 
 //#include <QButtonGroup>
 //#include <QCheckBox>
@@ -73,6 +75,9 @@
 #include "fastlog.h"
 #include "checkbox.h"
 #include "verticalmeter.h"
+#include "pluginpool.h"
+#include "pluginscan.h"
+#include "pluginbridge.h"
 //#include "popupmenu.h"
 //#include "menutitleitem.h"
 #ifdef LV2_SUPPORT
@@ -640,6 +645,7 @@ Plugin::Plugin(QFileInfo* f, const LADSPA_Descriptor* d, bool isDssi, bool isDss
   _isDssiSynth = isDssiSynth;
   _isLV2Plugin = false;
   _isLV2Synth = false;
+  _isBridged = false;
 
   #ifdef DSSI_SUPPORT
   dssi_descr = NULL;
@@ -927,90 +933,60 @@ CtrlList::Mode Plugin::ctrlMode(unsigned long i) const
 
 //---------------------------------------------------------
 //   loadPluginLib
+//   The descriptors come from the plugin scan cache, the
+//    library is only loaded if it is new or has changed.
 //---------------------------------------------------------
 
 static void loadPluginLib(QFileInfo* fi)
 {
-  void* handle = dlopen(fi->filePath().toLatin1().constData(), RTLD_NOW);
-  if (handle == 0) {
-        fprintf(stderr, "dlopen(%s) failed: %s\n",
-           fi->filePath().toLatin1().constData(), dlerror());
+  PluginScanLib* lib = MusEGlobal::pluginScanCache.lib(*fi);
+  if (lib == 0)
         return;
-        }
 
-  #ifdef DSSI_SUPPORT
-  DSSI_Descriptor_Function dssi = (DSSI_Descriptor_Function)dlsym(handle, "dssi_descriptor");
-  if(dssi)
+  for (std::vector<PluginScanInfo>::iterator i = lib->plugins.begin(); i != lib->plugins.end(); ++i)
   {
-    const DSSI_Descriptor* descr;
-    for (unsigned long i = 0;; ++i)
+    // Make sure it doesn't already exist.
+    if(MusEGlobal::plugins.find(fi->completeBaseName(), QString(i->label)) != 0)
+      continue;
+
+    // Run in a child process.
+    if(BridgedPlugin::bridged(*fi))
     {
-      descr = dssi(i);
-      if (descr == 0)
-            break;
+      if(MusEGlobal::debugMsg)
+        fprintf(stderr, "loadPluginLib: adding bridged plugin:%s label:%s\n", fi->filePath().toLatin1().constData(), i->label.constData());
+      MusEGlobal::plugins.push_back(new BridgedPlugin(fi, *i));
+      continue;
+    }
 
-      // Make sure it doesn't already exist.
-      if(MusEGlobal::plugins.find(fi->completeBaseName(), QString(descr->LADSPA_Plugin->Label)) != 0)
-        continue;
+    const LADSPA_Descriptor* descr = i->descriptor();
 
+    #ifdef DSSI_SUPPORT
+    if(i->isDssi)
+    {
       #ifdef PLUGIN_DEBUGIN
-      fprintf(stderr, "loadPluginLib: dssi effect name:%s inPlaceBroken:%d\n", descr->LADSPA_Plugin->Name, LADSPA_IS_INPLACE_BROKEN(descr->LADSPA_Plugin->Properties));
+      fprintf(stderr, "loadPluginLib: dssi effect name:%s inPlaceBroken:%d\n", descr->Name, LADSPA_IS_INPLACE_BROKEN(descr->Properties));
       #endif
 
-      bool is_synth = descr->run_synth || descr->run_synth_adding
-                  || descr->run_multiple_synths || descr->run_multiple_synths_adding;
       if(MusEGlobal::debugMsg)
         fprintf(stderr, "loadPluginLib: adding dssi effect plugin:%s name:%s label:%s synth:%d\n",
                 fi->filePath().toLatin1().constData(),
-                descr->LADSPA_Plugin->Name, descr->LADSPA_Plugin->Label,
-                is_synth
+                descr->Name, descr->Label,
+                i->isDssiSynth
                 );
 
-      MusEGlobal::plugins.add(fi, descr->LADSPA_Plugin, true, is_synth);
-    }
-  }
-  else
-  #endif
-  {
-    LADSPA_Descriptor_Function ladspa = (LADSPA_Descriptor_Function)dlsym(handle, "ladspa_descriptor");
-    if(!ladspa)
-    {
-      const char *txt = dlerror();
-      if(txt)
-      {
-        fprintf(stderr,
-              "Unable to find ladspa_descriptor() function in plugin "
-              "library file \"%s\": %s.\n"
-              "Are you sure this is a LADSPA plugin file?\n",
-              fi->filePath().toLatin1().constData(),
-              txt);
-      }
-      dlclose(handle);
-      return;
+      MusEGlobal::plugins.add(fi, descr, true, i->isDssiSynth);
+      continue;
     }
+    #endif
 
-    const LADSPA_Descriptor* descr;
-    for (unsigned long i = 0;; ++i)
-    {
-      descr = ladspa(i);
-      if (descr == NULL)
-            break;
-
-      // Make sure it doesn't already exist.
-      if(MusEGlobal::plugins.find(fi->completeBaseName(), QString(descr->Label)) != 0)
-        continue;
-
-      #ifdef PLUGIN_DEBUGIN
-      fprintf(stderr, "loadPluginLib: ladspa effect name:%s inPlaceBroken:%d\n", descr->Name, LADSPA_IS_INPLACE_BROKEN(descr->Properties));
-      #endif
+    #ifdef PLUGIN_DEBUGIN
+    fprintf(stderr, "loadPluginLib: ladspa effect name:%s inPlaceBroken:%d\n", descr->Name, LADSPA_IS_INPLACE_BROKEN(descr->Properties));
+    #endif
 
-      if(MusEGlobal::debugMsg)
-        fprintf(stderr, "loadPluginLib: adding ladspa plugin:%s name:%s label:%s\n", fi->filePath().toLatin1().constData(), descr->Name, descr->Label);
-      MusEGlobal::plugins.add(fi, descr);
-    }
+    if(MusEGlobal::debugMsg)
+      fprintf(stderr, "loadPluginLib: adding ladspa plugin:%s name:%s label:%s\n", fi->filePath().toLatin1().constData(), descr->Name, descr->Label);
+    MusEGlobal::plugins.add(fi, descr);
   }
-
-  dlclose(handle);
 }
 
 //---------------------------------------------------------
@@ -1165,6 +1141,7 @@ Pipeline::Pipeline()
       for(int i = 0; i < MAX_CHANNELS; ++i)
         buffer[i] = NULL;
       initBuffers();
+      initPlan();
 
       for (int i = 0; i < PipelineDepth; ++i)
             push_back(0);
@@ -1180,6 +1157,7 @@ Pipeline::Pipeline(const Pipeline& p, AudioTrack* t)
       for(int i = 0; i < MAX_CHANNELS; ++i)
         buffer[i] = NULL;
       initBuffers();
+      initPlan();
 
       for(int i = 0; i < PipelineDepth; ++i)
       {
@@ -1190,7 +1168,8 @@ Pipeline::Pipeline(const Pipeline& p, AudioTrack* t)
           if(pl)
           {
             PluginI* new_pl = new PluginI();
-            if(new_pl->initPluginInstance(pl, t->channels())) {
+            // Handles are created by the plugin pool, a failure takes the copy out of the rack.
+            if(new_pl->initPluginInstance(pl, t->channels(), true)) {
                   fprintf(stderr, "cannot instantiate plugin <%s>\n",
                       pl->name().toLatin1().constData());
                   delete new_pl;
@@ -1247,6 +1226,111 @@ void Pipeline::initBuffers()
   }
 }
 
+//---------------------------------------------------------
+//   initPlan
+//---------------------------------------------------------
+
+void Pipeline::initPlan()
+{
+  for(int i = 0; i < PipelineDepth; ++i)
+  {
+    _plan[i].mode        = PlanSkip;
+    _plan[i].internalIn  = false;
+    _plan[i].internalOut = false;
+    _slotLoad[i]         = 0.0;
+  }
+  _planCopy = false;
+  invalidatePlan();
+}
+
+//---------------------------------------------------------
+//   planKey
+//   Two bits per slot: empty, bypassed, on and in-place capable,
+//    on and replacing. Plugins still being instantiated in the
+//    background count as empty. Above those one bit per slot:
+//    the plugin writes all ports output channels, so it may
+//    be run replacing instead of in place. Cheap enough to
+//    check every cycle, so plugins switched on/off or moved
+//    behind our back (gui bypass button, song loading) and
+//    channel changes are picked up too.
+//---------------------------------------------------------
+
+unsigned Pipeline::planKey(unsigned long ports) const
+{
+  unsigned key = 0;
+  for(int i = 0; i < PipelineDepth; ++i)
+  {
+    const PluginI* p = (*this)[i];
+    unsigned st = 0;
+    if(p && p->instancesReady())
+    {
+      st = !p->on() ? 1 : (p->inPlaceCapable() ? 2 : 3);
+      if(p->outputsCover(ports))
+        key |= 1u << (PipelineDepth * 2 + i);
+    }
+    key |= st << (i * 2);
+  }
+  return key;
+}
+
+//---------------------------------------------------------
+//   updatePlan
+//   Assign input and output buffers to all running slots so that
+//    the result ends up in the caller's buffer. Each replacing
+//    plugin flips between the caller's buffer and our own. With an
+//    odd number of flips one in-place capable plugin is run
+//    replacing instead, which removes the trailing copy. Only if
+//    there is no such plugin the copy is still needed. That
+//    plugin must write every channel: in place, the channels a
+//    plugin with fewer outputs (a meter, an analyzer) leaves
+//    alone pass through, run replacing they would keep the
+//    data of the last cycle.
+//---------------------------------------------------------
+
+void Pipeline::updatePlan(unsigned key)
+{
+  int flips = 0;
+  int firstInPlace = -1;
+  for(int i = 0; i < PipelineDepth; ++i)
+  {
+    const unsigned st = (key >> (i * 2)) & 3;
+    const bool covers = key & (1u << (PipelineDepth * 2 + i));
+    if(st == 3)
+      ++flips;
+    else if(st == 2 && covers && firstInPlace == -1)
+      firstInPlace = i;
+  }
+  const int extraFlip = (flips & 1) ? firstInPlace : -1;
+
+  bool internal = false;
+  for(int i = 0; i < PipelineDepth; ++i)
+  {
+    const unsigned st = (key >> (i * 2)) & 3;
+    SlotPlan& sp = _plan[i];
+    switch(st)
+    {
+      case 0:
+        sp.mode = PlanSkip;
+        sp.internalIn = sp.internalOut = false;
+      break;
+      case 1:
+        sp.mode = PlanControls;
+        sp.internalIn = sp.internalOut = false;
+        _slotLoad[i] = 0.0;
+      break;
+      default:
+        sp.mode = PlanRun;
+        sp.internalIn = internal;
+        if(st == 3 || i == extraFlip)
+          internal = !internal;
+        sp.internalOut = internal;
+      break;
+    }
+  }
+  _planCopy = internal;
+  _planKey  = key;
+}
+
 //---------------------------------------------------------
 //   addScheduledControlEvent
 //   track_ctrl_id is the fully qualified track audio controller number
@@ -1332,6 +1416,7 @@ void Pipeline::insert(PluginI* plugin, int index)
       {
       remove(index);
       (*this)[index] = plugin;
+      invalidatePlan();
       }
 
 //---------------------------------------------------------
@@ -1344,6 +1429,27 @@ void Pipeline::remove(int index)
       if (plugin)
             delete plugin;
       (*this)[index] = 0;
+      invalidatePlan();
+      }
+
+//---------------------------------------------------------
+//   cancelJobs
+//    Gui thread. Settles the background instantiation of
+//    the plugin in slot idx, or of all slots if idx is -1,
+//    before they are deleted, maybe by the audio thread.
+//---------------------------------------------------------
+
+void Pipeline::cancelJobs(int idx)
+      {
+      if (!MusEGlobal::pluginPool)
+            return;
+      for (int i = 0; i < PipelineDepth; ++i) {
+            if (idx != -1 && i != idx)
+                  continue;
+            PluginI* plugin = (*this)[i];
+            if (plugin)
+                  MusEGlobal::pluginPool->cancel(plugin);
+            }
       }
 
 //---------------------------------------------------------
@@ -1379,6 +1485,7 @@ void Pipeline::setOn(int idx, bool flag)
             p->setOn(flag);
             if (p->gui())
                   p->gui()->setOn(flag);
+            invalidatePlan();
             }
       }
 
@@ -1406,6 +1513,16 @@ QString Pipeline::name(int idx) const
       return QString("empty");
       }
 
+//---------------------------------------------------------
+//   bridgeRoundTrip
+//---------------------------------------------------------
+
+bool Pipeline::bridgeRoundTrip(int idx, float* avg, float* max) const
+      {
+      PluginI* p = (*this)[idx];
+      return p && p->bridgeRoundTrip(avg, max);
+      }
+
 //---------------------------------------------------------
 //   empty
 //---------------------------------------------------------
@@ -1455,6 +1572,7 @@ void Pipeline::move(int idx, bool up)
               MusEGlobal::audio->msgSwapControllerIDX(p1->track(), idx, idx + 1);
             }
       }
+      invalidatePlan();
 }
 
 //---------------------------------------------------------
@@ -1599,38 +1717,46 @@ bool Pipeline::nativeGuiVisible(int idx)
 
 void Pipeline::apply(unsigned pos, unsigned long ports, unsigned long nframes, float** buffer1)
 {
-      bool swap = false;
+      const unsigned key = planKey(ports);
+      if (key != _planKey)
+            updatePlan(key);
+
+      // Period length in nanoseconds, for the per-slot load.
+      const double period = double(nframes) * 1.0e9 / double(MusEGlobal::sampleRate);
 
-      for (iPluginI ip = begin(); ip != end(); ++ip) {
-            PluginI* p = *ip;
+      for (int i = 0; i < PipelineDepth; ++i) {
+            const SlotPlan& sp = _plan[i];
+            if (sp.mode == PlanSkip)
+                  continue;
+            PluginI* p = (*this)[i];
 
-            if(p)
+            if (sp.mode == PlanControls)
             {
-              if (p->on())
-              {
-                if (p->inPlaceCapable())
-                {
-                      if (swap)
-                            p->apply(pos, nframes, ports, buffer, buffer);
-                      else
-                            p->apply(pos, nframes, ports, buffer1, buffer1);
-                }
-                else
-                {
-                      if (swap)
-                            p->apply(pos, nframes, ports, buffer, buffer1);
-                      else
-                            p->apply(pos, nframes, ports, buffer1, buffer);
-                      swap = !swap;
-                }
-              }
-              else
-              {
-                p->apply(pos, nframes, 0, 0, 0); // Do not process (run) audio, process controllers only.
-              }
+                  // Bypassed. Do not process (run) audio, process controllers only,
+                  //  and only if there is anything scheduled.
+                  if (p->controlEventsPending())
+                        p->apply(pos, nframes, 0, 0, 0);
+                  continue;
+            }
+
+            if (ports == 0)
+            {
+                  p->apply(pos, nframes, 0, 0, 0);
+                  continue;
             }
+
+            struct timespec t0, t1;
+            clock_gettime(CLOCK_MONOTONIC, &t0);
+            p->apply(pos, nframes, ports,
+               sp.internalIn  ? buffer : buffer1,
+               sp.internalOut ? buffer : buffer1);
+            clock_gettime(CLOCK_MONOTONIC, &t1);
+
+            const double ns = double(t1.tv_sec - t0.tv_sec) * 1.0e9 + double(t1.tv_nsec - t0.tv_nsec);
+            const float load = period > 0.0 ? float(ns * 100.0 / period) : 0.0;
+            _slotLoad[i] += (load - _slotLoad[i]) * 0.1;
       }
-      if (ports != 0 && swap)
+      if (ports != 0 && _planCopy)
       {
             for (unsigned long i = 0; i < ports; ++i)
                   AL::dsp->cpy(buffer1[i], buffer[i], nframes);
@@ -1768,6 +1894,8 @@ void PluginI::init()
       _on               = true;
       initControlValues = false;
       _showNativeGuiPending = false;
+      _instancesFailed  = false;
+      _instancesReady   = 0;
       }
 
 PluginI::PluginI()
@@ -1784,6 +1912,10 @@ PluginI::PluginI()
 
 PluginI::~PluginI()
       {
+      // May run in the audio thread. The job was settled in the
+      //  gui thread before, see Pipeline::cancelJobs().
+      assert(!MusEGlobal::pluginPool || !MusEGlobal::pluginPool->hasJob(this));
+
       #ifdef OSC_SUPPORT
       _oscif.oscSetPluginI(NULL);
       #endif
@@ -1828,6 +1960,9 @@ void PluginI::updateControllers()
 
 void PluginI::setChannels(int c)
 {
+      if (!instancesReady() && MusEGlobal::pluginPool)
+            MusEGlobal::pluginPool->finish(this);
+
       channel = c;
 
       unsigned long ins = _plugin->inports();
@@ -1912,6 +2047,17 @@ void PluginI::setCustomData(const std::vector<QString> &customParams)
 {
    if(_plugin == NULL)
       return;
+   if(!instancesReady())
+   {
+      // Handles still being created in the background. Apply in finishInstances().
+      _pendingCustomData.push_back(customParams);
+      return;
+   }
+   applyCustomData(customParams);
+}
+
+void PluginI::applyCustomData(const std::vector<QString> &customParams)
+{
    if(!_plugin->isLV2Plugin()) //now only do it for lv2 plugs
       return;
 #ifdef LV2_SUPPORT
@@ -1940,9 +2086,12 @@ LADSPA_Handle Plugin::instantiate(PluginI *)
 //---------------------------------------------------------
 //   initPluginInstance
 //    return true on error
+//    With async the plugin handles are created by the plugin
+//     pool in the background. The controls can be set up right
+//     away, but the instance must not run until instancesReady().
 //---------------------------------------------------------
 
-bool PluginI::initPluginInstance(Plugin* plug, int c)
+bool PluginI::initPluginInstance(Plugin* plug, int c, bool async)
       {
       channel = c;
       if(plug == 0)
@@ -1985,17 +2134,6 @@ bool PluginI::initPluginInstance(Plugin* plug, int c)
       for(int i = 0; i < instances; ++i)
         handle[i]=NULL;
 
-      for(int i = 0; i < instances; ++i)
-      {
-        #ifdef PLUGIN_DEBUGIN
-        fprintf(stderr, "PluginI::initPluginInstance instance:%d\n", i);
-        #endif
-
-        handle[i] = _plugin->instantiate(this);
-        if(handle[i] == NULL)
-          return true;
-      }
-
       unsigned long ports = _plugin->ports();
 
       controlPorts = 0;
@@ -2031,8 +2169,6 @@ bool PluginI::initPluginInstance(Plugin* plug, int c)
             controls[curPort].val    = val;
             controls[curPort].tmpVal = val;
             controls[curPort].enCtrl  = true;
-            for(int i = 0; i < instances; ++i)
-              _plugin->connectPort(handle[i], k, &controls[curPort].val);
             ++curPort;
           }
           else
@@ -2042,16 +2178,141 @@ bool PluginI::initPluginInstance(Plugin* plug, int c)
             controlsOut[curOutPort].val     = 0.0;
             controlsOut[curOutPort].tmpVal  = 0.0;
             controlsOut[curOutPort].enCtrl  = false;
+            ++curOutPort;
+          }
+        }
+      }
+
+      if(async && MusEGlobal::pluginPool)
+      {
+        MusEGlobal::pluginPool->schedule(this);
+        return false;
+      }
+
+      if(createInstances())
+        return true;
+      if(MusEGlobal::pluginPool)
+        MusEGlobal::pluginPool->noteUsed(_plugin);
+      finishInstances();
+      return false;
+      }
+
+//---------------------------------------------------------
+//   createInstances
+//    Instantiate, connect the control ports and activate
+//     all plugin handles. Called from the plugin pool's
+//     worker threads for background instantiation, so it
+//     must not touch anything but this instance.
+//    return true on error
+//---------------------------------------------------------
+
+bool PluginI::createInstances()
+      {
+      for(int i = 0; i < instances; ++i)
+      {
+        #ifdef PLUGIN_DEBUGIN
+        fprintf(stderr, "PluginI::createInstances instance:%d\n", i);
+        #endif
+
+        handle[i] = MusEGlobal::pluginPool ? MusEGlobal::pluginPool->takeWarm(_plugin) : NULL;
+        if(handle[i] == NULL)
+          handle[i] = _plugin->instantiate(this);
+        if(handle[i] == NULL)
+        {
+          _instancesFailed = true;
+          return true;
+        }
+      }
+
+      unsigned long ports = _plugin->ports();
+      unsigned long curPort = 0;
+      unsigned long curOutPort = 0;
+      for(unsigned long k = 0; k < ports; ++k)
+      {
+        LADSPA_PortDescriptor pd = _plugin->portd(k);
+        if(pd & LADSPA_PORT_CONTROL)
+        {
+          if(pd & LADSPA_PORT_INPUT)
+          {
+            for(int i = 0; i < instances; ++i)
+              _plugin->connectPort(handle[i], k, &controls[curPort].val);
+            ++curPort;
+          }
+          else
+          if(pd & LADSPA_PORT_OUTPUT)
+          {
             for(int i = 0; i < instances; ++i)
               _plugin->connectPort(handle[i], k, &controlsOut[curOutPort].val);
             ++curOutPort;
           }
         }
       }
-      activate();
+      for (int i = 0; i < instances; ++i)
+            _plugin->activate(handle[i]);
       return false;
       }
 
+//---------------------------------------------------------
+//   finishInstances
+//    Called in the gui thread once the handles exist.
+//    Syncs the control values, applies any custom data
+//     read while the handles were still being created and
+//     lets the audio thread run the instance.
+//---------------------------------------------------------
+
+void PluginI::finishInstances()
+      {
+      if (_instancesFailed) {
+            fprintf(stderr, "PluginI::finishInstances: cannot instantiate plugin <%s>\n",
+               _name.toLatin1().constData());
+            _pendingCustomData.clear();
+            if (MusEGlobal::pluginPool)
+                  MusEGlobal::pluginPool->failed(this);
+            return;
+            }
+      syncControls();
+      for (std::vector< std::vector<QString> >::const_iterator i = _pendingCustomData.begin();
+         i != _pendingCustomData.end(); ++i)
+            applyCustomData(*i);
+      _pendingCustomData.clear();
+      _instancesReady.storeRelease(1);
+      }
+
+//---------------------------------------------------------
+//   bridgeRoundTrip
+//    Round trip time of a bridged plugin in microseconds,
+//     summed over its instances.
+//    return false if not bridged or disabled
+//---------------------------------------------------------
+
+bool PluginI::bridgeRoundTrip(float* avg, float* max) const
+      {
+      if (!_plugin || !_plugin->isBridged() || !instancesReady())
+            return false;
+      *avg = *max = 0.0;
+      for (int i = 0; i < instances; ++i) {
+            float a, m;
+            if (!BridgedPlugin::roundTrip(handle[i], &a, &m))
+                  return false;
+            *avg += a;
+            *max += m;
+            }
+      return true;
+      }
+
+//---------------------------------------------------------
+//   waitInstances
+//    Wait for handles still being created in the background.
+//    return false if the instance has no handles
+//---------------------------------------------------------
+
+bool PluginI::waitInstances()
+      {
+      if (!instancesReady() && MusEGlobal::pluginPool)
+            MusEGlobal::pluginPool->finish(this);
+      return instancesReady();
+      }
+
 //---------------------------------------------------------
 //   connect
 //---------------------------------------------------------
@@ -2085,8 +2346,11 @@ void PluginI::connect(unsigned long ports, unsigned long offset, float** src, fl
 void PluginI::deactivate()
       {
       for (int i = 0; i < instances; ++i) {
+            if (!handle[i])
+                  continue;
             _plugin->deactivate(handle[i]);
             _plugin->cleanup(handle[i]);
+            handle[i] = NULL;
             }
       }
 
@@ -2098,6 +2362,15 @@ void PluginI::activate()
       {
       for (int i = 0; i < instances; ++i)
             _plugin->activate(handle[i]);
+      syncControls();
+      }
+
+//---------------------------------------------------------
+//   syncControls
+//---------------------------------------------------------
+
+void PluginI::syncControls()
+      {
       if (initControlValues) {
             for (unsigned long i = 0; i < controlPorts; ++i) {
                   controls[i].val = controls[i].tmpVal;
@@ -2135,6 +2408,9 @@ bool PluginI::setControl(const QString& s, float val)
 
 void PluginI::writeConfiguration(int level, Xml& xml)
       {
+      // A plugin which failed to instantiate is dropped from the song.
+      if (!waitInstances())
+            return;
       xml.tag(level++, "plugin file=\"%s\" label=\"%s\" channel=\"%d\"",
          Xml::xmlString(_plugin->lib()).toLatin1().constData(), Xml::xmlString(_plugin->label()).toLatin1().constData(), channel);
 #ifdef LV2_SUPPORT
@@ -2246,6 +2522,9 @@ bool PluginI::readConfiguration(Xml& xml, bool readPreset)
             switch (token) {
                   case Xml::Error:
                   case Xml::End:
+                        // The caller deletes us.
+                        if (MusEGlobal::pluginPool)
+                              MusEGlobal::pluginPool->cancel(this);
                         return true;
                   case Xml::TagStart:
                         if (!readPreset && _plugin == 0) {
@@ -2253,7 +2532,9 @@ bool PluginI::readConfiguration(Xml& xml, bool readPreset)
 
                               if (_plugin)
                               {
-                                 if(initPluginInstance(_plugin, channel)) {
+                                 // Song loading: let the plugin pool create the handles in the
+                                 //  background. Song reading waits for them with finishAll().
+                                 if(initPluginInstance(_plugin, channel, !readPreset)) {
                                     _plugin = 0;
                                     xml.parse1();
                                     printf("Error initializing plugin instance (%s, %s)\n",
@@ -2338,7 +2619,7 @@ bool PluginI::readConfiguration(Xml& xml, bool readPreset)
                                       return true;
                                     }
 
-                                    if (initPluginInstance(_plugin, channel))
+                                    if (initPluginInstance(_plugin, channel, true))
                                     {
                                       printf("Error initializing plugin instance (%s, %s)\n",
                                         file.toLatin1().constData(), label.toLatin1().constData());
@@ -2404,6 +2685,8 @@ bool PluginI::guiVisible()
 
 void PluginI::showNativeGui()
 {
+  if(!waitInstances())
+    return;
 
 #ifdef LV2_SUPPORT
   if(plugin() && plugin()->isLV2Plugin())
@@ -2429,6 +2712,8 @@ void PluginI::showNativeGui()
 
 void PluginI::showNativeGui(bool flag)
 {
+  if(!instancesReady() && (!flag || !waitInstances()))
+    return;
 #ifdef LV2_SUPPORT
   if(plugin() && plugin()->isLV2Plugin())
   {
@@ -2451,6 +2736,8 @@ void PluginI::showNativeGui(bool flag)
 
 bool PluginI::nativeGuiVisible()
 {
+  if(!instancesReady())
+    return false;
 #ifdef LV2_SUPPORT
     if(plugin() && plugin()->isLV2Plugin())
       return ((LV2PluginWrapper *)plugin())->nativeGuiVisible(this);
@@ -2795,7 +3082,7 @@ int Plugin::oscConfigure(LADSPA_Handle handle, const char* key, const char* valu
 
 int PluginI::oscConfigure(const char *key, const char *value)
       {
-      if(!_plugin)
+      if(!_plugin || !waitInstances())
         return 0;
 
       // This is pretty much the simplest legal implementation of
@@ -37,6 +37,7 @@
 #include <QFileInfo>
 #include <QMainWindow>
 #include <QUiLoader>
+#include <QAtomicInt>
 
 
 #include <ladspa.h>
@@ -104,6 +105,7 @@ class Plugin {
       bool _isLV2Plugin;
       // Hack: Special flag required.
       bool _isDssiVst;
+      bool _isBridged;
 
       #ifdef DSSI_SUPPORT
       const DSSI_Descriptor* dssi_descr;
@@ -119,7 +121,7 @@ class Plugin {
       bool _inPlaceCapable;
 
    public:
-      Plugin() {} //empty constructor for LV2PluginWrapper
+      Plugin() : _isBridged(false) {} //empty constructor for LV2PluginWrapper
       Plugin(QFileInfo* f, const LADSPA_Descriptor* d, bool isDssi = false, bool isDssiSynth = false);
       virtual ~Plugin();
       virtual QString label() const                        { return _label; }
@@ -139,6 +141,8 @@ class Plugin {
       bool isDssiSynth() const  { return _isDssiSynth; }
       inline bool isLV2Plugin() const { return _isLV2Plugin; } //inline it to use in RT audio thread
       bool isLV2Synth() const { return _isLV2Synth; }
+      bool isDssiVst() const { return _isDssiVst; }
+      bool isBridged() const { return _isBridged; }
 
       virtual LADSPA_Handle instantiate(PluginI *);
       virtual void activate(LADSPA_Handle handle) {
@@ -300,6 +304,7 @@ class PluginIBase
 
       MusEGui::PluginGui* gui() const { return _gui; }
       void deleteGui();
+      bool controlEventsPending() const { return !_controlFifo.isEmpty(); }
 };
 
 //---------------------------------------------------------
@@ -333,12 +338,18 @@ class PluginI : public PluginIBase {
       QString _name;
       QString _label;
 
+      QAtomicInt _instancesReady;   // handles created and activated, audio may run us
+      bool _instancesFailed;
+      std::vector< std::vector<QString> > _pendingCustomData;  // custom data read before the handles existed
+
       #ifdef OSC_SUPPORT
       OscEffectIF _oscif;
       #endif
       bool _showNativeGuiPending;
 
       void init();
+      void syncControls();
+      void applyCustomData(const std::vector<QString>& customParams);
 
    public:
       PluginI();
@@ -355,7 +366,13 @@ class PluginI : public PluginIBase {
       int id()                      { return _id; }
       void updateControllers();
 
-      bool initPluginInstance(Plugin*, int channels);
+      bool initPluginInstance(Plugin*, int channels, bool async = false);
+      bool createInstances();
+      void finishInstances();
+      bool instancesReady() const { return _instancesReady.loadAcquire() != 0; }
+      bool instancesFailed() const { return _instancesFailed; }
+      bool waitInstances();
+      bool bridgeRoundTrip(float* avg, float* max) const;
       void setChannels(int);
       void connect(unsigned long ports, unsigned long offset, float** src, float** dst);
       void apply(unsigned pos, unsigned long n, unsigned long ports, float** bufIn, float** bufOut);
@@ -412,6 +429,8 @@ class PluginI : public PluginIBase {
       LADSPA_PortRangeHint range(unsigned long i) { return _plugin->range(controls[i].idx); }
       LADSPA_PortRangeHint rangeOut(unsigned long i) { return _plugin->range(controlsOut[i].idx); }
       inline bool inPlaceCapable() const { return _plugin->inPlaceCapable(); }
+      // Whether running it writes all of ports output channels.
+      bool outputsCover(unsigned long ports) const { return _plugin->outports() * instances >= ports; }
       CtrlValueType ctrlValueType(unsigned long i) const { return _plugin->ctrlValueType(controls[i].idx); }
       CtrlList::Mode ctrlMode(unsigned long i) const { return _plugin->ctrlMode(controls[i].idx); }
       virtual void setCustomData(const std::vector<QString> &customParams);
@@ -424,8 +443,25 @@ class PluginI : public PluginIBase {
 
 class Pipeline : public std::vector<PluginI*> {
    private:
+      enum { PlanSkip = 0, PlanControls, PlanRun };
+
+      // Precomputed buffer assignment of one rack slot.
+      struct SlotPlan {
+            int  mode;           // PlanSkip, PlanControls or PlanRun
+            bool internalIn;     // read from our own buffer instead of the caller's
+            bool internalOut;    // write to our own buffer instead of the caller's
+            };
+
       float* buffer[MAX_CHANNELS];
+      SlotPlan _plan[PipelineDepth];
+      unsigned _planKey;         // slot states the plan was made for
+      bool _planCopy;            // result ends in our own buffer, copy back needed
+      float _slotLoad[PipelineDepth];
+
       void initBuffers();
+      void initPlan();
+      unsigned planKey(unsigned long ports) const;
+      void updatePlan(unsigned key);
    public:
       Pipeline();
       Pipeline(const Pipeline&, AudioTrack*);
@@ -433,6 +469,7 @@ class Pipeline : public std::vector<PluginI*> {
       void insert(PluginI* p, int index);
       void remove(int index);
       void removeAll();
+      void cancelJobs(int idx = -1);
       bool isOn(int idx) const;
       void setOn(int, bool);
       QString label(int idx) const;
@@ -453,6 +490,9 @@ class Pipeline : public std::vector<PluginI*> {
       bool addScheduledControlEvent(int track_ctrl_id, float val, unsigned frame); // returns true if event cannot be delivered
       void enableController(int track_ctrl_id, bool en);
       bool controllerEnabled(int track_ctrl_id);
+      void invalidatePlan()  { _planKey = ~0u; }
+      float cpuLoad(int idx) const { return _slotLoad[idx]; }
+      bool bridgeRoundTrip(int idx, float* avg, float* max) const;
       };
 
 typedef Pipeline::iterator iPluginI;
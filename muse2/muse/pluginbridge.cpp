@@ -0,0 +1,791 @@
+//=========================================================
+//  MusE
+//  Linux Music Editor
+//
+//  pluginbridge.cpp
+//
+//  This program is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU General Public License
+//  as published by the Free Software Foundation; version 2 of
+//  the License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+//
+//=========================================================
+
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <limits.h>
+#include <dlfcn.h>
+#include <fcntl.h>
+#include <sched.h>
+#include <signal.h>
+#include <spawn.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/prctl.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <sys/wait.h>
+#include <linux/futex.h>
+
+#include <list>
+#include <vector>
+
+#include <QFileInfo>
+#include <QMutex>
+#include <QMutexLocker>
+#include <QStringList>
+
+#include "pluginbridge.h"
+#include "globals.h"
+#include "gconfig.h"
+#include "config.h"
+
+#ifdef DSSI_SUPPORT
+#include <dssi.h>
+#endif
+
+extern char** environ;
+
+namespace MusECore {
+
+enum BridgeCommand { BridgeInit, BridgeActivate, BridgeDeactivate, BridgeRun, BridgeQuit };
+
+// Consecutive missed deadlines before a handle is disabled.
+static const int bridgeMaxLate = 3;
+
+// Timeout of all commands but BridgeRun, in milliseconds.
+static const int bridgeCommandTimeout = 5000;
+
+// Share of the period, in percent, all bridged handles together
+//  may wait for their children in one cycle.
+static const int bridgeCycleShare = 75;
+
+// Why a handle was disabled, BridgeInstance::dead.
+enum BridgeDead { BridgeAlive, BridgeCrashed, BridgeNoResponse, BridgeNoActivate, BridgeNoDeactivate };
+
+static const char* const bridgeDeadText[] = {
+      "", "crashed", "does not respond", "did not activate", "did not deactivate"
+      };
+
+// End of the time the bridges may use in this cycle, see startCycle().
+static long long bridgeDeadline = 0;
+
+static QMutex bridgeListLock;
+static std::list<BridgeInstance*> bridgeList;   // for reap()
+
+//---------------------------------------------------------
+//   BridgeShm
+//    Head of the shared memory block. It is followed by
+//    the port descriptors and the port data, see layout().
+//    hostSeq and childSeq are the futex words: the host
+//    posts a command by bumping hostSeq, the child answers
+//    by setting childSeq to the same value.
+//---------------------------------------------------------
+
+struct BridgeShm {
+      int hostSeq;
+      int childSeq;
+      int command;
+      int result;             // 0 ok
+      unsigned nframes;
+      unsigned maxFrames;
+      unsigned sampleRate;
+      unsigned ports;
+      int priority;           // realtime priority for the child, 0 none
+      char lib[PATH_MAX];
+      char label[256];
+      };
+
+//---------------------------------------------------------
+//   BridgeInstance
+//    Host side of one bridged handle.
+//    dead is set by the audio thread or by reap(), whoever
+//    notices first. pid is only reset by reap() and cleanup(),
+//    the child stays a zombie until then.
+//---------------------------------------------------------
+
+struct BridgeInstance {
+      pid_t pid;
+      BridgeShm* shm;
+      size_t shmSize;
+      unsigned long ports;
+      std::vector<LADSPA_PortDescriptor> descr;
+      std::vector<float*> hostPort;   // connected by the PluginI
+      std::vector<float*> shmPort;    // the same port in shared memory
+      int dead;                       // BridgeDead
+      bool reported;                  // dead reported by reap()
+      int late;
+      unsigned long cycles;
+      unsigned long missed;
+      float rtAvg;                    // microseconds
+      float rtMax;
+      QByteArray label;
+
+      BridgeInstance() : pid(0), shm(0), shmSize(0), ports(0), dead(BridgeAlive), reported(false), late(0),
+         cycles(0), missed(0), rtAvg(0.0), rtMax(0.0) {}
+      };
+
+//---------------------------------------------------------
+//   futex helpers
+//    Not private, the words are shared between processes.
+//---------------------------------------------------------
+
+static int futexWait(int* addr, int val, const struct timespec* timeout)
+{
+  return syscall(SYS_futex, addr, FUTEX_WAIT, val, timeout, 0, 0);
+}
+
+static void futexWake(int* addr)
+{
+  syscall(SYS_futex, addr, FUTEX_WAKE, INT_MAX, 0, 0, 0);
+}
+
+static long long nowNs()
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (long long)ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+//---------------------------------------------------------
+//   layout
+//    Offsets of the port data in the shared block. Each port
+//    starts on a cache line. Returns the total size.
+//---------------------------------------------------------
+
+static size_t roundUp(size_t v) { return (v + 63) & ~size_t(63); }
+
+static size_t layout(const LADSPA_PortDescriptor* pd, unsigned long ports, unsigned maxFrames, std::vector<size_t>* offsets)
+{
+  size_t off = roundUp(sizeof(BridgeShm)) + roundUp(ports * sizeof(int));
+  offsets->resize(ports);
+  for(unsigned long k = 0; k < ports; ++k)
+  {
+    (*offsets)[k] = off;
+    off += roundUp((LADSPA_IS_PORT_AUDIO(pd[k]) ? maxFrames : 1) * sizeof(float));
+  }
+  return off;
+}
+
+static int* portTable(BridgeShm* shm)
+{
+  return (int*)((char*)shm + roundUp(sizeof(BridgeShm)));
+}
+
+//---------------------------------------------------------
+//   post
+//    Host side. Post a command and wait up to timeoutNs
+//    for the answer.
+//---------------------------------------------------------
+
+static bool post(BridgeInstance* b, int command, long long timeoutNs)
+{
+  BridgeShm* shm = b->shm;
+  const int seq = shm->hostSeq + 1;
+  shm->command = command;
+  __atomic_store_n(&shm->hostSeq, seq, __ATOMIC_RELEASE);
+  futexWake(&shm->hostSeq);
+
+  const long long deadline = nowNs() + timeoutNs;
+  for(;;)
+  {
+    int cs = __atomic_load_n(&shm->childSeq, __ATOMIC_ACQUIRE);
+    if(cs == seq)
+      return shm->result == 0;
+    long long left = deadline - nowNs();
+    if(left <= 0)
+      return false;
+    struct timespec ts;
+    ts.tv_sec  = left / 1000000000LL;
+    ts.tv_nsec = left % 1000000000LL;
+    futexWait(&shm->childSeq, cs, &ts);
+  }
+}
+
+//---------------------------------------------------------
+//   disable
+//    Any thread, the audio thread too. Only kills the child,
+//    reap() reports it and collects the zombie.
+//---------------------------------------------------------
+
+static bool isDead(const BridgeInstance* b)
+{
+  return __atomic_load_n(&b->dead, __ATOMIC_ACQUIRE) != BridgeAlive;
+}
+
+static void disable(BridgeInstance* b, int why)
+{
+  int alive = BridgeAlive;
+  if(!__atomic_compare_exchange_n(&b->dead, &alive, why, false, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE))
+    return;
+  if(b->pid > 0)
+    kill(b->pid, SIGKILL);
+}
+
+//---------------------------------------------------------
+//   report
+//---------------------------------------------------------
+
+static void report(BridgeInstance* b)
+{
+  if(b->reported || !isDead(b))
+    return;
+  b->reported = true;
+  fprintf(stderr, "PluginBridge: %s %s, disabled\n", b->label.constData(),
+          bridgeDeadText[__atomic_load_n(&b->dead, __ATOMIC_ACQUIRE)]);
+}
+
+//---------------------------------------------------------
+//   BridgedPlugin
+//---------------------------------------------------------
+
+BridgedPlugin::BridgedPlugin(QFileInfo* f, PluginScanInfo& info)
+   : Plugin(f, info.descriptor(), info.isDssi, info.isDssiSynth)
+{
+  _info = info;
+  _isBridged = true;
+  // Port queries (range, default, names) use the cached descriptor.
+  plugin = _info.descriptor();
+
+  unsigned long in_ctrls = 0;
+  for(unsigned long k = 0; k < _portCount; ++k)
+  {
+    LADSPA_PortDescriptor pd = _info.portDescr[k];
+    if(LADSPA_IS_PORT_CONTROL(pd) && LADSPA_IS_PORT_INPUT(pd))
+      rpIdx.push_back(in_ctrls++);
+    else
+      rpIdx.push_back((unsigned long)-1);
+  }
+}
+
+BridgedPlugin::~BridgedPlugin()
+{
+  plugin = NULL;
+}
+
+//---------------------------------------------------------
+//   bridged
+//    Whether the library is listed in config.pluginBridgeLibs
+//    (comma separated base names, "*" for all).
+//---------------------------------------------------------
+
+bool BridgedPlugin::bridged(const QFileInfo& fi)
+{
+  const QString libs = MusEGlobal::config.pluginBridgeLibs.trimmed();
+  if(libs.isEmpty())
+    return false;
+  const QStringList l = libs.split(QChar(','), QString::SkipEmptyParts);
+  for(QStringList::const_iterator i = l.begin(); i != l.end(); ++i)
+  {
+    const QString s = i->trimmed();
+    if(s == QString("*") || s == fi.completeBaseName())
+      return true;
+  }
+  return false;
+}
+
+//---------------------------------------------------------
+//   incReferences
+//    Nothing to load, the library lives in the child.
+//---------------------------------------------------------
+
+int BridgedPlugin::incReferences(int val)
+{
+  _references += val;
+  if(_references < 0)
+    _references = 0;
+  return _references;
+}
+
+//---------------------------------------------------------
+//   instantiate
+//    Create the shared block and start the child.
+//---------------------------------------------------------
+
+LADSPA_Handle BridgedPlugin::instantiate(PluginI*)
+{
+  static int serial = 0;
+  char name[64];
+  snprintf(name, sizeof(name), "/muse-bridge-%d-%d", (int)getpid(),
+           __atomic_add_fetch(&serial, 1, __ATOMIC_RELAXED));
+
+  const unsigned maxFrames = MusEGlobal::segmentSize;
+  std::vector<size_t> offsets;
+  const size_t size = layout(_info.portDescr.empty() ? 0 : &_info.portDescr[0], _portCount, maxFrames, &offsets);
+
+  int fd = shm_open(name, O_CREAT | O_EXCL | O_RDWR, 0600);
+  if(fd == -1)
+  {
+    fprintf(stderr, "PluginBridge: shm_open(%s) failed: %s\n", name, strerror(errno));
+    return 0;
+  }
+  if(ftruncate(fd, size) == -1)
+  {
+    fprintf(stderr, "PluginBridge: ftruncate failed: %s\n", strerror(errno));
+    close(fd);
+    shm_unlink(name);
+    return 0;
+  }
+  void* mem = mmap(0, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  close(fd);
+  if(mem == MAP_FAILED)
+  {
+    fprintf(stderr, "PluginBridge: mmap failed: %s\n", strerror(errno));
+    shm_unlink(name);
+    return 0;
+  }
+
+  BridgeInstance* b = new BridgeInstance;
+  b->shm     = (BridgeShm*)mem;
+  b->shmSize = size;
+  b->ports   = _portCount;
+  b->descr   = _info.portDescr;
+  b->label   = _info.label;
+  b->hostPort.assign(_portCount, (float*)0);
+  b->shmPort.resize(_portCount);
+  for(unsigned long k = 0; k < _portCount; ++k)
+  {
+    b->shmPort[k] = (float*)((char*)mem + offsets[k]);
+    portTable(b->shm)[k] = _info.portDescr[k];
+  }
+
+  BridgeShm* shm = b->shm;
+  shm->hostSeq    = 1;        // BridgeInit is answered when the child is up.
+  shm->childSeq   = 0;
+  shm->command    = BridgeInit;
+  shm->result     = -1;
+  shm->maxFrames  = maxFrames;
+  shm->sampleRate = MusEGlobal::sampleRate;
+  shm->ports      = _portCount;
+  shm->priority   = MusEGlobal::realTimeScheduling ? MusEGlobal::realTimePriority : 0;
+  strncpy(shm->lib, fi.filePath().toLocal8Bit().constData(), sizeof(shm->lib) - 1);
+  strncpy(shm->label, _info.label.constData(), sizeof(shm->label) - 1);
+
+  char arg0[] = "muse";
+  char arg1[] = "--plugin-bridge";
+  char* argv[] = { arg0, arg1, name, 0 };
+  int rv = posix_spawn(&b->pid, "/proc/self/exe", 0, 0, argv, environ);
+  if(rv != 0)
+  {
+    fprintf(stderr, "PluginBridge: cannot start bridge for %s: %s\n", b->label.constData(), strerror(rv));
+    b->pid = 0;
+  }
+
+  bool ok = false;
+  if(b->pid > 0)
+  {
+    const long long deadline = nowNs() + bridgeCommandTimeout * 1000000LL;
+    while(__atomic_load_n(&shm->childSeq, __ATOMIC_ACQUIRE) != 1)
+    {
+      long long left = deadline - nowNs();
+      if(left <= 0 || waitpid(b->pid, 0, WNOHANG) == b->pid)
+        break;
+      struct timespec ts;
+      ts.tv_sec  = 0;
+      ts.tv_nsec = left > 100000000LL ? 100000000LL : left;   // Look after the child now and then.
+      futexWait(&shm->childSeq, 0, &ts);
+    }
+    ok = __atomic_load_n(&shm->childSeq, __ATOMIC_ACQUIRE) == 1 && shm->result == 0;
+  }
+  shm_unlink(name);
+
+  if(!ok)
+  {
+    fprintf(stderr, "PluginBridge: %s failed to start\n", b->label.constData());
+    cleanup(b);
+    return 0;
+  }
+
+  QMutexLocker locker(&bridgeListLock);
+  bridgeList.push_back(b);
+  return b;
+}
+
+//---------------------------------------------------------
+//   activate
+//---------------------------------------------------------
+
+void BridgedPlugin::activate(LADSPA_Handle h)
+{
+  BridgeInstance* b = (BridgeInstance*)h;
+  if(!b || isDead(b))
+    return;
+  b->late = 0;
+  if(!post(b, BridgeActivate, bridgeCommandTimeout * 1000000LL))
+    disable(b, BridgeNoActivate);
+}
+
+//---------------------------------------------------------
+//   deactivate
+//---------------------------------------------------------
+
+void BridgedPlugin::deactivate(LADSPA_Handle h)
+{
+  BridgeInstance* b = (BridgeInstance*)h;
+  if(!b || isDead(b))
+    return;
+  // A late cycle may still be running.
+  if(b->shm->childSeq != b->shm->hostSeq)
+    return;
+  if(!post(b, BridgeDeactivate, bridgeCommandTimeout * 1000000LL))
+    disable(b, BridgeNoDeactivate);
+}
+
+//---------------------------------------------------------
+//   cleanup
+//    Stop the child and report the round trip figures.
+//---------------------------------------------------------
+
+void BridgedPlugin::cleanup(LADSPA_Handle h)
+{
+  BridgeInstance* b = (BridgeInstance*)h;
+  if(!b)
+    return;
+
+  {
+    QMutexLocker locker(&bridgeListLock);
+    bridgeList.remove(b);
+  }
+  report(b);
+  if(b->cycles)
+    fprintf(stderr, "PluginBridge: %s: %lu cycles, round trip avg %.1f us, max %.1f us, %lu missed\n",
+            b->label.constData(), b->cycles, b->rtAvg, b->rtMax, b->missed);
+
+  if(b->pid > 0)
+  {
+    bool quit = false;
+    if(!isDead(b) && b->shm->childSeq == b->shm->hostSeq)
+      quit = post(b, BridgeQuit, bridgeCommandTimeout * 1000000LL);
+    if(!quit)
+      kill(b->pid, SIGKILL);
+    waitpid(b->pid, 0, 0);
+  }
+  if(b->shm)
+    munmap(b->shm, b->shmSize);
+  delete b;
+}
+
+//---------------------------------------------------------
+//   connectPort
+//---------------------------------------------------------
+
+void BridgedPlugin::connectPort(LADSPA_Handle h, unsigned long port, float* value)
+{
+  BridgeInstance* b = (BridgeInstance*)h;
+  if(b && port < b->ports)
+    b->hostPort[port] = value;
+}
+
+//---------------------------------------------------------
+//   passThrough
+//    Output of a disabled or late handle: the n-th audio
+//    output gets the n-th audio input, or silence.
+//---------------------------------------------------------
+
+static void passThrough(BridgeInstance* b, unsigned long n)
+{
+  unsigned long in = 0;
+  for(unsigned long k = 0; k < b->ports; ++k)
+  {
+    LADSPA_PortDescriptor pd = b->descr[k];
+    if(!LADSPA_IS_PORT_AUDIO(pd) || !LADSPA_IS_PORT_OUTPUT(pd) || !b->hostPort[k])
+      continue;
+    const float* src = 0;
+    for(unsigned long i = 0; i < b->ports; ++i)
+    {
+      if(LADSPA_IS_PORT_AUDIO(b->descr[i]) && LADSPA_IS_PORT_INPUT(b->descr[i]) && i >= in)
+      {
+        src = b->hostPort[i];
+        in = i + 1;
+        break;
+      }
+    }
+    if(src == b->hostPort[k])
+      continue;
+    if(src)
+      memcpy(b->hostPort[k], src, n * sizeof(float));
+    else
+      memset(b->hostPort[k], 0, n * sizeof(float));
+  }
+}
+
+//---------------------------------------------------------
+//   startCycle
+//    Audio thread, start of a cycle. All bridged handles
+//    share one deadline, bridgeCycleShare of the period.
+//---------------------------------------------------------
+
+void BridgedPlugin::startCycle()
+{
+  bridgeDeadline = nowNs() + (long long)MusEGlobal::segmentSize * 10000000LL * bridgeCycleShare
+                              / MusEGlobal::sampleRate;
+}
+
+//---------------------------------------------------------
+//   apply
+//    Audio thread. One run in the child, waiting for it at
+//    most until the deadline of the cycle. No system calls
+//    but the futex and kill() for a child which has to go.
+//---------------------------------------------------------
+
+void BridgedPlugin::apply(LADSPA_Handle h, unsigned long n)
+{
+  BridgeInstance* b = (BridgeInstance*)h;
+  if(!b)
+    return;
+  BridgeShm* shm = b->shm;
+
+  if(!isDead(b) && __atomic_load_n(&shm->childSeq, __ATOMIC_ACQUIRE) != shm->hostSeq)
+  {
+    // Still busy with a late cycle. Don't touch its buffers.
+    ++b->missed;
+    if(++b->late >= bridgeMaxLate)
+      disable(b, BridgeNoResponse);
+  }
+  if(isDead(b) || n > shm->maxFrames || __atomic_load_n(&shm->childSeq, __ATOMIC_ACQUIRE) != shm->hostSeq)
+  {
+    passThrough(b, n);
+    return;
+  }
+
+  // The bridges before used up the cycle. Not the fault of this one.
+  const long long t0 = nowNs();
+  if(t0 >= bridgeDeadline)
+  {
+    ++b->missed;
+    passThrough(b, n);
+    return;
+  }
+
+  for(unsigned long k = 0; k < b->ports; ++k)
+  {
+    LADSPA_PortDescriptor pd = b->descr[k];
+    if(!LADSPA_IS_PORT_INPUT(pd) || !b->hostPort[k])
+      continue;
+    memcpy(b->shmPort[k], b->hostPort[k], (LADSPA_IS_PORT_AUDIO(pd) ? n : 1) * sizeof(float));
+  }
+
+  shm->nframes = n;
+  if(!post(b, BridgeRun, bridgeDeadline - t0))
+  {
+    // A crashed child is found by reap(), until then it is just late.
+    ++b->missed;
+    if(++b->late >= bridgeMaxLate)
+      disable(b, BridgeNoResponse);
+    passThrough(b, n);
+    return;
+  }
+  const float rt = float(nowNs() - t0) / 1000.0f;
+  b->late = 0;
+  ++b->cycles;
+  b->rtAvg += (rt - b->rtAvg) * 0.1f;
+  if(rt > b->rtMax)
+    b->rtMax = rt;
+
+  for(unsigned long k = 0; k < b->ports; ++k)
+  {
+    LADSPA_PortDescriptor pd = b->descr[k];
+    if(!LADSPA_IS_PORT_OUTPUT(pd) || !b->hostPort[k])
+      continue;
+    memcpy(b->hostPort[k], b->shmPort[k], (LADSPA_IS_PORT_AUDIO(pd) ? n : 1) * sizeof(float));
+  }
+}
+
+//---------------------------------------------------------
+//   roundTrip
+//---------------------------------------------------------
+
+bool BridgedPlugin::roundTrip(LADSPA_Handle h, float* avg, float* max)
+{
+  BridgeInstance* b = (BridgeInstance*)h;
+  if(!b || isDead(b))
+    return false;
+  *avg = b->rtAvg;
+  *max = b->rtMax;
+  return true;
+}
+
+//---------------------------------------------------------
+//   reap
+//    Gui thread, heartbeat. Disable handles whose child has
+//    died, report disabled handles and collect their
+//    children.
+//---------------------------------------------------------
+
+void BridgedPlugin::reap()
+{
+  QMutexLocker locker(&bridgeListLock);
+  for(std::list<BridgeInstance*>::iterator i = bridgeList.begin(); i != bridgeList.end(); ++i)
+  {
+    BridgeInstance* b = *i;
+    if(b->pid <= 0)
+      continue;
+    if(!isDead(b))
+    {
+      // Look, but leave the zombie: the audio thread may still kill() it.
+      siginfo_t si;
+      si.si_pid = 0;
+      if(waitid(P_PID, b->pid, &si, WEXITED | WNOHANG | WNOWAIT) == 0 && si.si_pid == b->pid)
+        disable(b, BridgeCrashed);
+    }
+    if(isDead(b))
+    {
+      // Collect it a heartbeat after the report, so the kill() of
+      //  the thread which disabled the handle is long done.
+      if(b->reported && waitpid(b->pid, 0, WNOHANG) == b->pid)
+        b->pid = 0;
+      report(b);
+    }
+  }
+}
+
+//---------------------------------------------------------
+//   pluginBridgeMain
+//    The child process. Loads the plugin and runs it on the
+//    shared block until told to quit.
+//---------------------------------------------------------
+
+int pluginBridgeMain(const char* shmName)
+{
+  // Don't outlive MusE.
+  prctl(PR_SET_PDEATHSIG, SIGKILL);
+
+  int fd = shm_open(shmName, O_RDWR, 0);
+  if(fd == -1)
+  {
+    fprintf(stderr, "plugin bridge: shm_open(%s) failed: %s\n", shmName, strerror(errno));
+    return 1;
+  }
+  struct stat st;
+  if(fstat(fd, &st) == -1)
+  {
+    close(fd);
+    return 1;
+  }
+  void* mem = mmap(0, st.st_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  close(fd);
+  if(mem == MAP_FAILED)
+    return 1;
+  BridgeShm* shm = (BridgeShm*)mem;
+
+  const LADSPA_Descriptor* d = 0;
+  void* lib = dlopen(shm->lib, RTLD_NOW);
+  if(lib)
+  {
+    #ifdef DSSI_SUPPORT
+    DSSI_Descriptor_Function dssi = (DSSI_Descriptor_Function)dlsym(lib, "dssi_descriptor");
+    if(dssi)
+    {
+      for(unsigned long i = 0; dssi(i); ++i)
+        if(strcmp(dssi(i)->LADSPA_Plugin->Label, shm->label) == 0)
+        {
+          d = dssi(i)->LADSPA_Plugin;
+          break;
+        }
+    }
+    else
+    #endif
+    {
+      LADSPA_Descriptor_Function ladspa = (LADSPA_Descriptor_Function)dlsym(lib, "ladspa_descriptor");
+      if(ladspa)
+      {
+        for(unsigned long i = 0; ladspa(i); ++i)
+          if(strcmp(ladspa(i)->Label, shm->label) == 0)
+          {
+            d = ladspa(i);
+            break;
+          }
+      }
+    }
+  }
+  else
+    fprintf(stderr, "plugin bridge: dlopen(%s) failed: %s\n", shm->lib, dlerror());
+
+  // The ports must be what MusE has cached.
+  LADSPA_Handle h = 0;
+  if(d && d->PortCount == shm->ports)
+  {
+    bool same = true;
+    for(unsigned long k = 0; k < d->PortCount; ++k)
+      if(portTable(shm)[k] != d->PortDescriptors[k])
+        same = false;
+    if(same)
+      h = d->instantiate(d, shm->sampleRate);
+  }
+
+  if(h)
+  {
+    std::vector<size_t> offsets;
+    layout(d->PortDescriptors, d->PortCount, shm->maxFrames, &offsets);
+    for(unsigned long k = 0; k < d->PortCount; ++k)
+      d->connect_port(h, k, (float*)((char*)mem + offsets[k]));
+
+    if(shm->priority > 0)
+    {
+      struct sched_param sp;
+      memset(&sp, 0, sizeof(sp));
+      sp.sched_priority = shm->priority;
+      sched_setscheduler(0, SCHED_FIFO, &sp);   // Best effort.
+    }
+    mlockall(MCL_CURRENT | MCL_FUTURE);
+  }
+
+  shm->result = h ? 0 : -1;
+  int seen = 1;
+  __atomic_store_n(&shm->childSeq, seen, __ATOMIC_RELEASE);
+  futexWake(&shm->childSeq);
+  if(!h)
+    return 1;
+
+  for(;;)
+  {
+    int hs = __atomic_load_n(&shm->hostSeq, __ATOMIC_ACQUIRE);
+    if(hs == seen)
+    {
+      futexWait(&shm->hostSeq, seen, 0);
+      continue;
+    }
+
+    const int command = shm->command;
+    switch(command)
+    {
+      case BridgeRun:
+        d->run(h, shm->nframes);
+        break;
+      case BridgeActivate:
+        if(d->activate)
+          d->activate(h);
+        break;
+      case BridgeDeactivate:
+        if(d->deactivate)
+          d->deactivate(h);
+        break;
+      case BridgeQuit:
+        if(d->cleanup)
+          d->cleanup(h);
+        break;
+      default:
+        break;
+    }
+    shm->result = 0;
+    seen = hs;
+    __atomic_store_n(&shm->childSeq, seen, __ATOMIC_RELEASE);
+    futexWake(&shm->childSeq);
+    if(command == BridgeQuit)
+      break;
+  }
+  return 0;
+}
+
+} // namespace MusECore
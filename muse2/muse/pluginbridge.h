@@ -0,0 +1,78 @@
+//=========================================================
+//  MusE
+//  Linux Music Editor
+//
+//  pluginbridge.h
+//
+//  This program is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU General Public License
+//  as published by the Free Software Foundation; version 2 of
+//  the License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+//
+//=========================================================
+
+#ifndef __PLUGINBRIDGE_H__
+#define __PLUGINBRIDGE_H__
+
+#include "plugin.h"
+#include "pluginscan.h"
+
+class QFileInfo;
+
+namespace MusECore {
+
+struct BridgeInstance;
+
+//---------------------------------------------------------
+//   BridgedPlugin
+//    A LADSPA/DSSI effect which runs in a child process
+//    ("muse --plugin-bridge <shm>"), one process per handle.
+//    Audio and control ports live in a shared memory block,
+//    each cycle is a futex handshake. The library is never
+//    loaded into MusE itself, port information comes from
+//    the plugin scan cache.
+//    All handles share one deadline per cycle. If the child
+//    crashes or misses its deadline repeatedly the handle is
+//    disabled: audio is passed through (or silenced) and the
+//    rest of the engine keeps running.
+//---------------------------------------------------------
+
+class BridgedPlugin : public Plugin {
+      PluginScanInfo _info;
+
+   public:
+      BridgedPlugin(QFileInfo* f, PluginScanInfo& info);
+      virtual ~BridgedPlugin();
+
+      virtual int incReferences(int);
+      virtual LADSPA_Handle instantiate(PluginI*);
+      virtual void activate(LADSPA_Handle);
+      virtual void deactivate(LADSPA_Handle);
+      virtual void cleanup(LADSPA_Handle);
+      virtual void connectPort(LADSPA_Handle, unsigned long port, float* value);
+      virtual void apply(LADSPA_Handle, unsigned long n);
+
+      // Round trip time of a cycle in microseconds, smoothed and peak.
+      // Returns false if the handle has been disabled.
+      static bool roundTrip(LADSPA_Handle, float* avg, float* max);
+
+      static void startCycle();   // audio thread, start of each cycle
+      static void reap();         // gui thread, heartbeat
+
+      static bool bridged(const QFileInfo& fi);
+      };
+
+extern int pluginBridgeMain(const char* shmName);
+
+} // namespace MusECore
+
+#endif
@@ -0,0 +1,595 @@
+//=========================================================
+//  MusE
+//  Linux Music Editor
+//
+//  pluginpool.cpp
+//
+//  This program is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU General Public License
+//  as published by the Free Software Foundation; version 2 of
+//  the License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+//
+//=========================================================
+
+#include <stdio.h>
+#include <vector>
+
+#include <QMutexLocker>
+#include <QRunnable>
+#include <QMessageBox>
+#include <QStringList>
+
+#include "pluginpool.h"
+#include "plugin.h"
+#include "globals.h"
+#include "gconfig.h"
+#include "app.h"
+#include "audio.h"
+#include "song.h"
+#include "track.h"
+
+namespace MusEGlobal {
+MusECore::PluginPool* pluginPool = 0;
+}
+
+namespace MusECore {
+
+//---------------------------------------------------------
+//   initPluginPool
+//---------------------------------------------------------
+
+void initPluginPool()
+{
+  MusEGlobal::pluginPool = new PluginPool();
+}
+
+//---------------------------------------------------------
+//   PluginInstanceJob
+//---------------------------------------------------------
+
+class PluginInstanceJob : public QRunnable {
+      PluginPool* _pool;
+      PluginI* _plugin;
+
+   public:
+      PluginInstanceJob(PluginPool* pool, PluginI* p) : _pool(pool), _plugin(p) {}
+      virtual void run() { _pool->runInstanceJob(_plugin); }
+      };
+
+//---------------------------------------------------------
+//   PluginWarmJob
+//---------------------------------------------------------
+
+class PluginWarmJob : public QRunnable {
+      PluginPool* _pool;
+      Plugin* _plugin;
+
+   public:
+      PluginWarmJob(PluginPool* pool, Plugin* p) : _pool(pool), _plugin(p) {}
+      virtual void run() { _pool->runWarmJob(_plugin); }
+      };
+
+//---------------------------------------------------------
+//   PluginPool
+//---------------------------------------------------------
+
+PluginPool::PluginPool()
+   : QObject(0)
+{
+  _finishPosted = false;
+  connect(this, SIGNAL(jobFinished()), SLOT(finishPending()), Qt::QueuedConnection);
+  connect(this, SIGNAL(instanceFailed()), SLOT(removeFailed()), Qt::QueuedConnection);
+}
+
+PluginPool::~PluginPool()
+{
+  finishAll();
+  clearWarm();
+  for(std::map<QString, QMutex*>::iterator i = _libLocks.begin(); i != _libLocks.end(); ++i)
+    delete i->second;
+}
+
+//---------------------------------------------------------
+//   mainThreadOnly
+//   LV2 instantiation goes through the lilv world and creates
+//    worker threads, dssi-vst talks to wine. Keep both in the
+//    gui thread.
+//---------------------------------------------------------
+
+bool PluginPool::mainThreadOnly(const Plugin* p)
+{
+  return p->isLV2Plugin() || p->isDssiVst();
+}
+
+//---------------------------------------------------------
+//   warmable
+//   Only plain handles can be pooled. LV2 handles are bound
+//    to their PluginI, bridged handles are processes.
+//---------------------------------------------------------
+
+bool PluginPool::warmable(const Plugin* p)
+{
+  return !mainThreadOnly(p) && !p->isBridged();
+}
+
+//---------------------------------------------------------
+//   libLock
+//   Serializes instantiation per plugin library.
+//   Must be called with _lock held.
+//---------------------------------------------------------
+
+QMutex* PluginPool::libLock(const Plugin* p)
+{
+  const QString path = p->filePath();
+  std::map<QString, QMutex*>::iterator i = _libLocks.find(path);
+  if(i != _libLocks.end())
+    return i->second;
+  QMutex* m = new QMutex();
+  _libLocks.insert(std::pair<QString, QMutex*>(path, m));
+  return m;
+}
+
+//---------------------------------------------------------
+//   schedule
+//   Queue creation of the handles of an initialized PluginI.
+//---------------------------------------------------------
+
+void PluginPool::schedule(PluginI* pi)
+{
+  Plugin* p = pi->plugin();
+  noteUsed(p);
+
+  QMutexLocker ml(&_lock);
+  _jobs[pi] = JobQueued;
+  if(mainThreadOnly(p))
+  {
+    _mainJobs.push_back(pi);
+    if(!_finishPosted)
+    {
+      _finishPosted = true;
+      emit jobFinished();
+    }
+  }
+  else
+    _threads.start(new PluginInstanceJob(this, pi));
+}
+
+//---------------------------------------------------------
+//   runInstanceJob
+//   Worker thread.
+//---------------------------------------------------------
+
+void PluginPool::runInstanceJob(PluginI* pi)
+{
+  QMutex* ll;
+  {
+    QMutexLocker ml(&_lock);
+    std::map<PluginI*, JobState>::iterator i = _jobs.find(pi);
+    if(i == _jobs.end() || i->second != JobQueued)   // Cancelled.
+      return;
+    i->second = JobRunning;
+    ll = libLock(pi->plugin());
+  }
+
+  ll->lock();
+  pi->createInstances();
+  ll->unlock();
+
+  bool post = false;
+  {
+    QMutexLocker ml(&_lock);
+    _jobs[pi] = JobDone;
+    _jobDone.wakeAll();
+    if(!_finishPosted)
+    {
+      _finishPosted = true;
+      post = true;
+    }
+  }
+  if(post)
+    emit jobFinished();
+}
+
+//---------------------------------------------------------
+//   finishPending
+//   Gui thread. Runs queued gui thread jobs and finishes all
+//    instances whose handles are done.
+//---------------------------------------------------------
+
+void PluginPool::finishPending()
+{
+  for(;;)
+  {
+    PluginI* pi;
+    {
+      QMutexLocker ml(&_lock);
+      _finishPosted = false;
+      if(_mainJobs.empty())
+        break;
+      pi = _mainJobs.front();
+      _mainJobs.pop_front();
+      _jobs[pi] = JobRunning;
+    }
+    pi->createInstances();
+    QMutexLocker ml(&_lock);
+    _jobs[pi] = JobDone;
+  }
+  finishDone();
+}
+
+//---------------------------------------------------------
+//   finishDone
+//---------------------------------------------------------
+
+void PluginPool::finishDone()
+{
+  std::vector<PluginI*> done;
+  {
+    QMutexLocker ml(&_lock);
+    for(std::map<PluginI*, JobState>::iterator i = _jobs.begin(); i != _jobs.end(); )
+    {
+      if(i->second == JobDone)
+      {
+        done.push_back(i->first);
+        _jobs.erase(i++);
+      }
+      else
+        ++i;
+    }
+  }
+  for(std::vector<PluginI*>::iterator i = done.begin(); i != done.end(); ++i)
+    (*i)->finishInstances();
+  settleReferences();
+}
+
+//---------------------------------------------------------
+//   finish
+//   Wait for the handles of one instance and finish it.
+//---------------------------------------------------------
+
+void PluginPool::finish(PluginI* pi)
+{
+  _lock.lock();
+  std::map<PluginI*, JobState>::iterator i = _jobs.find(pi);
+  if(i == _jobs.end())
+  {
+    _lock.unlock();
+    return;
+  }
+  for(std::list<PluginI*>::iterator im = _mainJobs.begin(); im != _mainJobs.end(); ++im)
+  {
+    if(*im == pi)
+    {
+      _mainJobs.erase(im);
+      i->second = JobRunning;
+      _lock.unlock();
+      pi->createInstances();
+      _lock.lock();
+      _jobs[pi] = JobDone;
+      break;
+    }
+  }
+  while(_jobs[pi] != JobDone)
+    _jobDone.wait(&_lock);
+  _jobs.erase(pi);
+  _lock.unlock();
+
+  pi->finishInstances();
+  settleReferences();
+}
+
+//---------------------------------------------------------
+//   finishAll
+//   Wait for all scheduled instances and finish them.
+//   Gui thread jobs are done here while the workers run.
+//---------------------------------------------------------
+
+void PluginPool::finishAll()
+{
+  finishPending();
+
+  _lock.lock();
+  for(;;)
+  {
+    bool busy = false;
+    for(std::map<PluginI*, JobState>::iterator i = _jobs.begin(); i != _jobs.end(); ++i)
+    {
+      if(i->second != JobDone)
+      {
+        busy = true;
+        break;
+      }
+    }
+    if(!busy)
+      break;
+    _jobDone.wait(&_lock);
+  }
+  _lock.unlock();
+
+  finishDone();
+}
+
+//---------------------------------------------------------
+//   cancel
+//   Gui thread, before a PluginI is removed from its rack
+//    or deleted. A queued job is dropped, a running one is
+//    waited for.
+//---------------------------------------------------------
+
+void PluginPool::cancel(PluginI* pi)
+{
+  _failed.remove(pi);
+  QMutexLocker ml(&_lock);
+  std::map<PluginI*, JobState>::iterator i = _jobs.find(pi);
+  if(i == _jobs.end())
+    return;
+  _mainJobs.remove(pi);
+  while(_jobs[pi] == JobRunning)
+    _jobDone.wait(&_lock);
+  _jobs.erase(pi);
+}
+
+//---------------------------------------------------------
+//   hasJob
+//   Any thread. Whether pi is still queued, instantiating
+//    or waiting to be finished.
+//---------------------------------------------------------
+
+bool PluginPool::hasJob(PluginI* pi)
+{
+  QMutexLocker ml(&_lock);
+  return _jobs.find(pi) != _jobs.end();
+}
+
+//---------------------------------------------------------
+//   failed
+//   Gui thread. The handles of pi could not be created.
+//    It is taken out of its rack once control is back in
+//    the event loop, its caller may still be using it.
+//---------------------------------------------------------
+
+void PluginPool::failed(PluginI* pi)
+{
+  if(_failed.empty())
+    emit instanceFailed();
+  _failed.push_back(pi);
+}
+
+//---------------------------------------------------------
+//   removeFailed
+//   Removes the failed instances from their rack slots, as
+//    the rack's remove does, and reports them.
+//---------------------------------------------------------
+
+void PluginPool::removeFailed()
+{
+  QStringList names;
+  bool removed = false;
+  while(!_failed.empty())
+  {
+    PluginI* pi = _failed.front();
+    _failed.pop_front();
+    names.append(pi->name());
+    AudioTrack* t = pi->track();
+    int idx = pi->id();
+    if(t && idx >= 0 && idx < PipelineDepth && (*t->efxPipe())[idx] == pi)
+    {
+      MusEGlobal::audio->msgAddPlugin(t, idx, 0);   // Deletes pi.
+      removed = true;
+    }
+  }
+  if(names.isEmpty())
+    return;
+  if(removed)
+    MusEGlobal::song->update(SC_RACK);
+  QMessageBox::warning(MusEGlobal::muse, tr("MusE: plugins"),
+     tr("These plugins could not be instantiated and were removed from the effect rack:\n%1")
+     .arg(names.join("\n")));
+}
+
+//---------------------------------------------------------
+//   takeWarm
+//   Any thread. Returns a pre-instantiated, not yet
+//    activated handle, or 0.
+//---------------------------------------------------------
+
+LADSPA_Handle PluginPool::takeWarm(Plugin* p)
+{
+  if(!warmable(p))
+    return 0;
+  QMutexLocker ml(&_lock);
+  std::map<Plugin*, WarmEntry>::iterator i = _warm.find(p);
+  if(i == _warm.end() || i->second.handles.empty())
+    return 0;
+  WarmHandle wh = i->second.handles.front();
+  if(wh.second != unsigned(MusEGlobal::sampleRate))   // Stale, purged by refill().
+    return 0;
+  LADSPA_Handle h = wh.first;
+  i->second.handles.pop_front();
+  // The new owner holds its own library reference. Ours is released in the gui thread.
+  ++i->second.owedRefs;
+  return h;
+}
+
+//---------------------------------------------------------
+//   noteUsed
+//   Count an instantiation of the plugin and keep the pool
+//    of the most used plugins filled.
+//---------------------------------------------------------
+
+void PluginPool::noteUsed(Plugin* p)
+{
+  if(!warmable(p))
+    return;
+  {
+    QMutexLocker ml(&_lock);
+    ++_warm[p].uses;
+  }
+  refill(p);
+}
+
+//---------------------------------------------------------
+//   refill
+//---------------------------------------------------------
+
+void PluginPool::refill(Plugin* p)
+{
+  int need = 0;
+  std::list<WarmHandle> stale;
+  {
+    QMutexLocker ml(&_lock);
+    WarmEntry& e = _warm[p];
+    for(std::list<WarmHandle>::iterator i = e.handles.begin(); i != e.handles.end(); )
+    {
+      if(i->second != unsigned(MusEGlobal::sampleRate))
+      {
+        stale.push_back(*i);
+        i = e.handles.erase(i);
+      }
+      else
+        ++i;
+    }
+  }
+  // Handles made for an old sample rate.
+  for(std::list<WarmHandle>::iterator i = stale.begin(); i != stale.end(); ++i)
+  {
+    p->cleanup(i->first);
+    p->incReferences(-1);
+  }
+
+  {
+    QMutexLocker ml(&_lock);
+    WarmEntry& e = _warm[p];
+    if(e.failed)
+      return;
+    int rank = 0;
+    for(std::map<Plugin*, WarmEntry>::const_iterator i = _warm.begin(); i != _warm.end(); ++i)
+      if(i->second.uses > e.uses)
+        ++rank;
+    if(rank >= MusEGlobal::config.pluginPoolPlugins)
+      return;
+    need = MusEGlobal::config.pluginPoolInstances - int(e.handles.size()) - e.pending;
+    if(need <= 0)
+      return;
+    e.pending += need;
+  }
+
+  for(int k = 0; k < need; ++k)
+  {
+    // Each pooled handle holds a library reference.
+    if(p->incReferences(1) == 0)
+    {
+      QMutexLocker ml(&_lock);
+      _warm[p].pending -= need - k;
+      _warm[p].failed = true;
+      return;
+    }
+    _threads.start(new PluginWarmJob(this, p));
+  }
+}
+
+//---------------------------------------------------------
+//   runWarmJob
+//   Worker thread.
+//---------------------------------------------------------
+
+void PluginPool::runWarmJob(Plugin* p)
+{
+  QMutex* ll;
+  {
+    QMutexLocker ml(&_lock);
+    ll = libLock(p);
+  }
+  ll->lock();
+  const unsigned rate = unsigned(MusEGlobal::sampleRate);
+  LADSPA_Handle h = p->instantiate(0);
+  ll->unlock();
+
+  QMutexLocker ml(&_lock);
+  WarmEntry& e = _warm[p];
+  --e.pending;
+  if(h)
+    e.handles.push_back(WarmHandle(h, rate));
+  else
+  {
+    ++e.owedRefs;
+    e.failed = true;
+  }
+}
+
+//---------------------------------------------------------
+//   settleReferences
+//   Gui thread. Release library references of taken or
+//    failed pool handles and optionally top up the pool again.
+//---------------------------------------------------------
+
+void PluginPool::settleReferences(bool topUp)
+{
+  std::vector< std::pair<Plugin*, int> > owed;
+  {
+    QMutexLocker ml(&_lock);
+    for(std::map<Plugin*, WarmEntry>::iterator i = _warm.begin(); i != _warm.end(); ++i)
+    {
+      if(i->second.owedRefs)
+      {
+        owed.push_back(std::pair<Plugin*, int>(i->first, i->second.owedRefs));
+        i->second.owedRefs = 0;
+      }
+    }
+  }
+  for(std::vector< std::pair<Plugin*, int> >::iterator i = owed.begin(); i != owed.end(); ++i)
+  {
+    i->first->incReferences(-i->second);
+    if(topUp)
+      refill(i->first);
+  }
+}
+
+//---------------------------------------------------------
+//   clearWarm
+//   Gui thread. Destroy all pooled handles.
+//---------------------------------------------------------
+
+void PluginPool::clearWarm()
+{
+  _threads.waitForDone();
+  settleReferences(false);
+
+  QMutexLocker ml(&_lock);
+  for(std::map<Plugin*, WarmEntry>::iterator i = _warm.begin(); i != _warm.end(); ++i)
+  {
+    Plugin* p = i->first;
+    WarmEntry& e = i->second;
+    for(std::list<WarmHandle>::iterator h = e.handles.begin(); h != e.handles.end(); ++h)
+    {
+      p->cleanup(h->first);
+      p->incReferences(-1);
+    }
+    e.handles.clear();
+  }
+  _warm.clear();
+}
+
+//---------------------------------------------------------
+//   warmCount
+//---------------------------------------------------------
+
+int PluginPool::warmCount()
+{
+  QMutexLocker ml(&_lock);
+  int n = 0;
+  for(std::map<Plugin*, WarmEntry>::const_iterator i = _warm.begin(); i != _warm.end(); ++i)
+    n += i->second.handles.size();
+  return n;
+}
+
+} // namespace MusECore
@@ -0,0 +1,131 @@
+//=========================================================
+//  MusE
+//  Linux Music Editor
+//
+//  pluginpool.h
+//
+//  This program is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU General Public License
+//  as published by the Free Software Foundation; version 2 of
+//  the License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+//
+//=========================================================
+
+#ifndef __PLUGINPOOL_H__
+#define __PLUGINPOOL_H__
+
+#include <list>
+#include <map>
+
+#include <QObject>
+#include <QMutex>
+#include <QWaitCondition>
+#include <QThreadPool>
+#include <QString>
+
+#include <ladspa.h>
+
+namespace MusECore {
+
+class Plugin;
+class PluginI;
+
+//---------------------------------------------------------
+//   PluginPool
+//    Creates plugin instance handles in worker threads and
+//    keeps a few pre-instantiated handles of the most used
+//    plugins ready.
+//
+//    Thread safety classes:
+//     LADSPA and DSSI handles are created in the workers,
+//      but never two at once from the same library.
+//     LV2 and dssi-vst plugins are instantiated in the gui
+//      thread only (lilv world, wine, worker threads).
+//
+//    All public functions except takeWarm() and hasJob()
+//    must be called from the gui thread. A PluginI may be
+//    deleted in the audio thread, so its job is cancelled
+//    in the gui thread before it is taken out of its rack
+//    or its track is deleted.
+//---------------------------------------------------------
+
+class PluginPool : public QObject {
+      Q_OBJECT
+
+      enum JobState { JobQueued, JobRunning, JobDone };
+
+      // A pooled handle and the sample rate it was instantiated with.
+      typedef std::pair<LADSPA_Handle, unsigned> WarmHandle;
+
+      struct WarmEntry {
+            std::list<WarmHandle> handles;
+            int pending;      // refill jobs scheduled
+            int uses;         // instantiations so far
+            int owedRefs;     // references of taken handles still to release
+            bool failed;      // instantiation failed, do not retry
+            WarmEntry() : pending(0), uses(0), owedRefs(0), failed(false) {}
+            };
+
+      QThreadPool _threads;
+      QMutex _lock;                       // guards everything below
+      QWaitCondition _jobDone;
+      std::map<PluginI*, JobState> _jobs;
+      std::list<PluginI*> _mainJobs;      // to be instantiated in the gui thread
+      std::list<PluginI*> _failed;        // gui thread only: to be removed from their racks
+      std::map<Plugin*, WarmEntry> _warm;
+      std::map<QString, QMutex*> _libLocks;
+      bool _finishPosted;
+
+      static bool mainThreadOnly(const Plugin*);
+      static bool warmable(const Plugin*);
+      QMutex* libLock(const Plugin*);
+      void refill(Plugin*);
+      void settleReferences(bool topUp = true);
+      void finishDone();
+
+      friend class PluginInstanceJob;
+      friend class PluginWarmJob;
+      void runInstanceJob(PluginI*);
+      void runWarmJob(Plugin*);
+
+   signals:
+      void jobFinished();
+      void instanceFailed();
+
+   private slots:
+      void finishPending();
+      void removeFailed();
+
+   public:
+      PluginPool();
+      virtual ~PluginPool();
+
+      void schedule(PluginI*);
+      void finish(PluginI*);
+      void finishAll();
+      void cancel(PluginI*);
+      bool hasJob(PluginI*);
+      void failed(PluginI*);
+
+      LADSPA_Handle takeWarm(Plugin*);
+      void noteUsed(Plugin*);
+      void clearWarm();
+      int warmCount();
+      };
+
+} // namespace MusECore
+
+namespace MusEGlobal {
+extern MusECore::PluginPool* pluginPool;
+}
+
+#endif
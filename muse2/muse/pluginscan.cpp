@@ -0,0 +1,609 @@
+//=========================================================
+//  MusE
+//  Linux Music Editor
+//
+//  pluginscan.cpp
+//
+//  This program is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU General Public License
+//  as published by the Free Software Foundation; version 2 of
+//  the License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+//
+//=========================================================
+
+#include <stdio.h>
+#include <string.h>
+#include <dlfcn.h>
+#include <unistd.h>
+
+#include <QCoreApplication>
+#include <QDateTime>
+#include <QFile>
+#include <QFileInfo>
+#include <QProcess>
+#include <QStringList>
+
+#include "pluginscan.h"
+#include "globals.h"
+#include "gconfig.h"
+#include "xml.h"
+#include "config.h"
+
+#ifdef DSSI_SUPPORT
+#include <dssi.h>
+#endif
+
+namespace MusEGlobal {
+MusECore::PluginScanCache pluginScanCache;
+}
+
+namespace MusECore {
+
+// Bump when the file layout changes. Old caches are then rescanned.
+static const int cacheVersion = 1;
+
+// Milliseconds a scanner child may take for one library.
+static const int scanTimeout = 10000;
+
+// Exit codes of the scanner child.
+enum { ScanExitOk = 0, ScanExitFailed = 1, ScanExitRetry = 2 };
+
+//---------------------------------------------------------
+//   descriptor
+//---------------------------------------------------------
+
+const LADSPA_Descriptor* PluginScanInfo::descriptor()
+{
+  memset(&_descr, 0, sizeof(_descr));
+  _descr.UniqueID   = uniqueID;
+  _descr.Label      = label.constData();
+  _descr.Properties = properties;
+  _descr.Name       = name.constData();
+  _descr.Maker      = maker.constData();
+  _descr.Copyright  = copyright.constData();
+  _descr.PortCount  = portDescr.size();
+
+  _portNamePtrs.resize(portNames.size());
+  for(unsigned long k = 0; k < portNames.size(); ++k)
+    _portNamePtrs[k] = portNames[k].constData();
+  if(!portDescr.empty())
+  {
+    _descr.PortDescriptors = &portDescr[0];
+    _descr.PortNames       = &_portNamePtrs[0];
+    _descr.PortRangeHints  = &portHints[0];
+  }
+  return &_descr;
+}
+
+//---------------------------------------------------------
+//   addDescriptor
+//---------------------------------------------------------
+
+static void addDescriptor(PluginScanLib* lib, const LADSPA_Descriptor* d, bool isDssi, bool isDssiSynth)
+{
+  PluginScanInfo info;
+  info.label       = QByteArray(d->Label);
+  info.name        = QByteArray(d->Name);
+  info.maker       = QByteArray(d->Maker);
+  info.copyright   = QByteArray(d->Copyright);
+  info.uniqueID    = d->UniqueID;
+  info.properties  = d->Properties;
+  info.isDssi      = isDssi;
+  info.isDssiSynth = isDssiSynth;
+  for(unsigned long k = 0; k < d->PortCount; ++k)
+  {
+    info.portDescr.push_back(d->PortDescriptors[k]);
+    info.portHints.push_back(d->PortRangeHints[k]);
+    info.portNames.push_back(QByteArray(d->PortNames[k]));
+  }
+  lib->plugins.push_back(info);
+}
+
+//---------------------------------------------------------
+//   scanLibrary
+//   Load the library and copy all its descriptors.
+//---------------------------------------------------------
+
+PluginScanCache::ScanResult PluginScanCache::scanLibrary(const QString& path, PluginScanLib* lib)
+{
+  void* handle = dlopen(path.toLatin1().constData(), RTLD_NOW);
+  if(handle == 0)
+  {
+    fprintf(stderr, "dlopen(%s) failed: %s\n", path.toLatin1().constData(), dlerror());
+    return ScanRetry;
+  }
+
+  #ifdef DSSI_SUPPORT
+  DSSI_Descriptor_Function dssi = (DSSI_Descriptor_Function)dlsym(handle, "dssi_descriptor");
+  if(dssi)
+  {
+    const DSSI_Descriptor* descr;
+    for(unsigned long i = 0;; ++i)
+    {
+      descr = dssi(i);
+      if(descr == 0)
+        break;
+      bool is_synth = descr->run_synth || descr->run_synth_adding
+                  || descr->run_multiple_synths || descr->run_multiple_synths_adding;
+      addDescriptor(lib, descr->LADSPA_Plugin, true, is_synth);
+    }
+  }
+  else
+  #endif
+  {
+    LADSPA_Descriptor_Function ladspa = (LADSPA_Descriptor_Function)dlsym(handle, "ladspa_descriptor");
+    if(!ladspa)
+    {
+      const char *txt = dlerror();
+      if(txt)
+      {
+        fprintf(stderr,
+              "Unable to find ladspa_descriptor() function in plugin "
+              "library file \"%s\": %s.\n"
+              "Are you sure this is a LADSPA plugin file?\n",
+              path.toLatin1().constData(),
+              txt);
+      }
+      dlclose(handle);
+      return ScanFailed;
+    }
+
+    const LADSPA_Descriptor* descr;
+    for(unsigned long i = 0;; ++i)
+    {
+      descr = ladspa(i);
+      if(descr == NULL)
+        break;
+      addDescriptor(lib, descr, false, false);
+    }
+  }
+
+  dlclose(handle);
+  return ScanOk;
+}
+
+//---------------------------------------------------------
+//   pluginScanMain
+//   Entry of the scanner child process. Writes the lib
+//    entry to stdout.
+//---------------------------------------------------------
+
+int pluginScanMain(const char* path)
+{
+  // Keep whatever the plugin prints out of our output.
+  int fd = dup(fileno(stdout));
+  dup2(fileno(stderr), fileno(stdout));
+
+  PluginScanLib lib;
+  switch(PluginScanCache::scanLibrary(QString(path), &lib))
+  {
+    case PluginScanCache::ScanRetry:
+      return ScanExitRetry;
+    case PluginScanCache::ScanFailed:
+      return ScanExitFailed;
+    case PluginScanCache::ScanOk:
+      break;
+  }
+  FILE* f = fdopen(fd, "w");
+  if(f == 0)
+    return ScanExitRetry;
+  Xml xml(f);
+  PluginScanCache::writeLib(0, xml, QString(path), lib);
+  fclose(f);
+  return ScanExitOk;
+}
+
+//---------------------------------------------------------
+//   scanOutOfProcess
+//---------------------------------------------------------
+
+PluginScanCache::ScanResult PluginScanCache::scanOutOfProcess(const QString& path, PluginScanLib* lib)
+{
+  QProcess proc;
+  proc.setProcessChannelMode(QProcess::ForwardedErrorChannel);
+  proc.start(QCoreApplication::applicationFilePath(), QStringList() << QString("--scan-plugin") << path);
+  if(!proc.waitForStarted())
+  {
+    // No scanner available. Better scan here than not at all.
+    fprintf(stderr, "PluginScanCache: cannot start scanner process, scanning %s in-process\n",
+            path.toLatin1().constData());
+    return scanLibrary(path, lib);
+  }
+  if(!proc.waitForFinished(scanTimeout))
+  {
+    proc.kill();
+    proc.waitForFinished();
+    fprintf(stderr, "PluginScanCache: %s hangs while scanning, skipped until it changes\n",
+            path.toLatin1().constData());
+    return ScanFailed;
+  }
+  if(proc.exitStatus() == QProcess::CrashExit)
+  {
+    fprintf(stderr, "PluginScanCache: %s crashed while scanning, skipped until it changes\n",
+            path.toLatin1().constData());
+    return ScanFailed;
+  }
+  switch(proc.exitCode())
+  {
+    case ScanExitOk:
+      break;
+    case ScanExitRetry:
+      return ScanRetry;
+    default:
+      return ScanFailed;
+  }
+
+  QByteArray out = proc.readAllStandardOutput();
+  Xml xml(out.constData());
+  for(;;)
+  {
+    Xml::Token token = xml.parse();
+    const QString& tag = xml.s1();
+    switch(token)
+    {
+      case Xml::Error:
+      case Xml::End:
+        return ScanFailed;
+      case Xml::TagStart:
+        if(tag == "lib")
+        {
+          // Size and time are ours, only take the descriptors.
+          QString p;
+          PluginScanLib l;
+          if(!readLib(xml, &p, &l))
+            return ScanFailed;
+          lib->plugins.swap(l.plugins);
+          return ScanOk;
+        }
+        xml.unknown("PluginScanCache");
+        break;
+      default:
+        break;
+    }
+  }
+}
+
+//---------------------------------------------------------
+//   lib
+//   Return the descriptors of a library, scanning it if it
+//    is not cached or has changed. Returns 0 if the library
+//    is not a usable plugin library.
+//---------------------------------------------------------
+
+PluginScanLib* PluginScanCache::lib(const QFileInfo& fi)
+{
+  const QString path = fi.filePath();
+  const qint64 size  = fi.size();
+  const qint64 mtime = fi.lastModified().toMSecsSinceEpoch();
+  _seen.insert(path);
+
+  std::map<QString, PluginScanLib>::iterator i = _libs.find(path);
+  if(i != _libs.end() && i->second.size == size && i->second.mtime == mtime)
+    return i->second.failed ? 0 : &i->second;
+
+  if(MusEGlobal::debugMsg)
+    fprintf(stderr, "PluginScanCache: scanning %s\n", path.toLatin1().constData());
+
+  PluginScanLib l;
+  l.size  = size;
+  l.mtime = mtime;
+  ScanResult r = MusEGlobal::config.pluginScanOutOfProcess ? scanOutOfProcess(path, &l) : scanLibrary(path, &l);
+  if(r == ScanRetry)
+  {
+    // Could not be loaded, maybe missing dependencies. Try again next time.
+    if(i != _libs.end())
+    {
+      _libs.erase(i);
+      _dirty = true;
+    }
+    return 0;
+  }
+  l.failed = r == ScanFailed;
+  if(l.failed)
+    l.plugins.clear();
+
+  PluginScanLib& e = _libs[path];
+  e = l;
+  _dirty = true;
+  return e.failed ? 0 : &e;
+}
+
+//---------------------------------------------------------
+//   fileName
+//---------------------------------------------------------
+
+QString PluginScanCache::fileName()
+{
+  return MusEGlobal::configPath + QString("/plugincache.xml");
+}
+
+//---------------------------------------------------------
+//   readPort
+//---------------------------------------------------------
+
+void PluginScanCache::readPort(Xml& xml, PluginScanInfo* info)
+{
+  LADSPA_PortDescriptor pd = 0;
+  LADSPA_PortRangeHint hint;
+  hint.HintDescriptor = 0;
+  hint.LowerBound = 0.0;
+  hint.UpperBound = 0.0;
+  QByteArray name;
+
+  for(;;)
+  {
+    Xml::Token token = xml.parse();
+    const QString& tag = xml.s1();
+    switch(token)
+    {
+      case Xml::Error:
+      case Xml::End:
+        return;
+      case Xml::Attribut:
+        if(tag == "desc")
+          pd = xml.s2().toInt();
+        else if(tag == "hint")
+          hint.HintDescriptor = xml.s2().toInt();
+        else if(tag == "lower")
+          hint.LowerBound = xml.s2().toFloat();
+        else if(tag == "upper")
+          hint.UpperBound = xml.s2().toFloat();
+        else if(tag == "name")
+          name = xml.s2().toLatin1();
+        break;
+      case Xml::TagEnd:
+        if(tag == "port")
+        {
+          info->portDescr.push_back(pd);
+          info->portHints.push_back(hint);
+          info->portNames.push_back(name);
+          return;
+        }
+        break;
+      default:
+        break;
+    }
+  }
+}
+
+//---------------------------------------------------------
+//   readPlugin
+//---------------------------------------------------------
+
+void PluginScanCache::readPlugin(Xml& xml, PluginScanInfo* info)
+{
+  for(;;)
+  {
+    Xml::Token token = xml.parse();
+    const QString& tag = xml.s1();
+    switch(token)
+    {
+      case Xml::Error:
+      case Xml::End:
+        return;
+      case Xml::TagStart:
+        if(tag == "port")
+          readPort(xml, info);
+        else
+          xml.unknown("PluginScanCache plugin");
+        break;
+      case Xml::Attribut:
+        // Strings are stored as Latin-1 to keep the bytes the plugin reported.
+        if(tag == "label")
+          info->label = xml.s2().toLatin1();
+        else if(tag == "name")
+          info->name = xml.s2().toLatin1();
+        else if(tag == "maker")
+          info->maker = xml.s2().toLatin1();
+        else if(tag == "copyright")
+          info->copyright = xml.s2().toLatin1();
+        else if(tag == "id")
+          info->uniqueID = xml.s2().toULong();
+        else if(tag == "properties")
+          info->properties = xml.s2().toInt();
+        else if(tag == "dssi")
+          info->isDssi = xml.s2().toInt();
+        else if(tag == "synth")
+          info->isDssiSynth = xml.s2().toInt();
+        break;
+      case Xml::TagEnd:
+        if(tag == "plugin")
+          return;
+        break;
+      default:
+        break;
+    }
+  }
+}
+
+//---------------------------------------------------------
+//   readLib
+//   return false on error
+//---------------------------------------------------------
+
+bool PluginScanCache::readLib(Xml& xml, QString* path, PluginScanLib* lib)
+{
+  for(;;)
+  {
+    Xml::Token token = xml.parse();
+    const QString& tag = xml.s1();
+    switch(token)
+    {
+      case Xml::Error:
+      case Xml::End:
+        return false;
+      case Xml::TagStart:
+        if(tag == "plugin")
+        {
+          lib->plugins.push_back(PluginScanInfo());
+          readPlugin(xml, &lib->plugins.back());
+        }
+        else
+          xml.unknown("PluginScanCache lib");
+        break;
+      case Xml::Attribut:
+        if(tag == "path")
+          *path = xml.s2();
+        else if(tag == "size")
+          lib->size = xml.s2().toLongLong();
+        else if(tag == "mtime")
+          lib->mtime = xml.s2().toLongLong();
+        else if(tag == "failed")
+          lib->failed = xml.s2().toInt();
+        break;
+      case Xml::TagEnd:
+        if(tag == "lib")
+          return !path->isEmpty();
+        break;
+      default:
+        break;
+    }
+  }
+}
+
+//---------------------------------------------------------
+//   writeLib
+//---------------------------------------------------------
+
+void PluginScanCache::writeLib(int level, Xml& xml, const QString& path, const PluginScanLib& lib)
+{
+  xml.tag(level++, "lib path=\"%s\" size=\"%lld\" mtime=\"%lld\" failed=\"%d\"",
+          Xml::xmlString(path).toUtf8().constData(), (long long)lib.size, (long long)lib.mtime, lib.failed);
+  for(std::vector<PluginScanInfo>::const_iterator i = lib.plugins.begin(); i != lib.plugins.end(); ++i)
+  {
+    xml.tag(level++, "plugin label=\"%s\" name=\"%s\" maker=\"%s\" copyright=\"%s\" id=\"%lu\" properties=\"%d\" dssi=\"%d\" synth=\"%d\"",
+            Xml::xmlString(QString::fromLatin1(i->label)).toUtf8().constData(),
+            Xml::xmlString(QString::fromLatin1(i->name)).toUtf8().constData(),
+            Xml::xmlString(QString::fromLatin1(i->maker)).toUtf8().constData(),
+            Xml::xmlString(QString::fromLatin1(i->copyright)).toUtf8().constData(),
+            i->uniqueID, i->properties, i->isDssi, i->isDssiSynth);
+    for(unsigned long k = 0; k < i->portDescr.size(); ++k)
+    {
+      const LADSPA_PortRangeHint& h = i->portHints[k];
+      xml.put(level, "<port desc=\"%d\" hint=\"%d\" lower=\"%.9g\" upper=\"%.9g\" name=\"%s\" />",
+              i->portDescr[k], h.HintDescriptor, h.LowerBound, h.UpperBound,
+              Xml::xmlString(QString::fromLatin1(i->portNames[k])).toUtf8().constData());
+    }
+    xml.etag(--level, "plugin");
+  }
+  xml.etag(--level, "lib");
+}
+
+//---------------------------------------------------------
+//   read
+//---------------------------------------------------------
+
+void PluginScanCache::read()
+{
+  _libs.clear();
+  _seen.clear();
+  _dirty = false;
+  if(!MusEGlobal::config.pluginScanCache)
+    return;
+
+  FILE* f = fopen(fileName().toLocal8Bit().constData(), "r");
+  if(f == 0)
+    return;
+
+  Xml xml(f);
+  for(;;)
+  {
+    Xml::Token token = xml.parse();
+    const QString& tag = xml.s1();
+    switch(token)
+    {
+      case Xml::Error:
+      case Xml::End:
+        fclose(f);
+        return;
+      case Xml::TagStart:
+        if(tag == "lib")
+        {
+          QString path;
+          PluginScanLib lib;
+          if(readLib(xml, &path, &lib))
+            _libs[path] = lib;
+        }
+        else if(tag != "pluginScanCache")
+          xml.unknown("PluginScanCache");
+        break;
+      case Xml::Attribut:
+        if(tag == "version" && xml.s2().toInt() != cacheVersion)
+        {
+          fclose(f);
+          _libs.clear();
+          _dirty = true;
+          return;
+        }
+        break;
+      case Xml::TagEnd:
+        if(tag == "pluginScanCache")
+        {
+          fclose(f);
+          return;
+        }
+        break;
+      default:
+        break;
+    }
+  }
+}
+
+//---------------------------------------------------------
+//   write
+//   Save the cache if anything was rescanned. Libraries
+//    which no longer exist are dropped. After a full scan
+//    (LADSPA and DSSI) so are libraries which are no longer
+//    on the search paths.
+//---------------------------------------------------------
+
+void PluginScanCache::write(bool fullScan)
+{
+  if(!MusEGlobal::config.pluginScanCache)
+    return;
+
+  for(std::map<QString, PluginScanLib>::iterator i = _libs.begin(); i != _libs.end(); )
+  {
+    if(!QFileInfo(i->first).isFile() || (fullScan && _seen.find(i->first) == _seen.end()))
+    {
+      _libs.erase(i++);
+      _dirty = true;
+    }
+    else
+      ++i;
+  }
+  if(!_dirty)
+    return;
+
+  const QString name = fileName();
+  const QString tmp  = name + QString(".tmp");
+  FILE* f = fopen(tmp.toLocal8Bit().constData(), "w");
+  if(f == 0)
+  {
+    fprintf(stderr, "PluginScanCache: cannot write %s\n", tmp.toLocal8Bit().constData());
+    return;
+  }
+  Xml xml(f);
+  xml.header();
+  xml.tag(0, "pluginScanCache version=\"%d\"", cacheVersion);
+  for(std::map<QString, PluginScanLib>::const_iterator i = _libs.begin(); i != _libs.end(); ++i)
+    writeLib(1, xml, i->first, i->second);
+  xml.etag(0, "pluginScanCache");
+  if(fclose(f) != 0 || rename(tmp.toLocal8Bit().constData(), name.toLocal8Bit().constData()) != 0)
+  {
+    fprintf(stderr, "PluginScanCache: cannot write %s\n", name.toLocal8Bit().constData());
+    return;
+  }
+  _dirty = false;
+}
+
+} // namespace MusECore
@@ -0,0 +1,129 @@
+//=========================================================
+//  MusE
+//  Linux Music Editor
+//
+//  pluginscan.h
+//
+//  This program is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU General Public License
+//  as published by the Free Software Foundation; version 2 of
+//  the License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+//
+//=========================================================
+
+#ifndef __PLUGINSCAN_H__
+#define __PLUGINSCAN_H__
+
+#include <map>
+#include <set>
+#include <vector>
+
+#include <QByteArray>
+#include <QString>
+
+#include <ladspa.h>
+
+class QFileInfo;
+
+namespace MusECore {
+
+class Xml;
+
+//---------------------------------------------------------
+//   PluginScanInfo
+//    Everything the plugin lists need to know about one
+//    LADSPA or DSSI descriptor, without loading the library.
+//---------------------------------------------------------
+
+struct PluginScanInfo {
+      QByteArray label;
+      QByteArray name;
+      QByteArray maker;
+      QByteArray copyright;
+      unsigned long uniqueID;
+      int properties;
+      bool isDssi;
+      bool isDssiSynth;
+      std::vector<LADSPA_PortDescriptor> portDescr;
+      std::vector<LADSPA_PortRangeHint> portHints;
+      std::vector<QByteArray> portNames;
+
+      PluginScanInfo() : uniqueID(0), properties(0), isDssi(false), isDssiSynth(false) {}
+
+      // A descriptor without any functions, pointing into this object.
+      const LADSPA_Descriptor* descriptor();
+
+   private:
+      LADSPA_Descriptor _descr;
+      std::vector<const char*> _portNamePtrs;
+      };
+
+//---------------------------------------------------------
+//   PluginScanLib
+//---------------------------------------------------------
+
+struct PluginScanLib {
+      qint64 size;
+      qint64 mtime;
+      bool failed;      // not a plugin, crashed or hung while scanning
+      std::vector<PluginScanInfo> plugins;
+
+      PluginScanLib() : size(-1), mtime(-1), failed(false) {}
+      };
+
+//---------------------------------------------------------
+//   PluginScanCache
+//    Persistent LADSPA/DSSI descriptor cache, keyed by
+//    library path, size and modification time. Only new or
+//    changed libraries are loaded at startup.
+//    With config.pluginScanOutOfProcess the libraries are
+//    scanned by a child process ("muse --scan-plugin <lib>"),
+//    so a crashing or hanging library is only marked as
+//    failed until it changes.
+//    Libraries which are gone, or were not looked at by a
+//    full scan, are dropped when the cache is saved.
+//---------------------------------------------------------
+
+class PluginScanCache {
+      enum ScanResult { ScanOk, ScanFailed, ScanRetry };
+
+      std::map<QString, PluginScanLib> _libs;
+      std::set<QString> _seen;      // libraries looked at by this scan
+      bool _dirty;
+
+      static QString fileName();
+      static ScanResult scanLibrary(const QString& path, PluginScanLib* lib);
+      static ScanResult scanOutOfProcess(const QString& path, PluginScanLib* lib);
+      static bool readLib(Xml&, QString* path, PluginScanLib* lib);
+      static void readPlugin(Xml&, PluginScanInfo* info);
+      static void readPort(Xml&, PluginScanInfo* info);
+      static void writeLib(int level, Xml&, const QString& path, const PluginScanLib& lib);
+
+      friend int pluginScanMain(const char* path);
+
+   public:
+      PluginScanCache() : _dirty(false) {}
+
+      PluginScanLib* lib(const QFileInfo& fi);
+      void read();
+      void write(bool fullScan);
+      };
+
+extern int pluginScanMain(const char* path);
+
+} // namespace MusECore
+
+namespace MusEGlobal {
+extern MusECore::PluginScanCache pluginScanCache;
+}
+
+#endif
@@ -0,0 +1,343 @@
+//=========================================================
+//  MusE
+//  Linux Music Editor
+//
+//  recwriter.cpp
+//
+//  This program is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU General Public License
+//  as published by the Free Software Foundation; version 2 of
+//  the License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+//
+//=========================================================
+
+#include <string.h>
+#include <algorithm>
+
+#include <QThread>
+#include <QReadLocker>
+#include <QWriteLocker>
+
+#include "recwriter.h"
+#include "track.h"
+#include "gconfig.h"
+
+namespace MusEGlobal {
+MusECore::RecordWriter* recordWriter = 0;
+}
+
+namespace MusECore {
+
+// Frames of the scratch buffer a chunk is collected in.
+static const unsigned chunkFrames = RecordWriter::ChunkBytes / (MAX_CHANNELS * sizeof(float));
+
+//---------------------------------------------------------
+//   initRecordWriter
+//---------------------------------------------------------
+
+void initRecordWriter()
+{
+  MusEGlobal::recordWriter = new RecordWriter(MusEGlobal::config.recWriterThreads);
+}
+
+//---------------------------------------------------------
+//   RecordRing
+//---------------------------------------------------------
+
+RecordRing::RecordRing()
+      {
+      for (int ch = 0; ch < MAX_CHANNELS; ++ch)
+            _data[ch] = 0;
+      _size    = 0;
+      _blocks  = 0;
+      _nblocks = 0;
+      clear();
+      }
+
+RecordRing::~RecordRing()
+      {
+      free();
+      }
+
+void RecordRing::free()
+      {
+      for (int ch = 0; ch < MAX_CHANNELS; ++ch) {
+            delete[] _data[ch];
+            _data[ch] = 0;
+            }
+      delete[] _blocks;
+      _blocks  = 0;
+      _size    = 0;
+      _nblocks = 0;
+      }
+
+//---------------------------------------------------------
+//   resize
+//    Gui thread, while the ring is not in use.
+//---------------------------------------------------------
+
+void RecordRing::resize(unsigned frames)
+      {
+      if (frames != _size) {
+            free();
+            for (int ch = 0; ch < MAX_CHANNELS; ++ch)
+                  _data[ch] = new float[frames];
+            // Periods are at least 16 frames.
+            _nblocks = frames / 16 + 1;
+            _blocks  = new RecordBlock[_nblocks];
+            _size    = frames;
+            }
+      clear();
+      }
+
+void RecordRing::clear()
+      {
+      _wframe = _wblock = 0;
+      _rframe = _rblock = 0;
+      _fill.store(0);
+      _blockCount.store(0);
+      _maxFill  = 0;
+      _overruns = 0;
+      busy.store(0);
+      }
+
+//---------------------------------------------------------
+//   put
+//    Audio thread. Returns true on overrun, the frames
+//    are lost then.
+//---------------------------------------------------------
+
+bool RecordRing::put(int channels, unsigned n, float** src, unsigned pos)
+      {
+      if (n > _size - unsigned(_fill.load()) || _blockCount.load() >= int(_nblocks)) {
+            ++_overruns;
+            return true;
+            }
+      if (channels > MAX_CHANNELS)
+            channels = MAX_CHANNELS;
+      const unsigned n1 = std::min(n, _size - _wframe);
+      for (int ch = 0; ch < channels; ++ch) {
+            memcpy(_data[ch] + _wframe, src[ch], n1 * sizeof(float));
+            if (n1 < n)
+                  memcpy(_data[ch], src[ch] + n1, (n - n1) * sizeof(float));
+            }
+      _wframe = (_wframe + n) % _size;
+      RecordBlock& b = _blocks[_wblock];
+      b.pos      = pos;
+      b.frames   = n;
+      b.channels = channels;
+      _wblock = (_wblock + 1) % _nblocks;
+
+      const int fill = _fill.fetchAndAddOrdered(n) + n;
+      _blockCount.fetchAndAddOrdered(1);
+      if (fill > _maxFill)
+            _maxFill = fill;
+      return false;
+      }
+
+//---------------------------------------------------------
+//   take
+//    Copies the frames of the next block to dst at offset
+//    and removes the block. Returns the number of frames.
+//---------------------------------------------------------
+
+unsigned RecordRing::take(float** dst, unsigned offset)
+      {
+      const RecordBlock& b = _blocks[_rblock];
+      const unsigned n  = b.frames;
+      const unsigned n1 = std::min(n, _size - _rframe);
+      for (int ch = 0; ch < b.channels; ++ch) {
+            memcpy(dst[ch] + offset, _data[ch] + _rframe, n1 * sizeof(float));
+            if (n1 < n)
+                  memcpy(dst[ch] + offset + n1, _data[ch], (n - n1) * sizeof(float));
+            }
+      drop();
+      return n;
+      }
+
+void RecordRing::drop()
+      {
+      const unsigned n = _blocks[_rblock].frames;
+      _rframe = (_rframe + n) % _size;
+      _rblock = (_rblock + 1) % _nblocks;
+      _blockCount.fetchAndAddOrdered(-1);
+      _fill.fetchAndAddOrdered(-int(n));
+      }
+
+//---------------------------------------------------------
+//   takeMaxFill
+//    Highest fill since the last call.
+//---------------------------------------------------------
+
+int RecordRing::takeMaxFill()
+      {
+      const int f = _maxFill;
+      _maxFill = _fill.load();
+      return f;
+      }
+
+//---------------------------------------------------------
+//   RecordWriterThread
+//---------------------------------------------------------
+
+class RecordWriterThread : public QThread {
+      RecordWriter* _writer;
+      float* _chunk[MAX_CHANNELS];
+
+   public:
+      volatile bool quit;
+
+      RecordWriterThread(RecordWriter* w) : _writer(w), quit(false) {
+            for (int ch = 0; ch < MAX_CHANNELS; ++ch)
+                  _chunk[ch] = new float[chunkFrames];
+            }
+      ~RecordWriterThread() {
+            for (int ch = 0; ch < MAX_CHANNELS; ++ch)
+                  delete[] _chunk[ch];
+            }
+      virtual void run() {
+            while (!quit) {
+                  _writer->pass(_chunk);
+                  msleep(10);
+                  }
+            }
+      };
+
+//---------------------------------------------------------
+//   RecordWriter
+//---------------------------------------------------------
+
+RecordWriter::RecordWriter(int threads)
+      {
+      _overruns = 0;
+      if (threads < 1)
+            threads = 1;
+      for (int i = 0; i < threads; ++i) {
+            RecordWriterThread* t = new RecordWriterThread(this);
+            t->start(QThread::HighPriority);
+            _threads.push_back(t);
+            }
+      }
+
+RecordWriter::~RecordWriter()
+      {
+      for (size_t i = 0; i < _threads.size(); ++i)
+            _threads[i]->quit = true;
+      for (size_t i = 0; i < _threads.size(); ++i) {
+            _threads[i]->wait();
+            delete _threads[i];
+            }
+      }
+
+//---------------------------------------------------------
+//   pass
+//    One round over the tracks of a writer thread. A ring
+//    is drained when it holds a chunk, or a quarter of its
+//    size, so the file sees few large writes.
+//---------------------------------------------------------
+
+void RecordWriter::pass(float** chunk)
+      {
+      QReadLocker locker(&_lock);
+      for (size_t i = 0; i < _tracks.size(); ++i) {
+            AudioTrack* t = _tracks[i];
+            RecordRing& r = t->recordRing();
+            if (!r.blocks())
+                  continue;
+            if (unsigned(r.fill()) < std::min(chunkFrames, r.size() / 4))
+                  continue;
+            if (!r.busy.testAndSetAcquire(0, 1))
+                  continue;   // another thread is at it
+            t->record(chunk, chunkFrames);
+            r.busy.storeRelease(0);
+            }
+      }
+
+//---------------------------------------------------------
+//   add
+//    Gui thread. The track's ring must be ready.
+//---------------------------------------------------------
+
+void RecordWriter::add(AudioTrack* t)
+      {
+      QWriteLocker locker(&_lock);
+      if (_tracks.empty())
+            _overruns = 0;    // a new take
+      if (std::find(_tracks.begin(), _tracks.end(), t) == _tracks.end())
+            _tracks.push_back(t);
+      }
+
+//---------------------------------------------------------
+//   remove
+//---------------------------------------------------------
+
+void RecordWriter::remove(AudioTrack* t)
+      {
+      QWriteLocker locker(&_lock);
+      std::vector<AudioTrack*>::iterator i = std::find(_tracks.begin(), _tracks.end(), t);
+      if (i != _tracks.end())
+            _tracks.erase(i);
+      }
+
+//---------------------------------------------------------
+//   finish
+//    Gui thread, recording stopped. Writes what is left in
+//    the rings and lets go of the tracks.
+//---------------------------------------------------------
+
+void RecordWriter::finish()
+      {
+      QWriteLocker locker(&_lock);
+      if (_tracks.empty())
+            return;
+      std::vector<float> buffer(MAX_CHANNELS * chunkFrames);
+      float* chunk[MAX_CHANNELS];
+      for (int ch = 0; ch < MAX_CHANNELS; ++ch)
+            chunk[ch] = &buffer[ch * chunkFrames];
+      for (size_t i = 0; i < _tracks.size(); ++i) {
+            RecordRing& r = _tracks[i]->recordRing();
+            if (r.blocks())
+                  _tracks[i]->record(chunk, chunkFrames);
+            _overruns += r.overruns();
+            r.clear();
+            }
+      _tracks.clear();
+      }
+
+//---------------------------------------------------------
+//   health
+//    Highest ring fill in percent since the last call and
+//    the number of overruns in this take. False if busy.
+//---------------------------------------------------------
+
+bool RecordWriter::health(int* maxFillPercent, int* overruns)
+      {
+      if (!_lock.tryLockForRead())
+            return false;
+      int fill = 0;
+      int ovr  = _overruns;
+      for (size_t i = 0; i < _tracks.size(); ++i) {
+            RecordRing& r = _tracks[i]->recordRing();
+            if (r.size()) {
+                  const int p = int(qint64(r.takeMaxFill()) * 100 / r.size());
+                  if (p > fill)
+                        fill = p;
+                  }
+            ovr += r.overruns();
+            }
+      _lock.unlock();
+      *maxFillPercent = fill;
+      *overruns       = ovr;
+      return true;
+      }
+
+} // namespace MusECore
@@ -0,0 +1,131 @@
+//=========================================================
+//  MusE
+//  Linux Music Editor
+//
+//  recwriter.h
+//
+//  This program is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU General Public License
+//  as published by the Free Software Foundation; version 2 of
+//  the License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+//
+//=========================================================
+
+#ifndef __RECWRITER_H__
+#define __RECWRITER_H__
+
+#include <vector>
+
+#include <QAtomicInt>
+#include <QReadWriteLock>
+
+#include "globaldefs.h"
+
+namespace MusECore {
+
+class AudioTrack;
+class RecordWriterThread;
+
+//---------------------------------------------------------
+//   RecordBlock
+//    One audio cycle worth of recorded frames.
+//---------------------------------------------------------
+
+struct RecordBlock {
+      unsigned pos;           // absolute frame of the first frame
+      unsigned frames;
+      int channels;
+      };
+
+//---------------------------------------------------------
+//   RecordRing
+//    Recorded audio of a track on its way from the audio
+//    thread to a record writer thread. One writer, one
+//    reader, no locks. Sized in seconds when recording is
+//    prepared.
+//---------------------------------------------------------
+
+class RecordRing {
+      float* _data[MAX_CHANNELS];
+      unsigned _size;         // frames
+      RecordBlock* _blocks;
+      unsigned _nblocks;
+      unsigned _wframe, _wblock;    // audio thread only
+      unsigned _rframe, _rblock;    // reader only
+      QAtomicInt _fill;             // frames in the ring
+      QAtomicInt _blockCount;
+
+      // Health, for the gui.
+      volatile int _maxFill;
+      volatile int _overruns;
+
+      void free();
+
+   public:
+      QAtomicInt busy;              // a writer thread is draining it
+
+      RecordRing();
+      ~RecordRing();
+      void resize(unsigned frames);
+      void clear();
+      unsigned size() const   { return _size; }
+
+      // audio thread
+      bool put(int channels, unsigned n, float** src, unsigned pos);
+
+      // reader
+      int fill() const        { return _fill.load(); }
+      int blocks() const      { return _blockCount.load(); }
+      const RecordBlock& block() const { return _blocks[_rblock]; }
+      unsigned take(float** dst, unsigned offset);
+      void drop();
+
+      int takeMaxFill();
+      int overruns() const    { return _overruns; }
+      };
+
+//---------------------------------------------------------
+//   RecordWriter
+//    Threads writing recorded audio from the record rings
+//    of the registered tracks to their take files, in
+//    chunks of up to ChunkBytes. The audio prefetch thread
+//    is left to playback.
+//---------------------------------------------------------
+
+class RecordWriter {
+      std::vector<RecordWriterThread*> _threads;
+      std::vector<AudioTrack*> _tracks;
+      QReadWriteLock _lock;   // _tracks; read locked by a writing pass
+      int _overruns;          // of tracks done with
+
+      friend class RecordWriterThread;
+      void pass(float** chunk);
+
+   public:
+      enum { ChunkBytes = 4 * 1024 * 1024 };
+
+      RecordWriter(int threads);
+      ~RecordWriter();
+
+      void add(AudioTrack*);
+      void remove(AudioTrack*);
+      void finish();
+      bool health(int* maxFillPercent, int* overruns);
+      };
+
+} // namespace MusECore
+
+namespace MusEGlobal {
+extern MusECore::RecordWriter* recordWriter;
+}
+
+#endif
@@ -0,0 +1,324 @@
+//=========================================================
+//  MusE
+//  Linux Music Editor
+//
+//  sampleconv.cpp
+//
+//  This program is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU General Public License
+//  as published by the Free Software Foundation; version 2 of
+//  the License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+//
+//=========================================================
+
+#include <string.h>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+#include "sampleconv.h"
+
+namespace MusECore {
+
+//---------------------------------------------------------
+//   sample
+//---------------------------------------------------------
+
+static inline float sample(float v) { return v; }
+static inline float sample(short v) { return float(v) * (1.0f / 32768.0f); }
+static inline float sample(int v)   { return float(v) * (1.0f / 2147483648.0f); }
+
+//---------------------------------------------------------
+//   clip
+//---------------------------------------------------------
+
+static inline float clip(float v, float limit)
+      {
+      // Written so it compiles to min/max, without branches.
+      v = v < limit ? v : limit;
+      return v > -limit ? v : -limit;
+      }
+
+//---------------------------------------------------------
+//   mapChannels
+//    Any channel counts, one track channel at a time.
+//---------------------------------------------------------
+
+template <typename T>
+static void mapChannels(const T* src, int fch, float** dst, int ch, unsigned n, bool overwrite)
+      {
+      if (fch > ch) {
+            for (int t = 0; t < ch; ++t) {
+                  float* d = dst[t];
+                  for (unsigned i = 0; i < n; ++i) {
+                        const T* s = src + i * fch;
+                        float v = 0.0f;
+                        for (int c = t; c < fch; c += ch)
+                              v += sample(s[c]);
+                        if (overwrite)
+                              d[i] = v;
+                        else
+                              d[i] += v;
+                        }
+                  }
+            }
+      else {
+            for (int t = 0; t < ch; ++t) {
+                  float* d = dst[t];
+                  const T* s = src + t % fch;
+                  if (overwrite)
+                        for (unsigned i = 0; i < n; ++i)
+                              d[i] = sample(s[i * fch]);
+                  else
+                        for (unsigned i = 0; i < n; ++i)
+                              d[i] += sample(s[i * fch]);
+                  }
+            }
+      }
+
+//---------------------------------------------------------
+//   deinterleaveCh
+//    CH channels on both sides, unrolled by the compiler.
+//---------------------------------------------------------
+
+template <typename T, int CH>
+static void deinterleaveCh(const T* src, float** dst, unsigned n, bool overwrite)
+      {
+      // A channel at a time, a constant stride vectorizes.
+      for (int ch = 0; ch < CH; ++ch) {
+            float* d = dst[ch];
+            const T* s = src + ch;
+            if (overwrite)
+                  for (unsigned i = 0; i < n; ++i)
+                        d[i] = sample(s[i * CH]);
+            else
+                  for (unsigned i = 0; i < n; ++i)
+                        d[i] += sample(s[i * CH]);
+            }
+      }
+
+#ifdef __SSE2__
+
+//---------------------------------------------------------
+//   load4
+//    Four samples as floats.
+//---------------------------------------------------------
+
+static inline __m128 load4(const float* p)
+      {
+      return _mm_loadu_ps(p);
+      }
+
+static inline __m128 load4(const short* p)
+      {
+      __m128i v = _mm_loadl_epi64((const __m128i*)p);
+      v = _mm_srai_epi32(_mm_unpacklo_epi16(v, v), 16);
+      return _mm_mul_ps(_mm_cvtepi32_ps(v), _mm_set1_ps(1.0f / 32768.0f));
+      }
+
+static inline __m128 load4(const int* p)
+      {
+      __m128i v = _mm_loadu_si128((const __m128i*)p);
+      return _mm_mul_ps(_mm_cvtepi32_ps(v), _mm_set1_ps(1.0f / 2147483648.0f));
+      }
+
+static inline void store4(float* p, __m128 v, bool overwrite)
+      {
+      if (!overwrite)
+            v = _mm_add_ps(v, _mm_loadu_ps(p));
+      _mm_storeu_ps(p, v);
+      }
+
+//---------------------------------------------------------
+//   deinterleave2
+//---------------------------------------------------------
+
+template <typename T>
+static void deinterleave2(const T* src, float** dst, unsigned n, bool overwrite)
+      {
+      float* l = dst[0];
+      float* r = dst[1];
+      unsigned i = 0;
+      for (; i + 4 <= n; i += 4, src += 8) {
+            __m128 a = load4(src);        // l0 r0 l1 r1
+            __m128 b = load4(src + 4);    // l2 r2 l3 r3
+            store4(l + i, _mm_shuffle_ps(a, b, _MM_SHUFFLE(2, 0, 2, 0)), overwrite);
+            store4(r + i, _mm_shuffle_ps(a, b, _MM_SHUFFLE(3, 1, 3, 1)), overwrite);
+            }
+      float* d[2] = { l + i, r + i };
+      deinterleaveCh<T, 2>(src, d, n - i, overwrite);
+      }
+
+//---------------------------------------------------------
+//   deinterleave4
+//---------------------------------------------------------
+
+template <typename T>
+static void deinterleave4(const T* src, float** dst, unsigned n, bool overwrite)
+      {
+      unsigned i = 0;
+      for (; i + 4 <= n; i += 4, src += 16) {
+            __m128 a = load4(src);
+            __m128 b = load4(src + 4);
+            __m128 c = load4(src + 8);
+            __m128 e = load4(src + 12);
+            _MM_TRANSPOSE4_PS(a, b, c, e);
+            store4(dst[0] + i, a, overwrite);
+            store4(dst[1] + i, b, overwrite);
+            store4(dst[2] + i, c, overwrite);
+            store4(dst[3] + i, e, overwrite);
+            }
+      float* d[4] = { dst[0] + i, dst[1] + i, dst[2] + i, dst[3] + i };
+      deinterleaveCh<T, 4>(src, d, n - i, overwrite);
+      }
+
+#endif
+
+//---------------------------------------------------------
+//   deinterleaveT
+//---------------------------------------------------------
+
+template <typename T>
+static void deinterleaveT(const T* src, int fch, float** dst, int ch, unsigned n, bool overwrite)
+      {
+      if (fch != ch) {
+            mapChannels(src, fch, dst, ch, n, overwrite);
+            return;
+            }
+      switch (ch) {
+            case 1: deinterleaveCh<T, 1>(src, dst, n, overwrite); break;
+#ifdef __SSE2__
+            case 2: deinterleave2(src, dst, n, overwrite); break;
+            case 4: deinterleave4(src, dst, n, overwrite); break;
+#else
+            case 2: deinterleaveCh<T, 2>(src, dst, n, overwrite); break;
+            case 4: deinterleaveCh<T, 4>(src, dst, n, overwrite); break;
+#endif
+            case 3: deinterleaveCh<T, 3>(src, dst, n, overwrite); break;
+            case 5: deinterleaveCh<T, 5>(src, dst, n, overwrite); break;
+            case 6: deinterleaveCh<T, 6>(src, dst, n, overwrite); break;
+            case 7: deinterleaveCh<T, 7>(src, dst, n, overwrite); break;
+            case 8: deinterleaveCh<T, 8>(src, dst, n, overwrite); break;
+            default: mapChannels(src, fch, dst, ch, n, overwrite); break;
+            }
+      }
+
+//---------------------------------------------------------
+//   deinterleave
+//---------------------------------------------------------
+
+void deinterleave(const float* src, int fileChannels, float** dst, int channels,
+   unsigned n, bool overwrite)
+      {
+      if (fileChannels == 1 && channels == 1 && overwrite) {
+            memcpy(dst[0], src, n * sizeof(float));
+            return;
+            }
+      deinterleaveT(src, fileChannels, dst, channels, n, overwrite);
+      }
+
+void deinterleave(const short* src, int fileChannels, float** dst, int channels,
+   unsigned n, bool overwrite)
+      {
+      deinterleaveT(src, fileChannels, dst, channels, n, overwrite);
+      }
+
+void deinterleave(const int* src, int fileChannels, float** dst, int channels,
+   unsigned n, bool overwrite)
+      {
+      deinterleaveT(src, fileChannels, dst, channels, n, overwrite);
+      }
+
+//---------------------------------------------------------
+//   interleaveCh
+//---------------------------------------------------------
+
+template <int CH>
+static void interleaveCh(float** src, float* dst, unsigned n, float limit)
+      {
+      for (int ch = 0; ch < CH; ++ch) {
+            const float* s = src[ch];
+            float* d = dst + ch;
+            for (unsigned i = 0; i < n; ++i)
+                  d[i * CH] = clip(s[i], limit);
+            }
+      }
+
+#ifdef __SSE2__
+
+//---------------------------------------------------------
+//   interleave2
+//---------------------------------------------------------
+
+static void interleave2(float** src, float* dst, unsigned n, float limit)
+      {
+      const __m128 hi = _mm_set1_ps(limit);
+      const __m128 lo = _mm_set1_ps(-limit);
+      const float* l = src[0];
+      const float* r = src[1];
+      unsigned i = 0;
+      for (; i + 4 <= n; i += 4, dst += 8) {
+            __m128 a = _mm_min_ps(_mm_max_ps(_mm_loadu_ps(l + i), lo), hi);
+            __m128 b = _mm_min_ps(_mm_max_ps(_mm_loadu_ps(r + i), lo), hi);
+            _mm_storeu_ps(dst,     _mm_unpacklo_ps(a, b));
+            _mm_storeu_ps(dst + 4, _mm_unpackhi_ps(a, b));
+            }
+      float* s[2] = { src[0] + i, src[1] + i };
+      interleaveCh<2>(s, dst, n - i, limit);
+      }
+
+#endif
+
+//---------------------------------------------------------
+//   interleave
+//---------------------------------------------------------
+
+void interleave(float** src, int channels, float* dst, int fch, unsigned n, float limit)
+      {
+      if (channels == fch) {
+            switch (fch) {
+                  case 1: interleaveCh<1>(src, dst, n, limit); return;
+#ifdef __SSE2__
+                  case 2: interleave2(src, dst, n, limit); return;
+#else
+                  case 2: interleaveCh<2>(src, dst, n, limit); return;
+#endif
+                  case 3: interleaveCh<3>(src, dst, n, limit); return;
+                  case 4: interleaveCh<4>(src, dst, n, limit); return;
+                  case 5: interleaveCh<5>(src, dst, n, limit); return;
+                  case 6: interleaveCh<6>(src, dst, n, limit); return;
+                  case 7: interleaveCh<7>(src, dst, n, limit); return;
+                  case 8: interleaveCh<8>(src, dst, n, limit); return;
+                  default: break;
+                  }
+            }
+      // Other mappings, a file channel at a time.
+      for (int c = 0; c < fch; ++c) {
+            float* d = dst + c;
+            if (channels > fch) {
+                  for (unsigned i = 0; i < n; ++i) {
+                        float v = 0.0f;
+                        for (int t = c; t < channels; t += fch)
+                              v += src[t][i];
+                        d[i * fch] = clip(v, limit);
+                        }
+                  }
+            else {
+                  const float* s = src[c % channels];
+                  for (unsigned i = 0; i < n; ++i)
+                        d[i * fch] = clip(s[i], limit);
+                  }
+            }
+      }
+
+} // namespace MusECore
@@ -0,0 +1,55 @@
+//=========================================================
+//  MusE
+//  Linux Music Editor
+//
+//  sampleconv.h
+//
+//  This program is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU General Public License
+//  as published by the Free Software Foundation; version 2 of
+//  the License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+//
+//=========================================================
+
+#ifndef __SAMPLECONV_H__
+#define __SAMPLECONV_H__
+
+namespace MusECore {
+
+//---------------------------------------------------------
+//   Sample conversion between interleaved sound file
+//   frames and the channel buffers of a track.
+//
+//   If the channel counts differ, a track channel gets the
+//   sum of the file channels with its index modulo the
+//   track channels (stereo to mono), or the file channel
+//   of its index modulo the file channels (mono to stereo).
+//
+//   Integer samples are scaled like libsndfile does for
+//   normalized float reads: short by 1/2^15, int (24 and
+//   32 bit pcm, left aligned) by 1/2^31.
+//---------------------------------------------------------
+
+extern void deinterleave(const float* src, int fileChannels, float** dst, int channels,
+   unsigned n, bool overwrite);
+extern void deinterleave(const short* src, int fileChannels, float** dst, int channels,
+   unsigned n, bool overwrite);
+extern void deinterleave(const int* src, int fileChannels, float** dst, int channels,
+   unsigned n, bool overwrite);
+
+// Interleaves and clips to -limit .. limit in one pass.
+extern void interleave(float** src, int channels, float* dst, int fileChannels,
+   unsigned n, float limit);
+
+} // namespace MusECore
+
+#endif
@@ -0,0 +1,400 @@
+//=========================================================
+//  MusE
+//  Linux Music Editor
+//
+//  sampleconv_bench.cpp
+//    Output and throughput of the sample conversion
+//    kernels against the per sample loops SndFile used
+//    before
+//
+//  This program is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU General Public License
+//  as published by the Free Software Foundation; version 2 of
+//  the License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+//
+//=========================================================
+
+//---------------------------------------------------------
+//    First checks that the kernels give the same samples
+//    as the old loops: each sample format and channel
+//    count, the mono/stereo mappings the old loops had,
+//    overwrite and mix, and frame counts that end in the
+//    middle of a vector. Exits with 1 on a difference.
+//
+//    Then converts noise in memory, one segment at a time like
+//    the prefetch thread and the record writer do. The
+//    old loops read floats only; for 16 and 32 bit input
+//    they are given the integer to float conversion
+//    libsndfile did for them. Printed per channel count,
+//    in MB/s of decoded float audio:
+//      float    float frames to channel buffers
+//      int16    16 bit frames to channel buffers
+//      int32    24/32 bit frames to channel buffers
+//      write    channel buffers to limited float frames
+//---------------------------------------------------------
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <time.h>
+#include <vector>
+
+#include "sampleconv.h"
+
+using MusECore::deinterleave;
+using MusECore::interleave;
+
+static const float limitValue = 0.9999f;
+
+//---------------------------------------------------------
+//   cpuTime
+//---------------------------------------------------------
+
+static double cpuTime()
+      {
+      struct timespec ts;
+      clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+      return ts.tv_sec + ts.tv_nsec * 1e-9;
+      }
+
+//---------------------------------------------------------
+//   oldRead
+//    The loop of the former SndFile::readInternal. False
+//    for the channel counts it did not handle.
+//---------------------------------------------------------
+
+static bool oldRead(const float* src, int fileChannels, float** dst, int channels,
+   unsigned n, bool overwrite)
+      {
+      if (fileChannels == channels) {
+            for (unsigned i = 0; i < n; ++i)
+                  for (int ch = 0; ch < channels; ++ch)
+                        if (overwrite)
+                              *(dst[ch]+i) = *src++;
+                        else
+                              *(dst[ch]+i) += *src++;
+            }
+      else if (channels == 1 && fileChannels == 2) {
+            for (unsigned i = 0; i < n; ++i)
+                  if (overwrite)
+                        *(dst[0] + i) = src[i + i] + src[i + i + 1];
+                  else
+                        *(dst[0] + i) += src[i + i] + src[i + i + 1];
+            }
+      else if (channels == 2 && fileChannels == 1) {
+            for (unsigned i = 0; i < n; ++i) {
+                  float data = *src++;
+                  if (overwrite) {
+                        *(dst[0]+i) = data;
+                        *(dst[1]+i) = data;
+                        }
+                  else {
+                        *(dst[0]+i) += data;
+                        *(dst[1]+i) += data;
+                        }
+                  }
+            }
+      else
+            return false;
+      return true;
+      }
+
+//---------------------------------------------------------
+//   oldWrite
+//    The loop of the former SndFile::write.
+//---------------------------------------------------------
+
+static bool oldWrite(float** src, int channels, float* dst, int fileChannels, unsigned n)
+      {
+      if (channels == fileChannels) {
+            for (unsigned i = 0; i < n; ++i)
+                  for (int ch = 0; ch < channels; ++ch)
+                        if (*(src[ch]+i) > 0)
+                              *dst++ = *(src[ch]+i) < limitValue ? *(src[ch]+i) : limitValue;
+                        else
+                              *dst++ = *(src[ch]+i) > -limitValue ? *(src[ch]+i) : -limitValue;
+            }
+      else if (channels == 1 && fileChannels == 2) {
+            for (unsigned i = 0; i < n; ++i) {
+                  float data = *(src[0]+i);
+                  if (data > 0) {
+                        *dst++ = data < limitValue ? data : limitValue;
+                        *dst++ = data < limitValue ? data : limitValue;
+                        }
+                  else {
+                        *dst++ = data > -limitValue ? data : -limitValue;
+                        *dst++ = data > -limitValue ? data : -limitValue;
+                        }
+                  }
+            }
+      else if (channels == 2 && fileChannels == 1) {
+            for (unsigned i = 0; i < n; ++i)
+                  if (*(src[0]+i) + *(src[1]+i) > 0)
+                        *dst++ = (*(src[0]+i) + *(src[1]+i)) < limitValue ? (*(src[0]+i) + *(src[1]+i)) : limitValue;
+                  else
+                        *dst++ = (*(src[0]+i) + *(src[1]+i)) > -limitValue ? (*(src[0]+i) + *(src[1]+i)) : -limitValue;
+            }
+      else
+            return false;
+      return true;
+      }
+
+//---------------------------------------------------------
+//   Data
+//---------------------------------------------------------
+
+struct Data {
+      int channels;
+      unsigned segment;
+      unsigned segments;
+      std::vector<float> f;         // interleaved
+      std::vector<short> s;
+      std::vector<int> i;
+      std::vector<float> out;       // channel after channel
+      std::vector<float*> dst;
+      std::vector<float> conv;      // one segment, interleaved
+
+      Data(int ch, unsigned seg, unsigned segs)
+         : channels(ch), segment(seg), segments(segs),
+           f(size_t(seg) * segs * ch), s(f.size()), i(f.size()),
+           out(size_t(seg) * ch), dst(ch), conv(size_t(seg) * ch)
+            {
+            for (size_t k = 0; k < f.size(); ++k) {
+                  f[k] = 2.2f * rand() / RAND_MAX - 1.1f;
+                  s[k] = short(rand() - RAND_MAX / 2);
+                  i[k] = rand() - RAND_MAX / 2;
+                  }
+            for (int c = 0; c < ch; ++c)
+                  dst[c] = &out[size_t(c) * seg];
+            }
+      double mb() const { return double(f.size()) * sizeof(float) / (1024 * 1024); }
+      };
+
+//---------------------------------------------------------
+//   run
+//    MB/s of one way, old or new.
+//---------------------------------------------------------
+
+enum Kind { FLOAT, INT16, INT32, WRITE };
+
+static double run(Data& d, Kind kind, bool old, int rounds)
+      {
+      const int ch = d.channels;
+      const unsigned seg = d.segment;
+      const size_t step = size_t(seg) * ch;
+      const double t0 = cpuTime();
+      for (int r = 0; r < rounds; ++r) {
+            for (unsigned k = 0; k < d.segments; ++k) {
+                  const size_t off = k * step;
+                  switch (kind) {
+                        case FLOAT:
+                              if (old)
+                                    oldRead(&d.f[off], ch, &d.dst[0], ch, seg, true);
+                              else
+                                    deinterleave(&d.f[off], ch, &d.dst[0], ch, seg, true);
+                              break;
+                        case INT16:
+                              if (old) {
+                                    for (size_t j = 0; j < step; ++j)
+                                          d.conv[j] = d.s[off + j] * (1.0f / 32768.0f);
+                                    oldRead(&d.conv[0], ch, &d.dst[0], ch, seg, true);
+                                    }
+                              else
+                                    deinterleave(&d.s[off], ch, &d.dst[0], ch, seg, true);
+                              break;
+                        case INT32:
+                              if (old) {
+                                    for (size_t j = 0; j < step; ++j)
+                                          d.conv[j] = d.i[off + j] * (1.0f / 2147483648.0f);
+                                    oldRead(&d.conv[0], ch, &d.dst[0], ch, seg, true);
+                                    }
+                              else
+                                    deinterleave(&d.i[off], ch, &d.dst[0], ch, seg, true);
+                              break;
+                        case WRITE:
+                              {
+                              float* src[ch];
+                              for (int c = 0; c < ch; ++c)
+                                    src[c] = &d.f[off + size_t(c) * seg];
+                              if (old)
+                                    oldWrite(src, ch, &d.conv[0], ch, seg);
+                              else
+                                    interleave(src, ch, &d.conv[0], ch, seg, limitValue);
+                              }
+                              break;
+                        }
+                  }
+            }
+      const double t = cpuTime() - t0;
+      return t > 0.0 ? d.mb() * rounds / t : 0.0;
+      }
+
+//---------------------------------------------------------
+//   verify
+//    n frames of noise through the old loop and the new
+//    kernel, fch file channels, ch track channels. Returns
+//    the number of samples that differ, -1 if the old
+//    loops did not handle the channel counts.
+//---------------------------------------------------------
+
+static int verify(Kind kind, int fch, int ch, unsigned n, bool overwrite)
+      {
+      std::vector<float> f(size_t(n) * fch);
+      std::vector<short> s(f.size());
+      std::vector<int> i(f.size());
+      std::vector<float> conv(f.size());
+      for (size_t k = 0; k < f.size(); ++k) {
+            f[k] = 2.2f * rand() / RAND_MAX - 1.1f;
+            s[k] = short(rand() - RAND_MAX / 2);
+            i[k] = rand() - RAND_MAX / 2;
+            }
+      // Track side, old and new, starting out equal.
+      std::vector<float> a(size_t(n) * ch), b(a.size());
+      std::vector<float*> pa(ch), pb(ch);
+      for (size_t k = 0; k < a.size(); ++k)
+            a[k] = b[k] = 2.2f * rand() / RAND_MAX - 1.1f;
+      for (int c = 0; c < ch; ++c) {
+            pa[c] = &a[size_t(c) * n];
+            pb[c] = &b[size_t(c) * n];
+            }
+
+      bool handled = true;
+      switch (kind) {
+            case FLOAT:
+                  handled = oldRead(&f[0], fch, &pa[0], ch, n, overwrite);
+                  deinterleave(&f[0], fch, &pb[0], ch, n, overwrite);
+                  break;
+            case INT16:
+                  for (size_t k = 0; k < f.size(); ++k)
+                        conv[k] = s[k] * (1.0f / 32768.0f);
+                  handled = oldRead(&conv[0], fch, &pa[0], ch, n, overwrite);
+                  deinterleave(&s[0], fch, &pb[0], ch, n, overwrite);
+                  break;
+            case INT32:
+                  for (size_t k = 0; k < f.size(); ++k)
+                        conv[k] = i[k] * (1.0f / 2147483648.0f);
+                  handled = oldRead(&conv[0], fch, &pa[0], ch, n, overwrite);
+                  deinterleave(&i[0], fch, &pb[0], ch, n, overwrite);
+                  break;
+            case WRITE:
+                  // File side: f for the old loop, conv for the new.
+                  handled = oldWrite(&pa[0], ch, &f[0], fch, n);
+                  interleave(&pa[0], ch, &conv[0], fch, n, limitValue);
+                  a.swap(f);
+                  b.swap(conv);
+                  break;
+            }
+      if (!handled)
+            return -1;
+      int diffs = 0;
+      for (size_t k = 0; k < a.size(); ++k)
+            if (a[k] != b[k])
+                  ++diffs;
+      return diffs;
+      }
+
+//---------------------------------------------------------
+//   verifyAll
+//    Prints the cases that differ, returns their number.
+//---------------------------------------------------------
+
+static int verifyAll(int maxChannels, unsigned segment)
+      {
+      static const char* kindName[] = { "float", "int16", "int32", "write" };
+      // Whole vectors, and every tail length of the SSE loops.
+      const unsigned lengths[] = { segment, 1, 2, 3, 5, 6, 7, segment + 3 };
+      int failed = 0, cases = 0;
+      for (int fch = 1; fch <= maxChannels; ++fch) {
+            for (int ch = 1; ch <= maxChannels; ++ch) {
+                  for (int k = FLOAT; k <= WRITE; ++k) {
+                        for (int ow = 0; ow < 2; ++ow) {
+                              // Writing always overwrites.
+                              if (k == WRITE && !ow)
+                                    continue;
+                              for (size_t l = 0; l < sizeof(lengths) / sizeof(*lengths); ++l) {
+                                    int d = verify(Kind(k), fch, ch, lengths[l], ow);
+                                    if (d < 0)
+                                          break;
+                                    ++cases;
+                                    if (d) {
+                                          printf("%s %d -> %d channels, %u frames, %s: %d samples differ\n",
+                                             kindName[k], fch, ch, lengths[l], ow ? "overwrite" : "mix", d);
+                                          ++failed;
+                                          }
+                                    }
+                              }
+                        }
+                  }
+            }
+      printf("%d of %d cases as before\n\n", cases - failed, cases);
+      return failed;
+      }
+
+//---------------------------------------------------------
+//   usage
+//---------------------------------------------------------
+
+static void usage(const char* prog)
+      {
+      fprintf(stderr,
+         "usage: %s [-c max channels] [-n segment] [-m MB per channel count] [-r rounds]\n"
+         "   defaults: -c 8 -n 1024 -m 32 -r 20\n", prog);
+      }
+
+//---------------------------------------------------------
+//   main
+//---------------------------------------------------------
+
+int main(int argc, char* argv[])
+      {
+      int maxChannels = 8;
+      int segment     = 1024;
+      int mb          = 32;
+      int rounds      = 20;
+
+      int c;
+      while ((c = getopt(argc, argv, "c:n:m:r:h")) != EOF) {
+            switch (c) {
+                  case 'c': maxChannels = atoi(optarg); break;
+                  case 'n': segment     = atoi(optarg); break;
+                  case 'm': mb          = atoi(optarg); break;
+                  case 'r': rounds      = atoi(optarg); break;
+                  default:
+                        usage(argv[0]);
+                        return 1;
+                  }
+            }
+      if (maxChannels <= 0 || segment <= 0 || mb <= 0 || rounds <= 0) {
+            usage(argv[0]);
+            return 1;
+            }
+
+      if (verifyAll(maxChannels, segment))
+            return 1;
+
+      printf("%d frame segments, %d MB, %d rounds, MB/s old -> new\n\n", segment, mb, rounds);
+      printf("ch        float               int16               int32               write\n");
+      for (int ch = 1; ch <= maxChannels; ++ch) {
+            unsigned segs = unsigned((size_t(mb) * 1024 * 1024) / (sizeof(float) * segment * ch));
+            if (segs == 0)
+                  segs = 1;
+            Data d(ch, segment, segs);
+            printf("%2d", ch);
+            for (int k = FLOAT; k <= WRITE; ++k) {
+                  double o = run(d, Kind(k), true, rounds);
+                  double n = run(d, Kind(k), false, rounds);
+                  printf("  %8.0f -> %8.0f", o, n);
+                  }
+            printf("\n");
+            }
+      return 0;
+      }
@@ -206,6 +206,9 @@ void Audio::msgAddRoute1(Route src, Route dst)
 
 void Audio::msgAddPlugin(AudioTrack* node, int idx, PluginI* plugin)
       {
+      // The audio thread deletes the plugin replaced, it must not
+      //  wait for its instantiation.
+      node->efxPipe()->cancelJobs(idx);
       AudioMsg msg;
       msg.id     = AUDIO_ADDPLUGIN;
       msg.snode  = node;
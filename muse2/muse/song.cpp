@@ -37,6 +37,7 @@
 #include <QProcess>
 #include <QByteArray>
 #include <QProgressDialog>
+#include <QTimer>
 
 #include "app.h"
 #include "driver/jackmidi.h"
@@ -67,6 +68,8 @@
 #include <sys/wait.h>
 #include "tempo.h"
 #include "route.h"
+#include "recwriter.h"
+#include "pluginbridge.h"
 
 namespace MusEGlobal {
 MusECore::Song* song = 0;
@@ -96,6 +99,8 @@ Song::Song(const char* name)
       bounceTrack = NULL;
       bounceOutput = NULL;
       showSongInfo=true;
+      _changesPosted = false;
+      _delivering = 0;
       clearDrumMap(); // One-time only early init
       clear(false);
       }
@@ -1300,10 +1305,67 @@ void Song::update(MusECore::SongChangedFlags_t flags, bool allowRecursion)
             return;
             }
       ++level;
-      emit songChanged(flags);
+      // Delivered right away, together with anything still pending.
+      _changes.add(flags);
+      deliverChanges();
       --level;
       }
 
+//---------------------------------------------------------
+//   postChanges
+//    Operation groups collect their flags and the tracks
+//    and parts they touched in _changes. All that comes
+//    together until the gui event loop is back is delivered
+//    as one songChanged(), so a burst of operations (scripts,
+//    bulk edits) costs the views one rebuild.
+//---------------------------------------------------------
+
+void Song::postChanges(MusECore::SongChangedFlags_t flags)
+      {
+      _changes.add(flags, true);
+      if (!_changesPosted && !_changes.empty()) {
+            _changesPosted = true;
+            QTimer::singleShot(0, this, SLOT(deliverChanges()));
+            }
+      }
+
+//---------------------------------------------------------
+//   deliverChanges
+//---------------------------------------------------------
+
+void Song::deliverChanges()
+      {
+      _changesPosted = false;
+      if (_changes.empty())
+            return;
+      // An update() from within a songChanged() slot is delivered
+      //  nested, the outer journal is restored after it.
+      SongChanges outer;
+      outer.swap(_delivered);
+      _delivered.swap(_changes);
+      ++_delivering;
+      emit songChanged(_delivered.flags());
+      --_delivering;
+      _delivered.swap(outer);
+      }
+
+//---------------------------------------------------------
+//   changes
+//    What the songChanged(flags) being handled is about.
+//    Outside of a delivery, e.g. when a view calls its own
+//    songChanged() slot, anything may have changed.
+//---------------------------------------------------------
+
+const SongChanges& Song::changes(MusECore::SongChangedFlags_t flags) const
+      {
+      static SongChanges unknown;
+      if (unknown.empty())
+            unknown.add(SC_EVERYTHING);
+      if (_delivering && (flags & ~_delivered.flags()) == 0)
+            return _delivered;
+      return unknown;
+      }
+
 //---------------------------------------------------------
 //   updatePos
 //---------------------------------------------------------
@@ -1616,14 +1678,31 @@ void Song::beat()
       _heartbeatRateTimer = t;
       #endif
       
-      //First: update cpu load toolbar
+      //First: update cpu load toolbar. The labels are connected to
+      // cpuLoadTextChanged(), only sent when the text changes.
 
-      QList<QLabel *> jackCpuLoadLabelList = MusEGlobal::muse->findChildren<QLabel *>("JackCpuLoadToolbarLabel");
-      QList<QLabel *>::const_iterator it;
-      for(it = jackCpuLoadLabelList.begin(); it != jackCpuLoadLabelList.end(); ++it)
+      const QString cpuLoad = QString("<b>CPU (%)</b>: ") + QString("%1").arg((double)MusEGlobal::muse->getCPULoad(), 4, 'f', 1, QChar('0'));
+      if(cpuLoad != _cpuLoadText)
       {
-         //(*it)->setText(QString("<b>CPU (%): </b>") + QString::number(MusEGlobal::audioDevice->getCPULoad(), 'f', 2));
-         (*it)->setText(QString("<b>CPU (%)</b>: ") + QString("%1").arg((double)MusEGlobal::muse->getCPULoad(), 4, 'f', 1, QChar('0')));
+         _cpuLoadText = cpuLoad;
+         emit cpuLoadTextChanged(_cpuLoadText);
+      }
+
+      // How close the record writers are to losing audio.
+      QString recBuffer = _recordBufferText;
+      int fill, overruns;
+      if(!MusEGlobal::audio->isRecording())
+        recBuffer = QString();
+      else if(MusEGlobal::recordWriter && MusEGlobal::recordWriter->health(&fill, &overruns))
+      {
+        recBuffer = QString("<b>Rec buffer (%)</b>: %1").arg(fill, 3);
+        if(overruns)
+          recBuffer += QString(" <font color=red>%1 lost</font>").arg(overruns);
+      }
+      if(recBuffer != _recordBufferText)
+      {
+         _recordBufferText = recBuffer;
+         emit recordBufferTextChanged(_recordBufferText);
       }
 
       // Keep the sync detectors running... 
@@ -1639,6 +1718,8 @@ void Song::beat()
         MusEGlobal::tempo_rec_list.addTempo(_tempoFifo.get()); 
       
       // Update anything related to audio controller graphs etc.
+      // Cleared before looking, so nothing set meanwhile is lost.
+      if(CtrlList::takeAnyGuiUpdatePending())
       for(ciTrack it = _tracks.begin(); it != _tracks.end(); ++ it)
       {
         if((*it)->isMidiTrack())
@@ -1657,6 +1738,9 @@ void Song::beat()
       // Update synth native guis at the heartbeat rate.
       for(ciSynthI is = _synthIs.begin(); is != _synthIs.end(); ++is)
         (*is)->guiHeartBeat();
+
+      // Report bridged plugins which crashed or stopped responding.
+      BridgedPlugin::reap();
       
       while (noteFifoSize) {
             int pv = recNoteFifo[noteFifoRindex];
@@ -1799,7 +1883,7 @@ void Song::endMsgCmd()
             
             MusEGlobal::redoAction->setEnabled(false);
             setUndoRedoText();
-            emit songChanged(updateFlags);
+            postChanges(updateFlags);
             }
       }
 
@@ -1832,7 +1916,7 @@ void Song::undo()
       if(updateFlags)
         MusEGlobal::audio->msgUpdateSoloStates();
 
-      emit songChanged(updateFlags);
+      postChanges(updateFlags);
       emit sigDirty();
 }
 
@@ -1865,7 +1949,7 @@ void Song::redo()
       if(updateFlags & (SC_TRACK_REMOVED | SC_TRACK_INSERTED))
         MusEGlobal::audio->msgUpdateSoloStates();
 
-      emit songChanged(updateFlags);
+      postChanges(updateFlags);
       emit sigDirty();
 }
 
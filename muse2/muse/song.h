@@ -40,6 +40,7 @@
 #include "track.h"
 #include "synth.h"
 #include "operations.h"
+#include "songchanges.h"
 
 class QAction;
 class QFont;
@@ -135,6 +136,12 @@ class Song : public QObject {
       TempoFifo _tempoFifo; // External tempo changes, processed in heartbeat.
       
       MusECore::SongChangedFlags_t updateFlags;
+      SongChanges _changes;         // collected, not yet delivered
+      SongChanges _delivered;       // being delivered by songChanged()
+      bool _changesPosted;
+      int _delivering;
+      QString _cpuLoadText;
+      QString _recordBufferText;
 
       TrackList _tracks;      // tracklist as seen by arranger
       MidiTrackList  _midis;
@@ -210,6 +217,10 @@ class Song : public QObject {
 
       void putEvent(int pv);
       void endMsgCmd();
+      const QString& cpuLoadText() const { return _cpuLoadText; }
+      const QString& recordBufferText() const { return _recordBufferText; }
+      void postChanges(MusECore::SongChangedFlags_t);
+      const SongChanges& changes(MusECore::SongChangedFlags_t) const;
       void processMsg(AudioMsg* msg);
 
       void setFollow(FollowMode m)     { _follow = m; }
@@ -446,8 +457,13 @@ public:
       QString getScriptPath(int id, bool delivered);
       void populateScriptMenu(QMenu* menuPlugins, QObject* receiver);
 
+   private slots:
+      void deliverChanges();
+
    signals:
       void songChanged(MusECore::SongChangedFlags_t); 
+      void cpuLoadTextChanged(const QString&);
+      void recordBufferTextChanged(const QString&);
       void posChanged(int, unsigned, bool);
       void loopChanged(bool);
       void recordChanged(bool);
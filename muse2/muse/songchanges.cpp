@@ -0,0 +1,155 @@
+//=========================================================
+//  MusE
+//  Linux Music Editor
+//
+//  songchanges.cpp
+//
+//  This program is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU General Public License
+//  as published by the Free Software Foundation; version 2 of
+//  the License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+//
+//=========================================================
+
+#include "songchanges.h"
+#include "undo.h"
+#include "part.h"
+#include "track.h"
+
+namespace MusECore {
+
+//---------------------------------------------------------
+//   add
+//---------------------------------------------------------
+
+void SongChanges::add(SongChangedFlags_t flags, bool objectsKnown)
+      {
+      _flags |= flags;
+      if (!objectsKnown && flags)
+            _everything = true;
+      }
+
+void SongChanges::add(const UndoOp& op)
+      {
+      switch (op.type) {
+            case UndoOp::AddTrack:
+            case UndoOp::DeleteTrack:
+            case UndoOp::ModifyTrackName:
+                  addTrack(op.track);
+                  break;
+            case UndoOp::ModifyTrackChannel:
+                  addTrack(op._propertyTrack);
+                  break;
+            case UndoOp::MovePart:
+                  addTrack(op.track);
+                  addTrack(op.oldTrack);
+                  addPart(op.part);
+                  break;
+            case UndoOp::AddPart:
+            case UndoOp::DeletePart:
+            case UndoOp::ModifyPartLength:
+            case UndoOp::ModifyPartName:
+            case UndoOp::SelectPart:
+            case UndoOp::AddEvent:
+            case UndoOp::DeleteEvent:
+            case UndoOp::ModifyEvent:
+            case UndoOp::SelectEvent:
+                  addPart(op.part);
+                  break;
+            // Track order, or any part playing the clip.
+            case UndoOp::MoveTrack:
+            case UndoOp::ModifyClip:
+                  _everything = true;
+                  break;
+            // Tempo, signature, key, markers, routes etc.
+            //  are told by the flags alone.
+            default:
+                  break;
+            }
+      }
+
+//---------------------------------------------------------
+//   addTrack
+//---------------------------------------------------------
+
+void SongChanges::addTrack(const Track* t)
+      {
+      if (t)
+            _tracks.insert(t);
+      }
+
+//---------------------------------------------------------
+//   addPart
+//    Clones share the changes, take the whole chain.
+//---------------------------------------------------------
+
+void SongChanges::addPart(const Part* p)
+      {
+      if (!p)
+            return;
+      const Part* cp = p;
+      do {
+            _parts.insert(cp);
+            cp = cp->nextClone();
+            } while (cp && cp != p);
+      }
+
+//---------------------------------------------------------
+//   clear
+//---------------------------------------------------------
+
+void SongChanges::clear()
+      {
+      _flags      = 0;
+      _everything = false;
+      _tracks.clear();
+      _parts.clear();
+      }
+
+//---------------------------------------------------------
+//   swap
+//---------------------------------------------------------
+
+void SongChanges::swap(SongChanges& c)
+      {
+      std::swap(_flags, c._flags);
+      std::swap(_everything, c._everything);
+      _tracks.swap(c._tracks);
+      _parts.swap(c._parts);
+      }
+
+//---------------------------------------------------------
+//   touches
+//---------------------------------------------------------
+
+bool SongChanges::touches(const Track* t) const
+      {
+      return _everything || _tracks.find(t) != _tracks.end();
+      }
+
+bool SongChanges::touches(const Part* p) const
+      {
+      return _everything || _parts.find(p) != _parts.end()
+         || _tracks.find(p->track()) != _tracks.end();
+      }
+
+bool SongChanges::touches(const PartList* pl) const
+      {
+      if (_everything)
+            return true;
+      for (ciPart ip = pl->begin(); ip != pl->end(); ++ip)
+            if (touches(ip->second))
+                  return true;
+      return false;
+      }
+
+} // namespace MusECore
@@ -0,0 +1,74 @@
+//=========================================================
+//  MusE
+//  Linux Music Editor
+//
+//  songchanges.h
+//
+//  This program is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU General Public License
+//  as published by the Free Software Foundation; version 2 of
+//  the License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+//
+//=========================================================
+
+#ifndef __SONGCHANGES_H__
+#define __SONGCHANGES_H__
+
+#include <set>
+
+#include "type_defs.h"
+
+namespace MusECore {
+
+class Track;
+class Part;
+class PartList;
+struct UndoOp;
+
+//---------------------------------------------------------
+//   SongChanges
+//    Journal of what changed since the last songChanged():
+//    the flags and the tracks and parts the operations
+//    touched. The tracks and parts only narrow down the
+//    track, part and event flags. Changes reported by flags
+//    alone mean anything may have changed.
+//---------------------------------------------------------
+
+class SongChanges {
+      SongChangedFlags_t _flags;
+      bool _everything;
+      std::set<const Track*> _tracks;
+      std::set<const Part*> _parts;
+
+   public:
+      SongChanges() : _flags(0), _everything(false) {}
+
+      SongChangedFlags_t flags() const { return _flags; }
+      bool empty() const               { return _flags == 0; }
+      bool everything() const          { return _everything; }
+
+      void add(SongChangedFlags_t flags, bool objectsKnown = false);
+      void add(const UndoOp&);
+      void addTrack(const Track*);
+      void addPart(const Part*);
+      void setEverything()             { _everything = true; }
+      void clear();
+      void swap(SongChanges&);
+
+      bool touches(const Track*) const;
+      bool touches(const Part*) const;
+      bool touches(const PartList*) const;
+      };
+
+} // namespace MusECore
+
+#endif
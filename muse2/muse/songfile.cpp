@@ -48,6 +48,7 @@
 #include "conf.h"
 #include "driver/jackmidi.h"
 #include "keyevent.h"
+#include "pluginpool.h"
 
 namespace MusEGlobal {
 MusECore::CloneList cloneList;
@@ -1074,6 +1075,9 @@ void MusE::read(MusECore::Xml& xml, bool doReadMidiPorts, bool isTemplate)
                         else if (tag == "song")
                         {
                               MusEGlobal::song->read(xml, isTemplate);
+                              // Wait for the plugin handles created in the background.
+                              if (MusEGlobal::pluginPool)
+                                    MusEGlobal::pluginPool->finishAll();
                               MusEGlobal::audio->msgUpdateSoloStates();
                               // Inform the rest of the app that the song (may) have changed, using these flags.
                               // After this function is called, the caller can do a general Song::update() MINUS these flags,
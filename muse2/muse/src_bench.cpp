@@ -0,0 +1,161 @@
+//=========================================================
+//  MusE
+//  Linux Music Editor
+//
+//  src_bench.cpp
+//    How many streams of clips with another sample rate
+//    one core can convert in real time, per converter type
+//
+//  This program is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU General Public License
+//  as published by the Free Software Foundation; version 2 of
+//  the License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+//
+//=========================================================
+
+//---------------------------------------------------------
+//    Converts noise the way SRCAudioConverter::process does
+//    for the prefetch thread: one src_process() call per
+//    segment into an interleaved buffer, unused input given
+//    back, then split into the track channels. The input
+//    comes from memory, so this is the converter cost alone,
+//    without disk reads. Printed per converter type:
+//      cpu      cpu seconds per second of converted audio
+//      streams  how many such streams one core keeps up with
+//---------------------------------------------------------
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <math.h>
+#include <time.h>
+#include <vector>
+
+#include <samplerate.h>
+
+//---------------------------------------------------------
+//   cpuTime
+//---------------------------------------------------------
+
+static double cpuTime()
+      {
+      struct timespec ts;
+      clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+      return ts.tv_sec + ts.tv_nsec * 1e-9;
+      }
+
+//---------------------------------------------------------
+//   run
+//    Returns cpu seconds per second of output.
+//---------------------------------------------------------
+
+static double run(int type, int fileRate, int rate, int channels, int segment, double seconds)
+      {
+      const long fileFrames = long(fileRate * seconds) + 1024;
+      std::vector<float> in(fileFrames * channels);
+      for (size_t i = 0; i < in.size(); ++i)
+            in[i] = float(rand()) / RAND_MAX - 0.5f;
+
+      int err;
+      SRC_STATE* state = src_new(type, channels, &err);
+      if (!state) {
+            fprintf(stderr, "src_new: %s\n", src_strerror(err));
+            return -1.0;
+            }
+
+      const double ratio = double(rate) / double(fileRate);
+      std::vector<float> out(segment * channels);
+      std::vector<float> dst(segment * channels);
+      const long segments = long(rate * seconds) / segment;
+      long pos = 0;
+
+      const double t0 = cpuTime();
+      for (long s = 0; s < segments; ++s) {
+            long inFrames = long(ceil(segment / ratio)) + 1;
+            if (pos + inFrames > fileFrames)
+                  break;
+            SRC_DATA d;
+            d.data_in       = &in[pos * channels];
+            d.data_out      = &out[0];
+            d.input_frames  = inFrames;
+            d.output_frames = segment;
+            d.end_of_input  = 0;
+            d.src_ratio     = ratio;
+            if (src_process(state, &d)) {
+                  fprintf(stderr, "src_process failed\n");
+                  break;
+                  }
+            pos += d.input_frames_used;
+            // Deinterleave, like the copy into the track buffers.
+            const float* p = &out[0];
+            for (long i = 0; i < d.output_frames_gen; ++i)
+                  for (int ch = 0; ch < channels; ++ch)
+                        dst[ch * segment + i] = *p++;
+            }
+      const double t = cpuTime() - t0;
+      src_delete(state);
+      return t / seconds;
+      }
+
+//---------------------------------------------------------
+//   usage
+//---------------------------------------------------------
+
+static void usage(const char* prog)
+      {
+      fprintf(stderr,
+         "usage: %s [-r file rate] [-R session rate] [-c channels] [-n segment] [-s seconds]\n"
+         "   defaults: -r 44100 -R 48000 -c 2 -n 1024 -s 20\n", prog);
+      }
+
+//---------------------------------------------------------
+//   main
+//---------------------------------------------------------
+
+int main(int argc, char* argv[])
+      {
+      int fileRate = 44100;
+      int rate     = 48000;
+      int channels = 2;
+      int segment  = 1024;
+      double seconds = 20.0;
+
+      int c;
+      while ((c = getopt(argc, argv, "r:R:c:n:s:h")) != EOF) {
+            switch (c) {
+                  case 'r': fileRate = atoi(optarg); break;
+                  case 'R': rate     = atoi(optarg); break;
+                  case 'c': channels = atoi(optarg); break;
+                  case 'n': segment  = atoi(optarg); break;
+                  case 's': seconds  = atof(optarg); break;
+                  default:
+                        usage(argv[0]);
+                        return 1;
+                  }
+            }
+      if (fileRate <= 0 || rate <= 0 || channels <= 0 || segment <= 0 || seconds <= 0.0) {
+            usage(argv[0]);
+            return 1;
+            }
+
+      printf("%d Hz -> %d Hz, %d channels, %d frame segments, %.0f s\n\n",
+         fileRate, rate, channels, segment, seconds);
+      printf("type  converter                         cpu     streams\n");
+      for (int type = SRC_SINC_BEST_QUALITY; type <= SRC_LINEAR; ++type) {
+            double load = run(type, fileRate, rate, channels, segment, seconds);
+            if (load < 0.0)
+                  continue;
+            printf("%4d  %-32s %7.4f  %8.1f\n", type, src_get_name(type), load,
+               load > 0.0 ? 1.0 / load : 0.0);
+            }
+      return 0;
+      }
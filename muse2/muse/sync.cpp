@@ -598,15 +598,44 @@ void MidiSeq::mmcInput(int port, const unsigned char* p, int n)
             }
       }
 
+//---------------------------------------------------------
+//   mtcFps
+//    Frame rate of an MTC type, as MTC::time() counts them.
+//---------------------------------------------------------
+
+static double mtcFps(int type)
+      {
+      switch (type) {
+            case 0:  return 24.0;
+            case 1:  return 25.0;
+            default: return 30.0;
+            }
+      }
+
 //---------------------------------------------------------
 //   mtcInputQuarter
 //    process Quarter Frame Message
 //---------------------------------------------------------
 
-void MidiSeq::mtcInputQuarter(int port, unsigned char c)
+void MidiSeq::mtcInputQuarter(int port, unsigned char c, double time)
       {
       static int hour, min, sec, frame;
       
+      // Quarter frames are evenly spaced pulses, track their rate and phase.
+      if(port == MusEGlobal::curMidiSyncInPort)
+      {
+        _mtcDll.input(time > 0.0 ? time : curTime());
+        if(_mtcDll.locked() != _mtcLocked)
+        {
+          _mtcLocked = _mtcDll.locked();
+          if(MusEGlobal::debugSync || !_mtcLocked)
+            printf("MusE: MTC %s: speed %.4f, jitter %.3f ms, %d lock losses\n",
+               _mtcLocked ? "locked" : "lost lock",
+               _mtcDll.period() > 0.0 ? 1.0 / (4.0 * mtcFps(MusEGlobal::midiPorts[port].syncInfo().recMTCtype()) * _mtcDll.period()) : 0.0,
+               _mtcDll.jitter() * 1000.0, _mtcDll.unlocks());
+        }
+      }
+      
       int valL = c & 0xf;
       int valH = valL << 4;
 
@@ -830,6 +859,109 @@ void MidiSeq::alignAllTicks(int frameOverride)
         _averagerFull[i] = false;
       }
       _lastRealTempo = 0.0;
+      publishExtClock(false);
+      }
+
+//---------------------------------------------------------
+//   publishExtClock
+//    Hand the last received clock to the audio thread.
+//    Writers take turns by making the sequence odd.
+//---------------------------------------------------------
+
+void MidiSeq::publishExtClock(bool valid)
+      {
+      int seq;
+      do {
+            seq = _extClockSeq.loadAcquire() & ~1;
+            } while (!_extClockSeq.testAndSetOrdered(seq, seq + 1));
+      _extClock.tick   = MusEGlobal::curExtMidiSyncTick;
+      _extClock.time   = _clockDll.lastPulse();
+      _extClock.period = _clockDll.period();
+      _extClock.valid  = valid;
+      _extClockSeq.storeRelease(seq + 2);
+      }
+
+//---------------------------------------------------------
+//   extClockTick
+//    Song tick at time (curTime() clock), following the
+//    phase of the external clock between clocks, but never
+//    more than one clock ahead of the last one received.
+//    Returns false if the clock DLL is not locked, or if
+//    no consistent copy could be had after a few tries.
+//    Called from the audio thread.
+//---------------------------------------------------------
+
+bool MidiSeq::extClockTick(double time, unsigned* tick) const
+      {
+      ExtClock c;
+      int tries = 0;
+      for (;; ++tries) {
+            if (tries == 8)
+                  return false;   // a writer was preempted, don't spin on it
+            const int seq = _extClockSeq.loadAcquire();
+            if (seq & 1)
+                  continue;
+            c = _extClock;
+            __atomic_thread_fence(__ATOMIC_ACQUIRE);
+            if (_extClockSeq.loadAcquire() == seq)
+                  break;
+            }
+      if (!c.valid || c.period <= 0.0)
+            return false;
+      double phase = (time - c.time) / c.period;
+      if (phase > 1.0)
+            phase = 1.0;
+      else if (phase < -1.0)
+            phase = -1.0;
+      const int t = int(c.tick) + lrint(phase * (MusEGlobal::config.division / 24));
+      *tick = t < 0 ? 0 : t;
+      return true;
+      }
+
+//---------------------------------------------------------
+//   recordExtTempo
+//    Add a recorded external tempo at tick, quantized, if
+//    it differs enough from the last one.
+//---------------------------------------------------------
+
+void MidiSeq::recordExtTempo(double real_tempo, int tick)
+      {
+      // Without quantization still ignore the small wobble left
+      //  in the DLL period, or every clock would add a tempo.
+      const double hysteresis = _tempoQuantizeAmount > 0.0 ? _tempoQuantizeAmount/2.0 : 0.1;
+      if(fabs(real_tempo - _lastRealTempo) < hysteresis)
+        return;
+      if(_tempoQuantizeAmount > 0.0)
+      {
+        double f_mod = fmod(real_tempo, _tempoQuantizeAmount);
+        if(f_mod < _tempoQuantizeAmount/2.0)
+          real_tempo -= f_mod;
+        else
+          real_tempo += _tempoQuantizeAmount - f_mod;
+      }
+      _lastRealTempo = real_tempo;
+      int new_tempo = ((1000000.0 * 60.0) / (real_tempo));
+      if(new_tempo == lastTempo)
+        return;
+      lastTempo = new_tempo;
+      if(tick < 0)
+        tick = 0;
+      if(MusEGlobal::debugSync)
+        printf("adding new pll tempo tick:%d curExtMidiSyncTick:%d real_tempo:%f new_tempo:%d\n", tick, MusEGlobal::curExtMidiSyncTick, real_tempo, new_tempo);
+      MusEGlobal::song->addExternalTempo(TempoRecEvent(tick, new_tempo));
+      }
+
+//---------------------------------------------------------
+//   clockLockReport
+//---------------------------------------------------------
+
+void MidiSeq::clockLockReport(const char* what)
+      {
+      const double period = _clockDll.period();
+      printf("MusE: midi clock %s: tempo %.2f bpm, jitter %.3f ms, max error %.3f ms, %d clocks, %d lock losses\n",
+         what, period > 0.0 ? 60.0 / (period * 24.0) : 0.0,
+         _clockDll.jitter() * 1000.0, _clockDll.maxError() * 1000.0,
+         _clockDll.pulses(), _clockDll.unlocks());
       }
 
 //---------------------------------------------------------
@@ -885,6 +1017,14 @@ void MidiSeq::realtimeSystemInput(int port, int c, double time)
                   MusEGlobal::lastExtMidiSyncTime = MusEGlobal::curExtMidiSyncTime;
                   MusEGlobal::curExtMidiSyncTime = time;
                   
+                  _clockDll.input(time);
+                  if(_clockDll.locked() != _clockLocked)
+                  {
+                    _clockLocked = _clockDll.locked();
+                    if(MusEGlobal::debugSync)
+                      clockLockReport(_clockLocked ? "locked" : "lost lock");
+                  }
+                  
                   if(MusEGlobal::playPendingFirstClock)
                   {
                     MusEGlobal::playPendingFirstClock = false;
@@ -903,12 +1043,19 @@ void MidiSeq::realtimeSystemInput(int port, int c, double time)
                     MusEGlobal::midiExtSyncTicks += div;
                     MusEGlobal::lastExtMidiSyncTick = MusEGlobal::curExtMidiSyncTick;
                     MusEGlobal::curExtMidiSyncTick += div;
+                    publishExtClock(_clockLocked);
                     
                     if(MusEGlobal::song->record() && MusEGlobal::lastExtMidiSyncTime > 0.0)
                     {
                       double diff = MusEGlobal::curExtMidiSyncTime - MusEGlobal::lastExtMidiSyncTime;
                       if(diff != 0.0)
                       {
+                        if(_syncRecFilterPreset == MidiSyncInfo::PLL)
+                        {
+                          if(_clockLocked)
+                            recordExtTempo(60.0/(_clockDll.period() * 24.0), MusEGlobal::curExtMidiSyncTick - div);
+                        }
+                        else
                         if(_clockAveragerPoles == 0)
                         {
                           double real_tempo = 60.0/(diff * 24.0);
@@ -1341,6 +1488,7 @@ void MidiSeq::realtimeSystemInput(int port, int c, double time)
                         }  
 
                         alignAllTicks();
+                        _clockDll.resetStats();
 
                         storedtimediffs = 0;
                         
@@ -1378,6 +1526,8 @@ void MidiSeq::realtimeSystemInput(int port, int c, double time)
                         // Begin incrementing immediately upon first clock reception.
                         MusEGlobal::playPendingFirstClock = true;
                         
+                        publishExtClock(false);
+                        _clockDll.resetStats();
                         playStateExt = true;
                         }
                   break;
@@ -1387,6 +1537,10 @@ void MidiSeq::realtimeSystemInput(int port, int c, double time)
                     MusEGlobal::midiExtSyncTicks = 0;
                     playStateExt = false;
                     MusEGlobal::playPendingFirstClock = false;
+                    publishExtClock(false);
+                    // Lock quality of the run, always if the lock got lost.
+                    if(_clockDll.pulses() && (MusEGlobal::debugSync || _clockDll.unlocks()))
+                      clockLockReport("stopped");
                     
                     // Re-transmit stop to other devices if clock out turned on.
                     for(int p = 0; p < MIDI_PORTS; ++p)
@@ -1439,8 +1593,41 @@ void MidiSeq::mtcSyncMsg(const MTC& mtc, int type, bool seekFlag)
             if (MusEGlobal::debugSync)
               printf("MidiSeq::MusEGlobal::mtcSyncMsg starting transport.\n");
             MusEGlobal::audioDevice->startTransport();
+            _mtcOffsetValid = false;
+            return;
+            }
+
+      // Chase: compare the MTC position with the song position and
+      //  relocate when they drift apart by more than two frames.
+      if (!_mtcDll.locked() || !MusEGlobal::audio->isPlaying())
+            return;
+      if (_mtcHoldOff > 0) {
+            --_mtcHoldOff;
+            return;
+            }
+      const double qf = 1.0 / (4.0 * mtcFps(type));
+      // The time is complete with quarter frame 7, seven quarter
+      //  frames after the frame it names.
+      const double mtcNow  = stime + 7.0 * qf + (curTime() - _mtcDll.lastPulse()) * qf / _mtcDll.period();
+      const double songNow = double(MusEGlobal::audio->curFramePos()) / MusEGlobal::sampleRate;
+      const double offset  = mtcNow - songNow;
+      if (!_mtcOffsetValid) {
+            _mtcOffset      = offset;
+            _mtcOffsetValid = true;
             return;
             }
+      const double drift = offset - _mtcOffset;
+      if (MusEGlobal::debugSync)
+            printf("MidiSeq::mtcSyncMsg drift:%f ms speed:%f jitter:%f ms\n",
+               drift * 1000.0, qf / _mtcDll.period(), _mtcDll.jitter() * 1000.0);
+      if (fabs(drift) > 8.0 * qf) {
+            if (!MusEGlobal::checkAudioDevice()) return;
+            printf("MusE: MTC drifted %.1f ms from the song position, relocating\n", drift * 1000.0);
+            int frame = MusEGlobal::audio->curFramePos() + lrint(drift * MusEGlobal::sampleRate);
+            MusEGlobal::audioDevice->seekTransport(Pos(unsigned(frame < 0 ? 0 : frame), false));
+            // Give the seek a few frames to take effect.
+            _mtcHoldOff = 4;
+            }
 
       /*if (tempoSN != MusEGlobal::tempomap.tempoSN()) { DELETETHIS 13
             double cpos    = MusEGlobal::tempomap.tick2time(_midiTick, 0);
@@ -35,7 +35,7 @@ class Xml;
 class MidiSyncInfo
 {
   public:
-    enum SyncRecFilterPresetType { NONE=0, TINY, SMALL, MEDIUM, LARGE, LARGE_WITH_PRE_DETECT, TYPE_END };
+    enum SyncRecFilterPresetType { NONE=0, TINY, SMALL, MEDIUM, LARGE, LARGE_WITH_PRE_DETECT, PLL, TYPE_END };
     
   private:
     int _port;
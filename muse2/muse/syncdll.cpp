@@ -0,0 +1,167 @@
+//=========================================================
+//  MusE
+//  Linux Music Editor
+//
+//  syncdll.cpp
+//
+//  This program is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU General Public License
+//  as published by the Free Software Foundation; version 2 of
+//  the License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+//
+//=========================================================
+
+#include <math.h>
+
+#include "syncdll.h"
+
+namespace MusECore {
+
+// Pulses before the loop may report lock, and the number of
+//  pulses it runs with the wide acquisition bandwidth.
+static const int LOCK_PULSES    = 24;
+static const int ACQUIRE_PULSES = 48;
+// Consecutive pulses off by more than half a period before
+//  the loop gives up and starts over (tempo jump, lost pulses).
+static const int MAX_OUTLIERS   = 3;
+
+//---------------------------------------------------------
+//   SyncDll
+//---------------------------------------------------------
+
+SyncDll::SyncDll(double bandwidth)
+      {
+      _bandwidth = bandwidth;
+      _locked    = false;
+      resetStats();
+      reset();
+      }
+
+//---------------------------------------------------------
+//   reset
+//---------------------------------------------------------
+
+void SyncDll::reset()
+      {
+      _t0        = 0.0;
+      _t1        = 0.0;
+      _period    = 0.0;
+      _count     = 0;
+      _outliers  = 0;
+      _errSquare = 0.0;
+      if (_locked)
+            ++_unlocks;
+      _locked    = false;
+      }
+
+//---------------------------------------------------------
+//   resetStats
+//---------------------------------------------------------
+
+void SyncDll::resetStats()
+      {
+      _errMax  = 0.0;
+      _pulses  = 0;
+      _unlocks = 0;
+      }
+
+//---------------------------------------------------------
+//   restart
+//    Start over with t as the first pulse, keeping the
+//    statistics.
+//---------------------------------------------------------
+
+void SyncDll::restart(double t)
+      {
+      reset();
+      _t0    = t;
+      _count = 1;
+      }
+
+//---------------------------------------------------------
+//   jitter
+//---------------------------------------------------------
+
+double SyncDll::jitter() const
+      {
+      return sqrt(_errSquare);
+      }
+
+//---------------------------------------------------------
+//   input
+//    Feed the time stamp of the next pulse. Returns the
+//    phase error of the pulse against the prediction,
+//    0 while the loop has no period yet.
+//---------------------------------------------------------
+
+double SyncDll::input(double t)
+      {
+      ++_pulses;
+      if (_count == 0) {
+            restart(t);
+            return 0.0;
+            }
+      if (_count == 1) {
+            // The first interval gives the initial period.
+            if (t <= _t0) {
+                  restart(t);
+                  return 0.0;
+                  }
+            _period = t - _t0;
+            _t0     = t;
+            _t1     = t + _period;
+            _count  = 2;
+            return 0.0;
+            }
+
+      const double e = t - _t1;
+      if (fabs(e) > 0.5 * _period) {
+            if (++_outliers >= MAX_OUTLIERS) {
+                  restart(t);
+                  return e;
+                  }
+            // A single late or lost pulse: take it as it is and
+            //  keep the period.
+            _t0 = t;
+            _t1 = t + _period;
+            return e;
+            }
+      _outliers = 0;
+
+      // Loop coefficients for the bandwidth, normalized to the
+      //  pulse period. Kept below 0.5 for stability with slow pulses.
+      const double bw = _count < ACQUIRE_PULSES ? 4.0 * _bandwidth : _bandwidth;
+      double w = 2.0 * M_PI * bw * _period;
+      if (w > 0.5)
+            w = 0.5;
+      const double b = sqrt(2.0) * w;
+      const double c = w * w;
+
+      _t0      = _t1;
+      _t1     += b * e + _period;
+      _period += c * e;
+      ++_count;
+
+      _errSquare += (e * e - _errSquare) / 32.0;
+      // Some hysteresis, so that jitter close to the limit does
+      //  not toggle the lock.
+      const bool lock = _count >= LOCK_PULSES
+         && jitter() < (_locked ? 0.25 : 0.125) * _period;
+      if (_locked && !lock)
+            ++_unlocks;
+      _locked = lock;
+      if (_locked && fabs(e) > _errMax)
+            _errMax = fabs(e);
+      return e;
+      }
+
+} // namespace MusECore
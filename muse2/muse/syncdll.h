@@ -0,0 +1,74 @@
+//=========================================================
+//  MusE
+//  Linux Music Editor
+//
+//  syncdll.h
+//
+//  This program is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU General Public License
+//  as published by the Free Software Foundation; version 2 of
+//  the License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+//
+//=========================================================
+
+#ifndef __SYNCDLL_H__
+#define __SYNCDLL_H__
+
+namespace MusECore {
+
+//---------------------------------------------------------
+//   SyncDll
+//    Second order delay locked loop following a stream of
+//    time stamped pulses (midi clock, MTC quarter frames).
+//    It filters the jitter of the time stamps and gives the
+//    period and the phase of the pulses. Times in seconds.
+//    The loop starts with a wide bandwidth to lock quickly
+//    and narrows down to the given one once locked.
+//---------------------------------------------------------
+
+class SyncDll {
+      double _bandwidth;   // loop bandwidth in Hz when locked
+      double _t0;          // filtered time of the last pulse
+      double _t1;          // predicted time of the next pulse
+      double _period;      // filtered period
+      int _count;          // pulses since (re)start of the loop
+      int _outliers;       // consecutive pulses far off the prediction
+
+      // lock quality
+      double _errSquare;   // smoothed squared phase error
+      double _errMax;
+      bool _locked;
+      int _pulses;
+      int _unlocks;
+
+      void restart(double t);
+
+   public:
+      SyncDll(double bandwidth = 0.5);
+      void reset();
+      void resetStats();
+      void setBandwidth(double hz) { _bandwidth = hz; }
+      double input(double t);
+
+      bool locked() const      { return _locked; }
+      double period() const    { return _period; }
+      double lastPulse() const { return _t0; }
+      double nextPulse() const { return _t1; }
+      double jitter() const;   // rms phase error
+      double maxError() const  { return _errMax; }
+      int pulses() const       { return _pulses; }
+      int unlocks() const      { return _unlocks; }
+      };
+
+} // namespace MusECore
+
+#endif
@@ -0,0 +1,156 @@
+//=========================================================
+//  MusE
+//  Linux Music Editor
+//
+//  syncdll_sim.cpp
+//    Feeds simulated, jittered midi clock streams into the
+//    external sync DLL and prints how well it follows them
+//
+//  This program is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU General Public License
+//  as published by the Free Software Foundation; version 2 of
+//  the License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+//
+//=========================================================
+
+//---------------------------------------------------------
+//    Every scenario is a 24 ppq clock stream with a tempo
+//    curve, gaussian time stamp jitter and optionally lost
+//    clocks. Printed per scenario:
+//      lock     clocks until the loop first reports lock
+//      phase    rms / max error of the filtered clock time
+//               against the true one while locked
+//      tempo    rms / max error of the tempo from the loop
+//               period, and of the raw clock to clock tempo
+//               the "None" record filter would use
+//---------------------------------------------------------
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <math.h>
+
+#include "syncdll.h"
+
+using MusECore::SyncDll;
+
+//---------------------------------------------------------
+//   Scenario
+//---------------------------------------------------------
+
+struct Scenario {
+      const char* name;
+      double bpm0, bpm1;   // tempo at start and end
+      bool step;           // jump to bpm1 half way, else ramp
+      int dropEvery;       // lose every n-th clock, 0 none
+      };
+
+static const Scenario scenarios[] = {
+      { "steady 120 bpm",        120.0, 120.0, false,   0 },
+      { "steady 60 bpm",          60.0,  60.0, false,   0 },
+      { "ramp 100 - 130 bpm",    100.0, 130.0, false,   0 },
+      { "step 120 - 140 bpm",    120.0, 140.0, true,    0 },
+      { "steady 120, lost clocks", 120.0, 120.0, false, 500 },
+      };
+
+//---------------------------------------------------------
+//   gauss
+//---------------------------------------------------------
+
+static double gauss()
+      {
+      double u1 = (rand() + 1.0) / (RAND_MAX + 2.0);
+      double u2 = (rand() + 1.0) / (RAND_MAX + 2.0);
+      return sqrt(-2.0 * log(u1)) * cos(2.0 * M_PI * u2);
+      }
+
+//---------------------------------------------------------
+//   run
+//---------------------------------------------------------
+
+static void run(const Scenario& s, int clocks, double jitter, double bandwidth)
+      {
+      SyncDll dll(bandwidth);
+      double t = 1.0;            // true time of the clock
+      double lastIn = 0.0;
+      int lockAt = -1;
+      int n = 0;
+      double phase2 = 0.0, phaseMax = 0.0;
+      double tempo2 = 0.0, tempoMax = 0.0;
+      double raw2 = 0.0, rawMax = 0.0;
+
+      for (int i = 0; i < clocks; ++i) {
+            double bpm;
+            if (s.step)
+                  bpm = i < clocks / 2 ? s.bpm0 : s.bpm1;
+            else
+                  bpm = s.bpm0 + (s.bpm1 - s.bpm0) * i / clocks;
+            const double period = 60.0 / (bpm * 24.0);
+            t += period;
+            if (s.dropEvery && i % s.dropEvery == s.dropEvery - 1)
+                  continue;
+            const double in = t + jitter * gauss();
+            dll.input(in);
+            if (dll.locked() && lockAt < 0)
+                  lockAt = i;
+            // Judge only after the loop has settled, skipping the
+            //  clocks right after a tempo step or a lost clock.
+            if (lockAt >= 0 && dll.locked() && fabs(in - lastIn - period) < 0.5 * period) {
+                  const double pe = fabs(dll.lastPulse() - t);
+                  const double te = fabs(60.0 / (dll.period() * 24.0) - bpm);
+                  const double re = fabs(60.0 / ((in - lastIn) * 24.0) - bpm);
+                  phase2 += pe * pe;
+                  tempo2 += te * te;
+                  raw2   += re * re;
+                  if (pe > phaseMax) phaseMax = pe;
+                  if (te > tempoMax) tempoMax = te;
+                  if (re > rawMax)   rawMax   = re;
+                  ++n;
+                  }
+            lastIn = in;
+            }
+      printf("%-24s lock %4d  phase %6.3f / %6.3f ms  tempo %6.3f / %6.3f bpm  raw %6.3f / %6.3f bpm  unlocks %d\n",
+         s.name, lockAt,
+         n ? sqrt(phase2 / n) * 1000.0 : 0.0, phaseMax * 1000.0,
+         n ? sqrt(tempo2 / n) : 0.0, tempoMax,
+         n ? sqrt(raw2 / n) : 0.0, rawMax,
+         dll.unlocks());
+      }
+
+//---------------------------------------------------------
+//   main
+//---------------------------------------------------------
+
+int main(int argc, char* argv[])
+      {
+      int clocks       = 4800;
+      double jitter    = 0.5;
+      double bandwidth = 0.5;
+      int c;
+      while ((c = getopt(argc, argv, "n:j:b:s:")) != EOF) {
+            switch (c) {
+                  case 'n': clocks = atoi(optarg); break;
+                  case 'j': jitter = atof(optarg); break;
+                  case 'b': bandwidth = atof(optarg); break;
+                  case 's': srand(atoi(optarg)); break;
+                  default:
+                        fprintf(stderr,
+                           "usage: %s [-n clocks] [-j jitter ms] [-b bandwidth Hz] [-s seed]\n",
+                           argv[0]);
+                        return 1;
+                  }
+            }
+      printf("%d clocks, jitter %.3f ms rms, loop bandwidth %.3f Hz\n", clocks, jitter, bandwidth);
+      for (unsigned i = 0; i < sizeof(scenarios) / sizeof(scenarios[0]); ++i)
+            run(scenarios[i], clocks, jitter / 1000.0, bandwidth);
+      return 0;
+      }
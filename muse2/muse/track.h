@@ -40,6 +40,8 @@
 #include "globaldefs.h"
 #include "cleftypes.h"
 #include "controlfifo.h"
+#include "metersnapshot.h"
+#include "recwriter.h"
 
 namespace MusECore {
 class Pipeline;
@@ -99,6 +101,7 @@ class Track {
       int _lastActivity;
       double _meter[MAX_CHANNELS];
       double _peak[MAX_CHANNELS];
+      MeterSnapshot _meterSnapshot; // _meter, _peak as of the last audio cycle, for the gui
 
       int _y;
       int _height;            // visual height in arranger
@@ -195,6 +198,8 @@ class Track {
       double meter(int ch) const  { return _meter[ch]; }
       double peak(int ch) const   { return _peak[ch]; }
       void resetMeter();
+      void publishMeters()        { _meterSnapshot.publish(_channels, _meter, _peak); }
+      MeterSnapshot& meterSnapshot() { return _meterSnapshot; }
 
       bool readProperty(Xml& xml, const QString& tag);
       void setDefaultName(QString base = QString());
@@ -381,7 +386,7 @@ class AudioTrack : public Track {
       
       virtual bool getData(unsigned, int, unsigned, float**);
       SndFileR _recFile;
-      Fifo fifo;                    // fifo -> _recFile
+      RecordRing _recRing;          // -> _recFile, drained by MusEGlobal::recordWriter
       bool _processed;
       
    public:
@@ -432,8 +437,9 @@ class AudioTrack : public Track {
       virtual void updateInternalSoloStates();
       
       void putFifo(int channels, unsigned long n, float** bp);
+      RecordRing& recordRing()           { return _recRing; }
 
-      void record();
+      void record(float** chunk, unsigned chunkFrames);
 
       virtual void setMute(bool val);
       virtual void setOff(bool val);
@@ -636,6 +642,7 @@ class WaveTrack : public AudioTrack {
       virtual void write(int, Xml&) const;
 
       virtual void fetchData(unsigned pos, unsigned frames, float** bp, bool doSeek);
+      void releaseReaders();
       
       virtual bool getData(unsigned, int ch, unsigned, float** bp);
 
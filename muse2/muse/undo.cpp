@@ -35,6 +35,8 @@
 #include "part.h"
 #include "audiodev.h"
 #include "track.h"
+#include "midievent.h"
+#include "gconfig.h"
 
 #include <string.h>
 #include <QAction>
@@ -107,6 +109,81 @@ void UndoOp::dump()
             }
       }
 
+//---------------------------------------------------------
+//    deleteOps
+//    Free what the operations of u own and clear it.
+//---------------------------------------------------------
+
+void UndoList::deleteOps(Undo& u)
+{
+  if (this->isUndo)
+  {
+    for(iUndoOp i = u.begin(); i != u.end(); ++i)
+    {
+      switch(i->type)
+      {
+        case UndoOp::DeleteTrack:
+              if(i->track)
+                delete const_cast<Track*>(i->track);
+              break;
+              
+        case UndoOp::DeletePart:
+              delete const_cast<Part*>(i->part);
+              break;
+
+        case UndoOp::ModifyMarker:
+              if (i->copyMarker)
+                delete i->copyMarker;
+              break;
+              
+        case UndoOp::ModifyPartName:
+        case UndoOp::ModifyTrackName:
+              if (i->_oldName)
+                delete i->_oldName;
+              if (i->_newName)
+                delete i->_newName;
+              break;
+        
+        default:
+              break;
+      }
+    }
+  }
+  else
+  {
+    for(riUndoOp i = u.rbegin(); i != u.rend(); ++i)
+    {
+      switch(i->type)
+      {
+        case UndoOp::AddTrack:
+              delete i->track;
+              break;
+              
+        case UndoOp::AddPart:
+              delete i->part;
+              break;
+
+        case UndoOp::ModifyMarker:
+              if (i->realMarker)
+                delete i->realMarker;
+              break;
+              
+        case UndoOp::ModifyPartName:
+        case UndoOp::ModifyTrackName:
+              if (i->_oldName)
+                delete i->_oldName;
+              if (i->_newName)
+                delete i->_newName;
+              break;
+        
+        default:
+              break;
+      }
+    }
+  }
+  u.clear();
+}
+
 //---------------------------------------------------------
 //    clearDelete
 //---------------------------------------------------------
@@ -118,83 +195,51 @@ void UndoList::clearDelete()
     if (this->isUndo)
     {
       for(iUndo iu = begin(); iu != end(); ++iu)
-      {
-        Undo& u = *iu;
-        for(iUndoOp i = u.begin(); i != u.end(); ++i)
-        {
-          switch(i->type)
-          {
-            case UndoOp::DeleteTrack:
-                  if(i->track)
-                    delete const_cast<Track*>(i->track);
-                  break;
-                  
-            case UndoOp::DeletePart:
-                  delete const_cast<Part*>(i->part);
-                  break;
-
-            case UndoOp::ModifyMarker:
-                  if (i->copyMarker)
-                    delete i->copyMarker;
-                  break;
-                  
-            case UndoOp::ModifyPartName:
-            case UndoOp::ModifyTrackName:
-                  if (i->_oldName)
-                    delete i->_oldName;
-                  if (i->_newName)
-                    delete i->_newName;
-                  break;
-            
-            default:
-                  break;
-          }
-        }
-        u.clear();
-      }
+        deleteOps(*iu);
     }
     else
     {
       for(riUndo iu = rbegin(); iu != rend(); ++iu)
-      {
-        Undo& u = *iu;
-        for(riUndoOp i = u.rbegin(); i != u.rend(); ++i)
-        {
-          switch(i->type)
-          {
-            case UndoOp::AddTrack:
-                  delete i->track;
-                  break;
-                  
-            case UndoOp::AddPart:
-                  delete i->part;
-                  break;
-
-            case UndoOp::ModifyMarker:
-                  if (i->realMarker)
-                    delete i->realMarker;
-                  break;
-                  
-            case UndoOp::ModifyPartName:
-            case UndoOp::ModifyTrackName:
-                  if (i->_oldName)
-                    delete i->_oldName;
-                  if (i->_newName)
-                    delete i->_newName;
-                  break;
-            
-            default:
-                  break;
-          }
-        }
-        u.clear();
-      }
+        deleteOps(*iu);
     }
   }
 
   clear();
 }
 
+//---------------------------------------------------------
+//    memory
+//---------------------------------------------------------
+
+size_t UndoList::memory() const
+{
+  size_t n = 0;
+  for(const_iterator iu = begin(); iu != end(); ++iu)
+    n += iu->memory();
+  return n;
+}
+
+//---------------------------------------------------------
+//    limitMemory
+//    Drop the oldest steps until the list holds no more
+//    than bytes. The newest step is always kept. Returns
+//    the number of steps dropped.
+//---------------------------------------------------------
+
+int UndoList::limitMemory(size_t bytes)
+{
+  int dropped = 0;
+  size_t n = memory();
+  while(n > bytes && size() > 1)
+  {
+    n -= front().memory();
+    deleteOps(front());
+    pop_front();
+    ++dropped;
+  }
+  return dropped;
+}
+
 //---------------------------------------------------------
 //    startUndo
 //---------------------------------------------------------
@@ -231,6 +276,9 @@ void Song::endUndo(SongChangedFlags_t flags)
               if (prev_undo->merge_combo(undoList->back()))
                     undoList->pop_back();
         }
+        undoList->back().updateMemory();
+        if(MusEGlobal::config.undoMemoryLimit > 0)
+          undoList->limitMemory(size_t(MusEGlobal::config.undoMemoryLimit) << 20);
       }
       
       // Even if the current list was empty, or emptied during appending of given operations to the current list, 
@@ -263,6 +311,11 @@ void Song::setUndoRedoText()
       }
     }
     MusEGlobal::undoAction->setText(s);
+    QString tip = s;
+    tip.remove('&');
+    MusEGlobal::undoAction->setToolTip(tip + "\n" + tr("History: %1 steps, %2 MB")
+      .arg(undoList->size() + redoList->size())
+      .arg((undoList->memory() + redoList->memory()) / (1024.0 * 1024.0), 0, 'f', 1));
   }
   
   if(MusEGlobal::redoAction)
@@ -392,12 +445,12 @@ void Undo::insert(Undo::iterator position, const UndoOp& op)
       switch(n_op.type)
       {
         case UndoOp::AddRoute:
-          if(uo.type == UndoOp::AddRoute && uo.routeFrom == n_op.routeFrom && uo.routeTo == n_op.routeTo)
+          if(uo.type == UndoOp::AddRoute && uo.routes.from() == n_op.routes.from() && uo.routes.to() == n_op.routes.to())
           {
             fprintf(stderr, "MusE error: Undo::insert(): Double AddRoute. Ignoring.\n");
             return;
           }
-          else if(uo.type == UndoOp::DeleteRoute && uo.routeFrom == n_op.routeFrom && uo.routeTo == n_op.routeTo)
+          else if(uo.type == UndoOp::DeleteRoute && uo.routes.from() == n_op.routes.from() && uo.routes.to() == n_op.routes.to())
           {
             // Delete followed by add is useless. Cancel out the delete + add by erasing the delete command.
             erase(iuo);
@@ -406,12 +459,12 @@ void Undo::insert(Undo::iterator position, const UndoOp& op)
         break;
         
         case UndoOp::DeleteRoute:
-          if(uo.type == UndoOp::DeleteRoute && uo.routeFrom == n_op.routeFrom && uo.routeTo == n_op.routeTo)  
+          if(uo.type == UndoOp::DeleteRoute && uo.routes.from() == n_op.routes.from() && uo.routes.to() == n_op.routes.to())  
           {
             fprintf(stderr, "MusE error: Undo::insert(): Double DeleteRoute. Ignoring.\n");
             return;  
           }
-          else if(uo.type == UndoOp::AddRoute && uo.routeFrom == n_op.routeFrom && uo.routeTo == n_op.routeTo)  
+          else if(uo.type == UndoOp::AddRoute && uo.routes.from() == n_op.routes.from() && uo.routes.to() == n_op.routes.to())  
           {
             // Add followed by delete is useless. Cancel out the add + delete by erasing the add command.
             erase(iuo);
@@ -930,8 +983,13 @@ bool Song::applyOperationGroup(Undo& group, bool doUndo)
             MusEGlobal::audio->msgExecuteOperationGroup(group);
             
             // append all elements from "group" to the end of undoList->back().
+            // An empty one takes them as they are, they were merged while
+            //  the group was put together.
             Undo& curUndo = undoList->back();
-            curUndo.insert(curUndo.end(), group.begin(), group.end());
+            if (curUndo.empty())
+                  curUndo.std::list<UndoOp>::insert(curUndo.end(), group.begin(), group.end());
+            else
+                  curUndo.insert(curUndo.end(), group.begin(), group.end());
             if (group.combobreaker)
                curUndo.combobreaker=true;
             
@@ -1026,6 +1084,136 @@ UndoOp::UndoOp()
   type=UndoOp::DoNothing;
 }
 
+//---------------------------------------------------------
+//   UndoRoutes
+//---------------------------------------------------------
+
+UndoRoutes::UndoRoutes(const Route& from, const Route& to)
+      {
+      _routes = new Route[2];
+      _routes[0] = from;
+      _routes[1] = to;
+      }
+
+UndoRoutes::UndoRoutes(const UndoRoutes& r)
+      {
+      _routes = 0;
+      if (r._routes) {
+            _routes = new Route[2];
+            _routes[0] = r._routes[0];
+            _routes[1] = r._routes[1];
+            }
+      }
+
+UndoRoutes& UndoRoutes::operator=(const UndoRoutes& r)
+      {
+      if (this != &r) {
+            delete[] _routes;
+            _routes = 0;
+            if (r._routes) {
+                  _routes = new Route[2];
+                  _routes[0] = r._routes[0];
+                  _routes[1] = r._routes[1];
+                  }
+            }
+      return *this;
+      }
+
+const Route& UndoRoutes::from() const
+      {
+      static const Route none;
+      return _routes ? _routes[0] : none;
+      }
+
+const Route& UndoRoutes::to() const
+      {
+      static const Route none;
+      return _routes ? _routes[1] : none;
+      }
+
+//---------------------------------------------------------
+//   eventMemory
+//---------------------------------------------------------
+
+static size_t eventMemory(const Event& e)
+      {
+      return e.empty() ? 0 : sizeof(MidiEventBase) + e.dataLen();
+      }
+
+//---------------------------------------------------------
+//   partMemory
+//    The part and its events, each in its map node.
+//---------------------------------------------------------
+
+static size_t partMemory(const Part* part)
+      {
+      if (!part)
+            return 0;
+      const EventList& el = part->events();
+      size_t n = sizeof(MidiPart) + el.size() * (sizeof(EventList::value_type) + 4 * sizeof(void*));
+      for (ciEvent e = el.begin(); e != el.end(); ++e)
+            n += eventMemory(e->second);
+      return n;
+      }
+
+//---------------------------------------------------------
+//   memory
+//    Estimated bytes this operation keeps alive in the
+//    undo list, i.e. what dropping it would free: the list
+//    node, and deleted events, parts and tracks.
+//---------------------------------------------------------
+
+size_t UndoOp::memory() const
+      {
+      size_t n = sizeof(UndoOp) + 2 * sizeof(void*);
+      switch (type) {
+            case AddRoute:
+            case DeleteRoute:
+                  n += 2 * sizeof(Route);
+                  break;
+            case DeleteEvent:
+                  n += eventMemory(nEvent);
+                  break;
+            case ModifyEvent:
+                  n += eventMemory(oEvent);
+                  break;
+            case DeletePart:
+                  n += partMemory(part);
+                  break;
+            case DeleteTrack:
+                  if (track) {
+                        const PartList* pl = track->cparts();
+                        for (ciPart ip = pl->begin(); ip != pl->end(); ++ip)
+                              n += partMemory(ip->second);
+                        }
+                  break;
+            case ModifyMarker:
+                  n += sizeof(Marker);
+                  break;
+            case ModifyPartName:
+            case ModifyTrackName:
+                  if (_oldName)
+                        n += sizeof(QString) + _oldName->size() * sizeof(QChar);
+                  if (_newName)
+                        n += sizeof(QString) + _newName->size() * sizeof(QChar);
+                  break;
+            default:
+                  break;
+            }
+      return n;
+      }
+
+//---------------------------------------------------------
+//   updateMemory
+//---------------------------------------------------------
+
+void Undo::updateMemory()
+      {
+      _memory = 0;
+      for (ciUndoOp i = begin(); i != end(); ++i)
+            _memory += i->memory();
+      }
+
 UndoOp::UndoOp(UndoType type_, int a_, int b_, int c_)
       {
       assert(type_==AddKey || type_==DeleteKey || type_== ModifyKey ||
@@ -1300,15 +1488,12 @@ UndoOp::UndoOp(UndoOp::UndoType type_, const Track* track_, int old_chan, int ne
   _newPropValue = new_chan;
 }
 
-#pragma GCC diagnostic push
-#pragma GCC diagnostic ignored "-Wunused-parameter"
 UndoOp::UndoOp(UndoOp::UndoType type_, const Route& route_from_, const Route& route_to_)
       {
       assert(type_ == AddRoute || type_ == DeleteRoute);
-      routeFrom = route_from_;
-      routeTo = route_to_;
+      type = type_;
+      routes = UndoRoutes(route_from_, route_to_);
       }
-#pragma GCC diagnostic pop
 
 void Song::undoOp(UndoOp::UndoType type, const QString& changedFile, const QString& changeData, int startframe, int endframe)
       {
@@ -1342,6 +1527,7 @@ void Song::revertOperationGroup1(Undo& operations)
             Track* editable_track = const_cast<Track*>(i->track);
             Track* editable_property_track = const_cast<Track*>(i->_propertyTrack);
             Part* editable_part = const_cast<Part*>(i->part);
+            _changes.add(*i);
             switch(i->type) {
                   case UndoOp::SelectPart:
                         editable_part->setSelected(i->selected_old);
@@ -1519,7 +1705,7 @@ void Song::revertOperationGroup1(Undo& operations)
 #ifdef _UNDO_DEBUG_
                         fprintf(stderr, "Song::revertOperationGroup1:AddRoute\n");
 #endif                        
-                        pendingOperations.add(PendingOperationItem(i->routeFrom, i->routeTo, PendingOperationItem::DeleteRoute)); 
+                        pendingOperations.add(PendingOperationItem(i->routes.from(), i->routes.to(), PendingOperationItem::DeleteRoute)); 
                         updateFlags |= SC_ROUTE;
                         break;
                         
@@ -1527,7 +1713,7 @@ void Song::revertOperationGroup1(Undo& operations)
 #ifdef _UNDO_DEBUG_
                         fprintf(stderr, "Song::executeOperationGroup1:DeleteRoute\n");
 #endif                        
-                        pendingOperations.add(PendingOperationItem(i->routeFrom, i->routeTo, PendingOperationItem::AddRoute)); 
+                        pendingOperations.add(PendingOperationItem(i->routes.from(), i->routes.to(), PendingOperationItem::AddRoute)); 
                         updateFlags |= SC_ROUTE;
                         break;
                         
@@ -1820,6 +2006,7 @@ void Song::executeOperationGroup1(Undo& operations)
             Track* editable_track = const_cast<Track*>(i->track);
             Track* editable_property_track = const_cast<Track*>(i->_propertyTrack);
             Part* editable_part = const_cast<Part*>(i->part);
+            _changes.add(*i);
             switch(i->type) {
                   case UndoOp::SelectPart:
                         editable_part->setSelected(i->selected);
@@ -2008,7 +2195,7 @@ void Song::executeOperationGroup1(Undo& operations)
 #ifdef _UNDO_DEBUG_
                         fprintf(stderr, "Song::executeOperationGroup1:AddRoute\n");
 #endif                        
-                        pendingOperations.add(PendingOperationItem(i->routeFrom, i->routeTo, PendingOperationItem::AddRoute)); 
+                        pendingOperations.add(PendingOperationItem(i->routes.from(), i->routes.to(), PendingOperationItem::AddRoute)); 
                         updateFlags |= SC_ROUTE;
                         break;
                         
@@ -2016,7 +2203,7 @@ void Song::executeOperationGroup1(Undo& operations)
 #ifdef _UNDO_DEBUG_
                         fprintf(stderr, "Song::executeOperationGroup1:DeleteEvent\n");
 #endif                        
-                        pendingOperations.add(PendingOperationItem(i->routeFrom, i->routeTo, PendingOperationItem::DeleteRoute)); 
+                        pendingOperations.add(PendingOperationItem(i->routes.from(), i->routes.to(), PendingOperationItem::DeleteRoute)); 
                         updateFlags |= SC_ROUTE;
                         break;
                         
@@ -25,6 +25,7 @@
 #define __UNDO_H__
 
 #include <list>
+#include <stddef.h>
 
 #include "event.h"
 #include "marker/marker.h"
@@ -42,6 +43,28 @@ class Track;
 class Part;
 
 extern std::list<QString> temporaryWavFiles; //!< Used for storing all tmp-files, for cleanup on shutdown
+
+//---------------------------------------------------------
+//   UndoRoutes
+//    The two routes of an AddRoute or DeleteRoute, kept
+//    out of line. A Route carries its 256 byte port name,
+//    held inline it made every UndoOp pay for two of them.
+//---------------------------------------------------------
+
+class UndoRoutes {
+      Route* _routes;   // from, to; 0 if not a route operation
+
+   public:
+      UndoRoutes() : _routes(0) {}
+      UndoRoutes(const Route& from, const Route& to);
+      UndoRoutes(const UndoRoutes&);
+      UndoRoutes& operator=(const UndoRoutes&);
+      ~UndoRoutes() { delete[] _routes; }
+
+      const Route& from() const;
+      const Route& to() const;
+      };
+
 //---------------------------------------------------------
 //   UndoOp
 //---------------------------------------------------------
@@ -112,11 +135,11 @@ struct UndoOp {
       const Track* track;
       const Track* oldTrack;
       int trackno;
-      Route routeFrom;
-      Route routeTo;
+      UndoRoutes routes;
       
       const char* typeName();
       void dump();
+      size_t memory() const;
       
       UndoOp();
       UndoOp(UndoType type, int a, int b, int c=0);
@@ -137,9 +160,9 @@ struct UndoOp {
 
 class Undo : public std::list<UndoOp> {
    public:
-      Undo() : std::list<UndoOp>() { combobreaker=false; }
-      Undo(const Undo& other) : std::list<UndoOp>(other) { this->combobreaker=other.combobreaker; }
-      Undo& operator=(const Undo& other) { std::list<UndoOp>::operator=(other); this->combobreaker=other.combobreaker; return *this;}
+      Undo() : std::list<UndoOp>() { combobreaker=false; _memory=0; }
+      Undo(const Undo& other) : std::list<UndoOp>(other) { this->combobreaker=other.combobreaker; this->_memory=other._memory; }
+      Undo& operator=(const Undo& other) { std::list<UndoOp>::operator=(other); this->combobreaker=other.combobreaker; this->_memory=other._memory; return *this;}
 
       bool empty() const;
       
@@ -159,6 +182,18 @@ class Undo : public std::list<UndoOp> {
       void insert(iterator position, const_iterator first, const_iterator last);
       void insert(iterator position, const UndoOp& op);
       void insert (iterator position, size_type n, const UndoOp& op);
+      /** appends op without merging it with the operations before it.
+       *  For bulk edits which change each event once; push_back()
+       *  looks through all earlier operations. */
+      void append(const UndoOp& op) { std::list<UndoOp>::push_back(op); }
+
+      /** estimated bytes held by the operations, as of the
+       *  last updateMemory() */
+      size_t memory() const { return _memory; }
+      void updateMemory();
+
+   private:
+      size_t _memory;
 };
 
 typedef Undo::iterator iUndoOp;
@@ -169,8 +204,11 @@ typedef Undo::const_reverse_iterator criUndoOp;
 class UndoList : public std::list<Undo> {
    protected:
       bool isUndo;
+      void deleteOps(Undo&);
    public:
       void clearDelete();
+      size_t memory() const;
+      int limitMemory(size_t bytes);
       UndoList(bool _isUndo) : std::list<Undo>() { isUndo=_isUndo; }
 };
 
@@ -24,16 +24,22 @@
 #include <fcntl.h>
 #include <unistd.h>
 #include <errno.h>
+#include <string.h>
 #include <cmath>
 
 #include <QDateTime>
 #include <QFileInfo>
+#include <QMutexLocker>
 #include <QMessageBox>
 #include <QProgressDialog>
 
 #include "xml.h"
 #include "song.h"
 #include "wave.h"
+#include "wavetiles.h"
+#include "clipcache.h"
+#include "sampleconv.h"
+#include "decoderpool.h"
 #include "app.h"
 #include "filedialog.h"
 #include "arranger/arranger.h"
@@ -67,14 +73,20 @@ SndFile::SndFile(const QString& name)
       csize = 0;
       cache = 0;
       openFlag = false;
+      preallocated = false;
       sndFiles.push_back(this);
       refCount=0;
       }
 
 SndFile::~SndFile()
       {
+      if (MusEGlobal::waveTiles)
+            MusEGlobal::waveTiles->invalidate(this);
+      if (MusEGlobal::clipCache)
+            MusEGlobal::clipCache->invalidate(this);
       if (openFlag)
             close();
+      dropReadHandles();
       for (iSndFile i = sndFiles.begin(); i != sndFiles.end(); ++i) {
             if (*i == this) {
                   sndFiles.erase(i);
@@ -141,6 +153,10 @@ void SndFile::update()
 
 void SndFile::readCache(const QString& path, bool showProgress)
       {
+      if (MusEGlobal::waveTiles)
+            MusEGlobal::waveTiles->invalidate(this);
+      if (MusEGlobal::clipCache)
+            MusEGlobal::clipCache->invalidate(this);
       if (cache) {
             for (unsigned i = 0; i < channels(); ++i)
                   delete [] cache[i];
@@ -339,16 +355,39 @@ void SndFile::read(SampleV* s, int mag, unsigned pos, bool overwrite)
 
 //---------------------------------------------------------
 //   openWrite
+//    With preallocFrames, disk space for that many frames
+//    is reserved up front where the file system can do it,
+//    so that long takes are not scattered over the disk.
 //---------------------------------------------------------
 
-bool SndFile::openWrite()
+bool SndFile::openWrite(unsigned preallocFrames)
       {
       if (openFlag) {
             printf("SndFile:: alread open\n");
             return false;
             }
   QString p = path();
-      sf = sf_open(p.toLocal8Bit().constData(), SFM_RDWR, &sfinfo);
+      preallocated = false;
+      if (preallocFrames) {
+            int fd = ::open(p.toLocal8Bit().constData(), O_RDWR | O_CREAT, 0644);
+            if (fd == -1)
+                  return true;
+#if defined(__linux__) && defined(FALLOC_FL_KEEP_SIZE)
+            // Keep the size, libsndfile writes the header at 0 and
+            //  appends from there.
+            off_t bytes = off_t(preallocFrames) * sfinfo.channels * sizeof(float);
+            if (fallocate(fd, FALLOC_FL_KEEP_SIZE, 0, bytes) == 0)
+                  preallocated = true;
+            else if (MusEGlobal::debugMsg)
+                  printf("SndFile::openWrite: fallocate %s: %s\n",
+                     p.toLocal8Bit().constData(), ::strerror(errno));
+#endif
+            sf = sf_open_fd(fd, SFM_RDWR, &sfinfo, SF_TRUE);
+            if (!sf)
+                  ::close(fd);
+            }
+      else
+            sf = sf_open(p.toLocal8Bit().constData(), SFM_RDWR, &sfinfo);
       sfUI = 0;
       if (sf) {
             openFlag  = true;
@@ -374,6 +413,17 @@ void SndFile::close()
       if (sfUI)
             sf_close(sfUI);
       openFlag = false;
+      // Readers open the file again, it may change now.
+      dropReadHandles();
+      if (preallocated) {
+            // Give back what the take did not use.
+            QFileInfo fi(path());
+            fi.refresh();
+            if (truncate(fi.filePath().toLocal8Bit().constData(), fi.size()) == -1)
+                  printf("SndFile::close: truncate %s: %s\n",
+                     fi.filePath().toLocal8Bit().constData(), ::strerror(errno));
+            preallocated = false;
+            }
       }
 
 //---------------------------------------------------------
@@ -450,6 +500,12 @@ unsigned SndFile::format() const
       return sfinfo.format;
       }
 
+bool SndFile::isCompressed() const
+      {
+      const int type = sfinfo.format & SF_FORMAT_TYPEMASK;
+      return type == SF_FORMAT_FLAC || type == SF_FORMAT_OGG;
+      }
+
 void SndFile::setFormat(int fmt, int ch, int rate)
       {
       sfinfo.samplerate = rate;
@@ -483,54 +539,172 @@ size_t SndFile::read(int srcChannels, float** dst, size_t n, bool overwrite)
 
 size_t SndFile::readInternal(int srcChannels, float** dst, size_t n, bool overwrite, float *buffer)
 {
-      size_t rn = sf_readf_float(sf, buffer, n);
+      return readFrames(sf, sfinfo.format, sfinfo.channels, buffer, dst, srcChannels, n, overwrite);
+}
 
-      float* src      = buffer;
-      int dstChannels = sfinfo.channels;
-      if (srcChannels == dstChannels) {
-            if(overwrite)
-              for (size_t i = 0; i < rn; ++i) {
-                  for (int ch = 0; ch < srcChannels; ++ch)
-                        *(dst[ch]+i) = *src++;
-                  }
-              else
-              for (size_t i = 0; i < rn; ++i) {
-                  for (int ch = 0; ch < srcChannels; ++ch)
-                        *(dst[ch]+i) += *src++;
-                  }
+//---------------------------------------------------------
+//   readFrames
+//    n frames of handle h into the channel buffers of a
+//    track. 16 bit files are read as short and 24/32 bit
+//    pcm as int and converted here, in place of the
+//    float conversion in libsndfile. buffer holds
+//    n * fileChannels floats.
+//---------------------------------------------------------
+
+size_t SndFile::readFrames(SNDFILE* h, int format, int fileChannels, float* buffer,
+   float** dst, int channels, size_t n, bool overwrite)
+{
+      size_t rn;
+      switch (format & SF_FORMAT_SUBMASK) {
+            case SF_FORMAT_PCM_16:
+                  rn = sf_readf_short(h, (short*)buffer, n);
+                  deinterleave((const short*)buffer, fileChannels, dst, channels, rn, overwrite);
+                  break;
+            case SF_FORMAT_PCM_24:
+            case SF_FORMAT_PCM_32:
+                  rn = sf_readf_int(h, (int*)buffer, n);
+                  deinterleave((const int*)buffer, fileChannels, dst, channels, rn, overwrite);
+                  break;
+            default:
+                  rn = sf_readf_float(h, buffer, n);
+                  deinterleave(buffer, fileChannels, dst, channels, rn, overwrite);
+                  break;
             }
-      else if ((srcChannels == 1) && (dstChannels == 2)) {
-            // stereo to mono
-            if(overwrite)
-              for (size_t i = 0; i < rn; ++i)
-                  *(dst[0] + i) = src[i + i] + src[i + i + 1];
-            else
-              for (size_t i = 0; i < rn; ++i)
-                  *(dst[0] + i) += src[i + i] + src[i + i + 1];
+      return rn;
+}
+
+//---------------------------------------------------------
+//   takeReadHandle
+//    A handle of its own for a SndFileReader, from the
+//    pool or newly opened. 0 if the file can't be opened.
+//---------------------------------------------------------
+
+SNDFILE* SndFile::takeReadHandle(int* generation)
+      {
+      {
+      QMutexLocker locker(&readHandleLock);
+      *generation = readGeneration.load();
+      if (!readHandles.empty()) {
+            SNDFILE* h = readHandles.back();
+            readHandles.pop_back();
+            return h;
             }
-      else if ((srcChannels == 2) && (dstChannels == 1)) {
-            // mono to stereo
-            if(overwrite)
-              for (size_t i = 0; i < rn; ++i) {
-                  float data = *src++;
-                  *(dst[0]+i) = data;
-                  *(dst[1]+i) = data;
-                  }
-            else
-              for (size_t i = 0; i < rn; ++i) {
-                  float data = *src++;
-                  *(dst[0]+i) += data;
-                  *(dst[1]+i) += data;
-                  }
+      }
+      SF_INFO info;
+      info.format = 0;
+      return sf_open(path().toLocal8Bit().constData(), SFM_READ, &info);
+      }
+
+//---------------------------------------------------------
+//   giveBackReadHandle
+//---------------------------------------------------------
+
+void SndFile::giveBackReadHandle(SNDFILE* h, int generation)
+      {
+      // Idle handles kept per file.
+      static const size_t maxIdle = 8;
+      {
+      QMutexLocker locker(&readHandleLock);
+      if (generation == readGeneration.load() && readHandles.size() < maxIdle) {
+            readHandles.push_back(h);
+            return;
             }
-      else {
-            printf("SndFile:read channel mismatch %d -> %d\n",
-               srcChannels, dstChannels);
+      }
+      sf_close(h);
+      }
+
+//---------------------------------------------------------
+//   dropReadHandles
+//    The file data may change. Idle handles are closed,
+//    readers holding one take a new one on their next read.
+//---------------------------------------------------------
+
+void SndFile::dropReadHandles()
+      {
+      QMutexLocker locker(&readHandleLock);
+      readGeneration.fetchAndAddOrdered(1);
+      for (size_t i = 0; i < readHandles.size(); ++i)
+            sf_close(readHandles[i]);
+      readHandles.clear();
+      }
+
+//---------------------------------------------------------
+//   SndFileReader
+//---------------------------------------------------------
+
+SndFileReader::SndFileReader(const SndFileR& f)
+   : _file(f)
+      {
+      _sf         = 0;
+      _generation = 0;
+      _pos        = -1;
+      _stream     = 0;
+      _start      = 0;
+      _len        = 0;
+      _songOffset = 0;
+      }
+
+SndFileReader::~SndFileReader()
+      {
+      if (_stream) {
+            if (MusEGlobal::decoderPool)
+                  MusEGlobal::decoderPool->close(_stream);
+            else
+                  delete _stream;
             }
+      if (_sf)
+            _file->giveBackReadHandle(_sf, _generation);
+      }
 
-      return rn;
+//---------------------------------------------------------
+//   setPlacement
+//    The file frames the event plays, and its song frame
+//    minus its file frame. For decoding ahead.
+//---------------------------------------------------------
 
-}
+void SndFileReader::setPlacement(sf_count_t start, sf_count_t len, sf_count_t songOffset)
+      {
+      _start      = start;
+      _len        = len;
+      _songOffset = songOffset;
+      }
+
+//---------------------------------------------------------
+//   read
+//    n frames from file frame pos on into dst, like
+//    SndFile::read. Seeks only if pos is not where the
+//    last read ended.
+//---------------------------------------------------------
+
+size_t SndFileReader::read(int channels, float** dst, size_t n, off_t pos, bool overwrite)
+      {
+      if (_file.isNull())
+            return 0;
+      if (!_stream && _len && MusEGlobal::decoderPool && _file.isCompressed())
+            _stream = MusEGlobal::decoderPool->open(_file, _start, _len, _songOffset);
+      if (_stream)
+            return _stream->read(channels, dst, n, pos, overwrite);
+      if (_sf && _generation != _file->readGeneration.load()) {
+            sf_close(_sf);
+            _sf = 0;
+            }
+      if (!_sf) {
+            _sf = _file->takeReadHandle(&_generation);
+            if (!_sf)
+                  return 0;
+            _pos = -1;
+            }
+      if (pos != _pos) {
+            _pos = sf_seek(_sf, pos, SEEK_SET);
+            if (_pos != pos)
+                  return 0;
+            }
+      const int fch = _file.channels();
+      float buffer[n * fch];
+      size_t rn = SndFile::readFrames(_sf, _file->sfinfo.format, fch, buffer, dst, channels, n, overwrite);
+      _pos += rn;
+      return rn;
+      }
 
 
 //---------------------------------------------------------
@@ -545,50 +719,11 @@ size_t SndFile::readInternal(int srcChannels, float** dst, size_t n, bool overwr
 size_t SndFile::write(int srcChannels, float** src, size_t n)
       {
       int dstChannels = sfinfo.channels;
-      //float buffer[n * dstChannels];
       float *buffer = new float[n * dstChannels];
-      float *dst      = buffer;
 
       const float limitValue=0.9999;
+      interleave(src, srcChannels, buffer, dstChannels, n, limitValue);
 
-
-      if (srcChannels == dstChannels) {
-            for (size_t i = 0; i < n; ++i) {
-                  for (int ch = 0; ch < dstChannels; ++ch)
-                        if (*(src[ch]+i) > 0)
-                          *dst++ = *(src[ch]+i) < limitValue ? *(src[ch]+i) : limitValue;
-                        else
-                          *dst++ = *(src[ch]+i) > -limitValue ? *(src[ch]+i) : -limitValue;
-                  }
-            }
-      else if ((srcChannels == 1) && (dstChannels == 2)) {
-            // mono to stereo
-            for (size_t i = 0; i < n; ++i) {
-                  float data =  *(src[0]+i);
-                  if (data > 0) {
-                        *dst++ = data < limitValue ? data : limitValue; 
-                        *dst++ = data < limitValue ? data : limitValue;
-                        }
-                  else {
-                        *dst++ = data > -limitValue ? data : -limitValue; 
-                        *dst++ = data > -limitValue ? data : -limitValue; 
-                        }
-                  }
-            }
-      else if ((srcChannels == 2) && (dstChannels == 1)) {
-            // stereo to mono
-            for (size_t i = 0; i < n; ++i)
-                  if (*(src[0]+i) + *(src[1]+i) > 0)
-                    *dst++ = (*(src[0]+i) + *(src[1]+i)) < limitValue ? (*(src[0]+i) + *(src[1]+i)) : limitValue;
-                  else
-                    *dst++ = (*(src[0]+i) + *(src[1]+i)) > -limitValue ? (*(src[0]+i) + *(src[1]+i)) : -limitValue;
-            }
-      else {
-            printf("SndFile:write channel mismatch %d -> %d\n",
-               srcChannels, dstChannels);
-            delete[] buffer;
-            return 0;
-            }
       int nbr = sf_writef_float(sf, buffer, n) ;
       delete[] buffer;
       return nbr;
@@ -1239,18 +1374,11 @@ bool MusE::importWaveToTrack(QString& name, unsigned tick, MusECore::Track* trac
             printf("import audio file failed\n");
             return true;
             }
+      // A file of another samplerate is converted while playing,
+      //  its length is in frames at the current rate.
       int samples = f->samples();
-      if ((unsigned)MusEGlobal::sampleRate != f->samplerate()) {
-            if(QMessageBox::question(this, tr("Import Wavefile"),
-                  tr("This wave file has a samplerate of %1,\n"
-                  "as opposed to current setting %2.\n"
-                  "Do you still want to import it?").arg(f->samplerate()).arg(MusEGlobal::sampleRate),
-                  tr("&Yes"), tr("&No"),
-                  QString::null, 0, 1 ))
-                  {
-                  return true; // this removed f from the stack, dropping refcount maybe to zero and maybe deleting the thing
-                  }
-            }
+      if (f->samplerate() && (unsigned)MusEGlobal::sampleRate != f->samplerate())
+            samples = int((double)samples * MusEGlobal::sampleRate / f->samplerate());
       track->setChannels(f->channels());
 
       MusECore::WavePart* part = new MusECore::WavePart((MusECore::WaveTrack *)track);
@@ -25,9 +25,12 @@
 #define __WAVE_H__
 
 #include <list>
+#include <vector>
 #include <sndfile.h>
 
 #include <QString>
+#include <QMutex>
+#include <QAtomicInt>
 
 class QFileInfo;
 
@@ -46,6 +49,7 @@ struct SampleV {
       };
 
 class SndFileList;
+class DecodeStream;
 
 //---------------------------------------------------------
 //   SndFile
@@ -63,7 +67,15 @@ class SndFile {
 
       bool openFlag;
       bool writeFlag;
+      bool preallocated;            //!< disk space reserved past the end
       size_t readInternal(int srcChannels, float** dst, size_t n, bool overwrite, float *buffer);
+
+      // Idle handles of SndFileReaders. Handles of an older
+      //  generation are of the file data before it changed.
+      QMutex readHandleLock;
+      std::vector<SNDFILE*> readHandles;
+      QAtomicInt readGeneration;
+      void dropReadHandles();
       
    protected:
       int refCount;
@@ -79,7 +91,7 @@ class SndFile {
       void readCache(const QString& path, bool progress);
 
       bool openRead(bool createCache=true);        //!< returns true on error
-      bool openWrite();       //!< returns true on error
+      bool openWrite(unsigned preallocFrames = 0);       //!< returns true on error
       void close();
       void remove();
 
@@ -99,6 +111,7 @@ class SndFile {
       unsigned channels() const;
       unsigned samplerate() const;
       unsigned format() const;
+      bool isCompressed() const;    //!< FLAC or Ogg, decoding takes cpu time
       int sampleBits() const;
       void setFormat(int fmt, int ch, int rate);
 
@@ -112,7 +125,15 @@ class SndFile {
       QString strerror() const;
 
       static SndFile* search(const QString& name);
+      static size_t readFrames(SNDFILE* h, int format, int fileChannels, float* buffer,
+         float** dst, int channels, size_t n, bool overwrite);
+
+      SNDFILE* takeReadHandle(int* generation);
+      void giveBackReadHandle(SNDFILE*, int generation);
+
       friend class SndFileR;
+      friend class SndFileReader;
+      friend class DecodeStream;
       };
 
 //---------------------------------------------------------
@@ -139,7 +160,7 @@ class SndFileR {
       bool isNull() const     { return sf == 0; }
 
       bool openRead()         { return sf->openRead();  }
-      bool openWrite()        { return sf->openWrite(); }
+      bool openWrite(unsigned preallocFrames = 0) { return sf->openWrite(preallocFrames); }
       void close()            { sf->close();     }
       void remove()           { sf->remove();    }
 
@@ -159,6 +180,7 @@ class SndFileR {
       unsigned channels() const   { return sf->channels(); }
       unsigned samplerate() const { return sf->samplerate(); }
       unsigned format() const     { return sf->format(); }
+      bool isCompressed() const   { return sf->isCompressed(); }
       int sampleBits() const      { return sf->sampleBits(); }
       void setFormat(int fmt, int ch, int rate) {
             sf->setFormat(fmt, ch, rate);
@@ -183,6 +205,33 @@ class SndFileR {
       QString strerror() const { return sf->strerror(); }
       };
 
+//---------------------------------------------------------
+//   SndFileReader
+//    A read position of its own on a sound file, for one
+//    stream of the prefetch thread. Reads in sequence do
+//    not seek, and readers of the same file do not get in
+//    each other's way, in one thread or several. The
+//    handle comes from the file's pool and goes back to it.
+//    Compressed files are read through a stream of the
+//    decoder pool, if there is one.
+//---------------------------------------------------------
+
+class SndFileReader {
+      SndFileR _file;
+      SNDFILE* _sf;
+      int _generation;
+      sf_count_t _pos;
+      DecodeStream* _stream;
+      sf_count_t _start, _len, _songOffset;
+
+   public:
+      SndFileReader(const SndFileR& f);
+      ~SndFileReader();
+      const SndFileR& file() const { return _file; }
+      void setPlacement(sf_count_t start, sf_count_t len, sf_count_t songOffset);
+      size_t read(int channels, float** dst, size_t n, off_t pos, bool overwrite);
+      };
+
 
 //---------------------------------------------------------
 //   SndFileList
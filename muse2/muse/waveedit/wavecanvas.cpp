@@ -153,7 +153,14 @@ void WaveCanvas::songChanged(MusECore::SongChangedFlags_t flags)
       if(flags == SC_MIDI_CONTROLLER)
         return;
     
-      if (flags & ~(SC_SELECTION | SC_PART_SELECTION | SC_TRACK_SELECTION)) {
+      bool rebuild = flags & ~(SC_SELECTION | SC_PART_SELECTION | SC_TRACK_SELECTION);
+      // Only events or parts this editor does not show changed?
+      if (rebuild && !(flags & ~(SC_SELECTION | SC_PART_SELECTION | SC_TRACK_SELECTION |
+         SC_EVENT_INSERTED | SC_EVENT_REMOVED | SC_EVENT_MODIFIED | SC_PART_MODIFIED))
+         && !MusEGlobal::song->changes(flags).touches(editor->parts()))
+            rebuild = false;
+
+      if (rebuild) {
             // TODO FIXME: don't we actually only want SC_PART_*, and maybe SC_TRACK_DELETED?
             //             (same in waveview.cpp)
             bool curItemNeedsRestore=false;
@@ -0,0 +1,305 @@
+//=========================================================
+//  MusE
+//  Linux Music Editor
+//
+//  wavetiles.cpp
+//
+//  This program is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU General Public License
+//  as published by the Free Software Foundation; version 2 of
+//  the License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+//
+//=========================================================
+
+#include <string.h>
+#include <algorithm>
+#include <vector>
+
+#include <QMutexLocker>
+#include <QRunnable>
+
+#include "wavetiles.h"
+#include "wave.h"
+
+namespace MusEGlobal {
+MusECore::WaveTileCache* waveTiles = 0;
+}
+
+namespace MusECore {
+
+// Memory kept for tile images. When exceeded, the least
+//  recently used tiles are dropped down to three quarters.
+static const size_t maxTileBytes = 96 * 1024 * 1024;
+
+//---------------------------------------------------------
+//   initWaveTiles
+//---------------------------------------------------------
+
+void initWaveTiles()
+{
+  MusEGlobal::waveTiles = new WaveTileCache();
+}
+
+//---------------------------------------------------------
+//   Key::operator<
+//---------------------------------------------------------
+
+bool WaveTileCache::Key::operator<(const Key& k) const
+{
+  if(file != k.file)     return file < k.file;
+  if(frames != k.frames) return frames < k.frames;
+  if(spp != k.spp)       return spp < k.spp;
+  if(index != k.index)   return index < k.index;
+  if(height != k.height) return height < k.height;
+  if(peak != k.peak)     return peak < k.peak;
+  return rms < k.rms;
+}
+
+//---------------------------------------------------------
+//   vline
+//---------------------------------------------------------
+
+static inline void vline(QImage& img, int x, int y1, int y2, QRgb color)
+{
+  if(y1 < 0)
+    y1 = 0;
+  if(y2 >= img.height())
+    y2 = img.height() - 1;
+  uchar* p = img.bits() + y1 * img.bytesPerLine();
+  for(int y = y1; y <= y2; ++y, p += img.bytesPerLine())
+    ((QRgb*)p)[x] = color;
+}
+
+//---------------------------------------------------------
+//   WaveTileJob
+//    Renders one tile from the peak values collected in
+//    the gui thread. Same drawing as the plain column by
+//    column drawing in PartCanvas::drawWavePart.
+//---------------------------------------------------------
+
+class WaveTileJob : public QRunnable {
+      WaveTileCache* _cache;
+      WaveTileCache::Key _key;
+      std::vector<SampleV> _data;   // channels values per column
+      unsigned _channels;
+      unsigned _generation;
+
+   public:
+      WaveTileJob(WaveTileCache* cache, const WaveTileCache::Key& key,
+         std::vector<SampleV>& data, unsigned channels, unsigned generation)
+         : _cache(cache), _key(key), _channels(channels), _generation(generation)
+            {
+            _data.swap(data);
+            }
+      virtual void run();
+      };
+
+void WaveTileJob::run()
+{
+  const int hh = _key.height;
+  const QRgb peakColor = qPremultiply(_key.peak);
+  const QRgb rmsColor  = qPremultiply(_key.rms);
+  QImage img(WaveTileCache::TileWidth, hh, QImage::Format_ARGB32_Premultiplied);
+  img.fill(0);
+
+  const int h = hh / 2;
+  const SampleV* sa = &_data[0];
+  if(h < 20)
+  {
+    //    combine multi channels into one waveform
+    const int cc = hh % 2 ? 0 : 1;
+    for(int x = 0; x < WaveTileCache::TileWidth; ++x, sa += _channels)
+    {
+      int peak = 0;
+      int rms  = 0;
+      for(unsigned k = 0; k < _channels; ++k)
+      {
+        if(sa[k].peak > peak)
+          peak = sa[k].peak;
+        rms += sa[k].rms;
+      }
+      rms /= _channels;
+      peak = (peak * (hh-2)) >> 9;
+      rms  = (rms  * (hh-2)) >> 9;
+      vline(img, x, h - peak - cc, h + peak, peakColor);
+      vline(img, x, h - rms - cc, h + rms, rmsColor);
+    }
+  }
+  else
+  {
+    //  multi channel display
+    const int hm = hh / (_channels * 2);
+    const int cc = hh % (_channels * 2) ? 0 : 1;
+    for(int x = 0; x < WaveTileCache::TileWidth; ++x, sa += _channels)
+    {
+      int y = hm;
+      for(unsigned k = 0; k < _channels; ++k)
+      {
+        int peak = (sa[k].peak * (hm - 1)) >> 8;
+        int rms  = (sa[k].rms  * (hm - 1)) >> 8;
+        vline(img, x, y - peak - cc, y + peak, peakColor);
+        vline(img, x, y - rms - cc, y + rms, rmsColor);
+        y += 2 * hm;
+      }
+    }
+  }
+  _cache->store(_key, img, _generation);
+}
+
+//---------------------------------------------------------
+//   WaveTileCache
+//---------------------------------------------------------
+
+WaveTileCache::WaveTileCache()
+   : QObject(0)
+{
+  _generation = 0;
+  _useCounter = 0;
+  _bytes = 0;
+}
+
+WaveTileCache::~WaveTileCache()
+{
+  _threads.clear();
+  _threads.waitForDone();
+}
+
+//---------------------------------------------------------
+//   tile
+//    Sets image to the tile and returns true if it is
+//    ready. Otherwise schedules it and returns false,
+//    tileReady() is emitted when it is done.
+//---------------------------------------------------------
+
+bool WaveTileCache::tile(SndFileR& f, int spp, int index, int height,
+   const QColor& peak, const QColor& rms, QImage* image)
+{
+  Key key;
+  key.file   = f.operator->();
+  key.frames = f.samples();
+  key.spp    = spp;
+  key.index  = index;
+  key.height = height;
+  key.peak   = peak.rgba();
+  key.rms    = rms.rgba();
+
+  unsigned generation;
+  {
+    QMutexLocker locker(&_lock);
+    std::map<Key, Tile>::iterator i = _tiles.find(key);
+    if(i != _tiles.end())
+    {
+      if(!i->second.ready)
+        return false;
+      i->second.lastUse = ++_useCounter;
+      *image = i->second.image;
+      return true;
+    }
+    generation = _generation;
+    _tiles[key].generation = generation;
+  }
+
+  // Collect the peak values here, SndFile is not safe to read
+  //  from other threads. At spp >= the wca resolution this only
+  //  reads the in memory peak cache.
+  const unsigned channels = f.channels();
+  std::vector<SampleV> data(channels * TileWidth);
+  memset(&data[0], 0, data.size() * sizeof(SampleV));
+  unsigned pos = unsigned(index) * TileWidth * spp;
+  for(int x = 0; x < TileWidth && pos < key.frames; ++x, pos += spp)
+    f.read(&data[x * channels], spp, pos);
+
+  _threads.start(new WaveTileJob(this, key, data, channels, generation));
+  return false;
+}
+
+//---------------------------------------------------------
+//   store
+//    Called from the worker threads.
+//---------------------------------------------------------
+
+void WaveTileCache::store(const Key& key, const QImage& image, unsigned generation)
+{
+  {
+    QMutexLocker locker(&_lock);
+    // Dropped or dropped and asked for again in the meantime?
+    std::map<Key, Tile>::iterator i = _tiles.find(key);
+    if(i == _tiles.end() || i->second.generation != generation)
+      return;
+    i->second.image   = image;
+    i->second.ready   = true;
+    i->second.lastUse = ++_useCounter;
+    _bytes += image.bytesPerLine() * image.height();
+    if(_bytes > maxTileBytes)
+      evict();
+  }
+  emit tileReady();
+}
+
+//---------------------------------------------------------
+//   evict
+//    Must be called with _lock held.
+//---------------------------------------------------------
+
+void WaveTileCache::evict()
+{
+  std::vector<std::pair<unsigned, Key> > used;
+  for(std::map<Key, Tile>::const_iterator i = _tiles.begin(); i != _tiles.end(); ++i)
+    if(i->second.ready)
+      used.push_back(std::make_pair(i->second.lastUse, i->first));
+  std::sort(used.begin(), used.end());
+  for(size_t n = 0; n < used.size() && _bytes > maxTileBytes / 4 * 3; ++n)
+  {
+    std::map<Key, Tile>::iterator i = _tiles.find(used[n].second);
+    _bytes -= i->second.image.bytesPerLine() * i->second.image.height();
+    _tiles.erase(i);
+  }
+}
+
+//---------------------------------------------------------
+//   invalidate
+//    The peak data of the file changed or the file goes
+//    away. Drops its tiles, tiles in the works are
+//    discarded when done.
+//---------------------------------------------------------
+
+void WaveTileCache::invalidate(const SndFile* f)
+{
+  QMutexLocker locker(&_lock);
+  std::map<Key, Tile>::iterator i = _tiles.begin();
+  while(i != _tiles.end())
+  {
+    if(i->first.file == f)
+    {
+      if(i->second.ready)
+        _bytes -= i->second.image.bytesPerLine() * i->second.image.height();
+      _tiles.erase(i++);
+    }
+    else
+      ++i;
+  }
+  ++_generation;
+}
+
+//---------------------------------------------------------
+//   clear
+//---------------------------------------------------------
+
+void WaveTileCache::clear()
+{
+  QMutexLocker locker(&_lock);
+  _tiles.clear();
+  _bytes = 0;
+  ++_generation;
+}
+
+} // namespace MusECore
@@ -0,0 +1,104 @@
+//=========================================================
+//  MusE
+//  Linux Music Editor
+//
+//  wavetiles.h
+//
+//  This program is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU General Public License
+//  as published by the Free Software Foundation; version 2 of
+//  the License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+//
+//=========================================================
+
+#ifndef __WAVETILES_H__
+#define __WAVETILES_H__
+
+#include <map>
+
+#include <QObject>
+#include <QMutex>
+#include <QThreadPool>
+#include <QImage>
+#include <QColor>
+
+namespace MusECore {
+
+class SndFile;
+class SndFileR;
+
+//---------------------------------------------------------
+//   WaveTileCache
+//    Peak/rms images of sound files, TileWidth columns of
+//    a fixed number of frames each. Tiles are rendered by
+//    worker threads and kept (least recently used first
+//    out) until the file data changes. Gui thread only,
+//    except for the workers.
+//---------------------------------------------------------
+
+class WaveTileCache : public QObject {
+      Q_OBJECT
+
+   public:
+      enum { TileWidth = 256 };
+
+   private:
+      struct Key {
+            const SndFile* file;
+            unsigned frames;    // file length, a growing file gets new tiles
+            int spp;            // frames per column
+            int index;          // tile number at this spp
+            int height;
+            QRgb peak, rms;
+            bool operator<(const Key&) const;
+            };
+
+      struct Tile {
+            QImage image;
+            bool ready;
+            unsigned generation;  // of the job rendering it
+            unsigned lastUse;
+            Tile() : ready(false), generation(0), lastUse(0) {}
+            };
+
+      QThreadPool _threads;
+      QMutex _lock;                 // guards everything below
+      std::map<Key, Tile> _tiles;
+      unsigned _generation;         // bumped whenever tiles are dropped
+      unsigned _useCounter;
+      size_t _bytes;
+
+      void store(const Key&, const QImage&, unsigned generation);
+      void evict();
+
+      friend class WaveTileJob;
+
+   signals:
+      void tileReady();
+
+   public:
+      WaveTileCache();
+      virtual ~WaveTileCache();
+
+      bool tile(SndFileR& f, int spp, int index, int height,
+         const QColor& peak, const QColor& rms, QImage* image);
+      void invalidate(const SndFile*);
+      void clear();
+      };
+
+} // namespace MusECore
+
+namespace MusEGlobal {
+extern MusECore::WaveTileCache* waveTiles;
+}
+
+#endif
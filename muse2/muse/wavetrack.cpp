@@ -93,6 +93,17 @@ void WaveTrack::fetchData(unsigned pos, unsigned samples, float** bp, bool doSee
       for (int i = 0; i < channels(); ++i)
             memset(bp[i], 0, samples * sizeof(float));
       
+      // Let go of the converters of removed events now and then,
+      //  and of the read positions in the files of all parts,
+      //  also those skipped below.
+      if (doSeek) {
+        for (iPart ip = parts()->begin(); ip != parts()->end(); ++ip) {
+              WavePart* part = (WavePart*)(ip->second);
+              part->remapConverters();
+              part->releaseReaders();
+              }
+      }
+      
       // Process only if track is not off.
       if(!off())
       {  
@@ -147,6 +158,10 @@ void WaveTrack::fetchData(unsigned pos, unsigned samples, float** bp, bool doSee
                     }
               }
       }
+      
+      // Readers of events not read by this fetch are done.
+      for (iPart ip = parts()->begin(); ip != parts()->end(); ++ip)
+            ((WavePart*)(ip->second))->releaseUnread();
               
       if(MusEGlobal::config.useDenormalBias) {
             // add denormal bias to outdata
@@ -158,6 +173,18 @@ void WaveTrack::fetchData(unsigned pos, unsigned samples, float** bp, bool doSee
       _prefetchFifo.add();
       }
 
+//---------------------------------------------------------
+//   releaseReaders
+//    Of all parts. On stop, and when the track is off.
+//    Called from prefetch thread.
+//---------------------------------------------------------
+
+void WaveTrack::releaseReaders()
+      {
+      for (iPart ip = parts()->begin(); ip != parts()->end(); ++ip)
+            ((WavePart*)(ip->second))->releaseReaders();
+      }
+
 //---------------------------------------------------------
 //   write
 //---------------------------------------------------------
@@ -269,7 +296,7 @@ bool WaveTrack::getData(unsigned framePos, int channels, unsigned nframe, float*
                               //
                               // Tested: This line is OK for track-to-track recording, the waves are in sync:
 #endif                              
-                              if (fifo.put(channels, nframe, bp, MusEGlobal::audio->pos().frame()))  
+                              if (_recRing.put(channels, nframe, bp, MusEGlobal::audio->pos().frame()))  
                                     printf("WaveTrack::getData(%d, %d, %d): fifo overrun\n",
                                        framePos, channels, nframe);
                               }
@@ -235,6 +235,7 @@ MidiSyncConfig::MidiSyncConfig(QWidget* parent)
       syncRecFilterPreset->addItem(tr("Small"), MusECore::MidiSyncInfo::SMALL);
       syncRecFilterPreset->addItem(tr("Large"), MusECore::MidiSyncInfo::LARGE);
       syncRecFilterPreset->addItem(tr("Large with pre-detect"), MusECore::MidiSyncInfo::LARGE_WITH_PRE_DETECT);
+      syncRecFilterPreset->addItem(tr("Clock tracking loop"), MusECore::MidiSyncInfo::PLL);
       
       songChanged(-1);
       
@@ -42,6 +42,33 @@ class allpass
 //            bufidx = ++bufidx % bufsize;
       	return output;
             }
+
+      //---------------------------------------------------
+      //   processblock
+      //    In-place processing of n samples. Denormals are
+      //    left to the FTZ/DAZ mode set by the caller.
+      //---------------------------------------------------
+
+      void processblock(float* io, int n) {
+            int done = 0;
+            while (done < n) {
+                  int m = bufsize - bufidx;
+                  if (m > n - done)
+                        m = n - done;
+                  float* __restrict__ p   = buffer + bufidx;
+                  float* __restrict__ io1 = io + done;
+                  for (int i = 0; i < m; ++i) {
+                        float bufout = p[i];
+                        float input  = io1[i];
+                        p[i]   = input + (bufout*feedback);
+                        io1[i] = -input + bufout;
+                        }
+                  bufidx += m;
+                  if (bufidx >= bufsize)
+                        bufidx = 0;
+                  done += m;
+                  }
+            }
 	void	mute() {
       	for (int i=0; i<bufsize; i++)
 	      	buffer[i]=0;
@@ -0,0 +1,157 @@
+//=========================================================
+//  MusE
+//  Linux Music Editor
+//  $Id: ./plugins/freeverb/combbank.h $
+//
+// Based on the comb filter by Jezar at Dreampoint
+// This code is public domain
+//
+//=========================================================
+// Bank of eight comb filters processed in one vector
+//
+
+#ifndef _combbank_
+#define _combbank_
+
+#include <string.h>
+#include "denormals.h"
+#include "tuning.h"
+
+//---------------------------------------------------------
+//   CombBank
+//    Eight independent comb filters, one per vector lane.
+//    Each lane has its own delay line. The delay line reads
+//    and writes are scalar, the damping and feedback
+//    arithmetic is done for all lanes at once.
+//---------------------------------------------------------
+
+class CombBank
+      {
+   public:
+      enum { lanes = 8 };
+      typedef float vec __attribute__((vector_size(lanes * sizeof(float))));
+
+   private:
+      vec   feedback;
+      vec   filterstore;
+      vec   damp1;
+      vec   damp2;
+      vec   lanegain;
+      float* buffer[lanes];
+      int bufsize[lanes];
+      int bufidx[lanes];
+      float scratch[blocksize * lanes];
+
+      // Fills through a reference: returning the 32 byte vector
+      // by value changes the ABI without AVX (-Wpsabi).
+      static void splat(vec& r, float v) {
+            for (int k = 0; k < lanes; ++k)
+                  r[k] = v;
+            }
+
+   public:
+      CombBank() {
+            splat(filterstore, 0.0f);
+            splat(feedback, 0.0f);
+            splat(damp1, 0.0f);
+            splat(damp2, 1.0f);
+            splat(lanegain, 1.0f);
+            for (int k = 0; k < lanes; ++k) {
+                  buffer[k]  = 0;
+                  bufsize[k] = 0;
+                  bufidx[k]  = 0;
+                  }
+            }
+      void setbuffer(int lane, float* buf, int size) {
+            buffer[lane]  = buf;
+            bufsize[lane] = size;
+            bufidx[lane]  = 0;
+            }
+      void mute() {
+            for (int k = 0; k < lanes; ++k)
+                  for (int i = 0; i < bufsize[k]; ++i)
+                        buffer[k][i] = 0.0f;
+            splat(filterstore, 0.0f);
+            }
+      void setdamp(float val) {
+            splat(damp1, val);
+            splat(damp2, 1.0f - val);
+            }
+      void setfeedback(float val) { splat(feedback, val); }
+
+      //---------------------------------------------------
+      //   setlanegain
+      //    Output weight of one lane in the mixdown.
+      //---------------------------------------------------
+
+      void setlanegain(int lane, float val) { lanegain[lane] = val; }
+
+      //---------------------------------------------------
+      //   process
+      //    Run all combs over n <= blocksize samples of input.
+      //    The weighted sum of lanes [0, split) is written
+      //    to outA, the sum of lanes [split, lanes) to outB
+      //    (if outB is not null).
+      //    Every delay line is longer than blocksize, so the
+      //    delay outputs of a chunk can be read before any of
+      //    its inputs are written back.
+      //---------------------------------------------------
+
+      void process(const float* in, float* outA, float* outB, int split, int n) {
+            for (int i = 0; i < n; ++i)
+                  outA[i] = 0.0f;
+            if (outB)
+                  for (int i = 0; i < n; ++i)
+                        outB[i] = 0.0f;
+
+            int done = 0;
+            while (done < n) {
+                  // Largest chunk in which no delay line wraps around.
+                  int m = n - done;
+                  for (int k = 0; k < lanes; ++k) {
+                        int avail = bufsize[k] - bufidx[k];
+                        if (avail < m)
+                              m = avail;
+                        }
+
+                  // Transpose delay outputs into lane order and mix
+                  // them down, vectorized over samples.
+                  for (int k = 0; k < lanes; ++k) {
+                        const float* p = buffer[k] + bufidx[k];
+                        float* out     = (k < split ? outA : outB) + done;
+                        float g        = lanegain[k];
+                        for (int i = 0; i < m; ++i) {
+                              scratch[i * lanes + k] = p[i];
+                              out[i] += p[i] * g;
+                              }
+                        }
+
+                  // Damping and feedback, all lanes at once.
+                  vec fs = filterstore;
+                  for (int i = 0; i < m; ++i) {
+                        vec output;
+                        memcpy(&output, scratch + i * lanes, sizeof(vec));
+                        fs = output * damp2 + fs * damp1;
+                        vec w = in[done + i] + fs * feedback;
+                        memcpy(scratch + i * lanes, &w, sizeof(vec));
+                        }
+                  undenormaliseblock(fs);
+                  filterstore = fs;
+
+                  // Write the new delay inputs back.
+                  for (int k = 0; k < lanes; ++k) {
+                        float* p = buffer[k] + bufidx[k];
+                        for (int i = 0; i < m; ++i)
+                              p[i] = scratch[i * lanes + k];
+                        bufidx[k] += m;
+                        if (bufidx[k] >= bufsize[k])
+                              bufidx[k] = 0;
+                        }
+                  done += m;
+                  }
+            }
+      };
+
+#endif //_combbank_
+
+//ends
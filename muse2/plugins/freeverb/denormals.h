@@ -29,6 +29,40 @@
       sample -= anti_denormal;      \
       }
 
+// Block variant for filter state vectors: flushes the
+// state once per processed block instead of every sample.
+
+template <typename T> inline void undenormaliseblock(T& v)
+      {
+      const float anti_denormal = 1e-18f;
+      v += anti_denormal;
+      v -= anti_denormal;
+      }
+
+#ifdef __SSE__
+#include <xmmintrin.h>
+#endif
+
+//---------------------------------------------------------
+//   DenormalGuard
+//    Sets the FTZ (flush to zero) and DAZ (denormals are
+//    zero) flags for the lifetime of the object, so the
+//    hot loops need no per-sample denormal handling.
+//    The previous mode is restored on destruction.
+//---------------------------------------------------------
+
+class DenormalGuard {
+#ifdef __SSE__
+      unsigned int csr;
+   public:
+      DenormalGuard() {
+            csr = _mm_getcsr();
+            _mm_setcsr(csr | 0x8040);     // FTZ | DAZ
+            }
+      ~DenormalGuard() { _mm_setcsr(csr); }
+#endif
+      };
+
 #endif//_denormals_
 
 //ends
@@ -106,6 +106,7 @@ static const char* portNames[] = {
       "Room Size",
       "Damping",
       "Wet Level",
+      "Quality",
       };
 
 LADSPA_PortDescriptor portDescriptors[] = {
@@ -116,6 +117,7 @@ LADSPA_PortDescriptor portDescriptors[] = {
       LADSPA_PORT_INPUT  | LADSPA_PORT_CONTROL,
       LADSPA_PORT_INPUT  | LADSPA_PORT_CONTROL,
       LADSPA_PORT_INPUT  | LADSPA_PORT_CONTROL,
+      LADSPA_PORT_INPUT  | LADSPA_PORT_CONTROL,
       };
 
 LADSPA_PortRangeHint portRangeHints[] = {
@@ -126,6 +128,7 @@ LADSPA_PortRangeHint portRangeHints[] = {
       { LADSPA_HINT_BOUNDED_ABOVE | LADSPA_HINT_BOUNDED_BELOW,  0.0, 1.0 },
       { LADSPA_HINT_BOUNDED_ABOVE | LADSPA_HINT_BOUNDED_BELOW | LADSPA_HINT_LOGARITHMIC, 0.0, 1.0 },
       { LADSPA_HINT_BOUNDED_ABOVE | LADSPA_HINT_BOUNDED_BELOW | LADSPA_HINT_LOGARITHMIC, 0.0, 1.0 },
+      { LADSPA_HINT_TOGGLED | LADSPA_HINT_DEFAULT_1, 0.0, 0.0 },
       };
 
 LADSPA_Descriptor descriptor = {
@@ -135,7 +138,7 @@ LADSPA_Descriptor descriptor = {
       "Freeverb",
       "Werner Schweer",
       "None",
-      7,
+      8,
       portDescriptors,
       portNames,
       portRangeHints,
@@ -0,0 +1,187 @@
+//=========================================================
+//  MusE
+//  Linux Music Editor
+//  $Id: ./plugins/freeverb/freeverb_bench.cpp $
+//
+//  Throughput benchmark: per-sample scalar reverb model
+//  (comb.h/allpass.h) against the block processed
+//  Revmodel in economy and full quality.
+//
+//  This program is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU General Public License
+//  as published by the Free Software Foundation; version 2 of
+//  the License, or (at your option) any later version.
+//
+//=========================================================
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include <sys/time.h>
+
+#include "revmodel.h"
+#include "comb.h"
+
+//---------------------------------------------------------
+//   RefModel
+//    The original scalar processing loop.
+//---------------------------------------------------------
+
+class RefModel {
+      comb combL[numcombs];
+      comb combR[numcombs];
+      allpass allpassL[numallpasses];
+      allpass allpassR[numallpasses];
+      float* mem;
+
+   public:
+      RefModel() {
+            const int tc[numcombs] = { combtuningL1, combtuningL2, combtuningL3, combtuningL4,
+                                       combtuningL5, combtuningL6, combtuningL7, combtuningL8 };
+            const int ta[numallpasses] = { allpasstuningL1, allpasstuningL2,
+                                           allpasstuningL3, allpasstuningL4 };
+            mem = (float*)calloc(2 * (combtuningL8 + allpasstuningL1 + 2 * stereospread)
+                                 * (numcombs + numallpasses), sizeof(float));
+            float* p = mem;
+            for (int i = 0; i < numcombs; ++i) {
+                  combL[i].setbuffer(p, tc[i]);                p += tc[i];
+                  combR[i].setbuffer(p, tc[i] + stereospread); p += tc[i] + stereospread;
+                  combL[i].setfeedback(initialroom * scaleroom + offsetroom);
+                  combR[i].setfeedback(initialroom * scaleroom + offsetroom);
+                  combL[i].setdamp(initialdamp * scaledamp);
+                  combR[i].setdamp(initialdamp * scaledamp);
+                  }
+            for (int i = 0; i < numallpasses; ++i) {
+                  allpassL[i].setbuffer(p, ta[i]);                p += ta[i];
+                  allpassR[i].setbuffer(p, ta[i] + stereospread); p += ta[i] + stereospread;
+                  allpassL[i].setfeedback(0.5f);
+                  allpassR[i].setfeedback(0.5f);
+                  }
+            }
+      ~RefModel() { free(mem); }
+
+      void process(const float* inL, const float* inR, float* outL, float* outR, long n) {
+            for (long i = 0; i < n; ++i) {
+                  float l = 0.0f;
+                  float r = 0.0f;
+                  float input = (inL[i] + inR[i]) * fixedgain;
+                  for (int k = 0; k < numcombs; k++) {
+                        l += combL[k].process(input);
+                        r += combR[k].process(input);
+                        }
+                  for (int k = 0; k < numallpasses; k++) {
+                        l = allpassL[k].process(l);
+                        r = allpassR[k].process(r);
+                        }
+                  outL[i] = l;
+                  outR[i] = r;
+                  }
+            }
+      };
+
+static double now()
+      {
+      struct timeval tv;
+      gettimeofday(&tv, 0);
+      return tv.tv_sec + tv.tv_usec / 1000000.0;
+      }
+
+//---------------------------------------------------------
+//   main
+//    freeverb_bench [seconds-of-audio] [period-size]
+//---------------------------------------------------------
+
+int main(int argc, char* argv[])
+      {
+      const long rate = 48000;
+      long seconds    = argc > 1 ? atol(argv[1]) : 60;
+      long period     = argc > 2 ? atol(argv[2]) : 256;
+      if (seconds <= 0 || period <= 0) {
+            fprintf(stderr, "usage: %s [seconds-of-audio] [period-size]\n", argv[0]);
+            return 1;
+            }
+      long periods = seconds * rate / period;
+
+      float* inL  = new float[period];
+      float* inR  = new float[period];
+      float* outL = new float[period];
+      float* outR = new float[period];
+      float* refL = new float[period];
+      float* refR = new float[period];
+      srand(1);
+      for (long i = 0; i < period; ++i) {
+            inL[i] = (rand() / float(RAND_MAX)) * 2.0f - 1.0f;
+            inR[i] = (rand() / float(RAND_MAX)) * 2.0f - 1.0f;
+            }
+
+      double audio = double(periods * period) / rate;
+      printf("freeverb_bench: %ld s of audio at %ld Hz, period %ld\n", seconds, rate, period);
+
+      RefModel* ref = new RefModel;
+      double t0 = now();
+      for (long p = 0; p < periods; ++p)
+            ref->process(inL, inR, refL, refR, period);
+      double tref = now() - t0;
+      printf("  scalar reference : %8.3f s  %8.1fx realtime  %7.2f Msamples/s\n",
+         tref, audio / tref, periods * period / tref / 1e6);
+      delete ref;
+
+      for (int q = economyquality; q <= fullquality; ++q) {
+            Revmodel* rev = new Revmodel;
+            float room = initialroom, damp = initialdamp, dry = 0.0f, quality = q;
+            rev->port[0] = inL;
+            rev->port[1] = inR;
+            rev->port[2] = outL;
+            rev->port[3] = outR;
+            rev->port[4] = &room;
+            rev->port[5] = &damp;
+            rev->port[6] = &dry;
+            rev->port[7] = &quality;
+            rev->activate();
+            quality = q;
+            dry     = 0.0f;
+
+            // Compare against the reference in full quality, over
+            // enough periods for the delay lines (the longest comb
+            // is 1640 samples) to feed back several times.
+            if (q == fullquality) {
+                  RefModel cmp;
+                  long cmpperiods = (16 * 1024 + period - 1) / period;
+                  float maxdiff = 0.0f, maxout = 0.0f;
+                  float wet = scalewet;
+                  for (long p = 0; p < cmpperiods; ++p) {
+                        cmp.process(inL, inR, refL, refR, period);
+                        rev->processreplace(period);
+                        for (long i = 0; i < period; ++i) {
+                              float d = fabsf(outL[i] - refL[i] * wet);
+                              if (d > maxdiff)
+                                    maxdiff = d;
+                              d = fabsf(outR[i] - refR[i] * wet);
+                              if (d > maxdiff)
+                                    maxdiff = d;
+                              if (fabsf(refL[i] * wet) > maxout)
+                                    maxout = fabsf(refL[i] * wet);
+                              }
+                        }
+                  printf("  max deviation from reference (full quality, %ld samples): %g, peak %g\n",
+                     cmpperiods * period, maxdiff, maxout);
+                  }
+
+            t0 = now();
+            for (long p = 0; p < periods; ++p)
+                  rev->processreplace(period);
+            double t = now() - t0;
+            printf("  block %-9s  : %8.3f s  %8.1fx realtime  %7.2f Msamples/s  speedup %.2f\n",
+               q == economyquality ? "economy" : "full",
+               t, audio / t, periods * period / t / 1e6, tref / t);
+            delete rev;
+            }
+
+      delete[] inL;
+      delete[] inR;
+      delete[] outL;
+      delete[] outR;
+      delete[] refL;
+      delete[] refR;
+      return 0;
+      }
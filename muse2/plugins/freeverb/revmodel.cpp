@@ -20,23 +20,34 @@
 
 Revmodel::Revmodel()
       {
+      float* bufcombL[numcombs] = {
+            bufcombL1, bufcombL2, bufcombL3, bufcombL4,
+            bufcombL5, bufcombL6, bufcombL7, bufcombL8 };
+      float* bufcombR[numcombs] = {
+            bufcombR1, bufcombR2, bufcombR3, bufcombR4,
+            bufcombR5, bufcombR6, bufcombR7, bufcombR8 };
+      const int tuningL[numcombs] = {
+            combtuningL1, combtuningL2, combtuningL3, combtuningL4,
+            combtuningL5, combtuningL6, combtuningL7, combtuningL8 };
+      const int tuningR[numcombs] = {
+            combtuningR1, combtuningR2, combtuningR3, combtuningR4,
+            combtuningR5, combtuningR6, combtuningR7, combtuningR8 };
+
 	// Tie the components to their buffers
-	combL[0].setbuffer(bufcombL1,combtuningL1);
-	combR[0].setbuffer(bufcombR1,combtuningR1);
-	combL[1].setbuffer(bufcombL2,combtuningL2);
-	combR[1].setbuffer(bufcombR2,combtuningR2);
-	combL[2].setbuffer(bufcombL3,combtuningL3);
-	combR[2].setbuffer(bufcombR3,combtuningR3);
-	combL[3].setbuffer(bufcombL4,combtuningL4);
-	combR[3].setbuffer(bufcombR4,combtuningR4);
-	combL[4].setbuffer(bufcombL5,combtuningL5);
-	combR[4].setbuffer(bufcombR5,combtuningR5);
-	combL[5].setbuffer(bufcombL6,combtuningL6);
-	combR[5].setbuffer(bufcombR6,combtuningR6);
-	combL[6].setbuffer(bufcombL7,combtuningL7);
-	combR[6].setbuffer(bufcombR7,combtuningR7);
-	combL[7].setbuffer(bufcombL8,combtuningL8);
-	combR[7].setbuffer(bufcombR8,combtuningR8);
+      for (int i = 0; i < numcombs; i++) {
+            combL.setbuffer(i, bufcombL[i], tuningL[i]);
+            combR.setbuffer(i, bufcombR[i], tuningR[i]);
+            }
+      // Economy bank shares every second delay line of each channel.
+      for (int i = 0; i < economycombs; i++) {
+            combLR.setbuffer(i, bufcombL[i*2], tuningL[i*2]);
+            combLR.setbuffer(i + economycombs, bufcombR[i*2], tuningR[i*2]);
+            }
+      // Economy quality sums half as many combs per channel.
+      for (int i = 0; i < CombBank::lanes; i++)
+            combLR.setlanegain(i, float(numcombs) / float(economycombs));
+      for (int i = 0; i < 8; i++)
+            port[i] = 0;
 	allpassL[0].setbuffer(bufallpassL1,allpasstuningL1);
 	allpassR[0].setbuffer(bufallpassR1,allpasstuningR1);
 	allpassL[1].setbuffer(bufallpassL2,allpasstuningL2);
@@ -59,18 +70,27 @@ Revmodel::Revmodel()
       param[0] = initialroom;
       param[1] = initialdamp;
       param[2] = initialwet;
+      param[3] = initialquality;
 
+      quality = initialquality;
 	setroomsize(initialroom);
 	setdamp(initialdamp);
 	setwidth(initialwidth);
 	setmode(initialmode);
 
 	// Buffer will be full of rubbish - so we MUST mute them
+      mute();
+      }
 
-	for (int i = 0; i < numcombs; i++) {
-		combL[i].mute();
-		combR[i].mute();
-            }
+//---------------------------------------------------------
+//   mute
+//---------------------------------------------------------
+
+void Revmodel::mute()
+      {
+      combL.mute();
+      combR.mute();
+      combLR.mute();
 	for (int i=0;i<numallpasses;i++) {
 		allpassL[i].mute();
 		allpassR[i].mute();
@@ -86,13 +106,15 @@ void Revmodel::activate()
       *port[4] = param[0];
       *port[5] = param[1];
       *port[6] = param[2];
+      if (port[7])
+            *port[7] = param[3];
       }
 
 //---------------------------------------------------------
-//   processreplace
+//   checkParams
 //---------------------------------------------------------
 
-void Revmodel::processreplace(long n)
+void Revmodel::checkParams()
       {
       if (param[0] != *port[4]) {
             param[0] = *port[4];
@@ -102,72 +124,108 @@ void Revmodel::processreplace(long n)
             param[1] = *port[5];
             setdamp(param[1]);
             }
+      if (port[7] && param[3] != *port[7]) {
+            param[3] = *port[7];
+            setquality(param[3] >= 0.5f ? fullquality : economyquality);
+            }
+      }
+
+//---------------------------------------------------------
+//   processBlock
+//    Run the reverb tail for n <= blocksize samples.
+//    Result is left in blockL/blockR.
+//---------------------------------------------------------
+
+void Revmodel::processBlock(const float* inL, const float* inR, long n)
+      {
+      for (int i = 0; i < n; ++i)
+            blockIn[i] = (inL[i] + inR[i]) * gain;
+
+      // Accumulate comb filters in parallel
+      if (quality == economyquality)
+            combLR.process(blockIn, blockL, blockR, economycombs, n);
+      else {
+            combL.process(blockIn, blockL, 0, CombBank::lanes, n);
+            combR.process(blockIn, blockR, 0, CombBank::lanes, n);
+            }
+
+      // Feed through allpasses in series
+      for (int k = 0; k < numallpasses; k++) {
+            allpassL[k].processblock(blockL, n);
+            allpassR[k].processblock(blockR, n);
+            }
+      }
+
+//---------------------------------------------------------
+//   processreplace
+//---------------------------------------------------------
+
+void Revmodel::processreplace(long n)
+      {
+      DenormalGuard dg;
+      checkParams();
 
       float wet  = (1.0f - *port[6]) * scalewet;
       float dry  = *port[6] * scaledry;
 	float wet1 = wet * (width/2 + 0.5f);
 	float wet2 = wet * ((1-width)/2);
 
-	for (int i = 0; i < n; ++i) {
-		float outL  = 0;
-		float outR  = 0;
-		float input = (port[0][i] + port[1][i]) * gain;
-
-		// Accumulate comb filters in parallel
-		for (int k = 0; k < numcombs; k++) {
-			outL += combL[k].process(input);
-			outR += combR[k].process(input);
-		      }
-
-		// Feed through allpasses in series
-		for (int k=0; k < numallpasses; k++) {
-			outL = allpassL[k].process(outL);
-			outR = allpassR[k].process(outR);
-		      }
+      for (long pos = 0; pos < n; pos += blocksize) {
+            long m = n - pos;
+            if (m > blocksize)
+                  m = blocksize;
+            const float* inL = port[0] + pos;
+            const float* inR = port[1] + pos;
+            float* outL      = port[2] + pos;
+            float* outR      = port[3] + pos;
+            processBlock(inL, inR, m);
 
 		// Calculate output REPLACING anything already there
-		port[2][i] = outL*wet1 + outR*wet2 + port[0][i]*dry;
-		port[3][i] = outR*wet1 + outL*wet2 + port[1][i]*dry;
-	      }
+            for (long i = 0; i < m; ++i) {
+                  float l = blockL[i];
+                  float r = blockR[i];
+                  float dl = inL[i];
+                  float dr = inR[i];
+                  outL[i] = l*wet1 + r*wet2 + dl*dry;
+                  outR[i] = r*wet1 + l*wet2 + dr*dry;
+                  }
+            }
       }
 
+//---------------------------------------------------------
+//   processmix
+//---------------------------------------------------------
+
 void Revmodel::processmix(long n)
       {
-      if (param[0] != *port[4]) {
-            param[0] = *port[4];
-            setroomsize(param[0]);
-            }
-      if (param[1] != *port[5]) {
-            param[1] = *port[5];
-            setdamp(param[1]);
-            }
+      DenormalGuard dg;
+      checkParams();
 
       float wet  = (1.0f - *port[6]) * scalewet;
       float dry  = *port[6] * scaledry;
 	float wet1 = wet * (width/2 + 0.5f);
 	float wet2 = wet * ((1-width)/2);
 
-	for (int i = 0; i < n; ++i) {
-		float outL  = 0;
-		float outR  = 0;
-		float input = (port[0][i] + port[1][i]) * gain;
-
-		// Accumulate comb filters in parallel
-		for (int k = 0; k < numcombs; k++) {
-			outL += combL[k].process(input);
-			outR += combR[k].process(input);
-		      }
-
-		// Feed through allpasses in series
-		for (int k=0; k < numallpasses; k++) {
-			outL = allpassL[k].process(outL);
-			outR = allpassR[k].process(outR);
-		      }
-
-		// Calculate output REPLACING anything already there
-		port[2][i] += outL*wet1 + outR*wet2 + port[0][i]*dry;
-		port[3][i] += outR*wet1 + outL*wet2 + port[1][i]*dry;
-	      }
+      for (long pos = 0; pos < n; pos += blocksize) {
+            long m = n - pos;
+            if (m > blocksize)
+                  m = blocksize;
+            const float* inL = port[0] + pos;
+            const float* inR = port[1] + pos;
+            float* outL      = port[2] + pos;
+            float* outR      = port[3] + pos;
+            processBlock(inL, inR, m);
+
+		// Calculate output ADDING to anything already there
+            for (long i = 0; i < m; ++i) {
+                  float l = blockL[i];
+                  float r = blockR[i];
+                  float dl = inL[i];
+                  float dr = inR[i];
+                  outL[i] += l*wet1 + r*wet2 + dl*dry;
+                  outR[i] += r*wet1 + l*wet2 + dr*dry;
+                  }
+            }
       }
 
 //---------------------------------------------------------
@@ -188,15 +246,12 @@ void Revmodel::update()
 		gain      = fixedgain;
             }
 
-	for (int i = 0; i < numcombs; i++) {
-		combL[i].setfeedback(roomsize1);
-		combR[i].setfeedback(roomsize1);
-            }
-
-	for (int i = 0; i < numcombs; i++) {
-		combL[i].setdamp(damp1);
-		combR[i].setdamp(damp1);
-            }
+      combL.setfeedback(roomsize1);
+      combR.setfeedback(roomsize1);
+      combLR.setfeedback(roomsize1);
+      combL.setdamp(damp1);
+      combR.setdamp(damp1);
+      combLR.setdamp(damp1);
       }
 
 // The following get/set functions are not inlined, because
@@ -237,3 +292,17 @@ float Revmodel::getmode()
       {
 	return (mode >= freezemode) ? 1 : 0;
       }
+
+//---------------------------------------------------------
+//   setquality
+//    Switching clears the reverb tail, the banks share
+//    their delay lines.
+//---------------------------------------------------------
+
+void Revmodel::setquality(int value)
+      {
+      if (value == quality)
+            return;
+      quality = value;
+      mute();
+      }
@@ -14,13 +14,16 @@
 #ifndef _revmodel_
 #define _revmodel_
 
-#include "comb.h"
+#include "combbank.h"
 #include "allpass.h"
 #include "tuning.h"
 #include <ladspa.h>
 
 //---------------------------------------------------------
 //   Revmodel
+//    The parallel comb filters of one channel are run as
+//    one CombBank (one comb per vector lane). In economy
+//    quality a single bank holds four combs of each channel.
 //---------------------------------------------------------
 
 class Revmodel {
@@ -29,10 +32,12 @@ class Revmodel {
       float	damp,damp1;
       float	width;
       float	mode;
+      int   quality;
 
       // Comb filters
-      comb combL[numcombs];
-      comb combR[numcombs];
+      CombBank combL;
+      CombBank combR;
+      CombBank combLR;        // economy quality, lanes 0-3 left, 4-7 right
 
       // Allpass filters
       allpass allpassL[numallpasses];
@@ -65,11 +70,20 @@ class Revmodel {
       float	bufallpassR3[allpasstuningR3];
       float	bufallpassL4[allpasstuningL4];
       float	bufallpassR4[allpasstuningR4];
+
+      // Block scratch buffers
+      float blockIn[blocksize];
+      float blockL[blocksize];
+      float blockR[blocksize];
+
       void update();
+      void checkParams();
+      void processBlock(const float* inL, const float* inR, long n);
+      void mute();
 
    public:
-      LADSPA_Data* port[7];
-      float param[3];
+      LADSPA_Data* port[8];
+      float param[4];
 
       Revmodel();
 	void	processmix(long numsamples);
@@ -80,6 +94,8 @@ class Revmodel {
 	void	setwidth(float value);
 	void	setmode(float value);
 	float	getmode();
+      void  setquality(int value);
+      int   getquality() const { return quality; }
       void activate();
       };
 
@@ -32,6 +32,16 @@ const float initialmode		= 0;
 const float freezemode		= 0.5f;
 const int	stereospread	= 23;
 
+// Samples processed per internal block.
+const int	blocksize		= 256;
+
+// Quality settings. Economy runs four combs per channel
+// in a single comb bank.
+const int	economyquality	= 0;
+const int	fullquality		= 1;
+const int	initialquality	= fullquality;
+const int	economycombs	= 4;
+
 // These values assume 44.1KHz sample rate
 // they will probably be OK for 48KHz sample rate
 // but would need scaling for 96KHz (or other) sample rates.